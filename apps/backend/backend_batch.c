@@ -0,0 +1,445 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+ 
+  Copyright (C) 2020-2021 Olof Hagsand and Rubicon Communications, LLC (Netgate)
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2, 
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+ * Group commit of autocommit edits
+ *
+ * If CLICON_AUTOCOMMIT_BATCH is set, an autocommit edit-config of candidate is applied to
+ * candidate but not committed. Its reply is deferred, and the edit is added to a batch.
+ * Edits arriving within the batch window are added to the same batch, and then all are
+ * committed in one transaction, ie one round of plugin callbacks and one datastore write.
+ * Any other request flushes the batch before it is handled, so that it sees the
+ * datastores as if each edit had been committed directly.
+ * If the transaction fails, the edits are applied and committed one by one from running,
+ * so that the failing edit gets its own error, and the others are committed.
+ * The window only pays off with concurrent clients: restconf sends one request at a time
+ * and waits for its reply, so its edits are only delayed.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "clixon_config.h" /* generated by config & autoconf */
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <syslog.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+
+/* cligen */
+#include <cligen/cligen.h>
+
+/* clicon */
+#include <clixon/clixon.h>
+
+#include "clixon_backend_commit.h"
+#include "backend_client.h"
+#include "backend_batch.h"
+
+/* Autocommit edit pending in a batch
+ * Edits are kept in order of arrival
+ */
+struct batch_edit{
+    qelem_t              be_qelem;    /* List of pending edits */
+    struct client_entry *be_ce;       /* Client to reply to, NULL if it has closed */
+    cxobj               *be_xc;       /* Copy of edit-config <config>, for replay */
+    enum operation_type  be_op;       /* Default operation of edit */
+    char                *be_username; /* NACM user of edit, or NULL */
+    char                *be_peername; /* Peer user of client, or NULL */
+    char                *be_existed;  /* objectexisted attribute of reply, or NULL */
+};
+
+/* Pending edits of batch */
+static struct batch_edit *_batch = NULL;
+
+/* Batch window timeout registered */
+static int _batch_timer = 0;
+
+/*! Free a batch edit
+ */
+static int
+batch_edit_free(struct batch_edit *be)
+{
+    if (be->be_xc)
+	xml_free(be->be_xc);
+    if (be->be_username)
+	free(be->be_username);
+    if (be->be_peername)
+	free(be->be_peername);
+    if (be->be_existed)
+	free(be->be_existed);
+    free(be);
+    return 0;
+}
+
+/*! Batch window has expired: commit pending edits
+ */
+static int
+batch_timeout_cb(int   fd,
+		 void *arg)
+{
+    clicon_handle h = (clicon_handle)arg;
+
+    _batch_timer = 0;
+    return backend_batch_flush(h);
+}
+
+/*! Send reply of an edit to its client
+ * @param[in]  be     Batch edit
+ * @param[in]  cbret  Reply
+ * @retval     0      OK, also if client has closed
+ * @retval    -1      Error
+ */
+static int
+batch_reply(struct batch_edit *be,
+	    cbuf              *cbret)
+{
+    if (be->be_ce == NULL || be->be_ce->ce_s == 0)
+	return 0;
+    if (ce_reply(be->be_ce, cbuf_get(cbret), cbuf_len(cbret)+1) < 0){
+	switch (errno){
+	case EPIPE:
+	case ECONNRESET:
+	    clicon_log(LOG_WARNING, "client rpc reset");
+	    break;
+	default:
+	    return -1;
+	}
+    }
+    return 0;
+}
+
+/*! Commit candidate to running, revert candidate on failure
+ * @param[in]  h      Clicon handle
+ * @param[out] cbret  Error reply if retval is 0
+ * @retval     1      OK
+ * @retval     0      Commit failed, cbret set
+ * @retval    -1      Error
+ * @see from_client_edit_config
+ */
+static int
+batch_commit(clicon_handle h,
+	     cbuf         *cbret)
+{
+    int ret;
+
+    cbuf_reset(cbret);
+    if ((ret = candidate_commit(h, "candidate", cbret)) < 0){ /* Assume validation fail, nofatal */
+	cbuf_reset(cbret);
+	if (netconf_operation_failed(cbret, "application", clicon_err_reason)< 0)
+	    return -1;
+    }
+    if (ret < 1){
+	if (xmldb_copy(h, "running", "candidate") < 0)
+	    clicon_log(LOG_WARNING, "%s: revert of candidate failed: %s",
+		       __FUNCTION__, clicon_err_reason);
+	return 0;
+    }
+    return 1;
+}
+
+/*! Make ok reply of an edit
+ */
+static int
+batch_ok(struct batch_edit *be,
+	 cbuf              *cbret)
+{
+    cbuf_reset(cbret);
+    cprintf(cbret, "<rpc-reply xmlns=\"%s\"><ok", NETCONF_BASE_NAMESPACE);
+    if (be->be_existed)
+	cprintf(cbret, " objectexisted=\"%s\"", be->be_existed);
+    cprintf(cbret, "/></rpc-reply>");
+    return 0;
+}
+
+/*! Apply and commit a single edit from running, as if it was not batched
+ * NACM write access is checked again, since candidate differs from when the edit arrived.
+ * @param[in]  h      Clicon handle
+ * @param[in]  be     Batch edit
+ * @param[out] cbret  Reply of edit
+ * @retval     0      OK, cbret is ok or error reply
+ * @retval    -1      Error
+ */
+static int
+batch_replay(clicon_handle      h,
+	     struct batch_edit *be,
+	     cbuf              *cbret)
+{
+    int    retval = -1;
+    cxobj *xnacm = NULL;
+    int    ret;
+
+    cbuf_reset(cbret);
+    if (clicon_username_set(h, be->be_username) < 0)
+	goto done;
+    if ((ret = nacm_access_pre(h, be->be_peername, be->be_username, &xnacm)) < 0)
+	goto done;
+    if (clicon_nacm_cache_set(h, ret==0?xnacm:NULL) < 0)
+	goto done;
+    ret = xmldb_put(h, "candidate", be->be_op, be->be_xc, be->be_username, cbret);
+    if (clicon_nacm_cache_set(h, NULL) < 0)
+	goto done;
+    if (ret < 0){
+	cbuf_reset(cbret);
+	if (netconf_operation_failed(cbret, "protocol", clicon_err_reason)< 0)
+	    goto done;
+    }
+    if (ret < 1){
+	if (xmldb_copy(h, "running", "candidate") < 0)
+	    clicon_log(LOG_WARNING, "%s: revert of candidate failed: %s",
+		       __FUNCTION__, clicon_err_reason);
+	goto ok;
+    }
+    xmldb_modified_set(h, "candidate", 1); /* mark as dirty */
+    if ((ret = batch_commit(h, cbret)) < 0)
+	goto done;
+    if (ret == 1)
+	batch_ok(be, cbret);
+ ok:
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Check if a request is an edit-config that should be batched
+ * @param[in]  h   Clicon handle
+ * @param[in]  xe  Request, eg <edit-config>
+ * @retval     1   Autocommit edit of candidate, and batching is enabled
+ * @retval     0   No
+ */
+int
+backend_batch_edit(clicon_handle h,
+		   cxobj        *xe)
+{
+    char *target;
+    char *attr;
+
+    if (clicon_option_int(h, "CLICON_AUTOCOMMIT_BATCH") <= 0)
+	return 0;
+    if (strcmp(xml_name(xe), "edit-config") != 0)
+	return 0;
+    if ((target = netconf_db_find(xe, "target")) == NULL ||
+	strcmp(target, "candidate") != 0)
+	return 0;
+    if (!clicon_autocommit(h) &&
+	((attr = xml_find_value(xe, "autocommit")) == NULL || strcmp(attr, "true") != 0))
+	return 0;
+    if ((attr = xml_find_value(xe, "copystartup")) != NULL && strcmp(attr, "true") == 0)
+	return 0;
+    if (xmldb_islocked(h, "candidate"))
+	return 0;
+    return 1;
+}
+
+/*! Add an edit applied to candidate to the batch, its reply is sent when committed
+ * @param[in]  h        Clicon handle
+ * @param[in]  ce       Client entry of edit
+ * @param[in]  xc       Copy of edit-config <config>, consumed
+ * @param[in]  op       Default operation of edit
+ * @param[in]  username NACM user of edit, or NULL
+ * @param[in]  existed  objectexisted attribute of reply, or NULL
+ * @retval     0        OK
+ * @retval    -1        Error
+ */
+int
+backend_batch_add(clicon_handle        h,
+		  struct client_entry *ce,
+		  cxobj               *xc,
+		  enum operation_type  op,
+		  char                *username,
+		  char                *existed)
+{
+    int                retval = -1;
+    struct batch_edit *be = NULL;
+    struct timeval     t;
+    struct timeval     t1;
+    int                ms;
+
+    if ((be = malloc(sizeof(*be))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	goto done;
+    }
+    memset(be, 0, sizeof(*be));
+    be->be_ce = ce;
+    be->be_xc = xc;
+    xc = NULL;
+    be->be_op = op;
+    if ((username && (be->be_username = strdup(username)) == NULL) ||
+	(ce->ce_username && (be->be_peername = strdup(ce->ce_username)) == NULL) ||
+	(existed && (be->be_existed = strdup(existed)) == NULL)){
+	clicon_err(OE_UNIX, errno, "strdup");
+	goto done;
+    }
+    ADDQ(be, _batch);
+    be = NULL;
+    if (!_batch_timer){
+	ms = clicon_option_int(h, "CLICON_AUTOCOMMIT_BATCH");
+	gettimeofday(&t, NULL);
+	t1.tv_sec = ms/1000;
+	t1.tv_usec = (ms%1000)*1000;
+	timeradd(&t, &t1, &t);
+	if (clixon_event_reg_timeout(t, batch_timeout_cb, h, "autocommit batch") < 0)
+	    goto done;
+	_batch_timer = 1;
+    }
+    retval = 0;
+ done:
+    if (xc)
+	xml_free(xc);
+    if (be)
+	batch_edit_free(be);
+    return retval;
+}
+
+/*! Commit pending edits in one transaction, and reply to their clients
+ * If the transaction fails and there are several edits, they are committed one by one.
+ * @param[in]  h   Clicon handle
+ * @retval     0   OK
+ * @retval    -1   Error
+ */
+int
+backend_batch_flush(clicon_handle h)
+{
+    int                retval = -1;
+    struct batch_edit *batch;
+    struct batch_edit *be;
+    cbuf              *cbret = NULL;
+    char              *username = NULL;
+    int                n = 0;
+    int                ret;
+
+    if ((batch = _batch) == NULL)
+	return 0;
+    _batch = NULL;
+    if (_batch_timer){
+	clixon_event_unreg_timeout(batch_timeout_cb, h);
+	_batch_timer = 0;
+    }
+    be = batch;
+    do {
+	n++;
+	be = NEXTQ(struct batch_edit *, be);
+    } while (be != batch);
+    clicon_debug(1, "%s edits:%d", __FUNCTION__, n);
+    if ((cbret = cbuf_new()) == NULL){
+	clicon_err(OE_UNIX, errno, "cbuf_new");
+	goto done;
+    }
+    /* Replay may change the user of the handle, restore it after */
+    if (clicon_username_get(h) && (username = strdup(clicon_username_get(h))) == NULL){
+	clicon_err(OE_UNIX, errno, "strdup");
+	goto done;
+    }
+    if ((ret = batch_commit(h, cbret)) < 0)
+	goto done;
+    if (ret == 0 && n > 1){
+	/* Isolate the failing edit(s): commit the edits one by one */
+	clicon_log(LOG_NOTICE, "%s: commit of %d edits failed, committing them one by one",
+		   __FUNCTION__, n);
+	be = batch;
+	do {
+	    if (batch_replay(h, be, cbret) < 0)
+		goto done;
+	    if (backend_datastore_notify(h) < 0)
+		goto done;
+	    if (batch_reply(be, cbret) < 0)
+		goto done;
+	    be = NEXTQ(struct batch_edit *, be);
+	} while (be != batch);
+	if (clicon_username_set(h, username) < 0)
+	    goto done;
+    }
+    else {
+	if (backend_datastore_notify(h) < 0)
+	    goto done;
+	be = batch;
+	do {
+	    if (ret == 1)
+		batch_ok(be, cbret);
+	    if (batch_reply(be, cbret) < 0)
+		goto done;
+	    be = NEXTQ(struct batch_edit *, be);
+	} while (be != batch);
+    }
+    retval = 0;
+ done:
+    while ((be = batch) != NULL) {
+	DELQ(be, batch, struct batch_edit *);
+	batch_edit_free(be);
+    }
+    if (username)
+	free(username);
+    if (cbret)
+	cbuf_free(cbret);
+    return retval;
+}
+
+/*! Client has closed, its pending edits are committed but not replied to
+ * @param[in]  h   Clicon handle
+ * @param[in]  ce  Client entry
+ */
+int
+backend_batch_client_rm(clicon_handle        h,
+			struct client_entry *ce)
+{
+    struct batch_edit *be;
+
+    if ((be = _batch) != NULL)
+	do {
+	    if (be->be_ce == ce)
+		be->be_ce = NULL;
+	    be = NEXTQ(struct batch_edit *, be);
+	} while (be != _batch);
+    return 0;
+}
+
+/*! Free pending edits without committing them, eg on exit
+ * @param[in]  h   Clicon handle
+ */
+int
+backend_batch_exit(clicon_handle h)
+{
+    struct batch_edit *be;
+
+    if (_batch_timer){
+	clixon_event_unreg_timeout(batch_timeout_cb, h);
+	_batch_timer = 0;
+    }
+    while ((be = _batch) != NULL) {
+	DELQ(be, _batch, struct batch_edit *);
+	batch_edit_free(be);
+    }
+    return 0;
+}
@@ -53,6 +53,7 @@
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/param.h>
 #include <sys/types.h>
 #include <netinet/in.h>
@@ -71,6 +72,8 @@
 #include "clixon_backend_commit.h"
 #include "backend_client.h"
 #include "backend_handle.h"
+#include "backend_push.h"
+#include "backend_batch.h"
 
 /*! Find client by session-id 
  * @param[in] ce_list   List of clients
@@ -88,10 +91,286 @@ ce_find_byid(struct client_entry *ce_list,
     return NULL;
 }
 
+/* Flags of non-blocking writes to clients */
+#ifdef MSG_NOSIGNAL
+#define CE_SEND_FLAGS (MSG_DONTWAIT|MSG_NOSIGNAL)
+#else
+#define CE_SEND_FLAGS MSG_DONTWAIT
+#endif
+
+/* Queued output message to a client, written when the client socket is writable
+ * Replies are queued after notifications if there are queued notifications
+ */
+struct ce_msg{
+    qelem_t            cm_q;     /* queue header */
+    struct clicon_msg *cm_msg;   /* Message */
+    size_t             cm_off;   /* Bytes of message already written */
+    char              *cm_event; /* Name of event if notification, NULL if reply */
+};
+
+static int ce_output_cb(int s, void *arg);
+
+/*! Free queued message
+ */
+static int
+ce_msg_free(struct ce_msg *cm)
+{
+    if (cm->cm_msg)
+	free(cm->cm_msg);
+    if (cm->cm_event)
+	free(cm->cm_event);
+    free(cm);
+    return 0;
+}
+
+/*! Remove queued message from client output queue and free it
+ */
+static int
+ce_outq_rm(struct client_entry *ce,
+	   struct ce_msg       *cm)
+{
+    DELQ(cm, ce->ce_outq, struct ce_msg *);
+    if (cm->cm_event)
+	ce->ce_outq_nr--;
+    return ce_msg_free(cm);
+}
+
+/*! Free client output queue
+ */
+static int
+ce_outq_free(struct client_entry *ce)
+{
+    struct ce_msg *cm;
+
+    while ((cm = ce->ce_outq) != NULL)
+	ce_outq_rm(ce, cm);
+    return 0;
+}
+
+/*! Close output to client, the client is removed when its socket is read
+ * @param[in]  ce   Client entry
+ * @param[in]  reason Log message
+ */
+static int
+ce_out_close(struct client_entry *ce,
+	     char                *reason)
+{
+    clicon_log(LOG_WARNING, "client %d %s", ce->ce_nr, reason);
+    if (ce->ce_outq){
+	clixon_event_unreg_fd_write(ce->ce_s, ce_output_cb);
+	ce_outq_free(ce);
+    }
+    ce->ce_out_closed = 1;
+    shutdown(ce->ce_s, SHUT_RDWR);
+    return 0;
+}
+
+/*! Client socket is writable, write queued messages
+ * @param[in]  s    Client socket
+ * @param[in]  arg  Client entry
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+ce_output_cb(int   s,
+	     void *arg)
+{
+    struct client_entry *ce = (struct client_entry *)arg;
+    struct ce_msg       *cm;
+    size_t               len;
+    ssize_t              n;
+
+    while ((cm = ce->ce_outq) != NULL){
+	len = ntohl(cm->cm_msg->op_len);
+	if ((n = send(s, (char*)cm->cm_msg + cm->cm_off, len - cm->cm_off, CE_SEND_FLAGS)) < 0){
+	    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+		return 0;
+	    return ce_out_close(ce, "reset");
+	}
+	cm->cm_off += n;
+	if (cm->cm_off < len)
+	    return 0;
+	ce_outq_rm(ce, cm);
+    }
+    clixon_event_unreg_fd_write(s, ce_output_cb);
+    return 0;
+}
+
+/*! Append message to client output queue
+ * @param[in]  ce    Client entry
+ * @param[in]  msg   Message, consumed
+ * @param[in]  off   Bytes of message already written
+ * @param[in]  event Name of event if notification, NULL if reply
+ */
+static int
+ce_outq_add(struct client_entry *ce,
+	    struct clicon_msg   *msg,
+	    size_t               off,
+	    char                *event)
+{
+    int            retval = -1;
+    struct ce_msg *cm;
+
+    if ((cm = malloc(sizeof(*cm))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	free(msg);
+	goto done;
+    }
+    memset(cm, 0, sizeof(*cm));
+    cm->cm_msg = msg;
+    cm->cm_off = off;
+    if (event){
+	if ((cm->cm_event = strdup(event)) == NULL){
+	    clicon_err(OE_UNIX, errno, "strdup");
+	    ce_msg_free(cm);
+	    goto done;
+	}
+	ce->ce_outq_nr++;
+    }
+    if (ce->ce_outq == NULL &&
+	clixon_event_reg_fd_write(ce->ce_s, ce_output_cb, ce, "client output") < 0){
+	ce_msg_free(cm);
+	goto done;
+    }
+    ADDQ(cm, ce->ce_outq);
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Make room in full client output queue according to CLICON_STREAM_QUEUE_POLICY
+ * Only notifications not yet partly written are dropped.
+ * @param[in]  h     Clicon handle
+ * @param[in]  ce    Client entry
+ * @param[in]  event Name of new event
+ * @retval     1     OK, room made
+ * @retval     0     Client disconnected
+ */
+static int
+ce_outq_drop(clicon_handle        h,
+	     struct client_entry *ce,
+	     char                *event)
+{
+    char          *policy;
+    struct ce_msg *cm;
+    struct ce_msg *cmold = NULL;
+
+    policy = clicon_option_str(h, "CLICON_STREAM_QUEUE_POLICY");
+    if (policy && strcmp(policy, "disconnect") == 0){
+	ce_out_close(ce, "notification queue full, disconnected");
+	return 0;
+    }
+    if ((cm = ce->ce_outq) != NULL)
+	do {
+	    if (cm->cm_event && cm->cm_off == 0){
+		if (cmold == NULL)
+		    cmold = cm;
+		if (policy == NULL || strcmp(policy, "coalesce") != 0)
+		    break;
+		if (strcmp(cm->cm_event, event) == 0){
+		    cmold = cm;
+		    break;
+		}
+	    }
+	    cm = NEXTQ(struct ce_msg *, cm);
+	} while (cm && cm != ce->ce_outq);
+    if (cmold){
+	ce_outq_rm(ce, cmold);
+	ce->ce_dropped++;
+    }
+    return 1;
+}
+
+/*! Send notification to client without blocking, queue it if the client is not reading
+ * @param[in]  h     Clicon handle
+ * @param[in]  ce    Client entry
+ * @param[in]  event Name of event, queued notifications of same name are coalesced
+ * @param[in]  evstr Event encoded as XML string
+ * @retval     0     OK, written, queued, dropped or client disconnected
+ * @retval    -1     Error
+ * @see CLICON_STREAM_QUEUE_POLICY
+ */
+int
+ce_notify(clicon_handle        h,
+	  struct client_entry *ce,
+	  char                *event,
+	  char                *evstr)
+{
+    int                retval = -1;
+    struct clicon_msg  hdr;
+    struct clicon_msg *msg;
+    struct iovec       iov[2];
+    struct msghdr      mh = {0,};
+    size_t             len;
+    ssize_t            n = 0;
+    uint32_t           max;
+    
+    if (ce->ce_out_closed)
+	goto ok;
+    len = sizeof(hdr) + strlen(evstr) + 1;
+    if (ce->ce_outq == NULL){
+	/* Write directly, encoded event is not copied */
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.op_len = htonl(len);
+	iov[0].iov_base = &hdr;
+	iov[0].iov_len = sizeof(hdr);
+	iov[1].iov_base = evstr;
+	iov[1].iov_len = strlen(evstr) + 1;
+	mh.msg_iov = iov;
+	mh.msg_iovlen = 2;
+	if ((n = sendmsg(ce->ce_s, &mh, CE_SEND_FLAGS)) < 0){
+	    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR){
+		ce_out_close(ce, "reset");
+		goto ok;
+	    }
+	    n = 0;
+	}
+	if (n == len)
+	    goto ok;
+    }
+    else {
+	max = clicon_option_int(h, "CLICON_STREAM_QUEUE_MAX");
+	if (max && ce->ce_outq_nr >= max &&
+	    ce_outq_drop(h, ce, event) == 0)
+	    goto ok;
+    }
+    if ((msg = clicon_msg_encode(0, "%s", evstr)) == NULL)
+	goto done;
+    if (ce_outq_add(ce, msg, n, event) < 0)
+	goto done;
+ ok:
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Send reply to client, after any queued notifications
+ * @param[in]  ce    Client entry
+ * @param[in]  data  Reply as XML string
+ * @param[in]  len   Length of data including NULL
+ * @retval     0     OK
+ * @retval    -1     Error
+ * @see send_msg_reply
+ */
+int
+ce_reply(struct client_entry *ce,
+	 char                *data,
+	 uint32_t             len)
+{
+    struct clicon_msg *msg;
+
+    if (ce->ce_outq == NULL)
+	return send_msg_reply(ce->ce_s, data, len);
+    if ((msg = clicon_msg_encode(0, "%s", data)) == NULL)
+	return -1;
+    return ce_outq_add(ce, msg, 0, NULL);
+}
+
 /*! Stream callback for netconf stream notification (RFC 5277)
  * @param[in]  h     Clicon handle
  * @param[in]  op    0:event, 1:rm
  * @param[in]  event Event as XML
+ * @param[in]  evstr Event encoded as XML string
  * @param[in]  arg   Extra argument provided in stream_ss_add
  * @see stream_ss_add
  */
@@ -99,9 +378,12 @@ int
 ce_event_cb(clicon_handle h,
 	    int           op,
 	    cxobj        *event,
+	    char         *evstr,
 	    void         *arg)
 {
     struct client_entry *ce = (struct client_entry *)arg;
+    cxobj               *x = NULL;
+    char                *name = "";
     
     clicon_debug(1, "%s op:%d", __FUNCTION__, op);
     switch (op){
@@ -111,12 +393,15 @@ ce_event_cb(clicon_handle h,
 	    backend_client_rm(h, ce);
 	break;
     default:
-	if (send_msg_notify_xml(h, ce->ce_s, event) < 0){
-	    if (errno == ECONNRESET || errno == EPIPE){
-		clicon_log(LOG_WARNING, "client %d reset", ce->ce_nr);
+	/* Event name is name of first element after eventTime */
+	while ((x = xml_child_each(event, x, CX_ELMNT)) != NULL)
+	    if (strcmp(xml_name(x), "eventTime") != 0){
+		name = xml_name(x);
+		break;
 	    }
-	    break;
-	}
+	if (ce_notify(h, ce, name, evstr) < 0)
+	    return -1;
+	break;
     }
     return 0;
 }
@@ -139,10 +424,18 @@ backend_client_rm(clicon_handle        h,
     clicon_debug(1, "%s", __FUNCTION__);
     /* for all streams: XXX better to do it top-level? */
     stream_ss_delete_all(h, ce_event_cb, (void*)ce);
+    /* Yang-push subscriptions */
+    backend_push_client_rm(h, ce);
+    /* Pending batched edits are not replied to */
+    backend_batch_client_rm(h, ce);
     c0 = backend_client_list(h);
     ce_prev = &c0; /* this points to stack and is not real backpointer */
     for (c = *ce_prev; c; c = c->ce_next){
 	if (c == ce){
+	    if (ce->ce_outq){
+		clixon_event_unreg_fd_write(ce->ce_s, ce_output_cb);
+		ce_outq_free(ce);
+	    }
 	    if (ce->ce_s){
 		clixon_event_unreg_fd(ce->ce_s, from_client);
 		close(ce->ce_s);
@@ -186,6 +479,8 @@ client_get_capabilities(clicon_handle h,
     cprintf(cb, "<capabilities>");
     cprintf(cb, "<capability>urn:ietf:params:restconf:capability:defaults:1.0?basic-mode=explicit</capability>");
     cprintf(cb, "<capability>urn:ietf:params:restconf:capability:depth:1.0</capability>");
+    cprintf(cb, "<capability>urn:ietf:params:restconf:capability:fields:1.0</capability>");
+    cprintf(cb, "<capability>urn:ietf:params:restconf:capability:yang-patch:1.0</capability>");
     cprintf(cb, "</capabilities>");
     if (clixon_xml_parse_string(cbuf_get(cb), YB_PARENT, NULL, &xrstate, NULL) < 0)
 	goto done;
@@ -258,6 +553,79 @@ client_get_streams(clicon_handle   h,
     goto done;
 }
 
+/*! Get notification subscriber state: streams, output queue depth and drops
+ * @param[in]     h       Clicon handle
+ * @param[in]     yspec   Yang spec
+ * @param[in,out] xret    Existing XML tree, merge x into this
+ * @retval       -1       Error (fatal)
+ * @retval        0       Statedata callback failed
+ * @retval        1       OK
+ * @see CLICON_STREAM_SUBSCRIPTION_STATE
+ */
+static int
+client_get_subscriptions(clicon_handle h,
+			 yang_stmt    *yspec,
+			 cxobj       **xret)
+{
+    int                  retval = -1;
+    struct client_entry *ce;
+    event_stream_t      *es;
+    cxobj               *x = NULL;
+    cbuf                *cb = NULL;
+    cbuf                *cbs = NULL;
+    int                  nr = 0;
+    int                  ret;
+
+    if ((cb = cbuf_new()) == NULL ||
+	(cbs = cbuf_new()) == NULL){
+	clicon_err(OE_UNIX, errno, "cbuf_new");
+	goto done;
+    }
+    cprintf(cb, "<subscriptions xmlns=\"%s\">", CLIXON_LIB_NS);
+    for (ce = backend_client_list(h); ce; ce = ce->ce_next){
+	cbuf_reset(cbs);
+	if ((es = clicon_stream(h)) != NULL){
+	    do {
+		if (stream_ss_find(es, ce_event_cb, (void*)ce) != NULL)
+		    cprintf(cbs, "<stream>%s</stream>", es->es_name);
+		es = NEXTQ(struct event_stream *, es);
+	    } while (es && es != clicon_stream(h));
+	}
+	if (cbuf_len(cbs) == 0)
+	    continue;
+	cprintf(cb, "<subscription><client>%d</client>%s", ce->ce_nr, cbuf_get(cbs));
+	cprintf(cb, "<queue-depth>%d</queue-depth>", ce->ce_outq_nr);
+	cprintf(cb, "<dropped>%" PRIu64 "</dropped>", ce->ce_dropped);
+	cprintf(cb, "</subscription>");
+	nr++;
+    }
+    cprintf(cb, "</subscriptions>");
+    if (nr == 0)
+	goto ok;
+    if (clixon_xml_parse_string(cbuf_get(cb), YB_MODULE, yspec, &x, NULL) < 0){
+	if (xret && netconf_operation_failed_xml(xret, "protocol", clicon_err_reason)< 0)
+	    goto done;
+	goto fail;
+    }
+    if ((ret = netconf_trymerge(x, yspec, xret)) < 0)
+	goto done;
+    if (ret == 0)
+	goto fail;
+ ok:
+    retval = 1;
+ done:
+    if (cb)
+	cbuf_free(cb);
+    if (cbs)
+	cbuf_free(cbs);
+    if (x)
+	xml_free(x);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
 /*! Get clixon per datastore stats
  * @param[in]     h       Clicon handle
  * @param[in]     dbname  Datastore name
@@ -369,6 +737,12 @@ client_statedata(clicon_handle h,
 	if ((ret = client_get_capabilities(h, yspec, xpath, xret)) < 0)
 	    goto done;
     }
+    if (clicon_option_bool(h, "CLICON_STREAM_SUBSCRIPTION_STATE")){
+	if ((ret = client_get_subscriptions(h, yspec, xret)) < 0)
+	    goto done;
+	if (ret == 0)
+	    goto fail;
+    }
     if (clicon_option_bool(h, "CLICON_MODULE_LIBRARY_RFC7895")){
 	if ((ret = yang_modules_state_get(h, yspec, xpath, nsc, 0, xret)) < 0)
 	    goto done;
@@ -391,6 +765,78 @@ client_statedata(clicon_handle h,
     goto done;
 }
 
+/*! Get list pagination attributes of a get or get-config request
+ * Clixon extension: offset, limit and direction (forwards or backwards) attributes
+ * As in draft-ietf-netconf-list-pagination, limit may be "unbounded", same as no limit
+ * @param[in]  xe      Request: <get> or <get-config>
+ * @param[in]  page    Page structure to fill in
+ * @param[out] pagep   Set to page if any pagination attribute is given, else NULL
+ * @param[out] cbret   Netconf error message if invalid
+ * @retval     1       OK
+ * @retval     0       Invalid attribute, netconf error in cbret
+ * @retval    -1       Error
+ */
+static int
+client_get_page(cxobj         *xe,
+		netconf_page  *page,
+		netconf_page **pagep,
+		cbuf          *cbret)
+{
+    int   retval = -1;
+    char *attr;
+    char *reason = NULL;
+    int   ret;
+
+    memset(page, 0, sizeof(*page));
+    *pagep = NULL;
+    if ((attr = xml_find_value(xe, "offset")) != NULL){
+	if ((ret = parse_uint32(attr, &page->np_offset, &reason)) < 0){
+	    clicon_err(OE_XML, errno, "parse_uint32");
+	    goto done;
+	}
+	if (ret == 0){
+	    if (netconf_bad_attribute(cbret, "application",
+				      "offset", "Unrecognized value of offset attribute") < 0)
+		goto done;
+	    goto fail;
+	}
+	*pagep = page;
+    }
+    if ((attr = xml_find_value(xe, "limit")) != NULL &&
+	strcmp(attr, "unbounded") != 0){
+	if ((ret = parse_uint32(attr, &page->np_limit, &reason)) < 0){
+	    clicon_err(OE_XML, errno, "parse_uint32");
+	    goto done;
+	}
+	if (ret == 0 || page->np_limit == 0){
+	    if (netconf_bad_attribute(cbret, "application",
+				      "limit", "Unrecognized value of limit attribute") < 0)
+		goto done;
+	    goto fail;
+	}
+	*pagep = page;
+    }
+    if ((attr = xml_find_value(xe, "direction")) != NULL){
+	if (strcmp(attr, "backwards") == 0)
+	    page->np_reverse = 1;
+	else if (strcmp(attr, "forwards") != 0){
+	    if (netconf_bad_attribute(cbret, "application",
+				      "direction", "Unrecognized value of direction attribute") < 0)
+		goto done;
+	    goto fail;
+	}
+	*pagep = page;
+    }
+    retval = 1;
+ done:
+    if (reason)
+	free(reason);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
 /*! Retrieve all or part of a specified configuration.
  * 
  * Function reused from both from_client_get() and from_client_get_config
@@ -399,7 +845,9 @@ client_statedata(clicon_handle h,
  * @param[in]  xpath
  * @param[in]  username
  * @param[in]  content
- * @param[in]  depth
+ * @param[in]  depth   Nr of levels to print, -1 is all. Applied when serializing the
+ *                     reply, the selected subtree is copied from the datastore in full
+ * @param[in]  page    List pagination, or NULL
  * @param[out] cbret   Return xml tree, eg <rpc-reply>..., <rpc-error.. 
  * @retval     0       OK
  * @retval    -1       Error
@@ -413,21 +861,28 @@ client_get_config_only(clicon_handle h,
 		       char         *xpath,
 		       char         *username,
 		       int32_t       depth,
+		       netconf_page *page,
 		       cbuf         *cbret)
 {
     int     retval = -1;
     cxobj  *xret = NULL;
     cxobj  *xnacm = NULL;
-    cxobj **xvec = NULL;
     cxobj  *xerr = NULL;
-    size_t  xlen;    
     int     ret;
 
     /* Note xret can be pruned by nacm below (and change name),
      * so zero-copy cant be used
      * Also, must use external namespace context here due to <filter stmt
+     * With NACM, read access is applied while copying from the datastore
      */
-    if ((ret = xmldb_get0(h, db, YB_MODULE, nsc, xpath, 1, &xret, NULL, &xerr)) < 0) {
+    xnacm = clicon_nacm_cache(h);
+    if (xnacm != NULL)
+	ret = nacm_datanode_read_get(h, db, nsc, xpath, page, username, xnacm, &xret, &xerr);
+    else if (page)
+	ret = xmldb_get0_page(h, db, YB_MODULE, nsc, xpath, page, &xret, &xerr);
+    else
+	ret = xmldb_get0(h, db, YB_MODULE, nsc, xpath, 1, &xret, NULL, &xerr);
+    if (ret < 0) {
 	if (netconf_operation_failed(cbret, "application", "read registry")< 0)
 	    goto done;
 	goto ok;
@@ -437,15 +892,6 @@ client_get_config_only(clicon_handle h,
 	    goto done;
 	goto ok;
     }
-    /* Pre-NACM access step */
-    xnacm = clicon_nacm_cache(h);
-    if (xnacm != NULL){ /* Do NACM validation */
-	if (xpath_vec(xret, nsc, "%s", &xvec, &xlen, xpath?xpath:"/") < 0)
-	    goto done;
-	/* NACM datanode/module read validation */
-	if (nacm_datanode_read(h, xret, xvec, xlen, username, xnacm) < 0) 
-	    goto done;
-    }
     cprintf(cbret, "<rpc-reply xmlns=\"%s\">", NETCONF_BASE_NAMESPACE);
     if (xret==NULL)
 	cprintf(cbret, "<data/>");
@@ -461,8 +907,6 @@ client_get_config_only(clicon_handle h,
  done:
     if (xerr)
 	xml_free(xerr);
-    if (xvec)
-	free(xvec);
     if (xret)
 	xml_free(xret);
     return retval;
@@ -499,6 +943,8 @@ from_client_get_config(clicon_handle h,
     char      *attr;
     char      *xpath0;
     cvec      *nsc1 = NULL;
+    netconf_page  page0;
+    netconf_page *page = NULL;
     
     username = clicon_username_get(h);
     if ((yspec =  clicon_dbspec_yang(h)) == NULL){
@@ -550,7 +996,12 @@ from_client_get_config(clicon_handle h,
 	    goto ok;
 	}
     }
-    if ((ret = client_get_config_only(h, nsc, yspec, db, xpath, username, -1, cbret)) < 0)
+    /* Clixon extensions: list pagination */
+    if ((ret = client_get_page(xe, &page0, &page, cbret)) < 0)
+	goto done;
+    if (ret == 0)
+	goto ok;
+    if ((ret = client_get_config_only(h, nsc, yspec, db, xpath, username, -1, page, cbret)) < 0)
 	goto done;
  ok:
     retval = 0;
@@ -600,6 +1051,7 @@ from_client_edit_config(clicon_handle h,
     char               *val = NULL;
     cvec               *nsc = NULL;
     char               *prefix = NULL;
+    cxobj              *xbatch = NULL;
 
     username = clicon_username_get(h);
     if ((yspec =  clicon_dbspec_yang(h)) == NULL){
@@ -695,6 +1147,9 @@ from_client_edit_config(clicon_handle h,
      */
     if (xml_sort_recurse(xc) < 0)
 	goto done;
+    /* Batched autocommit: keep a copy of the edit in case it needs to be replayed */
+    if (backend_batch_edit(h, xn) && (xbatch = xml_dup(xc)) == NULL)
+	goto done;
     if ((ret = xmldb_put(h, target, operation, xc, username, cbret)) < 0){
 	clicon_debug(1, "%s ERROR PUT", __FUNCTION__);	
 	if (netconf_operation_failed(cbret, "protocol", clicon_err_reason)< 0)
@@ -704,6 +1159,17 @@ from_client_edit_config(clicon_handle h,
     if (ret == 0)
 	goto ok;
     xmldb_modified_set(h, target, 1); /* mark as dirty */
+    if (xbatch){ /* Commit and reply later, see backend_batch_flush */
+	if (clicon_data_get(h, "objectexisted", &val) < 0)
+	    val = NULL;
+	if (backend_batch_add(h, ce, xbatch, operation, username, val) < 0){
+	    xbatch = NULL;
+	    goto done;
+	}
+	xbatch = NULL;
+	ce->ce_deferred = 1;
+	goto ok;
+    }
     /* Clixon extension: autocommit */
     if ((attr = xml_find_value(xn, "autocommit")) != NULL &&
 	strcmp(attr,"true")==0)
@@ -746,6 +1212,8 @@ from_client_edit_config(clicon_handle h,
 	cvec_free(nsc);
     if (xret)
 	xml_free(xret);
+    if (xbatch)
+	xml_free(xbatch);
     if (cbx)
 	cbuf_free(cbx);
     clicon_debug(1, "%s done cbret:%s", __FUNCTION__, cbuf_get(cbret));	
@@ -1077,6 +1545,8 @@ from_client_get(clicon_handle h,
     cxobj          *xerr = NULL;
     int             ret;
     char           *reason = NULL;
+    netconf_page    page0;
+    netconf_page   *page = NULL;
     
     clicon_debug(1, "%s", __FUNCTION__);
     username = clicon_username_get(h);
@@ -1118,8 +1588,13 @@ from_client_get(clicon_handle h,
 	    goto ok;
 	}
     }
+    /* Clixon extensions: list pagination */
+    if ((ret = client_get_page(xe, &page0, &page, cbret)) < 0)
+	goto done;
+    if (ret == 0)
+	goto ok;
     if (content == CONTENT_CONFIG){ /* config only, no state */
-	if (client_get_config_only(h, nsc, yspec, "running", xpath, username, depth, cbret) < 0)
+	if (client_get_config_only(h, nsc, yspec, "running", xpath, username, depth, page, cbret) < 0)
 	    goto done;
 	goto ok;
     }
@@ -1198,6 +1673,9 @@ from_client_get(clicon_handle h,
      * otherwise return complete tree.
      */
     if (xvec != NULL){
+	/* State data is merged, so a page is taken after the merge */
+	if (page && netconf_page_vec(xvec, &xlen, page) < 0)
+	    goto done;
 	for (i=0; i<xlen; i++)
 	    xml_flag_set(xvec[i], XML_FLAG_MARK);
     }
@@ -1648,6 +2126,30 @@ from_client_hello(clicon_handle       h,
     return retval;
 }
 
+/*! Notify subscribers of CLIXON_DATASTORE_STREAM if running has been written
+ *
+ * Called after each client message, before the reply is sent. A client that has
+ * received the reply of a change, can be sure that its notification has been sent.
+ * @param[in]  h   Clicon handle
+ * @retval     0   OK
+ * @retval    -1   Error
+ * @see CLICON_STREAM_DATASTORE
+ */
+int
+backend_datastore_notify(clicon_handle h)
+{
+    static uint64_t notified = 0; /* Last generation notified */
+    uint64_t        gen;
+
+    if ((gen = xmldb_generation_get(h, "running")) == notified)
+	return 0;
+    notified = gen;
+    return stream_notify(h, CLIXON_DATASTORE_STREAM,
+			 "<datastore-changed xmlns=\"%s\"><datastore>running</datastore>"
+			 "<generation>%" PRIu64 "</generation></datastore-changed>",
+			 CLIXON_LIB_NS, gen);
+}
+
 /*! An internal clicon message has arrived from a client. Receive and dispatch.
  * @param[in]   h    Clicon handle
  * @param[in]   s    Socket where message arrived. read from this.
@@ -1780,6 +2282,9 @@ from_client_msg(clicon_handle        h,
 	}
 	module = yang_argument_get(ymod);
 	clicon_debug(1, "%s module:%s rpc:%s", __FUNCTION__, module, rpc);
+	/* Pending batched edits are committed before any other request */
+	if (!backend_batch_edit(h, xe) && backend_batch_flush(h) < 0)
+	    goto done;
 	/* Pre-NACM access step */
 	xnacm = NULL;
 
@@ -1791,6 +2296,7 @@ from_client_msg(clicon_handle        h,
 	if ((ret = nacm_access_pre(h, ce->ce_username, username, &xnacm)) < 0)
 	    goto done;
 	/* Cache XML NACM tree here. Use with caution, only valid on from_client_msg stack 
+	 * The tree is owned by NACM and reused across requests, it is not freed here
 	 */
 	if (clicon_nacm_cache_set(h, xnacm) < 0)
 	    goto done;
@@ -1801,7 +2307,7 @@ from_client_msg(clicon_handle        h,
 	    if (ret == 0) /* credentials fail */
 		goto reply;
 	    /* NACM rpc operation exec validation */
-	    if ((ret = nacm_rpc(rpc, module, username, xnacm, cbret)) < 0)
+	    if ((ret = nacm_rpc(h, rpc, module, username, xnacm, cbret)) < 0)
 		goto done;
 	    if (ret == 0) /* Not permitted and cbret set */
 		goto reply;
@@ -1819,20 +2325,25 @@ from_client_msg(clicon_handle        h,
 	    goto reply;
 	}
 	if (xnacm){
-	    xml_free(xnacm);
 	    xnacm = NULL;
 	    if (clicon_nacm_cache_set(h, NULL) < 0)
 		goto done;
 	}
     } /* while */
  reply:
+    if (ce->ce_deferred){ /* Reply is sent when the batch is committed */
+	ce->ce_deferred = 0;
+	goto ok;
+    }
     if (cbuf_len(cbret) == 0)
 	if (netconf_operation_failed(cbret, "application", clicon_errno?clicon_err_reason:"unknown")< 0)
 	    goto done;
     clicon_debug(1, "%s cbret:%s", __FUNCTION__, cbuf_get(cbret));
+    if (backend_datastore_notify(h) < 0)
+	goto done;
     /* XXX problem here is that cbret has not been parsed so may contain 
        parse errors */
-    if (send_msg_reply(ce->ce_s, cbuf_get(cbret), cbuf_len(cbret)+1) < 0){
+    if (ce_reply(ce, cbuf_get(cbret), cbuf_len(cbret)+1) < 0){
 	switch (errno){
 	case EPIPE:
 	    /* man (2) write: 
@@ -1849,12 +2360,12 @@ from_client_msg(clicon_handle        h,
 	    goto done;
 	}
     }
-    // ok:
+ ok:
     retval = 0;
   done:  
     clicon_debug(1, "%s retval:%d", __FUNCTION__, retval);
     if (xnacm){
-	xml_free(xnacm);
+	xnacm = NULL;
 	if (clicon_nacm_cache_set(h, NULL) < 0)
 	    goto done;
     }
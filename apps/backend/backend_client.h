@@ -40,6 +40,9 @@
 /*
  * Types
  */ 
+struct ce_msg; /* Queued output message, see backend_client.c */
+struct push_subscription; /* Yang-push subscription, see backend_push.c */
+
 /*
  * Client entry.
  * Keep state about every connected client.
@@ -54,12 +57,21 @@ struct client_entry{
     int                   ce_id;      /* Session id */
     char                 *ce_username;/* Translated from peer user cred */
     clicon_handle         ce_handle;  /* clicon config handle (all clients have same?) */
+    struct ce_msg        *ce_outq;    /* Messages not yet written to client */
+    int                   ce_outq_nr; /* Nr of notifications in ce_outq */
+    uint64_t              ce_dropped; /* Nr of notifications dropped or coalesced */
+    int                   ce_out_closed; /* Output closed, client is disconnected */
+    struct push_subscription *ce_push; /* Yang-push subscriptions of client */
+    int                   ce_deferred;/* Reply of current request is sent later (batch) */
 };
 
 /*
  * Prototypes
  */ 
 int backend_client_rm(clicon_handle h, struct client_entry *ce);
+int ce_notify(clicon_handle h, struct client_entry *ce, char *event, char *evstr);
+int ce_reply(struct client_entry *ce, char *data, uint32_t len);
+int backend_datastore_notify(clicon_handle h);
 int from_client(int fd, void *arg);
 int backend_rpc_init(clicon_handle h);
 
@@ -77,6 +77,8 @@
 #include "backend_handle.h"
 #include "backend_startup.h"
 #include "backend_plugin_restconf.h"
+#include "backend_push.h"
+#include "backend_batch.h"
 
 /* Command line options to be passed to getopt(3) */
 #define BACKEND_OPTS "hD:f:E:l:d:p:b:Fza:u:P:1qs:c:U:g:y:o:"
@@ -102,6 +104,8 @@ backend_terminate(clicon_handle h)
     clicon_debug(1, "%s", __FUNCTION__);
     if ((ss = clicon_socket_get(h)) != -1)
 	close(ss);
+    /* Pending batched edits are not committed */
+    backend_batch_exit(h);
     /* Disconnect datastore */
     xmldb_disconnect(h);
     /* Clear module state caches */
@@ -122,6 +126,7 @@ backend_terminate(clicon_handle h)
 	cvec_free(nsctx);
     if ((x = clicon_nacm_ext(h)) != NULL)
 	xml_free(x);
+    nacm_program_reset(h);
     if ((x = clicon_conf_xml(h)) != NULL)
 	xml_free(x);
     stream_publish_exit();
@@ -190,58 +195,6 @@ backend_server_socket(clicon_handle h)
     return ss;
 }
 
-/*! Load external NACM file
- */
-static int
-nacm_load_external(clicon_handle h)
-{
-    int         retval = -1;
-    char       *filename; /* NACM config file */
-    yang_stmt  *yspec = NULL;
-    cxobj      *xt = NULL;
-    struct stat st;
-    FILE       *f = NULL;
-
-    filename = clicon_option_str(h, "CLICON_NACM_FILE");
-    if (filename == NULL || strlen(filename)==0){
-	clicon_err(OE_UNIX, errno, "CLICON_NACM_FILE not set in NACM external mode");
-	goto done;
-    }
-    if (stat(filename, &st) < 0){
-	clicon_err(OE_UNIX, errno, "%s", filename);
-	goto done;
-    }
-    if (!S_ISREG(st.st_mode)){
-	clicon_err(OE_UNIX, 0, "%s is not a regular file", filename);
-	goto done;
-    }
-    if ((f = fopen(filename, "r")) == NULL) {
-	clicon_err(OE_UNIX, errno, "configure file: %s", filename);
-	return -1;
-    }
-    if ((yspec = yspec_new()) == NULL)
-	goto done;
-    if (yang_spec_parse_module(h, "ietf-netconf-acm", NULL, yspec) < 0)
-	goto done;
-    /* Read configfile */
-    if (clixon_xml_parse_file(f, YB_MODULE, yspec, &xt, NULL) < 0)
-	goto done;
-    if (xt == NULL){
-	clicon_err(OE_XML, 0, "No xml tree in %s", filename);
-	goto done;
-    }
-    if (clicon_nacm_ext_yang_set(h, yspec) < 0)
-	goto done;
-    if (clicon_nacm_ext_set(h, xt) < 0)
-	goto done;
-
-    retval = 0;
- done:
-    if (f)
-	fclose(f);
-    return retval;
-}
-
 static int 
 xmldb_drop_priv(clicon_handle h, 
 		const char   *db, 
@@ -754,6 +707,10 @@ main(int    argc,
     if (clicon_option_exists(h, "CLICON_STREAM_PUB") &&
 	stream_publish_init() < 0)
 	goto done;
+    /* Built-in stream notifying when running is written, eg used by restconf cache */
+    if (clicon_option_bool(h, "CLICON_STREAM_DATASTORE") &&
+	stream_add(h, CLIXON_DATASTORE_STREAM, "Clixon datastore changes", 0, NULL) < 0)
+	goto done;
     /* Connect to plugin to get a handle */
     if (xmldb_connect(h) < 0)
 	goto done;
@@ -833,6 +790,10 @@ main(int    argc,
     /* Initialize server socket and save it to handle */
     if (backend_rpc_init(h) < 0)
 	goto done;
+    /* Yang-push datastore subscriptions, RFC 8641 */
+    if (clicon_option_bool(h, "CLICON_YANG_PUSH") &&
+	backend_push_init(h) < 0)
+	goto done;
 
     /* Must be after netconf_module_load, but before startup code */
     if (clicon_option_bool(h, "CLICON_XML_CHANGELOG"))
@@ -0,0 +1,989 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+ 
+  Copyright (C) 2020-2021 Olof Hagsand and Rubicon Communications, LLC (Netgate)
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2, 
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+
+ * Yang-push datastore subscriptions, RFC 8641
+ *
+ * A client establishes a subscription with the RFC 8639 establish-subscription rpc,
+ * selecting the running datastore and an optional xpath filter:
+ * - Periodic: the selection is copied from the running datastore on a timer, and
+ *   sent in a push-update notification.
+ * - On-change: the changes of a commit are taken from the transaction vectors,
+ *   no diff of the datastore is made. Changes within the selection are sent as
+ *   yang-patch edits in a push-change-update notification.
+ * Notifications are sent on the client session that established the subscription.
+ * NACM read access of the subscribing user is applied to what is sent, RFC 8641 5.4.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "clixon_config.h" /* generated by config & autoconf */
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <syslog.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+
+/* cligen */
+#include <cligen/cligen.h>
+
+/* clicon */
+#include <clixon/clixon.h>
+
+#include "clixon_backend_transaction.h"
+#include "clixon_backend_plugin.h"
+#include "backend_client.h"
+#include "backend_handle.h"
+#include "backend_push.h"
+
+/* Excluded changes of on-change subscription, RFC 8641 change-type */
+#define PUSH_EXCLUDE_CREATE  0x01
+#define PUSH_EXCLUDE_DELETE  0x02
+#define PUSH_EXCLUDE_REPLACE 0x04
+
+/* Yang-push subscription
+ * Kept in a list per client in ce_push
+ */
+struct push_subscription{
+    qelem_t              ps_qelem;     /* List of subscriptions of a client */
+    clicon_handle        ps_h;         /* Clicon handle */
+    struct client_entry *ps_ce;        /* Subscribing client */
+    char                *ps_username;  /* NACM user of subscriber, or NULL */
+    uint32_t             ps_id;        /* Subscription id */
+    char                *ps_xpath;     /* Selection filter, NULL means all */
+    cvec                *ps_nsc;       /* Namespace context of filter */
+    xpath_tree          *ps_xptree;    /* Parsed filter */
+    int                  ps_onchange;  /* On-change, else periodic */
+    struct timeval       ps_period;    /* Periodic: period */
+    struct timeval       ps_dampening; /* On-change: dampening period */
+    int                  ps_exclude;   /* On-change: excluded changes, PUSH_EXCLUDE_* */
+    int                  ps_sync;      /* On-change: push-update pending (sync-on-start) */
+    struct timeval       ps_next;      /* Periodic: next update, on-change: end of dampening */
+    int                  ps_timer;     /* Timeout registered */
+    cbuf                *ps_edits;     /* On-change: yang-patch edits not yet sent */
+    uint32_t             ps_editnr;    /* Nr of edits in ps_edits */
+    uint32_t             ps_patchnr;   /* Nr of sent yang-patches */
+};
+
+/* Last subscription id */
+static uint32_t _push_id = 0;
+
+static int push_timeout_cb(int fd, void *arg);
+
+/*! Free yang-push subscription
+ */
+static int
+push_ss_free(struct push_subscription *ps)
+{
+    if (ps->ps_timer)
+	clixon_event_unreg_timeout(push_timeout_cb, ps);
+    if (ps->ps_username)
+	free(ps->ps_username);
+    if (ps->ps_xpath)
+	free(ps->ps_xpath);
+    if (ps->ps_nsc)
+	xml_nsctx_free(ps->ps_nsc);
+    if (ps->ps_xptree)
+	xpath_tree_free(ps->ps_xptree);
+    if (ps->ps_edits)
+	cbuf_free(ps->ps_edits);
+    free(ps);
+    return 0;
+}
+
+/*! Find yang-push subscription of any client given id
+ * @param[in]  h    Clicon handle
+ * @param[in]  id   Subscription id
+ * @retval     ps   Subscription
+ * @retval     NULL Not found
+ */
+static struct push_subscription *
+push_ss_find(clicon_handle h,
+	     uint32_t      id)
+{
+    struct client_entry      *ce;
+    struct push_subscription *ps;
+
+    for (ce = backend_client_list(h); ce; ce = ce->ce_next)
+	if ((ps = ce->ce_push) != NULL)
+	    do {
+		if (ps->ps_id == id)
+		    return ps;
+		ps = NEXTQ(struct push_subscription *, ps);
+	    } while (ps && ps != ce->ce_push);
+    return NULL;
+}
+
+/*! Register timeout of subscription at time tv
+ */
+static int
+push_timeout_reg(struct push_subscription *ps,
+		 struct timeval           *tv)
+{
+    if (ps->ps_timer)
+	return 0;
+    if (clixon_event_reg_timeout(*tv, push_timeout_cb, ps, "yang-push subscription") < 0)
+	return -1;
+    ps->ps_timer = 1;
+    return 0;
+}
+
+/*! Get NACM tree if read access of subscriber needs to be checked
+ * @param[in]  h      Clicon handle
+ * @param[in]  ps     Subscription
+ * @param[out] xnacm  NACM tree, or NULL if access is permitted without further checks
+ * @retval     0      OK
+ * @retval    -1      Error
+ * @note xnacm is owned by NACM and valid until next call of nacm_access_pre
+ */
+static int
+push_nacm(clicon_handle             h,
+	  struct push_subscription *ps,
+	  cxobj                   **xnacm)
+{
+    *xnacm = NULL;
+    if (nacm_access_pre(h, ps->ps_ce->ce_username, ps->ps_username, xnacm) < 0)
+	return -1;
+    return 0;
+}
+
+/*! Send notification of a subscription to its client
+ * @param[in]  h     Clicon handle
+ * @param[in]  ps    Subscription
+ * @param[in]  event Name of event, for coalescing of queued notifications
+ * @param[in]  body  Notification content
+ */
+static int
+push_notify(clicon_handle             h,
+	    struct push_subscription *ps,
+	    char                     *event,
+	    char                     *body)
+{
+    int            retval = -1;
+    cbuf          *cb = NULL;
+    char           timestr[28];
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    if (time2str(tv, timestr, sizeof(timestr)) < 0){
+	clicon_err(OE_UNIX, errno, "time2str");
+	goto done;
+    }
+    if ((cb = cbuf_new()) == NULL){
+	clicon_err(OE_UNIX, errno, "cbuf_new");
+	goto done;
+    }
+    cprintf(cb, "<notification xmlns=\"%s\"><eventTime>%s</eventTime>%s</notification>",
+	    NOTIFICATION_RFC5277_NAMESPACE, timestr, body);
+    if (ce_notify(h, ps->ps_ce, event, cbuf_get(cb)) < 0)
+	goto done;
+    retval = 0;
+ done:
+    if (cb)
+	cbuf_free(cb);
+    return retval;
+}
+
+/*! Send push-update with the selection of the running datastore
+ * The selection is copied from the cached running tree, if any. If NACM applies, only
+ * what the subscriber may read is copied.
+ * @param[in]  h     Clicon handle
+ * @param[in]  ps    Subscription
+ */
+static int
+push_update(clicon_handle             h,
+	    struct push_subscription *ps)
+{
+    int        retval = -1;
+    cxobj     *xt = NULL;
+    cxobj     *xtcopy = NULL; /* Not cached running, free */
+    cxobj     *x1t = NULL;
+    cxobj     *x;
+    cxobj     *xnacm = NULL;
+    cxobj     *xerr = NULL;
+    xp_ctx    *xr = NULL;
+    cbuf      *cb = NULL;
+    char       event[32];
+    int        i;
+    int        ret;
+
+    if (push_nacm(h, ps, &xnacm) < 0)
+	goto done;
+    if (xnacm != NULL){
+	if ((ret = nacm_datanode_read_get(h, "running", ps->ps_nsc, ps->ps_xpath, NULL,
+					  ps->ps_username, xnacm, &x1t, &xerr)) < 0)
+	    goto done;
+	if (ret == 0){
+	    clicon_err(OE_DB, 0, "Failed to read running");
+	    goto done;
+	}
+	xt = x1t;
+    }
+    else if ((xt = xmldb_cache_get(h, "running")) == NULL){
+	if ((ret = xmldb_get0(h, "running", YB_MODULE, NULL, "/", 1, &xtcopy, NULL, NULL)) < 0)
+	    goto done;
+	if (ret == 0){
+	    clicon_err(OE_DB, 0, "Failed to read running");
+	    goto done;
+	}
+	xt = xtcopy;
+    }
+    if ((cb = cbuf_new()) == NULL){
+	clicon_err(OE_UNIX, errno, "cbuf_new");
+	goto done;
+    }
+    cprintf(cb, "<push-update xmlns=\"%s\"><id>%u</id><datastore-contents>",
+	    YANG_PUSH_NAMESPACE, ps->ps_id);
+    if (xnacm == NULL && ps->ps_xptree){
+	/* Mark selected nodes and copy them with their ancestors */
+	if (xpath_tree_eval(xt, ps->ps_nsc, ps->ps_xptree, 0, &xr) < 0)
+	    goto done;
+	if ((x1t = xml_new(xml_name(xt), NULL, CX_ELMNT)) == NULL)
+	    goto done;
+	xml_spec_set(x1t, xml_spec(xt));
+	if (xr->xc_type == XT_NODESET){
+	    for (i=0; i<xr->xc_size; i++){
+		x = xr->xc_nodeset[i];
+		xml_flag_set(x, XML_FLAG_MARK);
+		xml_apply_ancestor(x, (xml_applyfn_t*)xml_flag_set, (void*)XML_FLAG_CHANGE);
+	    }
+	    ret = xml_copy_marked(xt, x1t);
+	    xml_apply(xt, CX_ELMNT, (xml_applyfn_t*)xml_flag_reset, (void*)(XML_FLAG_MARK|XML_FLAG_CHANGE));
+	    xml_apply(x1t, CX_ELMNT, (xml_applyfn_t*)xml_flag_reset, (void*)(XML_FLAG_MARK|XML_FLAG_CHANGE));
+	    if (ret < 0)
+		goto done;
+	}
+	xt = x1t;
+    }
+    x = NULL;
+    while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL){
+	if (xml_spec(x) && xmlns_assign(x) < 0)
+	    goto done;
+	if (clicon_xml2cbuf(cb, x, 0, 0, -1) < 0)
+	    goto done;
+    }
+    cprintf(cb, "</datastore-contents></push-update>");
+    /* Queued updates of the same subscription are coalesced */
+    snprintf(event, sizeof(event), "push-update %u", ps->ps_id);
+    if (push_notify(h, ps, event, cbuf_get(cb)) < 0)
+	goto done;
+    retval = 0;
+ done:
+    if (cb)
+	cbuf_free(cb);
+    if (xr)
+	ctx_free(xr);
+    if (x1t)
+	xml_free(x1t);
+    if (xerr)
+	xml_free(xerr);
+    if (xtcopy)
+	xmldb_get0_free(h, &xtcopy);
+    return retval;
+}
+
+/*! Send push-change-update with pending edits of on-change subscription
+ * @param[in]  h     Clicon handle
+ * @param[in]  ps    Subscription
+ */
+static int
+push_change_update(clicon_handle             h,
+		   struct push_subscription *ps)
+{
+    int   retval = -1;
+    cbuf *cb = NULL;
+    char  event[48];
+
+    if ((cb = cbuf_new()) == NULL){
+	clicon_err(OE_UNIX, errno, "cbuf_new");
+	goto done;
+    }
+    cprintf(cb, "<push-change-update xmlns=\"%s\"><id>%u</id><datastore-changes>"
+	    "<yang-patch><patch-id>%u</patch-id>%s</yang-patch>"
+	    "</datastore-changes></push-change-update>",
+	    YANG_PUSH_NAMESPACE, ps->ps_id, ps->ps_patchnr, cbuf_get(ps->ps_edits));
+    /* Changes are never coalesced */
+    snprintf(event, sizeof(event), "push-change-update %u %u", ps->ps_id, ps->ps_patchnr);
+    ps->ps_patchnr++;
+    cbuf_reset(ps->ps_edits);
+    ps->ps_editnr = 0;
+    if (push_notify(h, ps, event, cbuf_get(cb)) < 0)
+	goto done;
+    retval = 0;
+ done:
+    if (cb)
+	cbuf_free(cb);
+    return retval;
+}
+
+/*! Log that an update of a subscription could not be sent, the update is skipped
+ * @param[in]  ps    Subscription
+ * @param[in]  what  Kind of update
+ */
+static void
+push_update_failed(struct push_subscription *ps,
+		   char                     *what)
+{
+    clicon_log(LOG_WARNING, "%s: subscription %u: %s skipped: %s",
+	       __FUNCTION__, ps->ps_id, what, clicon_err_reason);
+    clicon_err_reset();
+}
+
+/*! Subscription timeout: periodic update, sync-on-start, or end of dampening period
+ *
+ * If an update cannot be sent, it is logged and skipped: the subscription remains and
+ * the next update is sent as scheduled. Errors are not returned since that would
+ * terminate the event loop, and thereby the backend.
+ */
+static int
+push_timeout_cb(int   fd,
+		void *arg)
+{
+    int                       retval = -1;
+    struct push_subscription *ps = (struct push_subscription *)arg;
+    clicon_handle             h = ps->ps_h;
+    struct timeval            now;
+
+    ps->ps_timer = 0;
+    gettimeofday(&now, NULL);
+    if (!ps->ps_onchange){
+	if (push_update(h, ps) < 0)
+	    push_update_failed(ps, "push-update");
+	/* Next period, skip periods that have passed */
+	do {
+	    timeradd(&ps->ps_next, &ps->ps_period, &ps->ps_next);
+	} while (timercmp(&ps->ps_next, &now, <=));
+	if (push_timeout_reg(ps, &ps->ps_next) < 0)
+	    goto done;
+	goto ok;
+    }
+    if (ps->ps_sync){
+	ps->ps_sync = 0;
+	if (push_update(h, ps) < 0)
+	    push_update_failed(ps, "push-update");
+    }
+    if (ps->ps_editnr){
+	if (push_change_update(h, ps) < 0)
+	    push_update_failed(ps, "push-change-update");
+	timeradd(&now, &ps->ps_dampening, &ps->ps_next);
+    }
+ ok:
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Get target of a yang-patch edit as api-path of a datastore node
+ * @param[in]  x     XML node
+ * @param[out] cb    api-path
+ */
+static int
+push_edit_target(cxobj *x,
+		 cbuf  *cb)
+{
+    cxobj *xp;
+
+    if ((xp = xml_parent(x)) != NULL && xml_spec(xp) != NULL &&
+	push_edit_target(xp, cb) < 0)
+	return -1;
+    return xml2api_path_1(x, cb);
+}
+
+/*! Add yang-patch edit of a changed node to pending edits of subscription
+ * An edit of a node the subscriber may not read is not added, and descendants it may
+ * not read are removed from the value.
+ * @param[in]  ps    Subscription
+ * @param[in]  op    Edit operation: create, delete or replace
+ * @param[in]  x     Changed node, in source tree if deleted, else in target tree
+ * @param[in]  xnacm NACM tree, or NULL if no read access check is made
+ */
+static int
+push_edit_add(struct push_subscription *ps,
+	      char                     *op,
+	      cxobj                    *x,
+	      cxobj                    *xnacm)
+{
+    int    retval = -1;
+    cbuf  *cb = ps->ps_edits;
+    cxobj *xv = NULL;
+
+    /* Copy value to give it a namespace */
+    if (xnacm != NULL){
+	if (nacm_datanode_read_node(ps->ps_h, x, ps->ps_username, xnacm, &xv) < 0)
+	    goto done;
+	if (xv == NULL) /* Not readable by subscriber */
+	    goto ok;
+    }
+    else if (strcmp(op, "delete") != 0 && (xv = xml_dup(x)) == NULL)
+	goto done;
+    cprintf(cb, "<edit><edit-id>edit%u</edit-id><operation>%s</operation><target>",
+	    ps->ps_editnr + 1, op);
+    if (push_edit_target(x, cb) < 0)
+	goto done;
+    cprintf(cb, "</target>");
+    if (strcmp(op, "delete") != 0){
+	if (xml_spec(xv) && xmlns_assign(xv) < 0)
+	    goto done;
+	cprintf(cb, "<value>");
+	if (clicon_xml2cbuf(cb, xv, 0, 0, -1) < 0)
+	    goto done;
+	cprintf(cb, "</value>");
+    }
+    cprintf(cb, "</edit>");
+    ps->ps_editnr++;
+ ok:
+    retval = 0;
+ done:
+    if (xv)
+	xml_free(xv);
+    return retval;
+}
+
+/*! Compare pointers for sorting and searching selected nodes
+ */
+static int
+push_xcmp(const void *a,
+	  const void *b)
+{
+    cxobj *xa = *(cxobj **)a;
+    cxobj *xb = *(cxobj **)b;
+
+    return xa < xb ? -1 : xa > xb ? 1 : 0;
+}
+
+/*! Check if x or any ancestor of x is selected
+ * @param[in]  ps    Subscription, all nodes are selected if it has no filter
+ * @param[in]  x     XML node
+ * @param[in]  sel   Sorted vector of selected nodes
+ * @param[in]  len   Length of sel
+ */
+static int
+push_selected(struct push_subscription *ps,
+	      cxobj                    *x,
+	      cxobj                   **sel,
+	      size_t                    len)
+{
+    if (ps->ps_xptree == NULL)
+	return 1;
+    if (len == 0)
+	return 0;
+    for (; x != NULL; x = xml_parent(x))
+	if (bsearch(&x, sel, len, sizeof(cxobj *), push_xcmp) != NULL)
+	    return 1;
+    return 0;
+}
+
+/*! Evaluate selection filter of subscription on tree and return sorted node vector
+ * @param[in]  ps    Subscription
+ * @param[in]  xt    XML tree
+ * @param[out] xrp   Xpath result, free with ctx_free
+ * @param[out] selp  Sorted vector of selected nodes, NULL if none or no filter
+ * @param[out] lenp  Length of vector
+ */
+static int
+push_selection(struct push_subscription *ps,
+	       cxobj                    *xt,
+	       xp_ctx                  **xrp,
+	       cxobj                  ***selp,
+	       size_t                   *lenp)
+{
+    xp_ctx *xr = NULL;
+
+    *selp = NULL;
+    *lenp = 0;
+    if (ps->ps_xptree == NULL || xt == NULL)
+	return 0;
+    if (xpath_tree_eval(xt, ps->ps_nsc, ps->ps_xptree, 0, &xr) < 0)
+	return -1;
+    *xrp = xr;
+    if (xr->xc_type != XT_NODESET || xr->xc_size == 0)
+	return 0;
+    qsort(xr->xc_nodeset, xr->xc_size, sizeof(cxobj *), push_xcmp);
+    *selp = xr->xc_nodeset;
+    *lenp = xr->xc_size;
+    return 0;
+}
+
+/*! Add edits of added or deleted nodes within the selection of a subscription
+ * A node is within the selection if it or an ancestor is selected. A selected node
+ * below an added (deleted) node that is not within the selection is also an edit.
+ * @param[in]  ps    Subscription
+ * @param[in]  op    create or delete
+ * @param[in]  flag  XML_FLAG_ADD or XML_FLAG_DEL, set on changed subtrees
+ * @param[in]  vec   Added or deleted nodes
+ * @param[in]  vlen  Length of vec
+ * @param[in]  sel   Sorted vector of selected nodes
+ * @param[in]  slen  Length of sel
+ * @param[in]  xnacm NACM tree, or NULL if no read access check is made
+ */
+static int
+push_edits_vec(struct push_subscription *ps,
+	       char                     *op,
+	       int                       flag,
+	       cxobj                   **vec,
+	       int                       vlen,
+	       cxobj                   **sel,
+	       size_t                    slen,
+	       cxobj                    *xnacm)
+{
+    int    i;
+    cxobj *x;
+    cxobj *xp;
+
+    for (i=0; i<vlen; i++)
+	if (push_selected(ps, vec[i], sel, slen) &&
+	    push_edit_add(ps, op, vec[i], xnacm) < 0)
+	    return -1;
+    for (i=0; i<slen; i++){
+	x = sel[i];
+	xp = xml_parent(x);
+	/* Selected node in changed subtree, but not topmost changed node */
+	if (xml_flag(x, flag) && xp && xml_flag(xp, flag) &&
+	    !push_selected(ps, xp, sel, slen) &&
+	    push_edit_add(ps, op, x, xnacm) < 0)
+	    return -1;
+    }
+    return 0;
+}
+
+/*! Add edits of a commit to an on-change subscription and send if not dampened
+ * Called after plugin commit callbacks but before running is replaced, so that the NACM
+ * rules of running before the commit apply.
+ * @param[in]  h     Clicon handle
+ * @param[in]  ps    Subscription
+ * @param[in]  td    Transaction data
+ */
+static int
+push_onchange(clicon_handle             h,
+	      struct push_subscription *ps,
+	      transaction_data_t       *td)
+{
+    int            retval = -1;
+    xp_ctx        *xrs = NULL;
+    xp_ctx        *xrt = NULL;
+    cxobj        **ssel;
+    size_t         slen;
+    cxobj        **tsel;
+    size_t         tlen;
+    int            i;
+    struct timeval now;
+    cxobj         *xnacm = NULL;
+
+    /* A pending push-update includes this commit */
+    if (ps->ps_sync)
+	goto ok;
+    if (push_nacm(h, ps, &xnacm) < 0)
+	goto done;
+    if (!(ps->ps_exclude & PUSH_EXCLUDE_DELETE) && td->td_dlen){
+	if (push_selection(ps, td->td_src, &xrs, &ssel, &slen) < 0)
+	    goto done;
+	if (push_edits_vec(ps, "delete", XML_FLAG_DEL, td->td_dvec, td->td_dlen, ssel, slen, xnacm) < 0)
+	    goto done;
+    }
+    if ((!(ps->ps_exclude & PUSH_EXCLUDE_CREATE) && td->td_alen) ||
+	(!(ps->ps_exclude & PUSH_EXCLUDE_REPLACE) && td->td_clen)){
+	if (push_selection(ps, td->td_target, &xrt, &tsel, &tlen) < 0)
+	    goto done;
+	if (!(ps->ps_exclude & PUSH_EXCLUDE_CREATE) &&
+	    push_edits_vec(ps, "create", XML_FLAG_ADD, td->td_avec, td->td_alen, tsel, tlen, xnacm) < 0)
+	    goto done;
+	if (!(ps->ps_exclude & PUSH_EXCLUDE_REPLACE))
+	    for (i=0; i<td->td_clen; i++)
+		if (push_selected(ps, td->td_tcvec[i], tsel, tlen) &&
+		    push_edit_add(ps, "replace", td->td_tcvec[i], xnacm) < 0)
+		    goto done;
+    }
+    if (ps->ps_editnr == 0 || ps->ps_timer)
+	goto ok;
+    /* Send now, or when dampening period ends */
+    gettimeofday(&now, NULL);
+    if (timercmp(&now, &ps->ps_next, <)){
+	if (push_timeout_reg(ps, &ps->ps_next) < 0)
+	    goto done;
+	goto ok;
+    }
+    if (push_change_update(h, ps) < 0)
+	goto done;
+    timeradd(&now, &ps->ps_dampening, &ps->ps_next);
+ ok:
+    retval = 0;
+ done:
+    if (xrs)
+	ctx_free(xrs);
+    if (xrt)
+	ctx_free(xrt);
+    return retval;
+}
+
+/*! Transaction commit done: notify on-change subscriptions of changes in running
+ * The transaction vectors give the changes, source and target trees are used to
+ * evaluate selection filters.
+ * @param[in]  h     Clicon handle
+ * @param[in]  td    Transaction data
+ */
+static int
+push_commit_done(clicon_handle    h,
+		 transaction_data td)
+{
+    struct client_entry      *ce;
+    struct push_subscription *ps;
+
+    for (ce = backend_client_list(h); ce; ce = ce->ce_next)
+	if ((ps = ce->ce_push) != NULL)
+	    do {
+		if (ps->ps_onchange &&
+		    push_onchange(h, ps, (transaction_data_t *)td) < 0)
+		    return -1;
+		ps = NEXTQ(struct push_subscription *, ps);
+	    } while (ps && ps != ce->ce_push);
+    return 0;
+}
+
+/*! Convert centiseconds to timeval
+ */
+static void
+push_centisec2tv(uint32_t        cs,
+		 struct timeval *tv)
+{
+    tv->tv_sec = cs / 100;
+    tv->tv_usec = (cs % 100) * 10000;
+}
+
+/*! Get centiseconds leaf of establish-subscription
+ * @retval  1   OK, or not present
+ * @retval  0   Invalid, cbret set
+ * @retval -1   Error
+ */
+static int
+push_centisec_get(cxobj          *xe,
+		  cvec           *nsc,
+		  char           *xpath,
+		  struct timeval *tv,
+		  cbuf           *cbret)
+{
+    cxobj    *x;
+    char     *str;
+    uint32_t  cs;
+    char     *reason = NULL;
+    int       ret;
+
+    if ((x = xpath_first(xe, nsc, "%s", xpath)) == NULL ||
+	(str = xml_body(x)) == NULL)
+	return 1;
+    if ((ret = parse_uint32(str, &cs, &reason)) < 0){
+	clicon_err(OE_XML, errno, "parse_uint32");
+	return -1;
+    }
+    if (reason)
+	free(reason);
+    if (ret == 0){
+	if (netconf_bad_element(cbret, "application", xml_name(x), "Expected centiseconds") < 0)
+	    return -1;
+	return 0;
+    }
+    push_centisec2tv(cs, tv);
+    return 1;
+}
+
+/*! Establish a yang-push datastore subscription, RFC 8639 / RFC 8641
+ * @param[in]  h       Clicon handle 
+ * @param[in]  xe      Request: <rpc><xn></rpc> 
+ * @param[out] cbret   Return xml tree, eg <rpc-reply>..., <rpc-error.. 
+ * @param[in]  arg     client-entry
+ * @param[in]  regarg  User argument given at rpc_callback_register() 
+ * @retval     0       OK
+ * @retval    -1       Error
+ * @example:
+ *   <establish-subscription xmlns="urn:ietf:params:xml:ns:yang:ietf-subscribed-notifications">
+ *      <datastore xmlns="urn:ietf:params:xml:ns:yang:ietf-yang-push"
+ *                 xmlns:ds="urn:ietf:params:xml:ns:yang:ietf-datastores">ds:running</datastore>
+ *      <datastore-xpath-filter xmlns="urn:ietf:params:xml:ns:yang:ietf-yang-push">/ex:x</datastore-xpath-filter>
+ *      <periodic xmlns="urn:ietf:params:xml:ns:yang:ietf-yang-push"><period>500</period></periodic>
+ *   </establish-subscription>
+ * @note Only the running datastore, xpath filters, and dynamic subscriptions are supported
+ */
+static int
+from_client_establish_subscription(clicon_handle h,
+				   cxobj        *xe,
+				   cbuf         *cbret,
+				   void         *arg, 
+				   void         *regarg)
+{
+    int                       retval = -1;
+    struct client_entry      *ce = (struct client_entry *)arg;
+    struct push_subscription *ps = NULL;
+    cvec                     *nsc = NULL;
+    cxobj                    *x;
+    cxobj                    *xc;
+    char                     *str;
+    char                     *prefix = NULL;
+    char                     *id = NULL;
+    char                     *ns = NULL;
+    struct timeval            now;
+    struct timeval            anchor;
+    uint64_t                  d;
+    uint64_t                  p;
+    int                       ret;
+
+    if ((nsc = xml_nsctx_init("yp", YANG_PUSH_NAMESPACE)) == NULL)
+	goto done;
+    if ((x = xpath_first(xe, nsc, "yp:datastore")) == NULL){
+	if (netconf_operation_not_supported(cbret, "application", "Only datastore subscriptions are supported, use create-subscription for event streams") < 0)
+	    goto done;
+	goto ok;
+    }
+    /* Datastore identity, eg ds:running */
+    if ((str = xml_body(x)) == NULL ||
+	nodeid_split(str, &prefix, &id) < 0 ||
+	xml2ns(x, prefix, &ns) < 0)
+	goto done;
+    if (ns == NULL || strcmp(ns, "urn:ietf:params:xml:ns:yang:ietf-datastores") != 0 ||
+	id == NULL || strcmp(id, "running") != 0){
+	if (netconf_operation_not_supported(cbret, "application", "Only the running datastore is supported") < 0)
+	    goto done;
+	goto ok;
+    }
+    if (xpath_first(xe, nsc, "yp:datastore-subtree-filter|yp:selection-filter-ref") != NULL){
+	if (netconf_operation_not_supported(cbret, "application", "Only datastore-xpath-filter is supported") < 0)
+	    goto done;
+	goto ok;
+    }
+    if ((ps = malloc(sizeof(*ps))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	goto done;
+    }
+    memset(ps, 0, sizeof(*ps));
+    ps->ps_h = h;
+    ps->ps_ce = ce;
+    if ((str = clicon_username_get(h)) != NULL &&
+	(ps->ps_username = strdup(str)) == NULL){
+	clicon_err(OE_UNIX, errno, "strdup");
+	goto done;
+    }
+    if ((x = xpath_first(xe, nsc, "yp:datastore-xpath-filter")) != NULL &&
+	(str = xml_body(x)) != NULL){
+	/* Filter is parsed once, namespace prefixes are those of the filter element */
+	if ((ps->ps_xpath = strdup(str)) == NULL){
+	    clicon_err(OE_UNIX, errno, "strdup");
+	    goto done;
+	}
+	if (xml_nsctx_node(x, &ps->ps_nsc) < 0)
+	    goto done;
+	if (xpath_parse(str, &ps->ps_xptree) < 0){
+	    cbuf_reset(cbret);
+	    if (netconf_bad_element(cbret, "application", "datastore-xpath-filter", "Invalid xpath") < 0)
+		goto done;
+	    goto ok;
+	}
+    }
+    gettimeofday(&now, NULL);
+    if ((x = xpath_first(xe, nsc, "yp:periodic")) != NULL){
+	if ((ret = push_centisec_get(x, nsc, "yp:period", &ps->ps_period, cbret)) < 0)
+	    goto done;
+	if (ret == 0)
+	    goto ok;
+	if (!timerisset(&ps->ps_period)){
+	    if (netconf_invalid_value(cbret, "application", "period must be > 0") < 0)
+		goto done;
+	    goto ok;
+	}
+	ps->ps_next = now;
+	/* First update at anchor-time plus a multiple of period */
+	if ((xc = xpath_first(x, nsc, "yp:anchor-time")) != NULL &&
+	    (str = xml_body(xc)) != NULL){
+	    if (str2time(str, &anchor) < 0){
+		if (netconf_bad_element(cbret, "application", "anchor-time", "Expected timestamp") < 0)
+		    goto done;
+		goto ok;
+	    }
+	    p = ps->ps_period.tv_sec*1000000ULL + ps->ps_period.tv_usec;
+	    if (timercmp(&anchor, &now, <)){
+		timersub(&now, &anchor, &ps->ps_next);
+		d = ps->ps_next.tv_sec*1000000ULL + ps->ps_next.tv_usec;
+		d = ((d + p - 1) / p) * p;
+		ps->ps_next.tv_sec = d / 1000000;
+		ps->ps_next.tv_usec = d % 1000000;
+		timeradd(&anchor, &ps->ps_next, &ps->ps_next);
+	    }
+	    else
+		ps->ps_next = anchor;
+	}
+    }
+    else if ((x = xpath_first(xe, nsc, "yp:on-change")) != NULL){
+	ps->ps_onchange = 1;
+	if ((ret = push_centisec_get(x, nsc, "yp:dampening-period", &ps->ps_dampening, cbret)) < 0)
+	    goto done;
+	if (ret == 0)
+	    goto ok;
+	ps->ps_sync = 1;
+	if ((xc = xpath_first(x, nsc, "yp:sync-on-start")) != NULL &&
+	    (str = xml_body(xc)) != NULL && strcmp(str, "false") == 0)
+	    ps->ps_sync = 0;
+	xc = NULL;
+	while ((xc = xml_child_each(x, xc, CX_ELMNT)) != NULL){
+	    if (strcmp(xml_name(xc), "excluded-change") != 0 ||
+		(str = xml_body(xc)) == NULL)
+		continue;
+	    if (strcmp(str, "create") == 0)
+		ps->ps_exclude |= PUSH_EXCLUDE_CREATE;
+	    else if (strcmp(str, "delete") == 0)
+		ps->ps_exclude |= PUSH_EXCLUDE_DELETE;
+	    else if (strcmp(str, "replace") == 0)
+		ps->ps_exclude |= PUSH_EXCLUDE_REPLACE;
+	}
+	if ((ps->ps_edits = cbuf_new()) == NULL){
+	    clicon_err(OE_UNIX, errno, "cbuf_new");
+	    goto done;
+	}
+	ps->ps_next = now;
+    }
+    else {
+	if (netconf_missing_element(cbret, "application", "periodic", "periodic or on-change is required") < 0)
+	    goto done;
+	goto ok;
+    }
+    /* First update (or sync-on-start) is made after the reply is sent */
+    if ((!ps->ps_onchange || ps->ps_sync) &&
+	push_timeout_reg(ps, &ps->ps_next) < 0)
+	goto done;
+    ps->ps_id = ++_push_id;
+    ADDQ(ps, ce->ce_push);
+    cprintf(cbret, "<rpc-reply xmlns=\"%s\"><id xmlns=\"%s\">%u</id></rpc-reply>",
+	    NETCONF_BASE_NAMESPACE, SUBSCRIBED_NOTIFICATIONS_NAMESPACE, ps->ps_id);
+    ps = NULL;
+ ok:
+    retval = 0;
+ done:
+    if (ps)
+	push_ss_free(ps);
+    if (prefix)
+	free(prefix);
+    if (id)
+	free(id);
+    if (nsc)
+	xml_nsctx_free(nsc);
+    return retval;
+}
+
+/*! Delete a yang-push subscription, RFC 8639 2.4.4
+ * @param[in]  h       Clicon handle 
+ * @param[in]  xe      Request: <rpc><xn></rpc> 
+ * @param[out] cbret   Return xml tree, eg <rpc-reply>..., <rpc-error.. 
+ * @param[in]  arg     client-entry
+ * @param[in]  regarg  User argument given at rpc_callback_register() 
+ * @retval     0       OK
+ * @retval    -1       Error
+ * @note A netconf session sends notifications on its own backend connection, so 
+ * the subscription may be deleted by any connection of the same user
+ */
+static int
+from_client_delete_subscription(clicon_handle h,
+				cxobj        *xe,
+				cbuf         *cbret,
+				void         *arg, 
+				void         *regarg)
+{
+    int                       retval = -1;
+    struct client_entry      *ce = (struct client_entry *)arg;
+    struct push_subscription *ps;
+    char                     *str;
+    uint32_t                  id = 0;
+    char                     *reason = NULL;
+
+    if ((str = xml_find_body(xe, "id")) == NULL ||
+	parse_uint32(str, &id, &reason) < 1 ||
+	(ps = push_ss_find(h, id)) == NULL ||
+	(ps->ps_ce != ce &&
+	 (ps->ps_ce->ce_username == NULL || ce->ce_username == NULL ||
+	  strcmp(ps->ps_ce->ce_username, ce->ce_username) != 0))){
+	if (netconf_invalid_value(cbret, "application", "No such subscription") < 0)
+	    goto done;
+	goto ok;
+    }
+    DELQ(ps, ps->ps_ce->ce_push, struct push_subscription *);
+    push_ss_free(ps);
+    cprintf(cbret, "<rpc-reply xmlns=\"%s\"><ok/></rpc-reply>", NETCONF_BASE_NAMESPACE);
+ ok:
+    retval = 0;
+ done:
+    if (reason)
+	free(reason);
+    return retval;
+}
+
+/*! Remove all yang-push subscriptions of a client
+ * @param[in]  h   Clicon handle
+ * @param[in]  ce  Client entry
+ */
+int
+backend_push_client_rm(clicon_handle        h,
+		       struct client_entry *ce)
+{
+    struct push_subscription *ps;
+
+    while ((ps = ce->ce_push) != NULL){
+	DELQ(ps, ce->ce_push, struct push_subscription *);
+	push_ss_free(ps);
+    }
+    return 0;
+}
+
+/*! Initialize yang-push subscriptions: register rpcs and commit callback
+ * @param[in]  h   Clicon handle
+ * @retval     0   OK
+ * @retval    -1   Error
+ * @see CLICON_YANG_PUSH
+ */
+int
+backend_push_init(clicon_handle h)
+{
+    int              retval = -1;
+    clixon_plugin_t *cp = NULL;
+
+    if (rpc_callback_register(h, from_client_establish_subscription, NULL,
+		      SUBSCRIBED_NOTIFICATIONS_NAMESPACE, "establish-subscription") < 0)
+	goto done;
+    if (rpc_callback_register(h, from_client_delete_subscription, NULL,
+		      SUBSCRIBED_NOTIFICATIONS_NAMESPACE, "delete-subscription") < 0)
+	goto done;
+    if (clixon_pseudo_plugin(h, "yang-push pseudo plugin", &cp) < 0)
+	goto done;
+    clixon_plugin_api_get(cp)->ca_trans_commit_done = push_commit_done;
+    retval = 0;
+ done:
+    return retval;
+}
@@ -338,7 +338,7 @@ yang2cli_var_pattern(clicon_handle h,
     while ((cvp = cvec_each(patterns, cvp)) != NULL){
 	pattern = cv_string_get(cvp);
 	invert = cv_flag(cvp, V_INVERT);
-	if (mode == REGEXP_POSIX){
+	if (mode != REGEXP_LIBXML2){ /* CLIgen has no dfa engine, translate to posix */
 	    posix = NULL;
 	    if (regexp_xsd2posix(pattern, &posix) < 0)
 		goto done;
@@ -1067,6 +1067,18 @@ yang2cli(clicon_handle      h,
 	clicon_err(OE_XML, errno, "cbuf_new");
 	goto done;
     }
+    /* Load modules not yet loaded, unless excluded, see CLICON_YANG_LAZY */
+    yc = NULL;
+    while ((yc = yang_lazy_each(yn, yc)) != NULL){
+	for (e = 0; e < nexvec; e++){
+	    if (strcmp(yang_argument_get(yc), exvec[e]) == 0)
+		break;
+	}
+	if (e < nexvec)
+	    continue;
+	if (yang_lazy_load(yn, yc) == NULL)
+	    goto done;
+    }
     /* Traverse YANG, loop through all modules and generate CLI */
     yc = NULL;
     while ((yc = yn_each(yn, yc)) != NULL){
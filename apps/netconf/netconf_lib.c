@@ -70,7 +70,14 @@
  * Exported variables
  */
 enum transport_type    transport = NETCONF_SSH; /* XXX Remove SOAP support */
-int cc_closed = 0; /* XXX Please remove (or at least hide in handle) this global variable */
+
+/* Session whose input or notification is processed, set by netconf_session_enter() */
+struct netconf_session *netconf_session_cur = NULL;
+
+/* List of all sessions */
+static struct netconf_session *netconf_sessions = NULL;
+
+static int netconf_session_write_cb(int s, void *arg);
 
 /*! Add netconf xml postamble of message. I.e, xml after the body of the message.
  * @param[in]  cb  Netconf packet (cligen buffer)
@@ -159,7 +166,64 @@ add_error_postamble(cbuf *cb)
     return 0;
 }
 
+/*! Write as much as possible of the output queue of a server session
+ * The socket is non-blocking. Output that cannot be written is left in the queue, and is
+ * written by netconf_session_write_cb when the socket is writable again.
+ * If the client has gone, the output is discarded and the session socket is shut down, so
+ * that the session is ended when its EOF is read.
+ * @param[in]  ns  Netconf session in server mode
+ * @retval     1   Output left in queue, waiting for socket
+ * @retval     0   OK, queue written
+ * @retval    -1   Error, client has gone
+ */
+static int
+netconf_session_flush(struct netconf_session *ns)
+{
+    char   *buf = cbuf_get(ns->ns_outq);
+    size_t  len = cbuf_len(ns->ns_outq);
+    ssize_t n;
+
+    while (ns->ns_outq_off < len){
+	if ((n = write(ns->ns_out, buf + ns->ns_outq_off, len - ns->ns_outq_off)) < 0){
+	    if (errno == EINTR)
+		continue;
+	    if (errno == EAGAIN || errno == EWOULDBLOCK)
+		return 1;
+	    if (errno != EPIPE && errno != ECONNRESET)
+		clicon_log(LOG_ERR, "%s: write: %s", __FUNCTION__, strerror(errno));
+	    cbuf_reset(ns->ns_outq);
+	    ns->ns_outq_off = 0;
+	    shutdown(ns->ns_s, SHUT_RDWR);
+	    return -1;
+	}
+	ns->ns_outq_off += n;
+    }
+    cbuf_reset(ns->ns_outq);
+    ns->ns_outq_off = 0;
+    return 0;
+}
+
+/*! Socket of server session is writable, continue writing its output queue
+ * @param[in]  s    Session output socket
+ * @param[in]  arg  Netconf session
+ * @see restconf_conn_write_cb  in restconf_native.c for the same pattern
+ */
+static int
+netconf_session_write_cb(int   s,
+			 void *arg)
+{
+    struct netconf_session *ns = (struct netconf_session *)arg;
+
+    clicon_debug(1, "%s session %u", __FUNCTION__, ns->ns_id);
+    /* Errors end the session, not the process */
+    if (netconf_session_flush(ns) != 1)
+	clixon_event_unreg_fd_write(s, netconf_session_write_cb);
+    return 0;
+}
+
 /*! Send netconf message from cbuf on socket
+ * Output on the socket of a server mode session is queued in the session and written
+ * without blocking, so that a client not reading its socket does not stall other sessions.
  * @param[in]   s    
  * @param[in]   cb   Cligen buffer that contains the XML message
  * @param[in]   msg  Only for debug
@@ -175,6 +239,8 @@ netconf_output(int   s,
     char *buf = cbuf_get(cb);
     int   len = cbuf_len(cb);
     int   retval = -1;
+    struct netconf_session *ns = NULL;
+    int   ret;
 
     clicon_debug(1, "SEND %s", msg);
     if (clicon_debug_get() > 1){ /* XXX: below only works to stderr, clicon_debug may log to syslog */
@@ -185,7 +251,25 @@ netconf_output(int   s,
 	    xml_free(xt);
 	}
     }
-    if (write(s, buf, len) < 0){
+    while ((ns = netconf_session_each(ns)) != NULL)
+	if (ns->ns_server && ns->ns_out == s)
+	    break;
+    if (ns != NULL){
+	if (cbuf_append_buf(ns->ns_outq, buf, len) < 0){
+	    clicon_err(OE_XML, errno, "cbuf_append_buf");
+	    goto done;
+	}
+	/* If the queue was not empty, the write callback is already registered */
+	if (cbuf_len(ns->ns_outq) == len){
+	    if ((ret = netconf_session_flush(ns)) < 0)
+		goto done;
+	    if (ret == 1 &&
+		clixon_event_reg_fd_write(s, netconf_session_write_cb, ns,
+					  "netconf session output") < 0)
+		goto done;
+	}
+    }
+    else if (write(s, buf, len) < 0){
 	if (errno == EPIPE)
 	    ;
 	else
@@ -199,6 +283,8 @@ netconf_output(int   s,
 
 	    
 /*! Encapsulate and send outgoing netconf packet as cbuf on socket
+ * With chunked framing (RFC 6242 Sec 4.2) the message is sent as a single chunk,
+ * otherwise it is terminated by the end-of-message marker.
  * @param[in]   s    
  * @param[in]   cb   Cligen buffer that contains the XML message
  * @param[in]   msg  Only for debug
@@ -220,11 +306,160 @@ netconf_output_encap(int   s,
 	goto done;
     }
     add_preamble(cb1);
-    cprintf(cb1, "%s", cbuf_get(cb));
-    add_postamble(cb1);
+    if (netconf_session_cur && netconf_session_cur->ns_framing == NETCONF_SSH_CHUNKED){
+	if (cbuf_len(cb) == 0){ /* A chunked message has at least one chunk */
+	    retval = 0;
+	    goto done;
+	}
+	cprintf(cb1, "\n#%lu\n", (unsigned long)cbuf_len(cb));
+	if (cbuf_append_buf(cb1, cbuf_get(cb), cbuf_len(cb)) < 0){
+	    clicon_err(OE_XML, errno, "cbuf_append_buf");
+	    goto done;
+	}
+	cprintf(cb1, "\n##\n");
+    }
+    else{
+	if (cbuf_append_buf(cb1, cbuf_get(cb), cbuf_len(cb)) < 0){
+	    clicon_err(OE_XML, errno, "cbuf_append_buf");
+	    goto done;
+	}
+	add_postamble(cb1);
+    }
     retval = netconf_output(s, cb1, msg);
  done:
     if (cb1)
 	cbuf_free(cb1);
     return retval;
 }
+
+/*! Create a netconf session and add it to the list of sessions
+ * @param[in]  h         Clixon handle
+ * @param[in]  s         Input socket
+ * @param[in]  out       Output socket, eg same as s, or 1 if s is stdin
+ * @param[in]  username  User of the session (is copied)
+ * @retval     ns        Netconf session, free with netconf_session_free
+ * @retval     NULL      Error
+ */
+struct netconf_session *
+netconf_session_new(clicon_handle h,
+		    int           s,
+		    int           out,
+		    char         *username)
+{
+    struct netconf_session *ns;
+
+    if ((ns = malloc(sizeof(*ns))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	return NULL;
+    }
+    memset(ns, 0, sizeof(*ns));
+    ns->ns_h = h;
+    ns->ns_s = s;
+    ns->ns_out = out;
+    ns->ns_framing = NETCONF_SSH_EOM;
+    ns->ns_backend = -1;
+    ns->ns_notify = -1;
+    if ((ns->ns_input.ni_cb = cbuf_new()) == NULL){
+	clicon_err(OE_XML, errno, "cbuf_new");
+	goto err;
+    }
+    if ((ns->ns_outq = cbuf_new()) == NULL){
+	clicon_err(OE_XML, errno, "cbuf_new");
+	goto err;
+    }
+    if (username && (ns->ns_username = strdup(username)) == NULL){
+	clicon_err(OE_UNIX, errno, "strdup");
+	goto err;
+    }
+    ADDQ(ns, netconf_sessions);
+    return ns;
+ err:
+    if (ns->ns_input.ni_cb)
+	cbuf_free(ns->ns_input.ni_cb);
+    if (ns->ns_outq)
+	cbuf_free(ns->ns_outq);
+    free(ns);
+    return NULL;
+}
+
+/*! Remove a netconf session from the list of sessions and free it
+ * Sockets are not closed. Output not yet written is discarded.
+ * @param[in]  ns  Netconf session
+ */
+int
+netconf_session_free(struct netconf_session *ns)
+{
+    DELQ(ns, netconf_sessions, struct netconf_session *);
+    if (netconf_session_cur == ns)
+	netconf_session_cur = NULL;
+    if (ns->ns_input.ni_cb)
+	cbuf_free(ns->ns_input.ni_cb);
+    if (ns->ns_outq){
+	if (cbuf_len(ns->ns_outq)) /* Write callback is registered */
+	    clixon_event_unreg_fd_write(ns->ns_out, netconf_session_write_cb);
+	cbuf_free(ns->ns_outq);
+    }
+    if (ns->ns_username)
+	free(ns->ns_username);
+    free(ns);
+    return 0;
+}
+
+/*! Iterate through netconf sessions
+ * @param[in]  ns  Previous session, or NULL to get first
+ * @retval     ns  Next session
+ * @retval     NULL  No more sessions
+ * @code
+ *   struct netconf_session *ns = NULL;
+ *   while ((ns = netconf_session_each(ns)) != NULL)
+ *      ...
+ * @endcode
+ */
+struct netconf_session *
+netconf_session_each(struct netconf_session *ns)
+{
+    if (netconf_sessions == NULL)
+	return NULL;
+    if (ns == NULL)
+	return netconf_sessions;
+    ns = NEXTQ(struct netconf_session *, ns);
+    return ns == netconf_sessions ? NULL : ns;
+}
+
+/*! Make a session current before processing its input or notifications
+ * Sessions share the clixon handle, so the backend socket, session-id and username of the
+ * session are set in the handle, to be used by the clicon_rpc_* functions.
+ * @param[in]  ns  Netconf session
+ * @see netconf_session_leave
+ */
+int
+netconf_session_enter(struct netconf_session *ns)
+{
+    clicon_handle h = ns->ns_h;
+
+    netconf_session_cur = ns;
+    clicon_client_socket_set(h, ns->ns_backend);
+    if (ns->ns_id)
+	clicon_session_id_set(h, ns->ns_id);
+    if (ns->ns_username &&
+	clicon_username_set(h, ns->ns_username) < 0)
+	return -1;
+    return 0;
+}
+
+/*! Save backend socket of the current session when it has been processed
+ * The backend socket may have been opened or closed by the clicon_rpc_* functions.
+ * @param[in]  ns  Netconf session
+ * @see netconf_session_enter
+ */
+int
+netconf_session_leave(struct netconf_session *ns)
+{
+    clicon_handle h = ns->ns_h;
+
+    ns->ns_backend = clicon_client_socket_get(h);
+    if (ns->ns_backend != -1)
+	clicon_client_socket_set(h, -1);
+    netconf_session_cur = NULL;
+    return 0;
+}
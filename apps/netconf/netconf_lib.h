@@ -53,6 +53,12 @@ enum transport_type{
 #endif
 };
 
+/* Message framing over SSH transport (RFC 6242 Sec 4) */
+enum framing_type{
+    NETCONF_SSH_EOM,     /* End-of-message framing ]]>]]>, netconf base:1.0 */
+    NETCONF_SSH_CHUNKED, /* Chunked framing, netconf base:1.1 */
+};
+
 enum test_option{ /* edit-config */
     SET,
     TEST_THEN_SET,
@@ -64,11 +70,58 @@ enum error_option{ /* edit-config */
     CONTINUE_ON_ERROR
 };
 
+/* Parse states of RFC 6242 Sec 4.2 chunked framing:
+ *   chunk         = LF HASH chunk-size LF chunk-data
+ *   end-of-chunks = LF HASH HASH LF
+ */
+enum chunk_state{
+    CHUNK_LF = 0, /* Expect LF of chunk header or end-of-chunks */
+    CHUNK_HASH,   /* Expect HASH */
+    CHUNK_SIZE1,  /* Expect first digit of chunk-size, or second HASH of end-of-chunks */
+    CHUNK_SIZE,   /* Expect digit of chunk-size or LF */
+    CHUNK_DATA,   /* Copy chunk-data */
+    CHUNK_END     /* Expect LF of end-of-chunks */
+};
+
+/*! Netconf input framing state, saved between reads
+ * A message may arrive in several reads, and a read may contain several messages.
+ */
+struct netconf_input{
+    cbuf              *ni_cb;    /* Message received so far */
+    enum chunk_state   ni_state; /* Chunked framing parse state */
+    unsigned long long ni_size;  /* Chunk-size being parsed, or chunk-data left to copy */
+};
+
+/*! Northbound netconf session
+ * A netconf process serves either one session on stdin/stdout, or in server mode many
+ * sessions on unix socket connections, which share event loop, yang specs and plugins.
+ * Each session has its own input framing, backend session and notification socket.
+ */
+struct netconf_session{
+    qelem_t              ns_qelem;    /* List of sessions */
+    clicon_handle        ns_h;        /* Clixon handle, shared by all sessions */
+    int                  ns_s;        /* Input socket */
+    int                  ns_out;      /* Output socket, differs from ns_s for stdin/stdout */
+    int                  ns_server;   /* Server mode: errors close the session, not the process */
+    enum framing_type    ns_framing;  /* Message framing, chunked if base:1.1 is negotiated */
+    int                  ns_closed;   /* Session is closed, eg close-session or end of input */
+    int                  ns_hello_nr; /* Hello messages received */
+    struct netconf_input ns_input;    /* Input framing state */
+    char                *ns_username; /* User of the session, used for NACM by the backend */
+    int                  ns_backend;  /* Backend socket, or -1 */
+    uint32_t             ns_id;       /* Backend session-id */
+    int                  ns_notify;   /* Notification socket, or -1 */
+    uint32_t             ns_notify_id; /* Subscription id on ns_notify if established by
+					  establish-subscription, else 0 */
+    cbuf                *ns_outq;     /* Server mode: output not yet written on ns_out */
+    size_t               ns_outq_off; /* Bytes of ns_outq already written */
+};
+
 /*
  * Variables
  */ 
 extern enum transport_type transport;
-extern int cc_closed;
+extern struct netconf_session *netconf_session_cur;
 
 /*
  * Prototypes
@@ -79,5 +132,10 @@ int add_error_preamble(cbuf *xf, char *reason);
 int add_error_postamble(cbuf *xf);
 int netconf_output(int s, cbuf *xf, char *msg);
 int netconf_output_encap(int s, cbuf *cb, char *msg);
+struct netconf_session *netconf_session_new(clicon_handle h, int s, int out, char *username);
+int netconf_session_free(struct netconf_session *ns);
+struct netconf_session *netconf_session_each(struct netconf_session *ns);
+int netconf_session_enter(struct netconf_session *ns);
+int netconf_session_leave(struct netconf_session *ns);
 
 #endif  /* _NETCONF_LIB_H_ */
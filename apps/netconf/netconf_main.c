@@ -50,7 +50,12 @@
 #include <time.h>
 #include <syslog.h>
 #include <sys/time.h>
+#define __USE_GNU   /* for ucred */
+#define _GNU_SOURCE /* for ucred */
 #include <sys/socket.h>
+#ifdef HAVE_LOCAL_PEERCRED
+#include <sys/ucred.h>
+#endif
 #include <sys/param.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -59,6 +64,8 @@
 #include <pwd.h>
 #include <netinet/in.h>
 #include <libgen.h>
+#include <poll.h>
+#include <sys/un.h>
 
 /* cligen */
 #include <cligen/cligen.h>
@@ -71,21 +78,26 @@
 #include "netconf_rpc.h"
 
 /* Command line options to be passed to getopt(3) */
-#define NETCONF_OPTS "hD:f:E:l:qa:u:d:p:y:U:t:eo:"
+#define NETCONF_OPTS "hD:f:E:l:qa:u:d:p:y:U:t:eo:SC:"
 
 #define NETCONF_LOGFILE "/tmp/clixon_netconf.log"
 
-/* clixon-data value to save buffer between invocations.
- * Saving data may be necessary if socket buffer contains partial netconf messages, such as:
- * <foo/> ..wait 1min  ]]>]]>
- */
-#define NETCONF_HASH_BUF "netconf_input_cbuf"
+/* RFC 4742 end-of-message marker */
+#define NETCONF_EOM "]]>]]>"
+
+/* Max chunk-size, RFC 6242 Sec 4.2 */
+#define CHUNK_SIZE_MAX 4294967295ULL
 
 /*! Ignore errors on packet errors: continue */
 static int ignore_packet_errors = 1;
 
-/* Hello request received */
-static int _netconf_hello_nr = 0;
+/*! Dont send hello to northbound clients */
+static int quiet = 0;
+
+/*! Server mode: listening socket of northbound sessions, or -1 */
+static int netconf_server_s = -1;
+
+static int netconf_session_end(struct netconf_session *ns);
 
 /*! Copy attributes from incoming request to reply. Skip already present (dont overwrite)
  *
@@ -134,18 +146,21 @@ netconf_hello_msg(clicon_handle h,
     cxobj  *x;
     cxobj  *xcap;
     int     foundbase;
+    int     found11;
     char   *body;
+    struct netconf_session *ns = netconf_session_cur;
 
-    _netconf_hello_nr++;
+    ns->ns_hello_nr++;
     if (xml_find_type(xn, NULL, "session-id", CX_ELMNT) != NULL) {
 	clicon_err(OE_XML, errno, "Server received hello with session-id from client, terminating (see RFC 6241 Sec 8.1");
-	cc_closed++;
+	ns->ns_closed++;
 	goto done;
     }
     if (xpath_vec(xn, nsc, "capabilities/capability", &vec, &veclen) < 0)
 	goto done;
     /* Each peer MUST send at least the base NETCONF capability, "urn:ietf:params:netconf:base:1.1"*/
     foundbase=0;
+    found11=0;
     if ((xcap = xml_find_type(xn, NULL, "capabilities", CX_ELMNT)) != NULL) {
 	x = NULL;
 	while ((x = xml_child_each(xcap, x, CX_ELMNT)) != NULL) {
@@ -157,16 +172,22 @@ netconf_hello_msg(clicon_handle h,
 	     * event any parameters are encoded at the end of the URI string. */
 	    if (strncmp(body, NETCONF_BASE_CAPABILITY_1_0, strlen(NETCONF_BASE_CAPABILITY_1_0)) == 0) /* RFC 4741 */
 		foundbase++;
-	    else if (strncmp(body, NETCONF_BASE_CAPABILITY_1_1, strlen(NETCONF_BASE_CAPABILITY_1_1)) == 0) /* RFC 6241 */
+	    else if (strncmp(body, NETCONF_BASE_CAPABILITY_1_1, strlen(NETCONF_BASE_CAPABILITY_1_1)) == 0){ /* RFC 6241 */
 		foundbase++;
+		found11++;
+	    }
 	}
     }
     if (foundbase == 0){
 	clicon_err(OE_XML, errno, "Server received hello without netconf base capability %s, terminating (see RFC 6241 Sec 8.1",
 		   NETCONF_BASE_CAPABILITY_1_1);
-	cc_closed++;
+	ns->ns_closed++;
 	goto done;
     }
+    /* If both peers advertise base:1.1, chunked framing is used for the remainder of the
+     * session (RFC 6242 Sec 4.1) */
+    if (found11 && clicon_option_int(h, "CLICON_NETCONF_BASE_CAPABILITY") > 0)
+	ns->ns_framing = NETCONF_SSH_CHUNKED;
     retval = 0;
  done:
     if (vec)
@@ -192,7 +213,7 @@ netconf_rpc_message(clicon_handle h,
     cbuf  *cbret = NULL;
     cxobj *xc;
 
-    if (_netconf_hello_nr == 0 &&
+    if (netconf_session_cur->ns_hello_nr == 0 &&
 	clicon_option_bool(h, "CLICON_NETCONF_HELLO_OPTIONAL") == 0){
 	if (netconf_operation_failed_xml(&xret, "rpc", "Client must send an hello element before any RPC")< 0)
 	    goto done;
@@ -204,8 +225,8 @@ netconf_rpc_message(clicon_handle h,
 	    goto done;
 	}
 	clicon_xml2cbuf(cbret, xret, 0, 0, -1);
-	netconf_output_encap(1, cbret, "rpc-error");
-	cc_closed++;
+	netconf_output_encap(netconf_session_cur->ns_out, cbret, "rpc-error");
+	netconf_session_cur->ns_closed++;
 	goto ok;
     }
     if ((ret = xml_bind_yang_rpc(xrpc, yspec, &xret)) < 0)
@@ -221,7 +242,7 @@ netconf_rpc_message(clicon_handle h,
 	    goto done;
 	}
 	clicon_xml2cbuf(cbret, xret, 0, 0, -1);
-	if (netconf_output_encap(1, cbret, "rpc-error") < 0)
+	if (netconf_output_encap(netconf_session_cur->ns_out, cbret, "rpc-error") < 0)
 	    goto done;
 	goto ok;
     }
@@ -239,7 +260,7 @@ netconf_rpc_message(clicon_handle h,
 	    goto done;
 	}
 	clicon_xml2cbuf(cbret, xret, 0, 0, -1);
-	if (netconf_output_encap(1, cbret, "rpc-error") < 0)
+	if (netconf_output_encap(netconf_session_cur->ns_out, cbret, "rpc-error") < 0)
 	    goto done;
 	goto ok;
     }
@@ -252,7 +273,7 @@ netconf_rpc_message(clicon_handle h,
 	    goto done;
 	}
 	clicon_xml2cbuf(cbret, xml_child_i(xret,0), 0, 0, -1);
-	if (netconf_output_encap(1, cbret, "rpc-reply") < 0)
+	if (netconf_output_encap(netconf_session_cur->ns_out, cbret, "rpc-reply") < 0)
 	    goto done;
     }
  ok:
@@ -302,7 +323,7 @@ netconf_input_packet(clicon_handle h,
 		goto done;
 	    }
 	    clicon_xml2cbuf(cbret, xret, 0, 0, -1);
-	    netconf_output_encap(1, cbret, "rpc-error");
+	    netconf_output_encap(netconf_session_cur->ns_out, cbret, "rpc-error");
 	    goto ok;
 	}
 	if (netconf_rpc_message(h, xreq, yspec) < 0)
@@ -324,7 +345,7 @@ netconf_input_packet(clicon_handle h,
 	}
 	if (netconf_unknown_element(cbret, "protocol", rpcname, "Unrecognized netconf operation")< 0)
 	    goto done;
-	netconf_output_encap(1, cbret, "rpc-error");
+	netconf_output_encap(netconf_session_cur->ns_out, cbret, "rpc-error");
     }
  ok:
     retval = 0;
@@ -334,10 +355,10 @@ netconf_input_packet(clicon_handle h,
     return retval;
 }
 
-/*! Process incoming frame, ie a char message framed by ]]>]]>
+/*! Process incoming frame, ie a char message framed by ]]>]]> or by chunks
  * Parse string to xml, check only one netconf message within a frame
  * @param[in]   h    Clicon handle
- * @param[in]   cb   Packet buffer
+ * @param[in]   cb   Packet buffer, message is the null-terminated string
  * @retval      0    OK
  * @retval     -1    Fatal error
  * @note there are errors detected here prior to whether you know what kind if message it is, and
@@ -357,7 +378,7 @@ netconf_input_frame(clicon_handle h,
 		    cbuf         *cb)
 {
     int        retval = -1;
-    char      *str = NULL;
+    char      *str;
     cxobj     *xtop = NULL; /* Request (in) */
     cxobj     *xreq = NULL;
     cxobj     *xret = NULL; /* Return (out) */
@@ -368,19 +389,16 @@ netconf_input_frame(clicon_handle h,
     clicon_debug(1, "%s", __FUNCTION__);
     clicon_debug(2, "%s: \"%s\"", __FUNCTION__, cbuf_get(cb));
     yspec = clicon_dbspec_yang(h);
-    if ((str = strdup(cbuf_get(cb))) == NULL){
-	clicon_err(OE_UNIX, errno, "strdup");
-	goto done;
-    }
+    str = cbuf_get(cb);
     /* Special case:  */
-    if (strlen(str) == 0){
+    if (*str == '\0'){
 	if ((cbret = cbuf_new()) == NULL){ 
 	    clicon_err(OE_UNIX, errno, "cbuf_new");
 	    goto done;
 	}
 	if (netconf_operation_failed(cbret, "rpc", "Empty XML")< 0)
 	    goto done;
-	netconf_output_encap(1, cbret, "rpc-error"); 
+	netconf_output_encap(netconf_session_cur->ns_out, cbret, "rpc-error"); 
 	goto ok;
     }
     /* Parse incoming XML message */
@@ -391,7 +409,7 @@ netconf_input_frame(clicon_handle h,
 	}
 	if (netconf_operation_failed(cbret, "rpc", clicon_err_reason)< 0)
 	    goto done;
-	netconf_output_encap(1, cbret, "rpc-error");
+	netconf_output_encap(netconf_session_cur->ns_out, cbret, "rpc-error");
 	goto ok;
     }
     if (ret == 0){
@@ -404,7 +422,7 @@ netconf_input_frame(clicon_handle h,
 	    goto done;
 	}
 	clicon_xml2cbuf(cbret, xret, 0, 0, -1);
-	netconf_output_encap(1, cbret, "rpc-error");
+	netconf_output_encap(netconf_session_cur->ns_out, cbret, "rpc-error");
 	goto ok;
     }
     /* Check for empty frame (no mesaages), return empty message, not clear from RFC what to do */
@@ -413,7 +431,7 @@ netconf_input_frame(clicon_handle h,
 	    clicon_err(OE_UNIX, errno, "cbuf_new");
 	    goto done;
 	}
-	netconf_output_encap(1, cbret, "rpc-error");
+	netconf_output_encap(netconf_session_cur->ns_out, cbret, "rpc-error");
 	goto ok;
     }
     /* Check for multi-messages in frame */
@@ -424,7 +442,7 @@ netconf_input_frame(clicon_handle h,
 	}
 	if (netconf_malformed_message(cbret, "More than one message in netconf rpc frame")< 0)
 	    goto done;
-	netconf_output_encap(1, cbret, "rpc-error"); 
+	netconf_output_encap(netconf_session_cur->ns_out, cbret, "rpc-error"); 
 	goto ok;
     }
     if ((xreq = xml_child_i_type(xtop, 0, CX_ELMNT)) == NULL){ /* Shouldnt happen */
@@ -436,8 +454,6 @@ netconf_input_frame(clicon_handle h,
  ok:
     retval = 0;
  done:
-    if (str)
-	free(str);
     if (xtop)
 	xml_free(xtop);
     if (xret)
@@ -447,13 +463,175 @@ netconf_input_frame(clicon_handle h,
     return retval;
 }
 
+/*! Find RFC 4742 end-of-message marker in a buffer
+ * Candidate positions are found with memchr, instead of a state machine per byte.
+ * @param[in]   buf     Buffer
+ * @param[in]   len     Length of buffer
+ * @param[in]   offset  Start scanning at this offset
+ * @retval      pos     Offset of marker in buf
+ * @retval     -1       Not found
+ */
+static ssize_t
+netconf_eom_find(char  *buf,
+		 size_t len,
+		 size_t offset)
+{
+    char  *p = buf + offset;
+    char  *end = buf + len;
+    size_t eomlen = strlen(NETCONF_EOM);
+
+    while (end - p >= eomlen &&
+	   (p = memchr(p, NETCONF_EOM[0], end - p - eomlen + 1)) != NULL){
+	if (memcmp(p, NETCONF_EOM, eomlen) == 0)
+	    return p - buf;
+	p++;
+    }
+    return -1;
+}
+
+/*! Read input data framed with end-of-message marker ]]>]]>
+ * Data is appended in bulk and only the new data (and a possible partial marker) is scanned
+ * @param[in]   ni     Input framing state
+ * @param[in]   buf    Input data
+ * @param[in]   len    Length of input data
+ * @param[out]  np     Number of bytes of buf consumed
+ * @retval      1      Complete message in ni_cb as null-terminated string
+ * @retval      0      All data consumed, message not complete
+ * @retval     -1      Error
+ */
+static int
+netconf_input_eom(struct netconf_input *ni,
+		  unsigned char        *buf,
+		  size_t                len,
+		  size_t               *np)
+{
+    cbuf          *cb = ni->ni_cb;
+    unsigned char *p;
+    size_t         n;
+    size_t         len0;
+    size_t         eomlen = strlen(NETCONF_EOM);
+    ssize_t        pos;
+
+    /* Skip NULL chars (eg from terminals) */
+    if ((p = memchr(buf, '\0', len)) != NULL)
+	n = p - buf;
+    else
+	n = len;
+    len0 = cbuf_len(cb);
+    if (cbuf_append_buf(cb, buf, n) < 0){
+	clicon_err(OE_XML, errno, "cbuf_append_buf");
+	return -1;
+    }
+    if ((pos = netconf_eom_find(cbuf_get(cb), cbuf_len(cb),
+				len0 < eomlen ? 0 : len0 - eomlen + 1)) < 0){
+	*np = p ? n + 1 : n;
+	return 0;
+    }
+    /* Remove trailer, data after the marker belongs to the next message */
+    *(cbuf_get(cb) + pos) = '\0';
+    *np = pos + eomlen - len0;
+    return 1;
+}
+
+/*! Read input data framed with RFC 6242 chunked framing
+ * Chunk headers are parsed incrementally, chunk-data is copied in bulk.
+ * @param[in]   ni     Input framing state
+ * @param[in]   buf    Input data
+ * @param[in]   len    Length of input data
+ * @param[out]  np     Number of bytes of buf consumed
+ * @retval      1      Complete message in ni_cb as null-terminated string
+ * @retval      0      All data consumed, message not complete
+ * @retval     -1      Error, invalid framing
+ */
+static int
+netconf_input_chunked(struct netconf_input *ni,
+		      unsigned char        *buf,
+		      size_t                len,
+		      size_t               *np)
+{
+    unsigned char *p = buf;
+    unsigned char *end = buf + len;
+    size_t         n;
+    int            c;
+
+    while (p < end){
+	if (ni->ni_state == CHUNK_DATA){
+	    n = end - p;
+	    if (n > ni->ni_size)
+		n = ni->ni_size;
+	    if (cbuf_append_buf(ni->ni_cb, p, n) < 0){
+		clicon_err(OE_XML, errno, "cbuf_append_buf");
+		return -1;
+	    }
+	    p += n;
+	    if ((ni->ni_size -= n) == 0)
+		ni->ni_state = CHUNK_LF;
+	    continue;
+	}
+	c = *p++;
+	switch (ni->ni_state){
+	case CHUNK_LF:
+	    if (c != '\n')
+		goto err;
+	    ni->ni_state = CHUNK_HASH;
+	    break;
+	case CHUNK_HASH:
+	    if (c != '#')
+		goto err;
+	    ni->ni_state = CHUNK_SIZE1;
+	    break;
+	case CHUNK_SIZE1:
+	    if (c == '#'){
+		if (cbuf_len(ni->ni_cb) == 0) /* At least one chunk */
+		    goto err;
+		ni->ni_state = CHUNK_END;
+	    }
+	    else if (c >= '1' && c <= '9'){
+		ni->ni_size = c - '0';
+		ni->ni_state = CHUNK_SIZE;
+	    }
+	    else
+		goto err;
+	    break;
+	case CHUNK_SIZE:
+	    if (c == '\n')
+		ni->ni_state = CHUNK_DATA;
+	    else if (c >= '0' && c <= '9'){
+		ni->ni_size = ni->ni_size*10 + c - '0';
+		if (ni->ni_size > CHUNK_SIZE_MAX)
+		    goto err;
+	    }
+	    else
+		goto err;
+	    break;
+	case CHUNK_END:
+	    if (c != '\n')
+		goto err;
+	    ni->ni_state = CHUNK_LF;
+	    *np = p - buf;
+	    return 1;
+	case CHUNK_DATA: /* Handled above */
+	    break;
+	}
+    }
+    *np = p - buf;
+    return 0;
+ err:
+    clicon_err(OE_XML, EBADMSG, "Invalid netconf chunked framing (see RFC 6242 Sec 4.2)");
+    return -1;
+}
+
 /*! Get netconf message: detect end-of-msg 
  * @param[in]   s    Socket where input arrived. read from this.
- * @param[in]   arg  Clicon handle.
+ * @param[in]   arg  Netconf session
  * This routine continuously reads until no more data on s. There could
  * be risk of starvation, but the netconf client does little else than
  * read data so I do not see a danger of true starvation here.
- * @note data is saved in clicon-handle at NETCONF_HASH_BUF since there is a potential issue if data
+ * In server mode however, only one read is made so that other sessions are served in between.
+ * Each read is framed in bulk with end-of-message or chunked framing, whichever is active
+ * when the data is reached: a base:1.1 hello switches to chunked framing also for the
+ * remaining data of the same read.
+ * @note input framing state is saved in the session since there is a potential issue if data
  * is not completely present on the s, ie if eg:
  *   <a>foo ..pause.. </a>]]>]]>
  * then only "</a>" would be delivered to netconf_input_frame().
@@ -463,86 +641,77 @@ netconf_input_cb(int   s,
 		 void *arg)
 {
     int           retval = -1;
-    clicon_handle h = arg;
+    struct netconf_session *ns = (struct netconf_session *)arg;
+    clicon_handle h = ns->ns_h;
+    struct netconf_input *ni = &ns->ns_input;
     unsigned char buf[BUFSIZ]; /* from stdio.h, typically 8K */
-    int           i;
+    size_t        i;
+    size_t        n;
     int           len;
-    cbuf         *cb=NULL;
-    int           xml_state = 0;
+    int           ret;
     int           poll;
-    clicon_hash_t *cdat = clicon_data(h); /* Save cbuf between calls if not done */
-    size_t         cdatlen = 0;
-    void          *ptr;
 
-    if ((ptr = clicon_hash_value(cdat, NETCONF_HASH_BUF, &cdatlen)) != NULL){
-	if (cdatlen != sizeof(cb)){
-	    clicon_err(OE_XML, errno, "size mismatch %lu %lu",
-		       (unsigned long)cdatlen, (unsigned long)sizeof(cb));
-	    goto done;
-	}
-	cb = *(cbuf**)ptr;
-	clicon_hash_del(cdat, NETCONF_HASH_BUF);
-    }
-    else{
-	if ((cb = cbuf_new()) == NULL){
-	    clicon_err(OE_XML, errno, "cbuf_new");
-	    goto done;
-	}
-    }
-    memset(buf, 0, sizeof(buf));
+    if (netconf_session_enter(ns) < 0)
+	goto done;
     while (1){
 	if ((len = read(s, buf, sizeof(buf))) < 0){
 	    if (errno == ECONNRESET)
 		len = 0; /* emulate EOF */
+	    else if (ns->ns_server && (errno == EAGAIN || errno == EWOULDBLOCK))
+		break; /* Non-blocking session socket, no data */
 	    else{
 		clicon_log(LOG_ERR, "%s: read: %s", __FUNCTION__, strerror(errno));
 		goto done;
 	    }
 	} /* read */
 	if (len == 0){ 	/* EOF */
-	    cc_closed++;
-	    close(s);
-	    retval = 0;
-	    goto done;
+	    ns->ns_closed++;
+	    break;
 	}
-	for (i=0; i<len; i++){
-	    if (buf[i] == 0)
-		continue; /* Skip NULL chars (eg from terminals) */
-	    cprintf(cb, "%c", buf[i]);
-	    if (detect_endtag("]]>]]>",
-			      buf[i],
-			      &xml_state)) {
+	for (i=0; i<len; i+=n){
+	    if (ns->ns_framing == NETCONF_SSH_CHUNKED)
+		ret = netconf_input_chunked(ni, buf+i, len-i, &n);
+	    else
+		ret = netconf_input_eom(ni, buf+i, len-i, &n);
+	    if (ret < 0){
+		/* Invalid framing: the session cannot be resynchronized */
+		clicon_log(LOG_ERR, "%s: %s", __FUNCTION__, clicon_err_reason);
+		ns->ns_closed++;
+		break;
+	    }
+	    if (ret == 1){
 		/* OK, we have an xml string from a client */
-		/* Remove trailer */
-		*(((char*)cbuf_get(cb)) + cbuf_len(cb) - strlen("]]>]]>")) = '\0';
-		if (netconf_input_frame(h, cb) < 0 &&
+		if (netconf_input_frame(h, ni->ni_cb) < 0 &&
 		    !ignore_packet_errors) // default is to ignore errors
 		    goto done; 
-		if (cc_closed){
+		if (ns->ns_closed){
 		    break;
 		}
-		cbuf_reset(cb);
+		cbuf_reset(ni->ni_cb);
 	    }
 	}
+	if (ns->ns_closed || ns->ns_server)
+	    break;
 	/* poll==1 if more, poll==0 if none */
 	if ((poll = clixon_event_poll(s)) < 0)
 	    goto done;
-	if (poll == 0){
-	    /* No data to read, save data and continue on next round */
-	    if (cbuf_len(cb) != 0){
-		if (clicon_hash_add(cdat, NETCONF_HASH_BUF, &cb, sizeof(cb)) == NULL)
-		    return -1;
-		cb = NULL;
-	    }
-	    break; 
-	}
+	if (poll == 0)
+	    break; /* No data to read, data is saved in session until next round */
     } /* while */
     retval = 0;
   done:
-    if (cb)
-	cbuf_free(cb);
-    if (cc_closed) 
-	retval = -1;
+    if (netconf_session_cur == ns)
+	netconf_session_leave(ns);
+    if (retval < 0 || ns->ns_closed){
+	/* In server mode only the session ends, otherwise the process */
+	if (ns->ns_server){
+	    clicon_debug(1, "%s session %u closed", __FUNCTION__, ns->ns_id);
+	    netconf_session_end(ns);
+	    retval = 0;
+	}
+	else
+	    retval = -1;
+    }
     return retval;
 }
 
@@ -573,6 +742,299 @@ send_hello(clicon_handle h,
     return retval;
 }
 
+/*! Start a netconf session
+ * Send hello request to backend to get session-id back.
+ * This is done once at the beginning of the session and then this is
+ * used by the client, even though new TCP sessions are created for
+ * each message sent to the backend.
+ * Then send hello to northbound client and register session input.
+ * @param[in]   ns  Netconf session
+ */
+static int
+netconf_session_start(struct netconf_session *ns)
+{
+    int           retval = -1;
+    clicon_handle h = ns->ns_h;
+    uint32_t      id;
+
+    if (netconf_session_enter(ns) < 0)
+	goto done;
+    if (clicon_hello_req(h, &id) < 0)
+	goto done;
+    ns->ns_id = id;
+    clicon_session_id_set(h, id);
+    /* Send hello to northbound client 
+     * Note that this is a violation of RDFC 6241 Sec 8.1:
+     * When the NETCONF session is opened, each peer(both client and server) MUST send a <hello..
+     */
+    if (!quiet){
+	if (send_hello(h, ns->ns_out, id) < 0)
+	    goto done;
+    }
+    if (clixon_event_reg_fd(ns->ns_s, netconf_input_cb, ns, "netconf socket") < 0)
+	goto done;
+    retval = 0;
+ done:
+    netconf_session_leave(ns);
+    return retval;
+}
+
+/*! End a netconf session: close its backend session and sockets, and free it
+ * @param[in]   ns  Netconf session
+ */
+static int
+netconf_session_end(struct netconf_session *ns)
+{
+    clicon_handle h = ns->ns_h;
+
+    if (netconf_session_enter(ns) == 0 && ns->ns_id)
+	clicon_rpc_close_session(h);
+    netconf_notification_close(ns);
+    netconf_session_leave(ns);
+    if (ns->ns_backend != -1)
+	close(ns->ns_backend);
+    clixon_event_unreg_fd(ns->ns_s, netconf_input_cb);
+    if (ns->ns_server)
+	close(ns->ns_s);
+    netconf_session_free(ns);
+    return 0;
+}
+
+/*! Accept a northbound session on the netconf server socket
+ * The user of the session is the user of the connecting process, ie the user logged in via
+ * ssh when clixon_netconf -C is the ssh subsystem.
+ * Errors in setting up a session closes only that session.
+ * @param[in]  ss   Server socket
+ * @param[in]  arg  Clixon handle
+ */
+static int
+netconf_accept_cb(int   ss,
+		  void *arg) 
+{
+    clicon_handle           h = (clicon_handle)arg;
+    int                     s;
+    struct sockaddr_un      from = {0,};
+    socklen_t               len;
+    char                   *name = NULL;
+    struct netconf_session *ns;
+    int                     flags;
+#ifdef HAVE_SO_PEERCRED        /* Linux. */
+    socklen_t               clen;
+    struct ucred            cr = {0,};
+#elif defined(HAVE_GETPEEREID) /* FreeBSD */
+    uid_t                   euid;
+    uid_t                   guid;
+#endif
+
+    len = sizeof(from);
+    if ((s = accept(ss, (struct sockaddr*)&from, &len)) < 0){
+	clicon_err(OE_UNIX, errno, "accept");
+	return 0;
+    }
+    /* Get credentials of connected peer */
+#if defined(HAVE_SO_PEERCRED)
+    clen =  sizeof(cr);
+    if(getsockopt(s, SOL_SOCKET, SO_PEERCRED, &cr, &clen) < 0){
+	clicon_err(OE_UNIX, errno, "getsockopt");
+	goto err;
+    }
+    if (uid2name(cr.uid, &name) < 0)
+	goto err;
+#elif defined(HAVE_GETPEEREID)
+    if (getpeereid(s, &euid, &guid) < 0){
+	clicon_err(OE_UNIX, errno, "getpeereid");
+	goto err;
+    }
+    if (uid2name(euid, &name) < 0)
+	goto err;
+#else
+#error "Need getsockopt O_PEERCRED or getpeereid for unix socket peer cred"
+#endif
+    if (name == NULL){
+	clicon_err(OE_UNIX, ENOENT, "No user of netconf client");
+	goto err;
+    }
+    /* Output to a client that does not read must not block other sessions */
+    if ((flags = fcntl(s, F_GETFL, 0)) < 0 ||
+	fcntl(s, F_SETFL, flags | O_NONBLOCK) < 0){
+	clicon_err(OE_UNIX, errno, "fcntl");
+	goto err;
+    }
+    if ((ns = netconf_session_new(h, s, s, name)) == NULL)
+	goto err;
+    ns->ns_server = 1;
+    if (netconf_session_start(ns) < 0){
+	netconf_session_end(ns);
+	goto ok;
+    }
+    clicon_debug(1, "%s session %u user %s", __FUNCTION__, ns->ns_id, name);
+ ok:
+    free(name);
+    return 0;
+ err:
+    close(s);
+    if (name)
+	free(name);
+    return 0;
+}
+
+/*! Open the netconf server socket, a UNIX domain socket where northbound sessions connect
+ *
+ * The socket is accessed via CLICON_NETCONF_SOCK option, has 770 permissions
+ * and group according to CLICON_SOCK_GROUP option, as the backend socket.
+ * @param[in]  h    Clicon handle
+ * @param[in]  sock Unix file-system path
+ * @retval     s    Socket file descriptor (see socket(2))
+ * @retval    -1    Error
+ */
+static int
+netconf_server_socket(clicon_handle h,
+		      char         *sock)
+{
+    int                s;
+    struct sockaddr_un addr;
+    mode_t             old_mask;
+    char              *config_group;
+    gid_t              gid;
+    struct stat        st;
+
+    if (lstat(sock, &st) == 0 && unlink(sock) < 0){
+	clicon_err(OE_UNIX, errno, "unlink(%s)", sock);
+	return -1;
+    }
+    if ((config_group = clicon_sock_group(h)) == NULL){
+	clicon_err(OE_FATAL, 0, "clicon_sock_group option not set");
+	return -1;
+    }
+    if (group_name2gid(config_group, &gid) < 0)
+	return -1;
+    if ((s = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+	clicon_err(OE_UNIX, errno, "socket");
+	return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, sock, sizeof(addr.sun_path)-1);
+    old_mask = umask(S_IRWXO | S_IXGRP | S_IXUSR);
+    if (bind(s, (struct sockaddr *)&addr, SUN_LEN(&addr)) < 0){
+	clicon_err(OE_UNIX, errno, "bind");
+	umask(old_mask); 
+	goto err;
+    }
+    umask(old_mask); 
+    /* change socket path file group */
+    if (lchown(sock, -1, gid) < 0){
+	clicon_err(OE_UNIX, errno, "lchown(%s, %s)", sock, config_group);
+	goto err;
+    }
+    clicon_debug(1, "Listen on netconf server socket at %s", addr.sun_path);
+    if (listen(s, SOMAXCONN) < 0){
+	clicon_err(OE_UNIX, errno, "listen");
+	goto err;
+    }
+    return s;
+  err:
+    close(s);
+    return -1;
+}
+
+/*! Write all of a buffer, retry on partial writes
+ * @param[in]  s    File descriptor
+ * @param[in]  buf  Buffer
+ * @param[in]  len  Length of buffer
+ */
+static int
+netconf_proxy_write(int   s,
+		    char *buf,
+		    int   len)
+{
+    int n;
+
+    while (len > 0){
+	if ((n = write(s, buf, len)) < 0){
+	    if (errno == EINTR)
+		continue;
+	    clicon_err(OE_UNIX, errno, "write");
+	    return -1;
+	}
+	buf += n;
+	len -= n;
+    }
+    return 0;
+}
+
+/*! Relay a northbound session on stdin/stdout to a netconf server (-C)
+ * A lightweight front-end to be used as ssh subsystem instead of a full netconf process:
+ * no configuration or yang is loaded, the server identifies the user by the credentials
+ * of this process.
+ * @param[in]  sock  Unix socket path of netconf server, see CLICON_NETCONF_SOCK
+ * @retval     0     Session ended
+ * @retval    -1     Error
+ */
+static int
+netconf_proxy(char *sock)
+{
+    int                retval = -1;
+    int                s = -1;
+    struct sockaddr_un addr;
+    struct pollfd      fds[2];
+    char               buf[BUFSIZ];
+    int                len;
+    int                nfds = 2;
+
+    if ((s = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+	clicon_err(OE_UNIX, errno, "socket");
+	goto done;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, sock, sizeof(addr.sun_path)-1);
+    if (connect(s, (struct sockaddr *)&addr, SUN_LEN(&addr)) < 0){
+	clicon_err(OE_UNIX, errno, "connect(%s)", sock);
+	goto done;
+    }
+    fds[0].fd = s;
+    fds[0].events = POLLIN;
+    fds[1].fd = 0;
+    fds[1].events = POLLIN;
+    while (1){
+	if (poll(fds, nfds, -1) < 0){
+	    if (errno == EINTR)
+		continue;
+	    clicon_err(OE_UNIX, errno, "poll");
+	    goto done;
+	}
+	if (fds[0].revents){ /* From server to stdout */
+	    if ((len = read(s, buf, sizeof(buf))) < 0){
+		clicon_err(OE_UNIX, errno, "read");
+		goto done;
+	    }
+	    if (len == 0) /* Session closed by server */
+		break;
+	    if (netconf_proxy_write(1, buf, len) < 0)
+		goto done;
+	}
+	if (nfds > 1 && fds[1].revents){ /* From stdin to server */
+	    if ((len = read(0, buf, sizeof(buf))) < 0){
+		clicon_err(OE_UNIX, errno, "read");
+		goto done;
+	    }
+	    if (len == 0){
+		/* End of input, wait for remaining output from server */
+		shutdown(s, SHUT_WR);
+		nfds = 1;
+	    }
+	    else if (netconf_proxy_write(s, buf, len) < 0)
+		goto done;
+	}
+    }
+    retval = 0;
+ done:
+    if (s != -1)
+	close(s);
+    return retval;
+}
+
 /*! Clean and close all state of netconf process (but dont exit). 
  * Cannot use h after this 
  * @param[in]  h  Clixon handle
@@ -583,11 +1045,20 @@ netconf_terminate(clicon_handle h)
     yang_stmt  *yspec;
     cvec       *nsctx;
     cxobj      *x;
+    char       *sock;
+    struct netconf_session *ns;
     
     /* Delete all plugins, and RPC callbacks */
     clixon_plugin_module_exit(h);
 
-    clicon_rpc_close_session(h);
+    /* Close all sessions, also their backend sessions */
+    while ((ns = netconf_session_each(NULL)) != NULL)
+	netconf_session_end(ns);
+    if (netconf_server_s != -1){
+	close(netconf_server_s);
+	if ((sock = clicon_option_str(h, "CLICON_NETCONF_SOCK")) != NULL)
+	    unlink(sock);
+    }
     if ((yspec = clicon_dbspec_yang(h)) != NULL)
 	ys_free(yspec);
     if ((yspec = clicon_config_yang(h)) != NULL)
@@ -604,6 +1075,19 @@ netconf_terminate(clicon_handle h)
     return 0;
 }
 
+/*! Termination signal in server mode: exit the event loop and close all sessions
+ */
+static void
+netconf_sig_term(int arg)
+{
+    static int i=0;
+
+    if (i++ == 0)
+	clicon_log(LOG_NOTICE, "%s: %s: pid: %u Signal %d", 
+		   __PROGRAM__, __FUNCTION__, getpid(), arg);
+    clixon_exit_set(1); /* checked in clixon_event_loop() */
+}
+
 static int
 timeout_fn(int s,
 	   void *arg)
@@ -636,7 +1120,9 @@ usage(clicon_handle h,
 	    "\t-U <user>\tOver-ride unix user with a pseudo user for NACM.\n"
 	    "\t-t <sec>\tTimeout in seconds. Quit after this time.\n"
 	    "\t-e \t\tDont ignore errors on packet input.\n"
-	    "\t-o \"<option>=<value>\"\tGive configuration option overriding config file (see clixon-config.yang)\n",
+	    "\t-o \"<option>=<value>\"\tGive configuration option overriding config file (see clixon-config.yang)\n"
+	    "\t-S \t\tServer mode: serve sessions on unix socket CLICON_NETCONF_SOCK\n"
+	    "\t-C <sock>\tRelay stdin/stdout to netconf server at unix socket <sock>\n",
 	    argv0,
 	    clicon_netconf_dir(h)
 	    );
@@ -650,7 +1136,6 @@ main(int    argc,
     int              retval = -1;
     int              c;
     char            *argv0 = argv[0];
-    int              quiet = 0;
     clicon_handle    h;
     char            *dir;
     int              logdst = CLICON_LOG_STDERR;
@@ -658,11 +1143,13 @@ main(int    argc,
     struct timeval   tv = {0,}; /* timeout */
     yang_stmt       *yspec = NULL;
     char            *str;
-    uint32_t         id;
     cvec            *nsctx_global = NULL; /* Global namespace context */
     size_t           cligen_buflen;
     size_t           cligen_bufthreshold;
     int              dbg = 0;
+    int              server = 0;
+    char            *proxysock = NULL;
+    struct netconf_session *ns;
     
     /* Create handle */
     if ((h = clicon_handle_init()) == NULL)
@@ -704,6 +1191,11 @@ main(int    argc,
 		clicon_log_file(optarg+1) < 0)
 		goto done;
 	     break;
+	case 'C': /* Relay to netconf server */
+	    if (!strlen(optarg))
+		usage(h, argv[0]);
+	    proxysock = optarg;
+	    break;
 	}
 
     /* 
@@ -712,6 +1204,13 @@ main(int    argc,
     clicon_log_init(__PROGRAM__, dbg?LOG_DEBUG:LOG_INFO, logdst); 
     clicon_debug_init(dbg, NULL); 
 
+    /* Relay to netconf server: no configuration or yang is loaded */
+    if (proxysock){
+	retval = netconf_proxy(proxysock);
+	clicon_handle_exit(h);
+	return retval;
+    }
+
     /* Find, read and parse configfile */
     if (clicon_options_main(h) < 0)
 	goto done;
@@ -726,6 +1225,7 @@ main(int    argc,
 	case 'f':  /* config file */
 	case 'E': /* extra config dir */
 	case 'l':  /* log  */
+	case 'C':  /* relay */
 	    break; /* see above */
 	case 'q':  /* quiet: dont write hello */
 	    quiet++;
@@ -764,6 +1264,9 @@ main(int    argc,
 	case 'e': /* dont ignore packet errors */
 	    ignore_packet_errors = 0;
 	    break;
+	case 'S': /* server mode */
+	    server++;
+	    break;
 	case 'o':{ /* Configuration option */
 	    char          *val;
 	    if ((val = index(optarg, '=')) == NULL)
@@ -848,30 +1351,35 @@ main(int    argc,
     /* Call start function is all plugins before we go interactive */
     if (clixon_plugin_start_all(h) < 0)
 	goto done;
+    if (server){
+	/* Many sessions on server socket */
+	if ((str = clicon_option_str(h, "CLICON_NETCONF_SOCK")) == NULL){
+	    clicon_err(OE_FATAL, 0, "CLICON_NETCONF_SOCK option not set");
+	    goto done;
+	}
+	if ((netconf_server_s = netconf_server_socket(h, str)) < 0)
+	    goto done;
+	if (clixon_event_reg_fd(netconf_server_s, netconf_accept_cb, h, "netconf server socket") < 0)
+	    goto done;
+	/* Writing to a closed session should not terminate the server */
+	if (set_signal(SIGPIPE, SIG_IGN, NULL) < 0 ||
+	    set_signal(SIGTERM, netconf_sig_term, NULL) < 0 ||
+	    set_signal(SIGINT, netconf_sig_term, NULL) < 0){
+	    clicon_err(OE_UNIX, errno, "Setting signal");
+	    goto done;
+	}
+    }
+    else{
 #if 1
-    /* XXX get session id from backend hello */
-    clicon_session_id_set(h, getpid()); 
+	/* XXX get session id from backend hello */
+	clicon_session_id_set(h, getpid()); 
 #endif
-
-    /* Send hello request to backend to get session-id back
-     * This is done once at the beginning of the session and then this is
-     * used by the client, even though new TCP sessions are created for
-     * each message sent to the backend.
-     */
-    if (clicon_hello_req(h, &id) < 0)
-	goto done;
-    clicon_session_id_set(h, id);
-    
-    /* Send hello to northbound client 
-     * Note that this is a violation of RDFC 6241 Sec 8.1:
-     * When the NETCONF session is opened, each peer(both client and server) MUST send a <hello..
-     */
-    if (!quiet){
-	if (send_hello(h, 1, id) < 0)
+	/* Single session on stdin/stdout */
+	if ((ns = netconf_session_new(h, 0, 1, clicon_username_get(h))) == NULL)
+	    goto done;
+	if (netconf_session_start(ns) < 0)
 	    goto done;
     }
-    if (clixon_event_reg_fd(0, netconf_input_cb, h, "netconf socket") < 0)
-	goto done;
     if (dbg)
 	clicon_option_dump(h, dbg);
     if (tv.tv_sec || tv.tv_usec){
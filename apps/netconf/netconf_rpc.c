@@ -449,7 +449,8 @@ netconf_notification_cb(int   s,
     cbuf              *cb;
     cxobj             *xn = NULL; /* event xml */
     cxobj             *xt = NULL; /* top xml */
-    clicon_handle      h = (clicon_handle)arg;
+    struct netconf_session *ns = (struct netconf_session *)arg;
+    clicon_handle      h = ns->ns_h;
     yang_stmt         *yspec = NULL;
     cvec              *nsc = NULL;
     int                ret;
@@ -462,9 +463,8 @@ netconf_notification_cb(int   s,
     /* handle close from remote end: this will exit the client */
     if (eof){
 	clicon_err(OE_PROTO, ESHUTDOWN, "Socket unexpected close");
-	close(s);
+	netconf_notification_close(ns);
 	errno = ESHUTDOWN;
-	clixon_event_unreg_fd(s, netconf_notification_cb);
 	goto done;
     }
     yspec = clicon_dbspec_yang(h);
@@ -485,16 +485,26 @@ netconf_notification_cb(int   s,
     }
     if (clicon_xml2cbuf(cb, xn, 0, 0, -1) < 0)
 	goto done;
-    /* Send it to listening client on stdout */
-    if (netconf_output_encap(1, cb, "notification") < 0){
+    /* Send it to listening client */
+    if (netconf_session_enter(ns) < 0){
 	cbuf_free(cb);
 	goto done;
     }
-    fflush(stdout);
+    ret = netconf_output_encap(ns->ns_out, cb, "notification");
+    netconf_session_leave(ns);
     cbuf_free(cb);
+    if (ret < 0)
+	goto done;
  ok:
     retval = 0;
  done:
+    /* In server mode, end only this session: its input is shut down, which closes the
+     * session when read */
+    if (retval < 0 && ns->ns_server){
+	netconf_notification_close(ns);
+	shutdown(ns->ns_s, SHUT_RDWR);
+	retval = 0;
+    }
     if (nsc)
 	xml_nsctx_free(nsc);
     if (xt != NULL)
@@ -506,6 +516,21 @@ netconf_notification_cb(int   s,
     return retval;
 }
 
+/*! Close notification socket of a session, if any
+ * @param[in]  ns  Netconf session
+ */
+int
+netconf_notification_close(struct netconf_session *ns)
+{
+    if (ns->ns_notify != -1){
+	clixon_event_unreg_fd(ns->ns_notify, netconf_notification_cb);
+	close(ns->ns_notify);
+	ns->ns_notify = -1;
+	ns->ns_notify_id = 0;
+    }
+    return 0;
+}
+
 /*
     <create-subscription> 
        <stream>RESULT</stream> # If not present, events in the default NETCONF stream will be sent.
@@ -514,6 +539,8 @@ netconf_notification_cb(int   s,
        <stopTime/>  # only for replay (NYI)
     </create-subscription> 
     Dont support replay
+ * Also RFC 8639 establish-subscription, eg a RFC 8641 yang-push subscription, whose
+ * notifications are also received on a backend socket of its own.
  * @param[in]  h       clicon handle
  * @param[in]  xn      Sub-tree (under xorig) at <rpc>...</rpc> level.
  * @param[out] xret    Return XML, error or OK
@@ -528,7 +555,21 @@ netconf_create_subscription(clicon_handle h,
     cxobj           *xfilter; 
     int              s;
     char            *ftype;
+    struct netconf_session *ns = netconf_session_cur;
+    cxobj           *xid;
+    char            *reason = NULL;
 
+    /* One active subscription per session */
+    if (ns->ns_notify != -1){
+	clixon_xml_parse_va(YB_NONE, NULL, xret, NULL, "<rpc-reply xmlns=\"%s\"><rpc-error>"
+			    "<error-tag>operation-failed</error-tag>"
+			    "<error-type>protocol</error-type>"
+			    "<error-severity>error</error-severity>"
+			    "<error-message>Subscription already active on session</error-message>"
+			    "</rpc-error></rpc-reply>",
+			    NETCONF_BASE_NAMESPACE);
+	goto ok;
+    }
     if ((xfilter = xpath_first(xn, NULL, "//filter")) != NULL){
 	if ((ftype = xml_find_value(xfilter, "type")) != NULL){
 	    if (strcmp(ftype, "xpath") != 0){
@@ -550,12 +591,51 @@ netconf_create_subscription(clicon_handle h,
 	goto ok;
     if (clixon_event_reg_fd(s, 
 		     netconf_notification_cb, 
-		     h,
+		     ns,
 		     "notification socket") < 0)
 	goto done;
+    ns->ns_notify = s;
+    if ((xid = xpath_first(*xret, NULL, "rpc-reply/id")) != NULL &&
+	parse_uint32(xml_body(xid), &ns->ns_notify_id, &reason) < 0)
+	goto done;
  ok:
     retval = 0;
   done:
+    if (reason)
+	free(reason);
+    return retval;
+}
+
+/*! Delete RFC 8639 subscription, close the notification socket if it is the subscription
+ * of this session
+ * @param[in]  h       clicon handle
+ * @param[in]  xn      Sub-tree (under xorig) at <rpc>...</rpc> level.
+ * @param[out] xret    Return XML, error or OK
+ */
+static int
+netconf_delete_subscription(clicon_handle h, 
+			    cxobj        *xn, 
+			    cxobj       **xret)
+{
+    int                     retval = -1;
+    struct netconf_session *ns = netconf_session_cur;
+    uint32_t                id = 0;
+    char                   *str;
+    char                   *reason = NULL;
+
+    if (clicon_rpc_netconf_xml(h, xml_parent(xn), xret, NULL) < 0)
+	goto done;
+    if (xpath_first(*xret, NULL, "rpc-reply/rpc-error") != NULL)
+	goto ok;
+    if ((str = xml_find_body(xn, "id")) != NULL &&
+	parse_uint32(str, &id, &reason) == 1 &&
+	id == ns->ns_notify_id)
+	netconf_notification_close(ns);
+ ok:
+    retval = 0;
+ done:
+    if (reason)
+	free(reason);
     return retval;
 }
 
@@ -730,7 +810,7 @@ netconf_rpc_dispatch(clicon_handle h,
 		goto done;
 	}
 	else if (strcmp(xml_name(xe), "close-session") == 0){
-	    cc_closed++;
+	    netconf_session_cur->ns_closed++;
 	    if (clicon_rpc_netconf_xml(h, xml_parent(xe), xret, NULL) < 0)
 		goto done;	
 	}
@@ -739,6 +819,15 @@ netconf_rpc_dispatch(clicon_handle h,
 	    if (netconf_create_subscription(h, xe, xret) < 0)
 		goto done;
 	}
+	/* RFC 8639 dynamic subscriptions, eg RFC 8641 yang-push */
+	else if (strcmp(xml_name(xe), "establish-subscription") == 0){
+	    if (netconf_create_subscription(h, xe, xret) < 0)
+		goto done;
+	}
+	else if (strcmp(xml_name(xe), "delete-subscription") == 0){
+	    if (netconf_delete_subscription(h, xe, xret) < 0)
+		goto done;
+	}
 	/* Others */
 	else {
 	    /* Look for application-defined RPC. This may either be local
@@ -39,6 +39,8 @@
 #ifndef _NETCONF_RPC_H_
 #define _NETCONF_RPC_H_
 
+struct netconf_session; /* see netconf_lib.h */
+
 /*
  * Prototypes
  */ 
@@ -46,5 +48,6 @@ int
 netconf_rpc_dispatch(clicon_handle h,
 		     cxobj        *xn, 
 		     cxobj       **xret);
+int netconf_notification_close(struct netconf_session *ns);
 
 #endif  /* _NETCONF_RPC_H_ */
@@ -38,6 +38,22 @@
 #ifndef _RESTCONF_API_H_
 #define _RESTCONF_API_H_
 
+/*
+ * Constants
+ */
+/* Size of each part of a streamed reply body, see restconf_reply_send_stream */
+#define RESTCONF_BODY_CHUNK 16384
+
+/*
+ * Types
+ */
+/* Append next part of a streamed reply body to cb, of approximately maxlen bytes
+ * (0: all). Return 1 if more remains, 0 if done, -1 on error */
+typedef int (restconf_body_fn)(void *arg, cbuf *cb, size_t maxlen);
+
+/* Free the argument of a streamed reply body */
+typedef int (restconf_body_free_fn)(void *arg);
+
 /*
  * Prototypes
  */
@@ -49,6 +65,9 @@ int restconf_reply_header(void *req, const char *name, const char *vfmt, ...);
 
 /* note cb is consumed dont free */
 int restconf_reply_send(void *req, int code, cbuf *cb, int head);
+/* note cb and arg are consumed dont free */
+int restconf_reply_send_stream(void *req, int code, cbuf *cb,
+			       restconf_body_fn *fn, restconf_body_free_fn *freefn, void *arg);
 
 cbuf *restconf_get_indata(void *req);
 
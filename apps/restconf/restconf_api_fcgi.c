@@ -220,6 +220,51 @@ restconf_reply_send(void  *req0,
     return retval;
 }
 
+/*! Send HTTP reply with a message body produced in parts
+ * Each part is written to fastcgi as it is produced
+ * @param[in]     req    Fastcgi request handle
+ * @param[in]     code   Status code
+ * @param[in]     cb     First part of body. Note is consumed
+ * @param[in]     fn     Produce next part of body
+ * @param[in]     freefn Free arg when body is done
+ * @param[in]     arg    Argument to fn and freefn. Note is consumed
+ * @see restconf_reply_send  for a body in a single buffer
+ */
+int
+restconf_reply_send_stream(void                  *req0,
+			   int                    code,
+			   cbuf                  *cb,
+			   restconf_body_fn      *fn,
+			   restconf_body_free_fn *freefn,
+			   void                  *arg)
+{
+    FCGX_Request *req = (FCGX_Request *)req0;
+    int           retval = -1;
+    const char   *reason_phrase;
+    int           ret;
+
+    FCGX_SetExitStatus(code, req->out);
+    if ((reason_phrase = restconf_code2reason(code)) == NULL)
+	reason_phrase="";
+    if (restconf_reply_header(req, "Status", "%d %s", code, reason_phrase) < 0)
+	goto done;
+    FCGX_FPrintF(req->out, "\r\n");
+    do {
+	FCGX_PutStr(cbuf_get(cb), cbuf_len(cb), req->out);
+	cbuf_reset(cb);
+	if ((ret = (*fn)(arg, cb, RESTCONF_BODY_CHUNK)) < 0)
+	    goto done;
+    } while (ret == 1);
+    FCGX_PutStr(cbuf_get(cb), cbuf_len(cb), req->out);
+    FCGX_FPrintF(req->out, "\r\n");
+    FCGX_FFlush(req->out);
+    retval = 0;
+ done:
+    cbuf_free(cb);
+    (*freefn)(arg);
+    return retval;
+}
+
 /*! Get input data from http request, eg such as curl -X PUT http://... <indata>
  * @param[in]  req        Fastcgi request handle
  * @retval     indata     
@@ -172,6 +172,49 @@ restconf_reply_send(void  *req0,
     return retval;
 }
 
+/*! Send HTTP reply with a message body produced in parts
+ * The first part is given in cb, the rest is produced by fn when the previous part has
+ * been sent: as http/1.1 chunks or as http/2 DATA frames.
+ * @param[in]     req    http request handle
+ * @param[in]     code   Status code
+ * @param[in]     cb     First part of body. Note is consumed
+ * @param[in]     fn     Produce next part of body
+ * @param[in]     freefn Free arg when body is done or request is aborted
+ * @param[in]     arg    Argument to fn and freefn. Note is consumed
+ * @see restconf_reply_send  for a body in a single buffer
+ */
+int
+restconf_reply_send_stream(void                  *req0,
+			   int                    code,
+			   cbuf                  *cb,
+			   restconf_body_fn      *fn,
+			   restconf_body_free_fn *freefn,
+			   void                  *arg)
+{
+    int                   retval = -1;
+    restconf_stream_data *sd = (restconf_stream_data *)req0;
+
+    clicon_debug(1, "%s code:%d", __FUNCTION__, code);
+    if (sd == NULL){
+	clicon_err(OE_CFG, EINVAL, "sd is NULL");
+	cbuf_free(cb);
+	(*freefn)(arg);
+	goto done;
+    }
+    sd->sd_code = code;
+    if (sd->sd_body)
+	cbuf_free(sd->sd_body);
+    sd->sd_body = cb;
+    sd->sd_body_offset = 0;
+    sd->sd_body_len = 0; /* Not known in advance */
+    sd->sd_body_fn = fn;
+    sd->sd_body_free = freefn;
+    sd->sd_body_arg = arg;
+    retval = 0;
+ done:
+    return retval;
+}
+
 /*! Get input data from http request, eg such as curl -X PUT http://... <indata>
  * @param[in]  req        Request handle
  * @note: reuses cbuf from stream-data
@@ -0,0 +1,452 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+ 
+  Copyright (C) 2009-2019 Olof Hagsand
+  Copyright (C) 2020-2021 Olof Hagsand and Rubicon Communications, LLC(Netgate)
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2, 
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+
+ * Restconf cache of GET responses and entity-tags
+ *
+ * Encoded responses of GET requests of configuration data (content=config) are cached,
+ * keyed by user, media type, pretty-print, api-path and query.
+ * All entries are invalidated when the running datastore changes:
+ * - The backend sends a clixon-lib:datastore-changed notification on the
+ *   CLIXON_DATASTORE_STREAM before it replies to the client making a change.
+ *   Pending notifications are read before each lookup, therefore a change that a
+ *   client has seen completed is never followed by a stale cached read.
+ * - A write request (not GET/HEAD) via this restconf process clears the cache directly.
+ * If the subscription is lost, eg backend restarts, the cache is disabled.
+ * Since NACM rules are configured in running, a change of rules also clears the cache.
+ * 
+ * Strong entity-tags (RFC 7232) are computed from the encoded response body and are
+ * also stored in the cache, an If-None-Match request matching the tag gets a 304 reply.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "clixon_config.h" /* generated by config & autoconf */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <syslog.h>
+#include <poll.h>
+
+/* cligen */
+#include <cligen/cligen.h>
+
+/* clicon */
+#include <clixon/clixon.h>
+
+#include "restconf_lib.h"
+#include "restconf_handle.h"
+#include "restconf_api.h"
+#include "restconf_cache.h"
+
+/* Cached response, value in hash */
+typedef struct {
+    uint64_t ce_etag;   /* Entity-tag of body */
+    size_t   ce_len;    /* Length of body (excluding NULL) */
+    char     ce_body[]; /* Encoded body, NULL-terminated */
+} restconf_cache_entry;
+
+/* Cache handle */
+typedef struct {
+    clicon_hash_t *rk_hash;   /* Key to restconf_cache_entry */
+    uint32_t       rk_size;   /* Max number of entries */
+    int            rk_s;      /* Backend subscription socket, -1 if lost */
+    uint64_t       rk_hits;   /* Statistics */
+    uint64_t       rk_misses;
+} restconf_cache;
+
+/* Forward */
+static int restconf_cache_notify_cb(int s, void *arg);
+
+/*! Get restconf cache handle
+ * @param[in]  h     Clicon handle
+ * @retval     rk    Cache handle
+ * @retval     NULL  Cache not initialized
+ */
+static restconf_cache *
+restconf_cache_handle_get(clicon_handle h)
+{
+    clicon_hash_t *cdat = clicon_data(h);
+    void          *p;
+
+    if ((p = clicon_hash_value(cdat, "restconf-get-cache", NULL)) != NULL)
+	return *(restconf_cache **)p;
+    return NULL;
+}
+
+/*! Initialize restconf GET cache and subscribe to datastore changes in backend
+ *
+ * Requires CLICON_STREAM_DATASTORE to be set in the backend.
+ * Call after the backend session is created, in each worker process.
+ * @param[in]  h     Clicon handle
+ * @param[in]  size  Max number of cached responses, 0 disables the cache
+ * @retval     0     OK, also if the subscription failed and the cache is not enabled
+ * @retval    -1     Error
+ */
+int
+restconf_cache_init(clicon_handle h,
+		    uint32_t      size)
+{
+    int             retval = -1;
+    restconf_cache *rk = NULL;
+    int             s = -1;
+
+    clicon_debug(1, "%s size:%u", __FUNCTION__, size);
+    if (size == 0)
+	goto ok;
+    if (clicon_rpc_create_subscription(h, CLIXON_DATASTORE_STREAM, NULL, &s) < 0){
+	clicon_log(LOG_WARNING, "%s: No %s stream, restconf GET cache disabled (set CLICON_STREAM_DATASTORE)",
+		   __FUNCTION__, CLIXON_DATASTORE_STREAM);
+	clicon_err_reset();
+	goto ok;
+    }
+    if ((rk = malloc(sizeof(*rk))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	goto done;
+    }
+    memset(rk, 0, sizeof(*rk));
+    rk->rk_size = size;
+    rk->rk_s = s;
+    if ((rk->rk_hash = clicon_hash_init()) == NULL)
+	goto done;
+    if (clixon_event_reg_fd(s, restconf_cache_notify_cb, h, "restconf cache subscription") < 0)
+	goto done;
+    s = -1;
+    if (clicon_hash_add(clicon_data(h), "restconf-get-cache", &rk, sizeof(rk)) == NULL)
+	goto done;
+    rk = NULL;
+ ok:
+    retval = 0;
+ done:
+    if (s != -1)
+	close(s);
+    if (rk){
+	if (rk->rk_s != -1){
+	    clixon_event_unreg_fd(rk->rk_s, restconf_cache_notify_cb);
+	    close(rk->rk_s);
+	}
+	if (rk->rk_hash)
+	    clicon_hash_free(rk->rk_hash);
+	free(rk);
+    }
+    return retval;
+}
+
+/*! Free restconf GET cache
+ * @param[in]  h     Clicon handle
+ */
+int
+restconf_cache_exit(clicon_handle h)
+{
+    restconf_cache *rk;
+
+    if ((rk = restconf_cache_handle_get(h)) == NULL)
+	return 0;
+    clicon_debug(1, "%s hits:%" PRIu64 " misses:%" PRIu64, __FUNCTION__,
+		 rk->rk_hits, rk->rk_misses);
+    if (rk->rk_s != -1){
+	clixon_event_unreg_fd(rk->rk_s, restconf_cache_notify_cb);
+	close(rk->rk_s);
+    }
+    if (rk->rk_hash)
+	clicon_hash_free(rk->rk_hash);
+    free(rk);
+    clicon_hash_del(clicon_data(h), "restconf-get-cache");
+    return 0;
+}
+
+/*! Check if restconf GET cache is enabled, ie initialized and subscription is active
+ * @param[in]  h     Clicon handle
+ * @retval     1     Enabled
+ * @retval     0     Not enabled
+ */
+int
+restconf_cache_enabled(clicon_handle h)
+{
+    restconf_cache *rk;
+
+    return (rk = restconf_cache_handle_get(h)) != NULL && rk->rk_s != -1;
+}
+
+/*! Remove all cached responses
+ * @param[in]  h     Clicon handle
+ */
+int
+restconf_cache_clear(clicon_handle h)
+{
+    restconf_cache *rk;
+
+    if ((rk = restconf_cache_handle_get(h)) == NULL ||
+	clicon_hash_len(rk->rk_hash) == 0)
+	return 0;
+    clicon_debug(1, "%s", __FUNCTION__);
+    clicon_hash_free(rk->rk_hash);
+    if ((rk->rk_hash = clicon_hash_init()) == NULL)
+	return -1;
+    return 0;
+}
+
+/*! Receive a datastore notification from backend and clear the cache
+ *
+ * On backend close, the cache is disabled
+ * @param[in]  s     Subscription socket
+ * @param[in]  arg   Clicon handle
+ */
+static int
+restconf_cache_notify_cb(int   s,
+			 void *arg)
+{
+    int                retval = -1;
+    clicon_handle      h = (clicon_handle)arg;
+    restconf_cache    *rk;
+    struct clicon_msg *msg = NULL;
+    int                eof = 0;
+
+    if (clicon_msg_rcv(s, &msg, &eof) < 0)
+	goto done;
+    if ((rk = restconf_cache_handle_get(h)) == NULL)
+	goto ok;
+    if (eof){
+	clicon_log(LOG_WARNING, "%s: Backend subscription closed, restconf GET cache disabled",
+		   __FUNCTION__);
+	clixon_event_unreg_fd(s, restconf_cache_notify_cb);
+	close(s);
+	rk->rk_s = -1;
+    }
+    /* Any notification, eg datastore-changed, invalidates all */
+    if (restconf_cache_clear(h) < 0)
+	goto done;
+ ok:
+    retval = 0;
+ done:
+    if (msg)
+	free(msg);
+    return retval;
+}
+
+/*! Read pending datastore notifications without blocking
+ *
+ * The event loop may serve a request before a notification that arrived earlier.
+ * @param[in]  h     Clicon handle
+ * @param[in]  rk    Cache handle
+ */
+static int
+restconf_cache_sync(clicon_handle   h,
+		    restconf_cache *rk)
+{
+    struct pollfd pfd;
+
+    while (rk->rk_s != -1){
+	pfd.fd = rk->rk_s;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	if (poll(&pfd, 1, 0) <= 0 || pfd.revents == 0)
+	    break;
+	if (restconf_cache_notify_cb(rk->rk_s, h) < 0)
+	    return -1;
+    }
+    return 0;
+}
+
+/*! Create cache key of a GET request
+ * @param[in]  h         Clicon handle
+ * @param[in]  api_path  Api-path of request
+ * @param[in]  qvec      Query parameters
+ * @param[in]  pretty    Pretty-print
+ * @param[in]  media     Output media
+ * @retval     cb        Key, free with cbuf_free
+ * @retval     NULL      Error
+ */
+cbuf *
+restconf_cache_key(clicon_handle  h,
+		   char          *api_path,
+		   cvec          *qvec,
+		   int            pretty,
+		   restconf_media media)
+{
+    cbuf   *cb;
+    cg_var *cv = NULL;
+    char   *user;
+
+    if ((cb = cbuf_new()) == NULL){
+	clicon_err(OE_UNIX, errno, "cbuf_new");
+	return NULL;
+    }
+    /* The user determines the NACM rules */
+    user = clicon_username_get(h);
+    cprintf(cb, "%s\n%d\n%d\n%s", user?user:"", media, pretty, api_path?api_path:"");
+    while ((cv = cvec_each(qvec, cv)) != NULL)
+	cprintf(cb, "%c%s=%s", cv==cvec_i(qvec, 0)?'?':'&',
+		cv_name_get(cv), cv_string_get(cv)?cv_string_get(cv):"");
+    return cb;
+}
+
+/*! Look up a cached response
+ * @param[in]  h     Clicon handle
+ * @param[in]  key   Key from restconf_cache_key
+ * @param[out] cbp   Copy of encoded body, free with cbuf_free
+ * @param[out] etag  Entity-tag of body
+ * @retval     1     Found
+ * @retval     0     Not found
+ * @retval    -1     Error
+ */
+int
+restconf_cache_get(clicon_handle h,
+		   char         *key,
+		   cbuf        **cbp,
+		   uint64_t     *etag)
+{
+    restconf_cache       *rk;
+    restconf_cache_entry *ce;
+    cbuf                 *cb;
+
+    if ((rk = restconf_cache_handle_get(h)) == NULL)
+	return 0;
+    if (restconf_cache_sync(h, rk) < 0)
+	return -1;
+    if (rk->rk_s == -1 ||
+	(ce = clicon_hash_value(rk->rk_hash, key, NULL)) == NULL){
+	rk->rk_misses++;
+	return 0;
+    }
+    rk->rk_hits++;
+    if ((cb = cbuf_new_alloc(ce->ce_len+3)) == NULL){
+	clicon_err(OE_UNIX, errno, "cbuf_new_alloc");
+	return -1;
+    }
+    cbuf_append_buf(cb, ce->ce_body, ce->ce_len);
+    *cbp = cb;
+    *etag = ce->ce_etag;
+    return 1;
+}
+
+/*! Store an encoded response in the cache
+ *
+ * If the cache is full, an arbitrary entry is replaced
+ * @param[in]  h     Clicon handle
+ * @param[in]  key   Key from restconf_cache_key
+ * @param[in]  cb    Encoded body
+ * @param[in]  etag  Entity-tag of body
+ */
+int
+restconf_cache_put(clicon_handle h,
+		   char         *key,
+		   cbuf         *cb,
+		   uint64_t      etag)
+{
+    int                   retval = -1;
+    restconf_cache       *rk;
+    restconf_cache_entry *ce = NULL;
+    size_t                len;
+    clicon_hash_t         hp;
+    char                 *k = NULL;
+
+    if ((rk = restconf_cache_handle_get(h)) == NULL || rk->rk_s == -1)
+	goto ok;
+    if (clicon_hash_len(rk->rk_hash) >= rk->rk_size &&
+	clicon_hash_lookup(rk->rk_hash, key) == NULL &&
+	(hp = clicon_hash_next(rk->rk_hash, NULL)) != NULL){
+	if ((k = strdup(hp->h_key)) == NULL){
+	    clicon_err(OE_UNIX, errno, "strdup");
+	    goto done;
+	}
+	clicon_hash_del(rk->rk_hash, k);
+    }
+    len = sizeof(*ce) + cbuf_len(cb) + 1;
+    if ((ce = malloc(len)) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	goto done;
+    }
+    ce->ce_etag = etag;
+    ce->ce_len = cbuf_len(cb);
+    memcpy(ce->ce_body, cbuf_get(cb), ce->ce_len+1);
+    if (clicon_hash_add(rk->rk_hash, key, ce, len) == NULL)
+	goto done;
+ ok:
+    retval = 0;
+ done:
+    if (k)
+	free(k);
+    if (ce)
+	free(ce);
+    return retval;
+}
+
+/*! Compute strong entity-tag of a response body (FNV-1a)
+ * @param[in]  cb    Encoded body
+ * @retval     etag  Entity-tag
+ */
+uint64_t
+restconf_etag(cbuf *cb)
+{
+    uint64_t      hash = 14695981039346656037ULL;
+    unsigned char *p = (unsigned char*)cbuf_get(cb);
+    size_t        i;
+
+    for (i=0; i<cbuf_len(cb); i++){
+	hash ^= p[i];
+	hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/*! Set ETag reply header and check If-None-Match request header
+ * @param[in]  h     Clicon handle
+ * @param[in]  req   Generic Www handle
+ * @param[in]  etag  Entity-tag of response
+ * @retval     1     If-None-Match matches, reply 304 Not Modified instead of body
+ * @retval     0     No match, reply with body
+ * @retval    -1     Error
+ * @see RFC 7232 Sec 3.2
+ */
+int
+restconf_etag_header(clicon_handle h,
+		     void         *req,
+		     uint64_t      etag)
+{
+    char  tag[20];
+    char *inm;
+
+    snprintf(tag, sizeof(tag), "\"%016" PRIx64 "\"", etag);
+    if (restconf_reply_header(req, "ETag", "%s", tag) < 0)
+	return -1;
+    if ((inm = restconf_param_get(h, "HTTP_IF_NONE_MATCH")) == NULL)
+	return 0;
+    /* Either "*" or a list of entity-tags, possibly weak W/"..." which compare equal */
+    if (strcmp(inm, "*") == 0 || strstr(inm, tag) != NULL)
+	return 1;
+    return 0;
+}
@@ -0,0 +1,55 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+ 
+  Copyright (C) 2009-2019 Olof Hagsand
+  Copyright (C) 2020-2021 Olof Hagsand and Rubicon Communications, LLC(Netgate)
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2, 
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+
+ * Restconf cache of GET responses and entity-tags
+ */
+
+#ifndef _RESTCONF_CACHE_H_
+#define _RESTCONF_CACHE_H_
+
+/*
+ * Prototypes
+ */
+int   restconf_cache_init(clicon_handle h, uint32_t size);
+int   restconf_cache_exit(clicon_handle h);
+int   restconf_cache_enabled(clicon_handle h);
+int   restconf_cache_clear(clicon_handle h);
+cbuf *restconf_cache_key(clicon_handle h, char *api_path, cvec *qvec, int pretty,
+			 restconf_media media);
+int   restconf_cache_get(clicon_handle h, char *key, cbuf **cbp, uint64_t *etag);
+int   restconf_cache_put(clicon_handle h, char *key, cbuf *cb, uint64_t etag);
+uint64_t restconf_etag(cbuf *cb);
+int   restconf_etag_header(clicon_handle h, void *req, uint64_t etag);
+
+#endif /* _RESTCONF_CACHE_H_ */
@@ -394,15 +394,27 @@ restconf_evhtp_reply(restconf_conn        *rc,
      * server MUST NOT send a Content-Length header field in any 2xx
      * (Successful) response to a CONNECT request (Section 4.3.6 of
      * [RFC7231]).
+     * A 304 (Not Modified) has no body, and a Content-Length would be of the full response.
      */
-    if (sd->sd_code != 204 && sd->sd_code > 199)
+    if (sd->sd_body_fn != NULL && req->proto != EVHTP_PROTO_11){
+	/* Streamed body but no chunked transfer coding in http/1.0: produce all of it */
+	if (restconf_stream_body_next(sd, 0) < 0)
+	    goto done;
+	sd->sd_body_len = cbuf_len(sd->sd_body);
+    }
+    if (sd->sd_body_fn != NULL){
+	/* Streamed body is written in chunks by restconf_conn_body after the headers */
+	if (restconf_reply_header(sd, "Transfer-Encoding", "chunked") < 0)
+	    goto done;
+    }
+    else if (sd->sd_code != 204 && sd->sd_code != 304 && sd->sd_code > 199)
 	if (restconf_reply_header(sd, "Content-Length", "%zu", sd->sd_body_len) < 0)
 	    goto done;	
     /* Create reply and write headers */
     if (native_send_reply(rc, sd, req) < 0)
 	goto done;
     /* Write a body */
-    if (sd->sd_body){
+    if (sd->sd_body && sd->sd_body_fn == NULL){
 	cbuf_append_str(sd->sd_outp_buf, cbuf_get(sd->sd_body));
     }
     retval = 0;
@@ -954,3 +954,169 @@ restconf_socket_extract(clicon_handle h,
     return retval;
 }
 
+
+/*! Signal from a worker process that exited
+ * Just so that sigsuspend in the master returns
+ */
+static void
+restconf_sig_worker(int arg)
+{
+    clicon_sig_child_set(1);
+}
+
+/*! Fork a worker process
+ * In the worker, the backend socket and session-id of the master are not shared, a separate
+ * backend session is opened, and the mode-specific init function is called.
+ * @param[in]  h       Clicon handle
+ * @param[in]  worker  Worker number
+ * @param[in]  sigset  Signal mask to restore in worker
+ * @param[in]  fn      Mode-specific worker init function, or NULL
+ * @retval     pid     In master: process id of new worker
+ * @retval     0       In worker
+ * @retval    -1       Error
+ */
+static pid_t
+restconf_worker_fork(clicon_handle            h,
+		     int                      worker,
+		     sigset_t                *sigset,
+		     restconf_worker_init_fn *fn)
+{
+    pid_t    pid;
+    int      s;
+    uint32_t id;
+
+    if ((pid = fork()) < 0){
+	clicon_err(OE_UNIX, errno, "fork");
+	return -1;
+    }
+    if (pid == 0){ /* Worker */
+	if (set_signal(SIGCHLD, SIG_DFL, NULL) < 0)
+	    return -1;
+	sigprocmask(SIG_SETMASK, sigset, NULL);
+	/* Do not share backend socket and session-id with master and other workers */
+	if ((s = clicon_client_socket_get(h)) >= 0){
+	    close(s);
+	    clicon_client_socket_set(h, -1);
+	}
+	if (clicon_session_id_get(h, &id) == 0){
+	    if (clicon_hello_req(h, &id) < 0)
+		return -1;
+	    clicon_session_id_set(h, id);
+	}
+	if (fn && (*fn)(h, worker) < 0)
+	    return -1;
+	return 0;
+    }
+    clicon_log(LOG_NOTICE, "%s: worker %d pid: %u started", __PROGRAM__, worker, pid);
+    return pid;
+}
+
+/*! Run restconf as a master with several worker processes
+ *
+ * If only one worker is configured, do nothing: the calling process handles all requests.
+ * Otherwise the calling process becomes a master that forks the workers, which return to
+ * serve requests. The master restarts workers that exit, and on a termination signal
+ * terminates all workers and returns.
+ * Listening sockets should be opened and privileges dropped before the workers are forked.
+ * @param[in]  h        Clicon handle
+ * @param[in]  nworkers Number of worker processes
+ * @param[in]  fn       Mode-specific init function called in each worker, or NULL
+ * @retval     1        In a worker (or only one worker): continue serving requests
+ * @retval     0        In master: all workers are terminated
+ * @retval    -1        Error
+ */
+int
+restconf_workers_run(clicon_handle            h,
+		     int                      nworkers,
+		     restconf_worker_init_fn *fn)
+{
+    int      retval = -1;
+    pid_t   *pids = NULL;
+    time_t  *started = NULL;
+    int      i;
+    pid_t    pid;
+    int      status;
+    int      s;
+    sigset_t sigset;
+    sigset_t oldset;
+
+    if (nworkers <= 1)
+	goto worker;
+    if ((pids = calloc(nworkers, sizeof(*pids))) == NULL ||
+	(started = calloc(nworkers, sizeof(*started))) == NULL){
+	clicon_err(OE_UNIX, errno, "calloc");
+	goto done;
+    }
+    /* The master does not use the backend */
+    if ((s = clicon_client_socket_get(h)) >= 0){
+	close(s);
+	clicon_client_socket_set(h, -1);
+    }
+    if (set_signal(SIGCHLD, restconf_sig_worker, NULL) < 0)
+	goto done;
+    /* Block signals except in sigsuspend to not lose any between waitpid and sigsuspend */
+    sigemptyset(&sigset);
+    sigaddset(&sigset, SIGCHLD);
+    sigaddset(&sigset, SIGTERM);
+    sigaddset(&sigset, SIGINT);
+    sigprocmask(SIG_BLOCK, &sigset, &oldset);
+    for (i=0; i<nworkers; i++){
+	if ((pid = restconf_worker_fork(h, i, &oldset, fn)) < 0)
+	    goto done;
+	if (pid == 0)
+	    goto worker;
+	pids[i] = pid;
+	started[i] = time(NULL);
+    }
+    while (clixon_exit_get() != 1){
+	if ((pid = waitpid(-1, &status, WNOHANG)) < 0){
+	    clicon_err(OE_UNIX, errno, "waitpid");
+	    goto done;
+	}
+	if (pid == 0){ /* No worker exited, wait for signal */
+	    sigsuspend(&oldset);
+	    continue;
+	}
+	for (i=0; i<nworkers; i++)
+	    if (pids[i] == pid)
+		break;
+	if (i == nworkers)
+	    continue;
+	pids[i] = 0;
+	if (WIFSIGNALED(status))
+	    clicon_log(LOG_NOTICE, "%s: worker %d pid: %u killed by signal %d",
+		       __PROGRAM__, i, pid, WTERMSIG(status));
+	else
+	    clicon_log(LOG_NOTICE, "%s: worker %d pid: %u exited with status %d",
+		       __PROGRAM__, i, pid, WEXITSTATUS(status));
+	/* Restart, but avoid a fork loop if a worker fails directly at start */
+	if (time(NULL) - started[i] < 1)
+	    sleep(1);
+	if (clixon_exit_get() == 1)
+	    break;
+	if ((pid = restconf_worker_fork(h, i, &oldset, fn)) < 0)
+	    goto done;
+	if (pid == 0)
+	    goto worker;
+	pids[i] = pid;
+	started[i] = time(NULL);
+    }
+    /* Terminate workers */
+    for (i=0; i<nworkers; i++)
+	if (pids[i] > 0)
+	    kill(pids[i], SIGTERM);
+    for (i=0; i<nworkers; i++)
+	if (pids[i] > 0)
+	    waitpid(pids[i], &status, 0);
+    sigprocmask(SIG_SETMASK, &oldset, NULL);
+    retval = 0;
+ done:
+    if (pids)
+	free(pids);
+    if (started)
+	free(started);
+    return retval;
+ worker:
+    retval = 1;
+    goto done;
+}
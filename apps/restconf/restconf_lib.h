@@ -75,6 +75,9 @@ enum restconf_http_proto{
     HTTP_2
 };
 typedef enum restconf_http_proto restconf_http_proto;
+
+/* Mode-specific init of a forked worker process, see restconf_workers_run */
+typedef int (restconf_worker_init_fn)(clicon_handle h, int worker);
     
 /*
  * Prototypes
@@ -97,6 +100,7 @@ int   restconf_authentication_cb(clicon_handle h, void *req, int pretty, restcon
 int   restconf_config_init(clicon_handle h, cxobj *xrestconf);
 int   restconf_socket_init(const char *netns0, const char *addrstr, const char *addrtype, uint16_t port, int backlog, int flags, int *ss);
 int   restconf_socket_extract(clicon_handle h, cxobj *xs, cvec *nsc, char **namespace, char **address, char **addrtype, uint16_t *port, uint16_t *ssl);
+int   restconf_workers_run(clicon_handle h, int nworkers, restconf_worker_init_fn *fn);
 
 #endif /* _RESTCONF_LIB_H_ */
 
@@ -170,6 +170,24 @@ restconf_sig_child(int arg)
 	stream_child_free(_CLICON_HANDLE, pid);
 }
 
+/*! Set up a forked fcgi worker process
+ * @param[in]  h       Clicon handle
+ * @param[in]  worker  Worker number
+ * @see restconf_workers_run
+ */
+static int
+fcgi_worker_init(clicon_handle h,
+		 int           worker)
+{
+    clicon_debug(1, "%s %d", __FUNCTION__, worker);
+    /* Reap stream children of this worker */
+    if (set_signal(SIGCHLD, restconf_sig_child, NULL) < 0){
+	clicon_err(OE_DAEMON, errno, "Setting signal");
+	return -1;
+    }
+    return 0;
+}
+
 /*! Usage help routine
  * @param[in]  argv0  command line
  * @param[in]  h      Clicon handle
@@ -232,6 +250,11 @@ main(int    argc,
     cxobj         *xconfig3 = NULL;   
     cxobj         *xrestconf3 = NULL; /* Config from backend */
     int            configure_done = 0; /* First try local then backend */
+    cxobj         *xrestconf = NULL;  /* Restconf config used, one of the above */
+    cxobj         *x;
+    char          *bstr;
+    int32_t        workers = 1;
+    char          *reason = NULL;
     cvec          *nsc = NULL;
     cxobj         *xerr = NULL;
     struct passwd *pw;
@@ -419,11 +442,9 @@ main(int    argc,
     if (yang_spec_parse_module(h, "ietf-restconf", NULL, yspec)< 0)
 	goto done;
     
-#ifdef YANG_PATCH
     /* Load yang restconf patch module */
     if (yang_spec_parse_module(h, "ietf-yang-patch", NULL, yspec)< 0)
-       goto done;
-#endif // YANG_PATCH
+	goto done;
 
     /* Add netconf yang spec, used as internal protocol */
     if (netconf_module_load(h) < 0)
@@ -467,16 +488,20 @@ main(int    argc,
 	    goto done;
 	if ((ret = restconf_config_init(h, xrestconf1)) < 0)
 	    goto done;
-	if (ret == 1)
+	if (ret == 1){
 	    configure_done = 1;
+	    xrestconf = xrestconf1;
+	}
     }
     else if (clicon_option_bool(h, "CLICON_BACKEND_RESTCONF_PROCESS") == 0){
 	/* 2. If not read from backend, try to get restconf config from local config-file */
 	if ((xrestconf2 = clicon_conf_restconf(h)) != NULL){
 	    if ((ret = restconf_config_init(h, xrestconf2)) < 0)
 		goto done;
-	    if (ret == 1)
+	    if (ret == 1){
 		configure_done = 1;
+		xrestconf = xrestconf2;
+	    }
 	}
     }
     /* 3. If no local config, or it is disabled, try to query backend of config. */
@@ -511,14 +536,29 @@ main(int    argc,
 	if ((xrestconf3 = xpath_first(xconfig3, nsc, "restconf")) != NULL){
 	    if ((ret = restconf_config_init(h, xrestconf3)) < 0)
 		goto done;
-	    if (ret == 1)
+	    if (ret == 1){
 		configure_done = 1;
+		xrestconf = xrestconf3;
+	    }
 	}
     }
     if (!configure_done){     /* Query backend of config. */
 	clicon_err(OE_DAEMON, EFAULT, "Restconf daemon config not found or disabled");
 	goto done;
     }
+    /* Number of worker processes accepting requests on the fastcgi socket */
+    if ((x = xpath_first(xrestconf, NULL, "workers")) != NULL &&
+	(bstr = xml_body(x)) != NULL){
+	if ((ret = parse_int32(bstr, &workers, &reason)) < 0){
+	    clicon_err(OE_XML, errno, "parse_int32");
+	    goto done;
+	}
+	if (ret == 0 || workers < 1){
+	    clicon_err(OE_CFG, EINVAL, "Invalid number of restconf workers: %s%s%s",
+		       bstr, reason?": ":"", reason?reason:"");
+	    goto done;
+	}
+    }
     /* XXX see restconf_config_init access directly */
     if ((sockpath = clicon_option_str(h, "CLICON_RESTCONF_PATH")) == NULL){
 	clicon_err(OE_CFG, errno, "No CLICON_RESTCONF_PATH in clixon configure file");
@@ -558,6 +598,15 @@ main(int    argc,
      */
     if (restconf_drop_privileges(h) < 0)
 	goto done;
+    /* Fork workers if several are configured. All accept requests on the same fastcgi
+     * socket, each with its own backend session, so that requests are served in parallel.
+     * The master returns when the workers are terminated */
+    if ((ret = restconf_workers_run(h, workers, fcgi_worker_init)) < 0)
+	goto done;
+    if (ret == 0){
+	retval = 0;
+	goto done;
+    }
     if (FCGX_InitRequest(req, sock, 0) != 0){
 	clicon_err(OE_CFG, errno, "FCGX_InitRequest");
 	goto done;
@@ -639,6 +688,8 @@ main(int    argc,
     } /* while */
     retval = 0;
  done:
+    if (reason)
+	free(reason);
     if (xrestconf1)
 	xml_free(xrestconf1);
     if (xconfig3)
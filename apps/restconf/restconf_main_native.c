@@ -139,6 +139,9 @@
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <sys/resource.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <time.h>
 
 #include <openssl/ssl.h>
 #include <openssl/rand.h>
@@ -173,6 +176,8 @@
 #include "restconf_err.h"
 #include "restconf_root.h"
 #include "restconf_native.h"   /* Restconf-openssl mode specific headers*/
+#include "restconf_tls_cache.h" /* TLS session cache and tickets */
+#include "restconf_cache.h"     /* GET response cache */
 #ifdef HAVE_LIBEVHTP
 #include "restconf_evhtp.h"   /* http/1 */
 #endif
@@ -183,12 +188,9 @@
 /* Command line options to be passed to getopt(3) */
 #define RESTCONF_OPTS "hD:f:E:l:p:y:a:u:rW:R:o:"
 
-/* If set, open outwards socket non-blocking, as opposed to blocking
- * Should work both ways, but in the ninblocking case,
- * the read/write/accept calls have an iteration to read/write/accept again in case
- * they are not completed in time. Note, in the accept case it has to do with SSL handshake.
- * Currently, the end-result is the same in both cases.
- * But it gets important in a multi-threaded setup.
+/* If set, open outwards (listening) socket non-blocking, as opposed to blocking
+ * Accepted data sockets are always non-blocking: reads, writes and the SSL handshake
+ * return to the event loop when they would block and are resumed when the socket is ready.
  */
 #define RESTCONF_OPENSSL_NONBLOCKING 1
 
@@ -199,7 +201,7 @@
 #define VERIFY_DEPTH 5
 
 /* Forward */
-static int restconf_connection(int s, void* arg);
+static int restconf_ssl_handshake(restconf_conn *rc);
 
 static int             session_id_context = 1;
 
@@ -237,96 +239,56 @@ restconf_native_handle_set(clicon_handle   h,
     return 0;
 }
 
-/* Write evbuf to socket
- * see also this function in restcont_api_openssl.c
+/*! Socket is ready for an SSL operation that returned SSL_ERROR_WANT_READ/WRITE
+ * Resume the TLS handshake, or the read if the handshake is done
+ * @param[in]  s    Socket
+ * @param[in]  arg  Restconf connection
+ * @see restconf_ssl_want where this callback is registered
  */
 static int
-buf_write(char   *buf,
-	  size_t  buflen,
-	  int     s,
-	  SSL    *ssl)
+restconf_ssl_want_cb(int   s,
+		     void *arg)
 {
-    int     retval = -1;
-    ssize_t len;
-    ssize_t totlen = 0;
-    int     er;
-
-    /* Two problems with debugging buffers from libevent that this fixes:
-     * 1. they are not "strings" in the sense they are not NULL-terminated
-     * 2. they are often very long
-     */
-    if (clicon_debug_get()) { 
-	char *dbgstr = NULL;
-	size_t sz;
-	sz = buflen>256?256:buflen; /* Truncate to 256 */
-	if ((dbgstr = malloc(sz+1)) == NULL){
-	    clicon_err(OE_UNIX, errno, "malloc");
-	    goto done;
-	}
-	memcpy(dbgstr, buf, sz);
-	dbgstr[sz] = '\0';
-	clicon_debug(1, "%s buflen:%zu buf:%s", __FUNCTION__, buflen, dbgstr);
-	free(dbgstr);
+    restconf_conn *rc = (restconf_conn *)arg;
+
+    clicon_debug(1, "%s %d", __FUNCTION__, s);
+    if (rc->rc_ssl_want == SSL_ERROR_WANT_READ)
+	clixon_event_unreg_fd(rc->rc_s, restconf_ssl_want_cb);
+    else if (rc->rc_ssl_want == SSL_ERROR_WANT_WRITE)
+	clixon_event_unreg_fd_write(rc->rc_s, restconf_ssl_want_cb);
+    rc->rc_ssl_want = 0;
+    if (!SSL_is_init_finished(rc->rc_ssl))
+	return restconf_ssl_handshake(rc);
+    return restconf_connection(s, rc);
+}
+
+/*! Wait for socket readiness requested by a non-blocking SSL operation
+ * @param[in]  rc    Restconf connection
+ * @param[in]  want  SSL_ERROR_WANT_READ or SSL_ERROR_WANT_WRITE, or 0 to stop waiting
+ * @retval     0     OK
+ * @retval    -1     Error
+ */
+static int
+restconf_ssl_want(restconf_conn *rc,
+		  int            want)
+{
+    if (rc->rc_ssl_want == want)
+	return 0;
+    if (rc->rc_ssl_want == SSL_ERROR_WANT_READ)
+	clixon_event_unreg_fd(rc->rc_s, restconf_ssl_want_cb);
+    else if (rc->rc_ssl_want == SSL_ERROR_WANT_WRITE)
+	clixon_event_unreg_fd_write(rc->rc_s, restconf_ssl_want_cb);
+    rc->rc_ssl_want = 0;
+    if (want == SSL_ERROR_WANT_READ){
+	if (clixon_event_reg_fd(rc->rc_s, restconf_ssl_want_cb, rc, "restconf ssl want read") < 0)
+	    return -1;
     }
-    while (totlen < buflen){
-	if (ssl){
-	    if ((len = SSL_write(ssl, buf+totlen, buflen-totlen)) <= 0){
-		er = errno;
-		switch (SSL_get_error(ssl, len)){
-		case SSL_ERROR_SYSCALL:              /* 5 */
-		    if (er == ECONNRESET) {/* Connection reset by peer */
-			if (ssl)
-			    SSL_free(ssl);
-			close(s);
-			clixon_event_unreg_fd(s, restconf_connection);
-			goto ok; /* Close socket and ssl */
-		    }
-		    else if (er == EAGAIN){
-			clicon_debug(1, "%s write EAGAIN", __FUNCTION__);
-			usleep(10000);
-			continue;
-		    }
-		    else{
-			clicon_err(OE_RESTCONF, er, "SSL_write %d", er);
-			goto done;
-		    }
-		    break;
-		default:
-		    clicon_err(OE_SSL, 0, "SSL_write");
-		    goto done;
-		    break;
-		}
-		goto done;
-	    }
-	}
-	else{
-	    if ((len = write(s, buf+totlen, buflen-totlen)) < 0){
-		if (errno == EAGAIN){
-		    clicon_debug(1, "%s write EAGAIN", __FUNCTION__);
-		    usleep(10000);
-		    continue;
-		}
-#if 1
-		else if (errno == ECONNRESET) {/* Connection reset by peer */
-		    close(s);
-		    clixon_event_unreg_fd(s, restconf_connection);
-		    goto ok; /* Close socket and ssl */
-		}
-#endif
-		else{
-		    clicon_err(OE_UNIX, errno, "write");
-		    goto done;
-		}
-	    }
-	    assert(len != 0);
-	}
-	totlen += len;
-    } /* while */
- ok:
-    retval = 0;
- done:
-    clicon_debug(1, "%s retval:%d", __FUNCTION__, retval);
-    return retval;
+    else if (want == SSL_ERROR_WANT_WRITE){
+	if (clixon_event_reg_fd_write(rc->rc_s, restconf_ssl_want_cb, rc, "restconf ssl want write") < 0)
+	    return -1;
+    }
+    rc->rc_ssl_want = want;
+    return 0;
 }
 
 /* util function to append log string
@@ -515,6 +477,9 @@ restconf_ssl_context_create(clicon_handle h)
     SSL_CTX_set_options(ctx, SSL_OP_NO_SSLv3 | SSL_OP_NO_TLSv1 | SSL_OP_NO_TLSv1_1);
 
     SSL_CTX_set_options(ctx, SSL_MODE_RELEASE_BUFFERS | SSL_OP_NO_COMPRESSION);
+    /* Non-blocking writes: SSL_write may write part of a buffer, and is retried from 
+     * the connection output queue which may have been reallocated in between */
+    SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
     //    SSL_CTX_set_timeout(ctx, cfg->ssl_ctx_timeout); /* default 300s */
     /* Application Layer Protocol Negotiation (alpn) callback */
     SSL_CTX_set_alpn_select_cb(ctx, alpn_select_proto_cb, h);
@@ -594,6 +559,8 @@ restconf_close_ssl_socket(restconf_conn *rc,
     int retval = -1;
     int                 ret;
 
+    if (restconf_ssl_want(rc, 0) < 0)
+	goto done;
     if (rc->rc_ssl != NULL){
 	if (shutdown && (ret = SSL_shutdown(rc->rc_ssl)) < 0){
 #if 0
@@ -624,15 +591,13 @@ Note that in this case SSL_ERROR_ZERO_RETURN does not necessarily indicate that
 
 /*! Send early handcoded bad request reply before actual packet received, just after accept
  * @param[in]  h    Clixon handle
- * @param[in]  s    Socket
- * @param[in]  ssl  If set, it will be freed
+ * @param[in]  rc   Restconf connection, written with ssl if rc_ssl is set
  * @param[in]  body If given add message body using media 
  * @see restconf_badrequest which can only be called in a request context
  */
 static int
 send_badrequest(clicon_handle       h,
-		int                 s,
-		SSL                *ssl,
+		restconf_conn      *rc,
 		char               *media,
     		char               *body)
 {
@@ -654,7 +619,7 @@ send_badrequest(clicon_handle       h,
     cprintf(cb, "\r\n");
     if (body)
 	cprintf(cb, "%s\r\n", body);
-    if (buf_write(cbuf_get(cb), cbuf_len(cb), s, ssl) < 0)
+    if (restconf_conn_write(rc, cbuf_get(cb), cbuf_len(cb)) < 0)
 	goto done;
     retval = 0;
  done:
@@ -675,8 +640,10 @@ send_badrequest(clicon_handle       h,
  * with 100 Continue, in which case that is replied and the function returns and the client sends 
  * more data.
  * OR evhtp returns 0 with no reply, then this is assumed to mean read more data from the socket.
+ * The socket is non-blocking: data is read until the socket would block, then the function
+ * returns to the event loop and is called again when more data arrives.
  */
-static int
+int
 restconf_connection(int   s,
 		    void *arg)
 {
@@ -715,13 +682,17 @@ restconf_connection(int   s,
 		switch (sslerr){
 		case SSL_ERROR_WANT_READ:            /* 2 */
 		    /* SSL_ERROR_WANT_READ is returned when the last operation was a read operation 
-		     * from a nonblocking BIO. 
-		     * That is, it can happen if restconf_socket_init() below is called 
-		     * with SOCK_NONBLOCK
+		     * from a nonblocking BIO, ie no more data: wait for next input event
 		     */
 		    clicon_debug(1, "%s SSL_read SSL_ERROR_WANT_READ", __FUNCTION__);
-		    usleep(1000);
-		    readmore = 1;
+		    goto ok;
+		    break;
+		case SSL_ERROR_WANT_WRITE:           /* 3 */
+		    /* Eg renegotiation: resume reading when socket is writable */
+		    clicon_debug(1, "%s SSL_read SSL_ERROR_WANT_WRITE", __FUNCTION__);
+		    if (restconf_ssl_want(rc, SSL_ERROR_WANT_WRITE) < 0)
+			goto done;
+		    goto ok;
 		    break;
 		default:
 		    clicon_err(OE_XML, errno, "SSL_read");
@@ -740,9 +711,11 @@ restconf_connection(int   s,
 		    restconf_conn_free(rc);
 		    goto ok; /* Close socket and ssl */
 		    break;
-		case EAGAIN:
+		case EAGAIN: /* No more data: wait for next input event */
 		    clicon_debug(1, "%s read EAGAIN", __FUNCTION__);
-		    usleep(1000);
+		    goto ok;
+		    break;
+		case EINTR:
 		    readmore = 1;
 		    break;
 		default:;
@@ -777,19 +750,15 @@ restconf_connection(int   s,
 		/* XXX To get more nuanced evhtp error check
 		 * htparser_get_error(conn->parser)
 		 */
-		if (send_badrequest(h, rc->rc_s, rc->rc_ssl, "application/yang-data+xml",
+		if (send_badrequest(h, rc, "application/yang-data+xml",
 				    "<errors xmlns=\"urn:ietf:params:xml:ns:yang:ietf-restconf\"><error><error-type>protocol</error-type><error-tag>malformed-message</error-tag><error-message>The requested URL or a header is in some way badly formed</error-message></error></errors>") < 0)
 		    goto done;
-		SSL_free(rc->rc_ssl);
-		rc->rc_ssl = NULL;
-		evconn->ssl = NULL;
-		if (close(rc->rc_s) < 0){
-		    clicon_err(OE_UNIX, errno, "close");
+		if (restconf_ssl_want(rc, 0) < 0)
 		    goto done;
-		}
-		clixon_event_unreg_fd(rc->rc_s, restconf_connection);
+		/* Close when the reply is written */
 		clicon_debug(1, "%s evconn-free (%p) 2", __FUNCTION__, evconn);
-		restconf_conn_free(rc);
+		if (restconf_conn_close(rc) < 0)
+		    goto done;
 		goto ok;
 	    } /* connection_parse_nobev */
 	    clicon_debug(1, "%s connection_parse OK", __FUNCTION__);
@@ -833,15 +802,17 @@ restconf_connection(int   s,
 		if (cbuf_len(sd->sd_outp_buf) == 0)
 		    readmore = 1;
 		else {
-		    if (buf_write(cbuf_get(sd->sd_outp_buf), cbuf_len(sd->sd_outp_buf),
-				  rc->rc_s, rc->rc_ssl) < 0)
+		    if (restconf_conn_write(rc, cbuf_get(sd->sd_outp_buf), cbuf_len(sd->sd_outp_buf)) < 0)
 			goto done;
 		    cvec_reset(sd->sd_outp_hdrs); /* Can be done in native_send_reply */
 		    cbuf_reset(sd->sd_outp_buf);
+		    /* Streamed body follows headers */
+		    if (sd->sd_body_fn != NULL && restconf_conn_body(rc, sd) < 0)
+			goto done;
 		}
 	    }
 	    else{
-		if (send_badrequest(h, rc->rc_s, rc->rc_ssl, "application/yang-data+xml",
+		if (send_badrequest(h, rc, "application/yang-data+xml",
 				    "<errors xmlns=\"urn:ietf:params:xml:ns:yang:ietf-restconf\"><error><error-type>protocol</error-type><error-tag>malformed-message</error-tag><error-message>No evhtp output</error-message></error></errors>") < 0)
 		    goto done;
 	    }
@@ -945,6 +916,31 @@ restconf_listcerts(SSL *ssl)
 }
 #endif/* debug */
 
+/*! Get an unsigned integer value from restconf config, or a default if not set
+ * 
+ * @param[in]  xrestconf XML tree containing restconf config
+ * @param[in]  nsc       Namespace context
+ * @param[in]  name      Name of configured leaf
+ * @param[in]  dflt      Default value if not set or not an integer
+ * @retval     value     Configured or default value
+ */
+static uint32_t
+restconf_config_uint32(cxobj    *xrestconf,
+		       cvec     *nsc,
+		       char     *name,
+		       uint32_t  dflt)
+{
+    cxobj   *x;
+    char    *str;
+    uint32_t val;
+
+    if ((x = xpath_first(xrestconf, nsc, "%s", name)) == NULL ||
+	(str = xml_body(x)) == NULL ||
+	parse_uint32(str, &val, NULL) != 1)
+	return dflt;
+    return val;
+}
+
 /*! Check if a "cert" file exists
  * 
  * @param[in]  xrestconf XML tree containing restconf config
@@ -1021,7 +1017,7 @@ ssl_alpn_check(clicon_handle        h,
 	if (alpn != NULL){
 	    cprintf(cberr, "<errors xmlns=\"urn:ietf:params:xml:ns:yang:ietf-restconf\"><error><error-type>protocol</error-type><error-tag>malformed-message</error-tag><error-message>ALPN: protocol not recognized: %s</error-message></error></errors>", alpn);
 	    clicon_log(LOG_INFO, "%s Warning: %s", __FUNCTION__, cbuf_get(cberr));
-	    if (send_badrequest(h, rc->rc_s, rc->rc_ssl,
+	    if (send_badrequest(h, rc,
 				"application/yang-data+xml",
 				cbuf_get(cberr)) < 0)
 		goto done;
@@ -1058,6 +1054,243 @@ ssl_alpn_check(clicon_handle        h,
     return retval;
 } /* ssl_alpn_check */
 
+/*! Set up a new connection for its http protocol and register it for input
+ * Called after accept on a plain socket, or after the TLS handshake on an SSL socket
+ * @param[in]  rc     Restconf connection
+ * @param[in]  proto  HTTP protocol
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+restconf_connection_init(restconf_conn      *rc,
+			 restconf_http_proto proto)
+{
+    int                     retval = -1;
+#ifdef HAVE_LIBEVHTP
+    restconf_native_handle *rh = NULL;
+#endif
+
+    clicon_debug(1, "%s proto:%s", __FUNCTION__, restconf_proto2str(proto));
+    rc->rc_proto = proto;
+    switch (rc->rc_proto){
+#ifdef HAVE_LIBEVHTP
+    case HTTP_10:
+    case HTTP_11:{
+	evhtp_t             *evhtp;
+	evhtp_connection_t  *evconn;
+
+	if ((rh = restconf_native_handle_get(rc->rc_h)) == NULL){
+	    clicon_err(OE_XML, EFAULT, "No openssl handle");
+	    goto done;
+	}
+	evhtp = (evhtp_t *)rh->rh_arg;
+	/* Create evhtp-specific struct */
+	if ((evconn = evhtp_connection_new_server(evhtp, rc->rc_s)) == NULL){
+	    clicon_err(OE_UNIX, errno, "evhtp_connection_new_server");
+	    goto done;
+	}
+	/* Mutual pointers, from generic rc to evhtp specific and from evhtp conn to generic
+	 */
+	rc->rc_evconn = evconn; /* Generic to specific */
+	evconn->arg = rc;    /* Specific to generic */
+	evconn->ssl = rc->rc_ssl; /* evhtp */
+	/* Create a default stream for http/1 */
+	if (restconf_stream_data_new(rc, 0) == NULL)
+	    goto done;
+    }
+	break;
+#endif /* HAVE_LIBEVHTP */
+#ifdef HAVE_LIBNGHTTP2
+    case HTTP_2:{
+	if (http2_session_init(rc) < 0){
+	    restconf_close_ssl_socket(rc, 1);
+	    goto done;
+	}
+	if (http2_send_server_connection(rc) < 0){
+	    restconf_close_ssl_socket(rc, 1);
+	    goto done;
+	}
+	break;
+    }
+#endif /* HAVE_LIBNGHTTP2 */
+    default:
+	break;
+    } /* switch proto */
+    if (clixon_event_reg_fd(rc->rc_s, restconf_connection, (void*)rc, "restconf client socket") < 0)
+	goto done;
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Run (or continue) TLS handshake on a new SSL connection
+ *
+ * The socket is non-blocking. If the handshake cannot complete without blocking, wait for
+ * the socket to be ready and continue from the event loop.
+ * When complete, check ALPN and set up the connection.
+ * @param[in]  rc   Restconf connection
+ * @retval     0    OK, also if handshake is not complete, or failed and connection closed
+ * @retval    -1    Error
+ * @see restconf_ssl_want_cb  Continues handshake when socket is ready
+ */
+static int
+restconf_ssl_handshake(restconf_conn *rc)
+{
+    int                     retval = -1;
+    clicon_handle           h;
+    int                     ret;
+    int                     e;
+    int                     er;
+    const unsigned char    *alpn = NULL;
+    unsigned int            alpnlen = 0;
+    restconf_http_proto     proto = HTTP_11;  /* Non-SSL negotiation NYI */
+
+    clicon_debug(1, "%s %d", __FUNCTION__, rc->rc_s);
+#ifdef HAVE_LIBNGHTTP2
+#ifndef HAVE_LIBEVHTP
+    proto = HTTP_2;     /* If nghttp2 only let default be 2.0  */
+#endif
+    /* If also evhtp, keep HTTP_11 */
+#endif
+    h = rc->rc_h;
+    /* 1: OK, -1 fatal, 0: TLS/SSL handshake was not successful
+     * Both error cases: Call SSL_get_error() with the return value ret 
+     */
+    if ((ret = SSL_accept(rc->rc_ssl)) != 1) {
+	clicon_debug(1, "%s SSL_accept() ret:%d errno:%d", __FUNCTION__, ret, er=errno);
+	e = SSL_get_error(rc->rc_ssl, ret);
+	switch (e){
+	case SSL_ERROR_SSL:                  /* 1 */
+	    clicon_debug(1, "%s SSL_ERROR_SSL (non-ssl message on ssl socket)", __FUNCTION__);
+	    if (restconf_ssl_want(rc, 0) < 0)
+		goto done;
+	    SSL_free(rc->rc_ssl);
+	    rc->rc_ssl = NULL;
+#if 1
+	    /* Reply in plain text */
+	    if (send_badrequest(h, rc, "application/yang-data+xml",
+				"<errors xmlns=\"urn:ietf:params:xml:ns:yang:ietf-restconf\"><error><error-type>protocol</error-type><error-tag>malformed-message</error-tag><error-message>The plain HTTP request was sent to HTTPS port</error-message></error></errors>") < 0)
+		goto done;
+#endif
+	    /* Close when the reply is written */
+	    if (restconf_conn_close(rc) < 0)
+		goto done;
+	    goto ok;
+	    break;
+	case SSL_ERROR_SYSCALL:              /* 5 */
+	    /* Some non-recoverable, fatal I/O error occurred. The OpenSSL error queue 
+	       may contain more information on the error. For socket I/O on Unix systems, 
+	       consult errno for details. If this error occurs then no further I/O
+	       operations should be performed on the connection and SSL_shutdown() must 
+	       not be called.*/
+	    clicon_debug(1, "%s SSL_accept() SSL_ERROR_SYSCALL %d", __FUNCTION__, er);
+	    if (restconf_close_ssl_socket(rc, 0) < 0)
+		goto done;
+	    restconf_conn_free(rc);    
+	    rc = NULL;
+	    goto ok;
+	    break;
+	case SSL_ERROR_WANT_READ:            /* 2 */
+	case SSL_ERROR_WANT_WRITE:           /* 3 */
+	    /* Returned when the last operation was a read/write operation on a nonblocking BIO.
+	     * Continue handshake when the socket is ready.
+	     */
+	    clicon_debug(1, "%s SSL_accept() %s", __FUNCTION__,
+			 e==SSL_ERROR_WANT_READ?"SSL_ERROR_WANT_READ":"SSL_ERROR_WANT_WRITE");
+	    if (restconf_ssl_want(rc, e) < 0)
+		goto done;
+	    goto ok;
+	    break;
+	case SSL_ERROR_NONE:                 /* 0 */
+	case SSL_ERROR_ZERO_RETURN:          /* 6 */
+	case SSL_ERROR_WANT_CONNECT:         /* 7 */
+	case SSL_ERROR_WANT_ACCEPT:          /* 8 */
+	case SSL_ERROR_WANT_X509_LOOKUP:     /* 4 */
+	case SSL_ERROR_WANT_ASYNC:           /* 8 */
+	case SSL_ERROR_WANT_ASYNC_JOB:       /* 10 */
+#ifdef SSL_ERROR_WANT_CLIENT_HELLO_CB
+	case SSL_ERROR_WANT_CLIENT_HELLO_CB: /* 11 */
+#endif
+	default:
+	    clicon_err(OE_SSL, 0, "SSL_accept:%d", e);
+	    goto done;
+	    break;
+	}
+    } /* SSL_accept */
+    /* Handshake complete */
+    if (restconf_ssl_want(rc, 0) < 0)
+	goto done;
+    if (restconf_tls_handshake_done(rc->rc_ssl, &rc->rc_ssl_start) < 0)
+	goto done;
+    /* Sets data and len to point to the client's requested protocol for this connection. */
+#ifndef OPENSSL_NO_NEXTPROTONEG
+    SSL_get0_next_proto_negotiated(rc->rc_ssl, &alpn, &alpnlen);
+#endif /* !OPENSSL_NO_NEXTPROTONEG */
+    if (alpn == NULL) {
+	/* Returns a pointer to the selected protocol in data with length len. */
+	SSL_get0_alpn_selected(rc->rc_ssl, &alpn, &alpnlen);
+    }
+    if ((ret = ssl_alpn_check(h, alpn, alpnlen, rc, &proto)) < 0)
+	goto done;
+    if (ret == 0)
+	goto ok;
+    clicon_debug(1, "%s proto:%s", __FUNCTION__, restconf_proto2str(proto));
+#if 0 /* Seems too early to fail here, instead let authentication callback deal with this */
+    /* For client-cert authentication, check if any certs are present,
+    * if not, send bad request
+    * Alt: set SSL_CTX_set_verify(ctx, SSL_VERIFY_FAIL_IF_NO_PEER_CERT)
+    * but then SSL_accept fails.
+    */
+    if (restconf_auth_type_get(h) == CLIXON_AUTH_CLIENT_CERTIFICATE){
+	X509 *peercert;
+
+	if ((peercert = SSL_get_peer_certificate(rc->rc_ssl)) != NULL){
+	    X509_free(peercert);
+	}
+	else { /* Get certificates (if available) */
+	    if (proto != HTTP_2 &&
+		send_badrequest(h, rc, "application/yang-data+xml",
+				"<errors xmlns=\"urn:ietf:params:xml:ns:yang:ietf-restconf\"><error><error-type>protocol</error-type><error-tag>malformed-message</error-tag><error-message>Peer certificate required</error-message></error></errors>") < 0)
+		goto done;
+	    restconf_conn_free(rc);
+	    if (rc->rc_ssl){
+		if ((ret = SSL_shutdown(rc->rc_ssl)) < 0){
+		    int e = SSL_get_error(rc->rc_ssl, ret);
+		    clicon_err(OE_SSL, 0, "SSL_shutdown, err:%d", e);
+		    goto done;
+		}
+		SSL_free(rc->rc_ssl);
+		rc->rc_ssl = NULL;
+	    }
+	    goto ok;
+	}
+    }
+#endif
+    /* Get the actual peer, XXX this maybe could be done in ca-auth client-cert code ? 
+     * Note this _only_ works if SSL_set1_host() was set previously,...
+     */
+    if (SSL_get_verify_result(rc->rc_ssl) == X509_V_OK) { /* for peer cert */
+
+	const char *peername = SSL_get0_peername(rc->rc_ssl);
+
+	if (peername != NULL) {
+	    /* Name checks were in scope and matched the peername */
+	    clicon_debug(1, "%s peername:%s", __FUNCTION__, peername);
+	}
+    }
+#if 0 /* debug */
+    if (clicon_debug_get())
+	restconf_listcerts(rc->rc_ssl);
+#endif
+    if (restconf_connection_init(rc, proto) < 0)
+	goto done;
+ ok:
+    retval = 0;
+ done:
+    clicon_debug(1, "%s retval %d", __FUNCTION__, retval);
+    return retval;
+} /* restconf_ssl_handshake */
+
 /*! Accept new socket client
  * @param[in]  fd   Socket (unix or ip)
  * @param[in]  arg  typecast clicon_handle
@@ -1075,13 +1308,7 @@ restconf_accept_client(int   fd,
     int                     s;
     struct sockaddr         from = {0,};
     socklen_t               len;
-    char                   *name = NULL;
-    int                     ret;
-    int                     e;
-    int                     er;
-    int                     readmore;
-    const unsigned char    *alpn = NULL;
-    unsigned int            alpnlen = 0;
+    int                     flags;
     restconf_http_proto     proto = HTTP_11;  /* Non-SSL negotiation NYI */
 
     clicon_debug(1, "%s %d", __FUNCTION__, fd);
@@ -1106,9 +1333,18 @@ restconf_accept_client(int   fd,
     }
     len = sizeof(from);
     if ((s = accept(rsock->rs_ss, &from, &len)) < 0){
+	if (errno == EAGAIN || errno == EWOULDBLOCK)
+	    goto ok; /* Client gone before accept */
 	clicon_err(OE_UNIX, errno, "accept");
 	goto done;
     }
+    /* Data socket is non-blocking, an accepted socket does not inherit this on all platforms */
+    if ((flags = fcntl(s, F_GETFL, 0)) < 0 ||
+	fcntl(s, F_SETFL, flags | O_NONBLOCK) < 0){
+	clicon_err(OE_UNIX, errno, "fcntl");
+	close(s);
+	goto done;
+    }
     /*
      * Register callbacks for actual data socket 
      */
@@ -1121,6 +1357,7 @@ restconf_accept_client(int   fd,
 	    goto done;
 	}
 	clicon_debug(1, "%s SSL_new(%p)", __FUNCTION__, rc->rc_ssl);
+	gettimeofday(&rc->rc_ssl_start, NULL);
 	/* CCL_CTX_set_verify already set, need not call SSL_set_verify again for this server
 	 */
 	/* X509_CHECK_FLAG_NO_WILDCARDS disables wildcard expansion */
@@ -1150,198 +1387,17 @@ restconf_accept_client(int   fd,
 	    clicon_err(OE_SSL, 0, "SSL_set_fd");
 	    goto done;
 	}
-	readmore = 1;
-	while (readmore){
-	    readmore = 0;
-	    /* 1: OK, -1 fatal, 0: TLS/SSL handshake was not successful
-	     * Both error cases: Call SSL_get_error() with the return value ret 
-	     */
-	    if ((ret = SSL_accept(rc->rc_ssl)) != 1) {
-		clicon_debug(1, "%s SSL_accept() ret:%d errno:%d", __FUNCTION__, ret, er=errno);
-		e = SSL_get_error(rc->rc_ssl, ret);
-		switch (e){
-		case SSL_ERROR_SSL:                  /* 1 */
-		    clicon_debug(1, "%s SSL_ERROR_SSL (non-ssl message on ssl socket)", __FUNCTION__);
-#if 1
-		    if (send_badrequest(h, rc->rc_s, NULL, "application/yang-data+xml",
-					"<errors xmlns=\"urn:ietf:params:xml:ns:yang:ietf-restconf\"><error><error-type>protocol</error-type><error-tag>malformed-message</error-tag><error-message>The plain HTTP request was sent to HTTPS port</error-message></error></errors>") < 0)
-			goto done;
-#endif
-		    SSL_free(rc->rc_ssl);
-		    rc->rc_ssl = NULL;
-		    clixon_event_unreg_fd(rc->rc_s, restconf_connection);
-		    if (close(rc->rc_s) < 0){
-			clicon_err(OE_UNIX, errno, "close");
-			goto done;
-		    }
-		    restconf_conn_free(rc);
-		    goto ok;
-		    break;
-		case SSL_ERROR_SYSCALL:              /* 5 */
-		    /* Some non-recoverable, fatal I/O error occurred. The OpenSSL error queue 
-		       may contain more information on the error. For socket I/O on Unix systems, 
-		       consult errno for details. If this error occurs then no further I/O
-		       operations should be performed on the connection and SSL_shutdown() must 
-		       not be called.*/
-		    clicon_debug(1, "%s SSL_accept() SSL_ERROR_SYSCALL %d", __FUNCTION__, er);
-		    if (restconf_close_ssl_socket(rc, 0) < 0)
-			goto done;
-		    restconf_conn_free(rc);    
-		    rc = NULL;
-		    goto ok;
-		    break;
-		case SSL_ERROR_WANT_READ:            /* 2 */
-		case SSL_ERROR_WANT_WRITE:           /* 3 */
-		    /* SSL_ERROR_WANT_READ is returned when the last operation was a read operation 
-		     * from a nonblocking BIO. 
-		     * That is, it can happen if restconf_socket_init() below is called 
-		     * with SOCK_NONBLOCK
-		     */
-		    clicon_debug(1, "%s write SSL_ERROR_WANT_READ", __FUNCTION__);
-		    usleep(10000);
-		    readmore = 1;
-		    break;
-		case SSL_ERROR_NONE:                 /* 0 */
-		case SSL_ERROR_ZERO_RETURN:          /* 6 */
-		case SSL_ERROR_WANT_CONNECT:         /* 7 */
-		case SSL_ERROR_WANT_ACCEPT:          /* 8 */
-		case SSL_ERROR_WANT_X509_LOOKUP:     /* 4 */
-		case SSL_ERROR_WANT_ASYNC:           /* 8 */
-		case SSL_ERROR_WANT_ASYNC_JOB:       /* 10 */
-#ifdef SSL_ERROR_WANT_CLIENT_HELLO_CB
-		case SSL_ERROR_WANT_CLIENT_HELLO_CB: /* 11 */
-#endif
-		default:
-		    clicon_err(OE_SSL, 0, "SSL_accept:%d", e);
-		    goto done;
-		    break;
-		}
-	    } /* SSL_accept */
-	} /* while(readmore) */
-	/* Sets data and len to point to the client's requested protocol for this connection. */
-#ifndef OPENSSL_NO_NEXTPROTONEG
-	SSL_get0_next_proto_negotiated(rc->rc_ssl, &alpn, &alpnlen);
-#endif /* !OPENSSL_NO_NEXTPROTONEG */
-	if (alpn == NULL) {
-	    /* Returns a pointer to the selected protocol in data with length len. */
-	    SSL_get0_alpn_selected(rc->rc_ssl, &alpn, &alpnlen);
-	}
-	if ((ret = ssl_alpn_check(h, alpn, alpnlen, rc, &proto)) < 0)
+	/* Handshake continues in event loop if it would block */
+	if (restconf_ssl_handshake(rc) < 0)
 	    goto done;
-	if (ret == 0)
-	    goto ok;
-	clicon_debug(1, "%s proto:%s", __FUNCTION__, restconf_proto2str(proto));
-
-#if 0 /* Seems too early to fail here, instead let authentication callback deal with this */
-	/* For client-cert authentication, check if any certs are present,
-	* if not, send bad request
-	* Alt: set SSL_CTX_set_verify(ctx, SSL_VERIFY_FAIL_IF_NO_PEER_CERT)
-	* but then SSL_accept fails.
-	*/
-	if (restconf_auth_type_get(h) == CLIXON_AUTH_CLIENT_CERTIFICATE){
-	    X509 *peercert;
-
-	    if ((peercert = SSL_get_peer_certificate(rc->rc_ssl)) != NULL){
-		X509_free(peercert);
-	    }
-	    else { /* Get certificates (if available) */
-		if (proto != HTTP_2 &&
-		    send_badrequest(h, rc->rc_s, rc->rc_ssl, "application/yang-data+xml",
-				    "<errors xmlns=\"urn:ietf:params:xml:ns:yang:ietf-restconf\"><error><error-type>protocol</error-type><error-tag>malformed-message</error-tag><error-message>Peer certificate required</error-message></error></errors>") < 0)
-		    goto done;
-		restconf_conn_free(rc);
-		if (rc->rc_ssl){
-		    if ((ret = SSL_shutdown(rc->rc_ssl)) < 0){
-			int e = SSL_get_error(rc->rc_ssl, ret);
-			clicon_err(OE_SSL, 0, "SSL_shutdown, err:%d", e);
-			goto done;
-		    }
-		    SSL_free(rc->rc_ssl);
-		    rc->rc_ssl = NULL;
-		}
-		goto ok;
-	    }
-	}
-#endif
-	/* Get the actual peer, XXX this maybe could be done in ca-auth client-cert code ? 
-	 * Note this _only_ works if SSL_set1_host() was set previously,...
-	 */
-	if (SSL_get_verify_result(rc->rc_ssl) == X509_V_OK) { /* for peer cert */
-
-	    const char *peername = SSL_get0_peername(rc->rc_ssl);
-
- 	    if (peername != NULL) {
-		/* Name checks were in scope and matched the peername */
-		clicon_debug(1, "%s peername:%s", __FUNCTION__, peername);
-	    }
-	}
-#if 0 /* debug */
-	if (clicon_debug_get())
-	    restconf_listcerts(rc->rc_ssl);
-#endif
+	goto ok;
     } /* if ssl */
-    rc->rc_proto = proto;
-    switch (rc->rc_proto){
-#ifdef HAVE_LIBEVHTP
-    case HTTP_10:
-    case HTTP_11:{
-	evhtp_t             *evhtp = (evhtp_t *)rh->rh_arg;
-	evhtp_connection_t  *evconn;
-
-	/* Create evhtp-specific struct */
-	if ((evconn = evhtp_connection_new_server(evhtp, rc->rc_s)) == NULL){
-	    clicon_err(OE_UNIX, errno, "evhtp_connection_new_server");
-	    goto done;
-	}
-	/* Mutual pointers, from generic rc to evhtp specific and from evhtp conn to generic
-	 */
-	rc->rc_evconn = evconn; /* Generic to specific */
-	evconn->arg = rc;    /* Specific to generic */
-	evconn->ssl = rc->rc_ssl; /* evhtp */
-	/* Create a default stream for http/1 */
-	if (restconf_stream_data_new(rc, 0) == NULL)
-	    goto done;
-    }
-	break;
-#endif /* HAVE_LIBEVHTP */
-#ifdef HAVE_LIBNGHTTP2
-    case HTTP_2:{
-	if (http2_session_init(rc) < 0){
-	    restconf_close_ssl_socket(rc, 1);
-	    goto done;
-	}
-	if (http2_send_server_connection(rc) < 0){
-	    restconf_close_ssl_socket(rc, 1);
-#ifdef NYI
-	    if (ssl) {
-		SSL_shutdown(ssl);
-	    }
-	    bufferevent_free(session_data->bev);
-	    nghttp2_session_del(session_data->session);
-	    for (stream_data = session_data->root.next; stream_data;) {
-		http2_stream_data *next = stream_data->next;
-		delete_http2_stream_data(stream_data);
-		stream_data = next;
-	    }
-	    free(session_data->client_addr);
-	    free(session_data);
-#endif
-	    goto done;
-	}
-	break;
-    }
-#endif /* HAVE_LIBNGHTTP2 */
-    default:
-	break;
-    } /* switch proto */
-    if (clixon_event_reg_fd(rc->rc_s, restconf_connection, (void*)rc, "restconf client socket") < 0)
+    if (restconf_connection_init(rc, proto) < 0)
 	goto done;
  ok:
     retval = 0;
  done:
     clicon_debug(1, "%s retval %d", __FUNCTION__, retval);
-    if (name)
-	free(name);
     return retval;
 } /* restconf_accept_client */
 
@@ -1365,6 +1421,8 @@ restconf_native_terminate(clicon_handle h)
 	}
 	if (rh->rh_ctx)
 	    SSL_CTX_free(rh->rh_ctx);
+	restconf_tls_cache_exit();
+	restconf_cache_exit(h);
 #ifdef HAVE_LIBEVHTP
 	{
 	    evhtp_t *evhtp = (evhtp_t *)rh->rh_arg;
@@ -1456,11 +1514,13 @@ restconf_clixon_backend(clicon_handle h,
  * @param[in]  h        Clicon handle
  * @param[in]  xs       XML config of single restconf socket
  * @param[in]  nsc      Namespace context
+ * @param[in]  worker   Worker process that accepts on this socket
  */
 static int
 openssl_init_socket(clicon_handle h,
 		    cxobj        *xs,
-		    cvec         *nsc)
+		    cvec         *nsc,
+		    int           worker)
 {
     int             retval = -1;
     char           *netns = NULL;
@@ -1473,24 +1533,24 @@ openssl_init_socket(clicon_handle h,
     restconf_socket *rsock = NULL; /* openssl per socket struct */
 
     clicon_debug(1, "%s", __FUNCTION__);
+    if ((rh = restconf_native_handle_get(h)) == NULL){
+	clicon_err(OE_XML, EFAULT, "No openssl handle");
+	goto done;
+    }
     /* Extract socket parameters from single socket config: ns, addr, port, ssl */
     if (restconf_socket_extract(h, xs, nsc, &netns, &address, &addrtype, &port, &ssl) < 0)
 	goto done;
-    /* Open restconf socket and bind */
+    /* Open restconf socket and bind
+     * With several workers, each has its own socket bound to the same address and port */
     if (restconf_socket_init(netns, address, addrtype, port,
 			     SOCKET_LISTEN_BACKLOG,
 #ifdef RESTCONF_OPENSSL_NONBLOCKING
-			     SOCK_NONBLOCK, /* Also 0 is possible */
-#else /* blocking */
-			     0,
+			     SOCK_NONBLOCK | /* Also 0 is possible */
 #endif
+			     (rh->rh_workers > 1 ? CLIXON_SOCK_REUSEPORT : 0),
 			     &ss
 			     ) < 0)
 	goto done;
-    if ((rh = restconf_native_handle_get(h)) == NULL){
-	clicon_err(OE_XML, EFAULT, "No openssl handle");
-	goto done;
-    }
     /*
      * Create per-socket openssl handle
      * See restconf_native_terminate for freeing
@@ -1512,6 +1572,7 @@ openssl_init_socket(clicon_handle h,
 	goto done;
     }
     rsock->rs_port = port;
+    rsock->rs_worker = worker;
     INSQ(rsock, rh->rh_sockets);
 
     /* ss is a server socket that the clients connect to. The callback
@@ -1550,6 +1611,7 @@ restconf_openssl_init(clicon_handle h,
     cxobj            **vec = NULL;
     size_t             veclen;
     int                i;
+    int                w;
 #ifdef HAVE_LIBEVHTP
     evhtp_t           *evhtp = NULL;
     struct event_base *evbase = NULL;
@@ -1605,9 +1667,23 @@ restconf_openssl_init(clicon_handle h,
 		goto done;
 	if (restconf_ssl_context_configure(h, ctx, server_cert_path, server_key_path, server_ca_cert_path) < 0)
 	    goto done;
+	/* Session cache and tickets, before workers are forked to be shared by all */
+	if (restconf_tls_cache_init(ctx,
+				    restconf_config_uint32(xrestconf, nsc, "tls-session-cache-size", 1024),
+				    restconf_config_uint32(xrestconf, nsc, "tls-session-timeout", 300),
+				    (x = xpath_first(xrestconf, nsc, "tls-session-tickets")) == NULL ||
+				    strcmp(xml_body(x), "false") != 0,
+				    restconf_config_uint32(xrestconf, nsc, "tls-ticket-key-rotation", 3600)) < 0)
+	    goto done;
     }
     rh = restconf_native_handle_get(h);
     rh->rh_ctx = ctx;
+    rh->rh_workers = 1;
+    if ((x = xpath_first(xrestconf, nsc, "workers")) != NULL &&
+	(bstr = xml_body(x)) != NULL &&
+	atoi(bstr) > 1)
+	rh->rh_workers = atoi(bstr);
+    rh->rh_cache_size = restconf_config_uint32(xrestconf, nsc, "get-cache-size", 0);
 #ifdef HAVE_LIBEVHTP
     /* evhtp stuff */ /* XXX move this to global level */
     if ((evbase = event_base_new()) == NULL){
@@ -1634,12 +1710,17 @@ restconf_openssl_init(clicon_handle h,
     if (xpath_vec(xrestconf, nsc, "socket", &vec, &veclen) < 0)
 	goto done;
     for (i=0; i<veclen; i++){
-	if (openssl_init_socket(h, vec[i], nsc) < 0){
-	    /* Bind errors are ignored, proceed with next after log */
-	    if (clicon_errno == OE_UNIX && clicon_suberrno == EADDRNOTAVAIL)
-		clicon_err_reset();
-	    else
-		goto done;
+	/* One socket per worker */
+	for (w=0; w<rh->rh_workers; w++){
+	    if (openssl_init_socket(h, vec[i], nsc, w) < 0){
+		/* Bind errors are ignored, proceed with next after log */
+		if (clicon_errno == OE_UNIX && clicon_suberrno == EADDRNOTAVAIL){
+		    clicon_err_reset();
+		    break;
+		}
+		else
+		    goto done;
+	    }
 	}
     }
     retval = 1;
@@ -1649,6 +1730,57 @@ restconf_openssl_init(clicon_handle h,
     return retval;
 }
 
+/*! Set up a forked native worker process
+ * Keep only the listening sockets of this worker
+ * @param[in]  h       Clicon handle
+ * @param[in]  worker  Worker number
+ * @retval     0       OK
+ * @retval    -1       Error
+ * @see restconf_workers_run
+ */
+static int
+restconf_worker_init(clicon_handle h,
+		     int           worker)
+{
+    int                     retval = -1;
+    restconf_native_handle *rh;
+    restconf_socket        *rsock;
+    restconf_socket        *rnext;
+    int                     nsock = 0;
+    int                     i;
+
+    clicon_debug(1, "%s %d", __FUNCTION__, worker);
+    if ((rh = restconf_native_handle_get(h)) == NULL){
+	clicon_err(OE_XML, EFAULT, "No openssl handle");
+	goto done;
+    }
+    /* Close listening sockets of other workers */
+    if ((rsock = rh->rh_sockets) != NULL){
+	do {
+	    nsock++;
+	    rsock = NEXTQ(restconf_socket *, rsock);
+	} while (rsock != rh->rh_sockets);
+    }
+    rsock = rh->rh_sockets;
+    for (i=0; i<nsock; i++){
+	rnext = NEXTQ(restconf_socket *, rsock);
+	if (rsock->rs_worker != worker){
+	    clixon_event_unreg_fd(rsock->rs_ss, restconf_accept_client);
+	    close(rsock->rs_ss);
+	    DELQ(rsock, rh->rh_sockets, restconf_socket *);
+	    if (rsock->rs_addrstr)
+		free(rsock->rs_addrstr);
+	    if (rsock->rs_addrtype)
+		free(rsock->rs_addrtype);
+	    free(rsock);
+	}
+	rsock = rnext;
+    }
+    retval = 0;
+ done:
+    return retval;
+}
+
 /*! Read restconf from config 
  * After SEVERAL iterations the code now does as follows:
  * - init clixon
@@ -1737,11 +1869,9 @@ restconf_clixon_init(clicon_handle h,
     if (yang_spec_parse_module(h, "ietf-restconf", NULL, yspec)< 0)
 	goto done;
     
-#ifdef YANG_PATCH
     /* Load yang restconf patch module */
     if (yang_spec_parse_module(h, "ietf-yang-patch", NULL, yspec)< 0)
-       goto done;
-#endif // YANG_PATCH
+	goto done;
 
     /* Add netconf yang spec, used as internal protocol */
     if (netconf_module_load(h) < 0)
@@ -2053,7 +2183,16 @@ main(int    argc,
      */
     if (restconf_drop_privileges(h) < 0)
 	goto done;
-
+    /* Fork workers if several are configured, the master returns when workers are terminated */
+    if ((ret = restconf_workers_run(h, rh->rh_workers, restconf_worker_init)) < 0)
+	goto done;
+    if (ret == 0){
+	retval = 0;
+	goto done;
+    }
+    /* GET response cache, per worker since it uses the backend session */
+    if (restconf_cache_init(h, rh->rh_cache_size) < 0)
+	goto done;
     /* Main event loop */ 
     if (clixon_event_loop(h) < 0)
 	goto done;
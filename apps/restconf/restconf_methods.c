@@ -65,8 +65,6 @@
 
 /* cligen */
 #include <cligen/cligen.h>
-// TODO - remove this include if cbuf_trunc() is added to cligen repo
-#include "../cligen/cligen_buf_internal.h"
 
 /* clicon */
 #include <clixon/clixon.h>
@@ -78,6 +76,9 @@
 #include "restconf_methods.h"
 #include "restconf_methods_post.h"
 
+/* RFC 8072 YANG patch namespace */
+#define YANG_PATCH_NAMESPACE "urn:ietf:params:xml:ns:yang:ietf-yang-patch"
+
 /*! REST OPTIONS method
  * According to restconf
  * @param[in]  h      Clixon handle
@@ -100,7 +101,7 @@ api_data_options(clicon_handle h,
     clicon_debug(1, "%s", __FUNCTION__);
     if (restconf_reply_header(req, "Allow", "OPTIONS,HEAD,GET,POST,PUT,PATCH,DELETE") < 0)
 	goto done;
-    if (restconf_reply_header(req, "Accept-Patch", "application/yang-data+xml,application/yang-data+json") < 0)
+    if (restconf_reply_header(req, "Accept-Patch", "application/yang-data+xml,application/yang-data+json,application/yang-patch+xml,application/yang-patch+json") < 0)
 	goto done;
     if (restconf_reply_send(req, 200, NULL, 0) < 0)
 	goto done;
@@ -582,414 +583,608 @@ api_data_write(clicon_handle h,
    return retval;
 } /* api_data_write */
 
-#ifdef YANG_PATCH
-
-/*! Free memory after a NULL pointer check
-  *
-  * @param [in] str     void pointer to memory to be freed
-  *
-  */
-static void yang_patch_free_mem(void *p)
-{
-    if (p != NULL)
-        free(p);
-}
-
-/*! Return a value within XML tags
- * @param [in] nsc  namespace context
- * @param [in] xn   cxobj containing XML with the current edit
- * @param [in] val   cbuf to which the value will be written
- * @param [in] key  string containing the tag
- * @retval 0 success
- * @retval <0 failure
+/*! Add netconf operation attribute to an edit-config node
+ * @param[in]  x   XML node
+ * @param[in]  op  Netconf operation
+ * @retval     0   OK
+ * @retval    -1   Error
  */
-static int yang_patch_get_xval(
-    cvec* nsc,
-    cxobj* xn,
-    cbuf* val,
-    const char* key
-    )
-{
-    cxobj **vec = NULL;
-    size_t veclen = 0;
-    char* tmp_val = NULL;
-    int ret = xpath_vec(xn, nsc, "%s", &vec, &veclen, key);
-    if (ret < 0) {
-        return ret;
-    }
-    cxobj *xn_tmp = NULL;
-    if (veclen == 1) { //veclen should always be 1
-        xn_tmp = vec[0];
-    }
-    if (xn_tmp != NULL) {
-        tmp_val = xml_body(xn_tmp);
-        cbuf_append_str(val, tmp_val);
-    }
-    return 0;
-}
-
-// TODO - add this to cligen repo if it is approved
-/*! Truncate a cbuf
-  *
-  * @param [in]  cb  cligen buffer allocated by cbuf_new(), may be reallocated.
-  * @param [in]  int pos position at which to truncate
-  * @retval new cbuf containing the truncated string (old buffer remains as it was)
-  * @retval NULL   Error
-  */
-cbuf*
-cbuf_trunc(cbuf       *cb,
-		int       pos)
-{
-    if (pos < 0 || pos > cb->cb_strlen){
-	errno = EINVAL;
-	return NULL;
-    }
-    /* Ensure buffer is right size */
-    cbuf* new_buf = cbuf_new_alloc(pos + 1);
-    if (new_buf == NULL)
-        return NULL;
-    strncpy(new_buf->cb_buffer, cb->cb_buffer, pos);
-    new_buf->cb_strlen = pos;
-    return new_buf;
-}
-
-/*! Add square brackets after the surrounding curly brackets in JSON
-  * Needed, in order to modify the result of xml2json_cbuf() to be valid input
-  * to api_dta_post() and api_dta_write()
-  * @param [in]  x_simple_patch  a cxobj to pass to xml2json_cbuf()
-  * @retval new cbuf with the modified json
-  * @retval NULL   Error
-  */
-
-static cbuf* yang_patch_xml2json_modified_cbuf(cxobj* x_simple_patch)
+static int
+yang_patch_op_add(cxobj              *x,
+		  enum operation_type op)
 {
-    cbuf *json_simple_patch = cbuf_new();
-    if (json_simple_patch == NULL)
-        return NULL;
-    cbuf* cb = cbuf_new();
-    xml2json_cbuf(cb, x_simple_patch, 1);
+    int    retval = -1;
+    cxobj *xa;
 
-    // Insert a '[' after the first '{' to get the JSON to match what api_data_post/write() expect
-    char *json_simple_patch_tmp = cbuf_get(cb);
-    int brace_count = 0;
-    for (int l = 0; l < strlen(json_simple_patch_tmp); l++) {
-        char c = json_simple_patch_tmp[l];
-        if (c == '{') {
-            brace_count++;
-            if (brace_count == 2) { // We've reached the second brace, insert a '[' before it
-                cbuf_append(json_simple_patch,(int)'[');
-            }
-        }
-        cbuf_append(json_simple_patch,(int)c);
-    }
-    cbuf* json_simple_patch_2 = NULL;
-
-    // Insert a ']' before the last '}' to get the JSON to match what api_data_post() expects
-    for (int l = cbuf_len(json_simple_patch) - 1; l >= 0; l--) {
-        char c = cbuf_get(json_simple_patch)[l];
-        if (c == '}') {
-            // Truncate and add a string, as there is not a function to insert a char into a cbuf
-           json_simple_patch_2 = cbuf_trunc(json_simple_patch, l);
-           cbuf_append_str(json_simple_patch_2, "]}");
-           break;
-        }
-    }
-    cbuf_free(json_simple_patch);
-    cbuf_free(cb);
-    return json_simple_patch_2;
+    if ((xa = xml_new("operation", x, CX_ATTR)) == NULL)
+	goto done;
+    if (xml_prefix_set(xa, NETCONF_BASE_PREFIX) < 0)
+	goto done;
+    if (xml_value_set(xa, xml_operation2str(op)) < 0)
+	goto done;
+    retval = 0;
+ done:
+    return retval;
 }
 
-/*!yang_patch_strip_after_last_slash 
- *
- * Strip /... from end  of val
- * so that e.g. "/interface=eth2" becomes "/"
- * or "/interface_list=mylist/interface=eth2" becomes "/interface_list=mylist/"
+/*! Merge the tree of one YANG patch edit into the edit-config tree of the whole patch
  *
- * @param[in]  val         value to strip
- * @retval new cbuf with the stripped string
- * @retval NULL error
+ * The path from xt down to xedit is matched with existing nodes in xtop. The first
+ * non-matching node is inserted in sorted order, so that later edits can be matched
+ * using binary search as in the datastore.
+ * Targets of edits are marked with XML_FLAG_MARK. If the path passes through the target of
+ * an earlier edit, or ends at a node on the path of an earlier edit, the edits overlap and
+ * their result depends on their order, which one edit-config tree cannot express.
+ * @param[in]  xtop   Edit-config <config> tree of earlier edits
+ * @param[in]  xt     Top of edit tree (not itself part of the path)
+ * @param[in]  xedit  Node in xt with the netconf operation of this edit, marked
+ * @retval     1      OK, edit merged into xtop
+ * @retval     0      Edit overlaps an earlier edit
+ * @retval    -1      Error
  */
-static cbuf* yang_patch_strip_after_last_slash(cbuf* val)
+static int
+yang_patch_graft(cxobj *xtop,
+		 cxobj *xt,
+		 cxobj *xedit)
 {
-      cbuf *cb = cbuf_new();
-      cbuf* val_tmp = cbuf_new();
-      cbuf_append_str(val_tmp, cbuf_get(val));
-      int idx = cbuf_len(val_tmp);
-      for (int l = cbuf_len(val_tmp) - 1; l>= 0; l--) {
-          if (cbuf_get(val_tmp)[l] == '/') {
-              idx = l;
-              break;
-          }
-      }
-      if (idx == cbuf_len(val_tmp)) // Didn't find a slash in the loop above
-          return NULL;
-      cbuf* val_tmp_2 = cbuf_trunc(val_tmp, idx + 1);
-      if (cbuf_append_str(cb, cbuf_get(val_tmp_2)) < 0)
-          return NULL;
-      cbuf_free(val_tmp);
-      cbuf_free(val_tmp_2);
-      return cb;
+    int    retval = -1;
+    cxobj *x0p = xtop;
+    cxobj *x0c;
+    cxobj *x1p = xt;
+    cxobj *x1c;
+
+    while (x1p != xedit){
+	/* Find child of x1p on the path to xedit */
+	for (x1c = xedit; xml_parent(x1c) != x1p; x1c = xml_parent(x1c))
+	    ;
+	if (match_base_child(x0p, x1c, xml_spec(x1c), &x0c) < 0)
+	    goto done;
+	if (x0c == NULL){
+	    if (xml_insert(x0p, x1c, INS_LAST, NULL, NULL) < 0)
+		goto done;
+	    break;
+	}
+	if (x1c == xedit || xml_flag(x0c, XML_FLAG_MARK))
+	    goto fail;
+	x0p = x0c;
+	x1p = x1c;
+    }
+    retval = 1;
+ done:
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
 }
 
-/*! YANG PATCH replace method
- * @param[in]  h         Clixon handle
- * @param[in]  req       Generic Www handle
- * @param[in]  pi        Offset, where to start pcvec
- * @param[in]  qvec      Vector of query string (QUERY_STRING)
- * @param[in]  pretty    Set to 1 for pretty-printed xml/json output
- * @param[in]  media_out Output media
- * @param[in]  ds       0 if "data" resource, 1 if rfc8527 "ds" resource
- * @param[in]  simplepatch_request_uri URI for patch request, e.g. "/restconf/data/ietf-interfaces:interfaces"
- * @param[in]  target_val       value in "target" field of edit in YANG patch
- * @param[in]  value_vec_len    number of elements in the "value" array of an edit in YANG patch
- * @param[in]  value_vec        pointer to the "value" array of an edit in YANG patch
- * @param[in]  x_simple_patch   pointer to XML containing module name, e.g. <ietf-interfaces:interface/>
+/*! Translate one YANG patch edit to netconf and merge it into an edit-config tree
+ *
+ * The target of the edit is the api-path of the request followed by the target of the
+ * edit. The value of the edit replaces the bottom of the target path, and the edit 
+ * operation is added as a netconf operation attribute:
+ *   create, insert: create, with yang:insert attributes for insert
+ *   merge, replace, delete, remove: same operation
+ *   move: replace of the existing entry (read from db) with yang:insert attributes
+ * @param[in]  h        Clixon handle
+ * @param[in]  xedit    YANG patch edit
+ * @param[in]  api_path Target resource of the request, or NULL for the datastore
+ * @param[in]  yspec    Yang spec
+ * @param[in]  db       Datastore to read the entry of a move from
+ * @param[in]  xtop     Edit-config <config> tree of the whole patch
+ * @param[out] xerr     Netconf error message if edit is invalid
+ * @retval     2        Edit overlaps an earlier edit in xtop, xtop is partly changed
+ * @retval     1        OK, edit merged into xtop
+ * @retval     0        Invalid edit, xerr set
+ * @retval    -1        Error
+ * @see RFC 8072 Sec 2.5
  */
-static int yang_patch_do_replace (
-        clicon_handle h,
-	    void         *req,
-	    int           pi,
-	    cvec         *qvec,
-	    int           pretty,
-	    restconf_media media_out,
-	    ietf_ds_t     ds,
-        cbuf* simple_patch_request_uri,
-        cbuf* target_val,       
-        int value_vec_len,
-        cxobj** value_vec,
-        cxobj *x_simple_patch
-      )
+static int
+yang_patch_edit2xml(clicon_handle h,
+		    cxobj        *xedit,
+		    char         *api_path,
+		    yang_stmt    *yspec,
+		    char         *db,
+		    cxobj        *xtop,
+		    cxobj       **xerr)
 {
-      cxobj * value_vec_tmp = NULL;
-      cbuf* delete_req_uri = cbuf_new();
-      if (delete_req_uri == NULL)
-          return 1;
-
-      // Make delete_req_uri something like "/restconf/data/ietf-interfaces:interfaces"
-      if (cbuf_append_str(delete_req_uri, cbuf_get(simple_patch_request_uri)) < 0)
-          return 1;
-
-      // Add the target to delete_req_uri,
-      // so it's something like "/restconf/data/ietf-interfaces:interfaces/interface=eth2"
-      if (cbuf_append_str(delete_req_uri, cbuf_get(target_val)) <  0)
-          return 1;
-
-      // Delete the object with the old values
-      int ret = api_data_delete(h, req, cbuf_get(delete_req_uri), pi, pretty, YANG_DATA_JSON, ds );
-      cbuf_free(delete_req_uri);
-      if (ret != 0)
-          return ret;
-
-      // Now set up for the post request.
-      // Strip /... from end  of target val
-      // so that e.g. "/interface=eth2" becomes "/"
-      // or "/interface_list=mylist/interface=eth2" becomes "/interface_list=mylist/"
-      cbuf* post_req_uri = yang_patch_strip_after_last_slash(target_val);
-
-      // Make post_req_uri something like "/restconf/data/ietf-interfaces:interfaces"
-      if (cbuf_append_str(simple_patch_request_uri, cbuf_get(post_req_uri)))
-          return 1;
-      cbuf_free(post_req_uri);
-
-      // Now insert the new values into the data
-      // (which will include the key value and all other mandatory values)
-      for (int k = 0; k < value_vec_len; k++) {
-          if (value_vec[k] != NULL) {
-              value_vec_tmp = xml_dup(value_vec[k]);
-              xml_addsub(x_simple_patch, value_vec_tmp);
-          }
-      }
-      // Convert the data to json
-     cbuf *json_simple_patch = cbuf_new();
-     if (json_simple_patch == NULL)
-         return 1;
-     xml2json_cbuf(json_simple_patch, x_simple_patch, 1);
-
-      // Send the POST request
-      ret = api_data_post(h, req, cbuf_get(simple_patch_request_uri), pi, qvec, cbuf_get(json_simple_patch), pretty, YANG_DATA_JSON, media_out, ds );
-      
-      cbuf_free(json_simple_patch);
-      xml_free(value_vec_tmp);
-      return ret;
+    int                 retval = -1;
+    char               *opstr;
+    char               *target;
+    char               *where;
+    char               *point;
+    enum operation_type op;
+    int                 hasvalue = 0; /* Edit has a value */
+    int                 move;
+    cbuf               *cb = NULL;
+    char               *path = NULL;
+    cxobj              *xt = NULL;    /* Tree of this edit */
+    cxobj              *xbot = NULL;  /* Bottom of target path */
+    yang_stmt          *ybot = NULL;
+    cxobj              *xvalue;
+    cxobj              *xv = NULL;
+    cxobj              *xret = NULL;
+    cvec               *qvec = NULL;
+    char               *xpath = NULL;
+    cvec               *nsc = NULL;
+    int                 ret;
+
+    if ((opstr = xml_find_body(xedit, "operation")) == NULL){
+	if (netconf_missing_element_xml(xerr, "protocol", "operation", NULL) < 0)
+	    goto done;
+	goto fail;
+    }
+    if ((target = xml_find_body(xedit, "target")) == NULL){
+	if (netconf_missing_element_xml(xerr, "protocol", "target", NULL) < 0)
+	    goto done;
+	goto fail;
+    }
+    if ((where = xml_find_body(xedit, "where")) == NULL)
+	where = "last";
+    point = xml_find_body(xedit, "point");
+    move = (strcmp(opstr, "move") == 0);
+    if (strcmp(opstr, "create") == 0 || strcmp(opstr, "insert") == 0){
+	op = OP_CREATE;
+	hasvalue++;
+    }
+    else if (strcmp(opstr, "merge") == 0){
+	op = OP_MERGE;
+	hasvalue++;
+    }
+    else if (strcmp(opstr, "replace") == 0){
+	op = OP_REPLACE;
+	hasvalue++;
+    }
+    else if (strcmp(opstr, "delete") == 0)
+	op = OP_DELETE;
+    else if (strcmp(opstr, "remove") == 0)
+	op = OP_REMOVE;
+    else if (move)
+	op = OP_REPLACE;
+    else{
+	if (netconf_invalid_value_xml(xerr, "protocol", "Invalid yang patch operation") < 0)
+	    goto done;
+	goto fail;
+    }
+    if ((cb = cbuf_new()) == NULL){
+	clicon_err(OE_UNIX, errno, "cbuf_new");
+	goto done;
+    }
+    /* Target is relative to the target resource of the request */
+    if (api_path && strcmp(api_path, "/") != 0)
+	cprintf(cb, "%s", api_path);
+    if (strcmp(target, "/") != 0)
+	cprintf(cb, "%s", target);
+    if (cbuf_len(cb))
+	path = cbuf_get(cb);
+    else if (!hasvalue){
+	if (netconf_invalid_value_xml(xerr, "protocol", "Edit target must be a data resource") < 0)
+	    goto done;
+	goto fail;
+    }
+    if ((xt = xml_new(NETCONF_INPUT_CONFIG, NULL, CX_ELMNT)) == NULL)
+	goto done;
+    xbot = xt;
+    if (path){
+	if ((ret = api_path2xml(path, yspec, xt, YC_DATANODE, 1, &xbot, &ybot, xerr)) < 0)
+	    goto done;
+	if (ret == 0)
+	    goto fail;
+    }
+    if (move){
+	/* The existing entry is moved, read it since replace needs the whole entry */
+	if ((ret = api_path2xpath(path, yspec, &xpath, &nsc, xerr)) < 0)
+	    goto done;
+	if (ret == 0)
+	    goto fail;
+	if (clicon_rpc_get_config(h, clicon_username_get(h), db, xpath, nsc, &xret) < 0)
+	    goto done;
+	if (xpath_first(xret, NULL, "rpc-error") != NULL){
+	    *xerr = xret;
+	    xret = NULL;
+	    goto fail;
+	}
+	if ((xv = xpath_first(xret, nsc, "%s", xpath)) == NULL){
+	    if (netconf_data_missing_xml(xerr, NULL, "Data does not exist; cannot move resource") < 0)
+		goto done;
+	    goto fail;
+	}
+	if (xml_rm(xv) < 0)
+	    goto done;
+    }
+    else if (hasvalue){
+	if ((xvalue = xml_find_type(xedit, NULL, "value", CX_ELMNT)) == NULL ||
+	    xml_child_nr_type(xvalue, CX_ELMNT) == 0){
+	    if (netconf_missing_element_xml(xerr, "protocol", "value", NULL) < 0)
+		goto done;
+	    goto fail;
+	}
+	if (path == NULL){
+	    /* Datastore is target: each top-level element of value is edited */
+	    while ((xv = xml_child_i_type(xvalue, 0, CX_ELMNT)) != NULL){
+		if (xml_addsub(xt, xv) < 0)
+		    goto done;
+		if ((ret = xml_bind_yang0(xv, YB_MODULE, yspec, xerr)) < 0)
+		    goto done;
+		if (ret == 0)
+		    goto fail;
+		if (yang_patch_op_add(xv, op) < 0)
+		    goto done;
+		xml_flag_set(xv, XML_FLAG_MARK);
+	    }
+	}
+	else{
+	    if (xml_child_nr_type(xvalue, CX_ELMNT) != 1){
+		if (netconf_malformed_message_xml(xerr, "The value MUST contain exactly one instance of the target resource") < 0)
+		    goto done;
+		goto fail;
+	    }
+	    xv = xml_child_i_type(xvalue, 0, CX_ELMNT);
+	}
+    }
+    if (path && xv){
+	/* Replace bottom of target path with value */
+	if (strcmp(xml_name(xv), xml_name(xbot)) != 0){
+	    if (netconf_bad_element_xml(xerr, "application", xml_name(xv),
+					"Value element does not match edit target") < 0)
+		goto done;
+	    goto fail;
+	}
+	if (xml_addsub(xml_parent(xbot), xv) < 0)
+	    goto done;
+	if ((ret = xml_bind_yang0(xv, xml_parent(xv)==xt?YB_MODULE:YB_PARENT, yspec, xerr)) < 0)
+	    goto done;
+	if (ret == 0)
+	    goto fail;
+	if (ybot && match_list_keys(ybot, xv, xbot) < 0){
+	    if (netconf_operation_failed_xml(xerr, "protocol", "Edit target keys do not match value keys") < 0)
+		goto done;
+	    goto fail;
+	}
+	xml_purge(xbot);
+	xbot = xv;
+    }
+    if (path){
+	if (yang_patch_op_add(xbot, op) < 0)
+	    goto done;
+	xml_flag_set(xbot, XML_FLAG_MARK);
+	/* Translate insert/move where and point to netconf insert attributes */
+	if (strcmp(opstr, "insert") == 0 || move){
+	    if ((strcmp(where, "before") == 0 || strcmp(where, "after") == 0) &&
+		point == NULL){
+		if (netconf_missing_element_xml(xerr, "protocol", "point", NULL) < 0)
+		    goto done;
+		goto fail;
+	    }
+	    if ((qvec = cvec_new(0)) == NULL){
+		clicon_err(OE_UNIX, errno, "cvec_new");
+		goto done;
+	    }
+	    if (cvec_add_string(qvec, "insert", where) < 0){
+		clicon_err(OE_UNIX, errno, "cvec_add_string");
+		goto done;
+	    }
+	    if (point){
+		/* Point is also relative to the target resource */
+		cbuf_reset(cb);
+		if (api_path && strcmp(api_path, "/") != 0)
+		    cprintf(cb, "%s", api_path);
+		cprintf(cb, "%s", point);
+		if (cvec_add_string(qvec, "point", cbuf_get(cb)) < 0){
+		    clicon_err(OE_UNIX, errno, "cvec_add_string");
+		    goto done;
+		}
+	    }
+	    if (restconf_insert_attributes(xbot, qvec) < 0)
+		goto done;
+	}
+    }
+    if (xml_sort_recurse(xt) < 0)
+	goto done;
+    if (path){
+	if ((ret = yang_patch_graft(xtop, xt, xbot)) < 0)
+	    goto done;
+    }
+    else{
+	ret = 1;
+	while (ret == 1 && (xv = xml_child_i_type(xt, 0, CX_ELMNT)) != NULL)
+	    if ((ret = yang_patch_graft(xtop, xt, xv)) < 0)
+		goto done;
+    }
+    if (ret == 0){
+	retval = 2;
+	goto done;
+    }
+    retval = 1;
+ done:
+    if (cb)
+	cbuf_free(cb);
+    if (xt)
+	xml_free(xt);
+    if (xret)
+	xml_free(xret);
+    if (qvec)
+	cvec_free(qvec);
+    if (xpath)
+	free(xpath);
+    if (nsc)
+	xml_nsctx_free(nsc);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
 }
 
-/*! YANG PATCH create method
- * @param[in]  h         Clixon handle
- * @param[in]  req       Generic Www handle
- * @param[in]  pi        Offset, where to start pcvec
- * @param[in]  qvec      Vector of query string (QUERY_STRING)
- * @param[in]  pretty    Set to 1 for pretty-printed xml/json output
- * @param[in]  media_out Output media
- * @param[in]  ds       0 if "data" resource, 1 if rfc8527 "ds" resource
- * @param[in]  simplepatch_request_uri URI for patch request, e.g. "/restconf/data/ietf-interfaces:interfaces"
- * @param[in]  value_vec_len    number of elements in the "value" array of an edit in YANG patch
- * @param[in]  value_vec        pointer to the "value" array of an edit in YANG patch
- * @param[in]  x_simple_patch   pointer to XML containing module name, e.g. <ietf-interfaces:interface/>
+/*! Send a netconf rpc to the backend on behalf of the restconf user
+ * @param[in]  h     Clixon handle
+ * @param[in]  body  Operation, eg <commit/>
+ * @param[out] xerr  Reply with rpc-error if retval is 0, or NULL
+ * @retval     1     OK
+ * @retval     0     Operation failed, xerr set
+ * @retval    -1     Error
  */
-static int yang_patch_do_create (
-        clicon_handle h,
-	    void         *req,
-	    int           pi,
-	    cvec         *qvec,
-	    int           pretty,
-	    restconf_media media_out,
-	    ietf_ds_t     ds,
-        cbuf* simple_patch_request_uri,
-        int value_vec_len,
-        cxobj** value_vec,
-        cxobj *x_simple_patch
-      )
+static int
+yang_patch_rpc(clicon_handle h,
+	       char         *body,
+	       cxobj       **xerr)
 {
-     cxobj * value_vec_tmp = NULL;
-     for (int k = 0; k < value_vec_len; k++) {
-         if (value_vec[k] != NULL) {
-             value_vec_tmp = xml_dup(value_vec[k]);
-             xml_addsub(x_simple_patch, value_vec_tmp);
-         }
-     }
+    int    retval = -1;
+    cbuf  *cb = NULL;
+    cxobj *xret = NULL;
+    char  *username;
 
-     // Send the POST request
-     cbuf* cb = cbuf_new();
-     xml2json_cbuf(cb, x_simple_patch, 1);
-     char *json_simple_patch = cbuf_get(cb);
-     int ret = api_data_post(h, req, cbuf_get(simple_patch_request_uri), pi, qvec, json_simple_patch, pretty, YANG_DATA_JSON, media_out, ds );
-     xml_free(value_vec_tmp);
-     return ret;
+    username = clicon_username_get(h);
+    if ((cb = cbuf_new()) == NULL){
+	clicon_err(OE_UNIX, errno, "cbuf_new");
+	goto done;
+    }
+    cprintf(cb, "<rpc xmlns=\"%s\" username=\"%s\" xmlns:%s=\"%s\" %s>%s</rpc>",
+	    NETCONF_BASE_NAMESPACE,
+	    username?username:"",
+	    NETCONF_BASE_PREFIX,
+	    NETCONF_BASE_NAMESPACE,  /* bind nc to netconf namespace */
+	    NETCONF_MESSAGE_ID_ATTR,
+	    body);
+    if (clicon_rpc_netconf(h, cbuf_get(cb), &xret, NULL) < 0)
+	goto done;
+    if (xpath_first(xret, NULL, "//rpc-error") != NULL){
+	if (xerr){
+	    *xerr = xret;
+	    xret = NULL;
+	}
+	retval = 0;
+	goto done;
+    }
+    retval = 1;
+ done:
+    if (cb)
+	cbuf_free(cb);
+    if (xret)
+	xml_free(xret);
+    return retval;
 }
 
-/*! YANG PATCH insert method
- * @param[in]  h         Clixon handle
- * @param[in]  req       Generic Www handle
- * @param[in]  pi        Offset, where to start pcvec
- * @param[in]  pretty    Set to 1 for pretty-printed xml/json output
- * @param[in]  media_out Output media
- * @param[in]  ds       0 if "data" resource, 1 if rfc8527 "ds" resource
- * @param[in]  simple_patch_request_uri URI for patch request, e.g. "/restconf/data/ietf-interfaces:interfaces"
- * @param[in]  value_vec_len    number of elements in the "value" array of an edit in YANG patch
- * @param[in]  value_vec        pointer to the "value" array of an edit in YANG patch
- * @param[in]  x_simple_patch   pointer to XML containing module name, e.g. <ietf-interfaces:interface/>
- * @param[in]  where_val       value in "where" field of edit in YANG patch
- * @param[in]  api_path        full API path, e.g. "/restconf/data/example-jukebox:jukebox/playlist=Foo-One" 
- * @param[in]  point_val       value in "point" field of edit in YANG patch
+/*! Apply the edits of a YANG patch one at a time to the candidate, and commit them
+ *
+ * Used when edits overlap, eg an entry is deleted and then a child of it is merged, so
+ * that they cannot be merged into one edit-config tree. The candidate is locked, each edit
+ * is sent as its own edit-config in patch order, and all edits are committed as one
+ * transaction. If an edit or the commit fails, the changes are discarded.
+ * @param[in]  h        Clixon handle
+ * @param[in]  xpatch   YANG patch
+ * @param[in]  api_path Target resource of the request, or NULL for the datastore
+ * @param[in]  yspec    Yang spec
+ * @param[in]  startup  Copy running to startup after commit
+ * @param[out] xerr     Netconf error if retval is 0
+ * @param[out] editid   Edit-id of failed edit, or NULL if the patch as a whole failed
+ * @retval     1        OK, patch applied
+ * @retval     0        Patch failed, xerr set, nothing applied
+ * @retval    -1        Error
+ * @note With CLICON_AUTOCOMMIT, each edit is committed by the backend on its own
  */
-static int yang_patch_do_insert (
-        clicon_handle h,
-	    void         *req,
-	    int           pi,
-	    int           pretty,
-	    restconf_media media_out,
-	    ietf_ds_t     ds,
-        cbuf* simple_patch_request_uri,
-        int value_vec_len,
-        cxobj** value_vec,
-        cxobj *x_simple_patch,
-        cbuf* where_val,
-        char* api_path,
-        cbuf *point_val
-      )
+static int
+yang_patch_ordered(clicon_handle h,
+		   cxobj        *xpatch,
+		   char         *api_path,
+		   yang_stmt    *yspec,
+		   int           startup,
+		   cxobj       **xerr,
+		   char        **editid)
 {
-     cxobj * value_vec_tmp = NULL;
-
-     // Loop through the XML, and get each value
-     for (int k = 0; k < value_vec_len; k++) {
-         if (value_vec[k] != NULL) {
-             value_vec_tmp = xml_dup(value_vec[k]);
-             xml_addsub(x_simple_patch, value_vec_tmp);
-         }
-     }
-     cbuf *json_simple_patch = yang_patch_xml2json_modified_cbuf(x_simple_patch);
-     if (json_simple_patch == NULL)
-         return 1;
-
-     // Set the insert attributes
-     cvec* qvec_tmp = NULL;
-     qvec_tmp = cvec_new(0);
-     if (qvec_tmp == NULL)
-         return 1;
-     cg_var *cv;
-     if ((cv = cvec_add(qvec_tmp, CGV_STRING)) == NULL){
-         return 1;
-     }
-     cv_name_set(cv, "insert");
-     cv_string_set(cv, cbuf_get(where_val));
-     cbuf *point_str = cbuf_new();
-     if (point_str == NULL)
-         return 1;
-     cbuf_append_str(point_str, api_path);
-     cbuf_append_str(point_str, cbuf_get(point_val));
-     if ((cv = cvec_add(qvec_tmp, CGV_STRING)) == NULL){
-         return 1;
-     }
-     cv_name_set(cv, "point");
-     cv_string_set(cv, cbuf_get(point_str));
-
-     // Send the POST request
-     int ret = api_data_post(h, req, cbuf_get(simple_patch_request_uri), pi, qvec_tmp, cbuf_get(json_simple_patch), pretty, YANG_DATA_JSON, media_out, ds );
-     xml_free(value_vec_tmp);
-     cbuf_free(point_str);
-     cbuf_free(json_simple_patch);
-     return ret;
+    int    retval = -1;
+    cxobj *xedit;
+    cxobj *xtop = NULL;
+    cbuf  *cb = NULL;
+    int    locked = 0;
+    int    ret;
+
+    *editid = NULL;
+    if ((cb = cbuf_new()) == NULL){
+	clicon_err(OE_UNIX, errno, "cbuf_new");
+	goto done;
+    }
+    if ((ret = yang_patch_rpc(h, "<lock><target><candidate/></target></lock>", xerr)) < 0)
+	goto done;
+    if (ret == 0)
+	goto fail;
+    locked++;
+    xedit = NULL;
+    while ((xedit = xml_child_each(xpatch, xedit, CX_ELMNT)) != NULL){
+	if (strcmp(xml_name(xedit), "edit") != 0)
+	    continue;
+	*editid = xml_find_body(xedit, "edit-id");
+	if ((xtop = xml_new(NETCONF_INPUT_CONFIG, NULL, CX_ELMNT)) == NULL)
+	    goto done;
+	/* Edits are applied one at a time, a move reads the entry from candidate */
+	if ((ret = yang_patch_edit2xml(h, xedit, api_path, yspec, "candidate", xtop, xerr)) < 0)
+	    goto done;
+	if (ret == 2){ /* Only if the value of an edit of the datastore has duplicates */
+	    if (netconf_operation_failed_xml(xerr, "protocol", "Edit value contains the same node twice") < 0)
+		goto done;
+	    ret = 0;
+	}
+	if (ret == 0)
+	    goto discard;
+	cbuf_reset(cb);
+	cprintf(cb, "<edit-config><target><candidate/></target>");
+	cprintf(cb, "<default-operation>none</default-operation>");
+	if (clicon_xml2cbuf(cb, xtop, 0, 0, -1) < 0)
+	    goto done;
+	cprintf(cb, "</edit-config>");
+	xml_free(xtop);
+	xtop = NULL;
+	if ((ret = yang_patch_rpc(h, cbuf_get(cb), xerr)) < 0)
+	    goto done;
+	if (ret == 0)
+	    goto discard;
+    }
+    *editid = NULL;
+    if ((ret = yang_patch_rpc(h, "<commit/>", xerr)) < 0)
+	goto done;
+    if (ret == 0)
+	goto discard;
+    /* RFC8040 Sec 1.4: update startup, see api_data_write */
+    if (startup &&
+	yang_patch_rpc(h, "<copy-config><source><running/></source><target><startup/></target></copy-config>", NULL) < 0)
+	goto done;
+    retval = 1;
+ done:
+    if (locked &&
+	yang_patch_rpc(h, "<unlock><target><candidate/></target></unlock>", NULL) < 0)
+	retval = -1;
+    if (xtop)
+	xml_free(xtop);
+    if (cb)
+	cbuf_free(cb);
+    return retval;
+ discard:
+    if (yang_patch_rpc(h, "<discard-changes/>", NULL) < 0)
+	goto done;
+ fail:
+    retval = 0;
+    goto done;
 }
 
-/*! YANG PATCH merge method
+/*! Send a YANG patch status reply
  * @param[in]  h         Clixon handle
  * @param[in]  req       Generic Www handle
- * @param[in]  pcvec    Vector of path ie DOCUMENT_URI element
- * @param[in]  pi        Offset, where to start pcvec
- * @param[in]  qvec      Vector of query string (QUERY_STRING)
+ * @param[in]  patchid   Patch-id of the request
+ * @param[in]  editid    Edit-id of a failed edit, or NULL for global errors
+ * @param[in]  xerr      Netconf error on the form <xxx><rpc-error>..., or NULL if success
  * @param[in]  pretty    Set to 1 for pretty-printed xml/json output
  * @param[in]  media_out Output media
- * @param[in]  ds       0 if "data" resource, 1 if rfc8527 "ds" resource
- * @param[in]  simple_patch_request_uri URI for patch request, e.g. "/restconf/data/ietf-interfaces:interfaces"
- * @param[in]  value_vec_len    number of elements in the "value" array of an edit in YANG patch
- * @param[in]  value_vec        pointer to the "value" array of an edit in YANG patch
- * @param[in]  x_simple_patch   pointer to XML containing module name, e.g. "<ietf-interfaces:interface/>"
- * @param[in]  where_val       value in "where" field of edit in YANG patch
- * @param[in]  key_xn          XML with key tag and value, e.g. "<name>Foo-One</name>"
+ * @see RFC 8072 Sec 2.3
  */
-static int yang_patch_do_merge (
-        clicon_handle h,
-	    void         *req,
-	    cvec         *pcvec,
-	    int           pi,
-	    cvec         *qvec,
-	    int           pretty,
-	    restconf_media media_out,
-	    ietf_ds_t     ds,
-        cbuf* simple_patch_request_uri,
-        int value_vec_len,
-        cxobj** value_vec,
-        cxobj *x_simple_patch,
-        cxobj *key_xn
-      )
+static int
+yang_patch_status_reply(clicon_handle  h,
+			void          *req,
+			char          *patchid,
+			char          *editid,
+			cxobj         *xerr,
+			int            pretty,
+			restconf_media media_out)
 {
-    int ret = -1;
-     cxobj * value_vec_tmp = NULL;
-     if (key_xn != NULL)
-         xml_addsub(x_simple_patch, key_xn);
-    
-     // Loop through the XML, create JSON from each one, and submit a simple patch
-     for (int k = 0; k < value_vec_len; k++) {
-         if (value_vec[k] != NULL) {
-             value_vec_tmp = xml_dup(value_vec[k]);
-             xml_addsub(x_simple_patch, value_vec_tmp);
-         }
-         cbuf* cb = cbuf_new();
-         xml2json_cbuf(cb, x_simple_patch, 1);
+    int        retval = -1;
+    cxobj     *xs = NULL;
+    cxobj     *xp;
+    cxobj     *xe;
+    cxobj     *xc;
+    cxobj     *xa;
+    cxobj    **vec = NULL;
+    size_t     veclen = 0;
+    int        i;
+    int        code = 200;
+    char      *tagstr;
+    cbuf      *cb = NULL;
+    yang_stmt *yspec;
 
-        cbuf *json_simple_patch = yang_patch_xml2json_modified_cbuf(x_simple_patch);
-        if (json_simple_patch == NULL)
-            return 1;
-         xml_free(value_vec_tmp);
-         // Send the simple patch request
-         ret = api_data_write(h, req, cbuf_get(simple_patch_request_uri), pcvec, pi, qvec, cbuf_get(json_simple_patch), pretty, YANG_DATA_JSON, media_out, 1, ds );
-         cbuf_free(cb);
-         cbuf_free(json_simple_patch);
-     }
-     return ret;
+    if ((xs = xml_new("yang-patch-status", NULL, CX_ELMNT)) == NULL)
+	goto done;
+    if (xmlns_set(xs, NULL, YANG_PATCH_NAMESPACE) < 0)
+	goto done;
+    if (xml_new_body("patch-id", xs, patchid) == NULL)
+	goto done;
+    if (xerr == NULL){
+	if (xml_new("ok", xs, CX_ELMNT) == NULL)
+	    goto done;
+    }
+    else {
+	xp = xs;
+	if (editid){
+	    if ((xp = xml_new("edit-status", xs, CX_ELMNT)) == NULL)
+		goto done;
+	    if ((xp = xml_new("edit", xp, CX_ELMNT)) == NULL)
+		goto done;
+	    if (xml_new_body("edit-id", xp, editid) == NULL)
+		goto done;
+	}
+	if ((xe = xml_new("errors", xp, CX_ELMNT)) == NULL)
+	    goto done;
+	if (xpath_vec(xerr, NULL, "//rpc-error", &vec, &veclen) < 0)
+	    goto done;
+	for (i=0; i<veclen; i++){
+	    if ((xc = xml_dup(vec[i])) == NULL)
+		goto done;
+	    if (xml_name_set(xc, "error") < 0)
+		goto done;
+	    if ((xa = xml_find_type(xc, NULL, "xmlns", CX_ATTR)) != NULL)
+		xml_purge(xa);
+	    if (xml_addsub(xe, xc) < 0)
+		goto done;
+	    if (i == 0 &&
+		(tagstr = xml_find_body(xc, "error-tag")) != NULL &&
+		(code = restconf_err2code(tagstr)) < 0)
+		code = 500; /* internal server error */
+	}
+	if (veclen == 0)
+	    code = 500;
+    }
+    /* Bind to get module names in JSON, best effort */
+    if ((yspec = clicon_dbspec_yang(h)) != NULL &&
+	xml_bind_yang0(xs, YB_MODULE, yspec, NULL) < 0)
+	goto done;
+    if ((cb = cbuf_new()) == NULL){
+	clicon_err(OE_UNIX, errno, "cbuf_new");
+	goto done;
+    }
+    if (restconf_reply_header(req, "Content-Type", "%s", restconf_media_int2str(media_out)) < 0)
+	goto done;
+    switch (media_out){
+    case YANG_DATA_XML:
+	if (clicon_xml2cbuf(cb, xs, 0, pretty, -1) < 0)
+	    goto done;
+	break;
+    case YANG_DATA_JSON:
+	if (xml2json_cbuf(cb, xs, pretty) < 0)
+	    goto done;
+	break;
+    default:
+	clicon_err(OE_YANG, EINVAL, "Invalid media type %d", media_out);
+	goto done;
+	break;
+    }
+    cprintf(cb, "\r\n");
+    if (restconf_reply_send(req, code, cb, 0) < 0)
+	goto done;
+    cb = NULL;
+    retval = 0;
+ done:
+    if (cb)
+	cbuf_free(cb);
+    if (vec)
+	free(vec);
+    if (xs)
+	xml_free(xs);
+    return retval;
 }
 
-/*! YANG PATCH method
+/*! YANG PATCH method according to RFC 8072
+ *
+ * All edits of the patch are translated to one netconf edit-config tree which is
+ * sent to the backend in a single edit-config with autocommit, ie all edits are 
+ * written to the datastore, validated and committed as one transaction.
+ * If edits overlap, their order matters and they are instead applied one at a time to
+ * the locked candidate and then committed, see yang_patch_ordered.
+ * If one edit fails, no edit is applied.
  * @param[in]  h         Clixon handle
  * @param[in]  req       Generic Www handle
  * @param[in]  api_path0 According to restconf (Sec 3.5.3.1 in rfc8040)
@@ -998,44 +1193,40 @@ static int yang_patch_do_merge (
  * @param[in]  qvec      Vector of query string (QUERY_STRING)
  * @param[in]  data      Stream input data
  * @param[in]  pretty    Set to 1 for pretty-printed xml/json output
+ * @param[in]  media_in  Input media, yang-patch xml or json
  * @param[in]  media_out Output media
- * Netconf:  <edit-config> (nc:operation="merge")
- * See RFC8072
- * YANG patch can be used to "create", "delete", "insert", "merge", "move", "replace", and/or
-   "remove" a resource within the target resource.
- * Currently "move" not supported
+ * @param[in]  ds        0 if "data" resource, 1 if rfc8527 "ds" resource
+ * Netconf:  <edit-config autocommit="true"> with one nc:operation per edit
+ * @see yang_patch_edit2xml for how edits are translated
  */
 static int
-api_data_yang_patch(clicon_handle h,
-	       void         *req,
-	       char         *api_path0,
-	       cvec         *pcvec,
-	       int           pi,
-	       cvec         *qvec,
-	       char         *data,
-	       int           pretty,
-	       restconf_media media_out,
-	       ietf_ds_t     ds)
+api_data_yang_patch(clicon_handle  h,
+		    void          *req,
+		    char          *api_path0,
+		    cvec          *pcvec,
+		    int            pi,
+		    cvec          *qvec,
+		    char          *data,
+		    int            pretty,
+		    restconf_media media_in,
+		    restconf_media media_out,
+		    ietf_ds_t      ds)
 {
-    int            retval = -1;
-    int            i;
-    cxobj         *xdata0 = NULL; /* Original -d data struct (including top symbol) */
-    cbuf          *cbx = NULL;
-    cxobj         *xtop = NULL; /* top of api-path */
-    cxobj         *xbot = NULL; /* bottom of api-path */
-    yang_stmt     *ybot = NULL; /* yang of xbot */
-    cxobj         *xbot_tmp = NULL;
-    yang_stmt     *yspec;
-    char          *api_path;
-    cxobj         *xret = NULL;
-    cxobj         *xretcom = NULL; /* return from commit */
-    cxobj         *xretdis = NULL; /* return from discard-changes */
-    cxobj         *xerr = NULL;    /* malloced must be freed */
-    int            ret;
-    cvec          *nsc = NULL;
-    yang_bind      yb;
-    char          *xpath = NULL;
-    cbuf *path_orig_1 = NULL;
+    int        retval = -1;
+    int        i;
+    yang_stmt *yspec;
+    char      *api_path;
+    cxobj     *xpatch0 = NULL; /* Parsed message-body (including top symbol) */
+    cxobj     *xpatch;
+    cxobj     *xedit;
+    char      *patchid;
+    cxobj     *xtop = NULL;    /* Edit-config tree of all edits */
+    cxobj     *xerr = NULL;
+    cxobj     *xret = NULL;
+    cbuf      *cbx = NULL;
+    char      *editid;
+    int        startup;
+    int        ret;
 
     clicon_debug(1, "%s api_path:\"%s\"",  __FUNCTION__, api_path0);
     if ((yspec = clicon_dbspec_yang(h)) == NULL){
@@ -1046,245 +1237,117 @@ api_data_yang_patch(clicon_handle h,
     /* strip /... from start */
     for (i=0; i<pi; i++)
 	api_path = index(api_path+1, '/');
-	/* Translate yang-patch path to xpath: xpath (cbpath) and namespace context (nsc) */
-    char yang_patch_path[] = "/ietf-yang-patch:yang-patch";
-	if ((ret = api_path2xpath(yang_patch_path, yspec, &xpath, &nsc, &xerr)) < 0)
+    if (data == NULL || strlen(data) == 0){
+	if (netconf_malformed_message_xml(&xerr, "The message-body MUST contain a yang-patch") < 0)
 	    goto done;
-	if (ret == 0){ /* validation failed */
-	    if (api_return_err0(h, req, xerr, pretty, media_out, 0) < 0)
-		goto done;
-	    goto ok;
-	}
-    /* Create config top-of-tree */
-    if ((xtop = xml_new(NETCONF_INPUT_CONFIG, NULL, CX_ELMNT)) == NULL)
+	if (api_return_err0(h, req, xerr, pretty, media_out, 0) < 0)
+	    goto done;
+	goto ok;
+    }
+    if ((xpatch0 = xml_new(XML_TOP_SYMBOL, NULL, CX_ELMNT)) == NULL)
 	goto done;
-
-    /* Translate yang-patch path to xml in the form of xtop/xbot */
-    xbot = xtop;
-	if ((ret = api_path2xml(yang_patch_path, yspec, xtop, YC_DATANODE, 1, &xbot, &ybot, &xerr)) < 0)
+    switch (media_in){
+    case YANG_PATCH_XML:
+	ret = clixon_xml_parse_string(data, YB_MODULE, yspec, &xpatch0, &xerr);
+	break;
+    case YANG_PATCH_JSON:
+	ret = clixon_json_parse_string(data, YB_MODULE, yspec, &xpatch0, &xerr);
+	break;
+    default:
+	restconf_unsupported_media(h, req, pretty, media_out);
+	goto ok;
+	break;
+    }
+    if (ret < 0){
+	if (netconf_malformed_message_xml(&xerr, clicon_err_reason) < 0)
 	    goto done;
-	if (ret == 0){ /* validation failed */
-	    if (api_return_err(h, req, xerr, pretty, media_out, 0) < 0)
-		goto done;
-	    goto ok;
-	}
- 
-	yb = YB_MODULE;
-	if ((ret = clixon_json_parse_string(data, yb, yspec, &xbot, &xerr)) < 0){
-	    if (netconf_malformed_message_xml(&xerr, clicon_err_reason) < 0)
-		goto done;
-	    if (api_return_err0(h, req, xerr, pretty, media_out, 0) < 0)
-		goto done;
-	    goto ok;
-	}
-	if (ret == 0){
-	    if (api_return_err0(h, req, xerr, pretty, media_out, 0) < 0)
-		goto done;
-	    goto ok;
-	}
-    /* 
-     * RFC 8072 2.1: The message-body MUST identify exactly one resource instance
-     */
-    int            nrchildren0 = 0;
-    cxobj         *x = NULL;
-    if (xml_child_nr_type(xbot, CX_ELMNT) - nrchildren0 != 1){
-	if (netconf_malformed_message_xml(&xerr, "The message-body MUST contain exactly one instance of the expected data resource") < 0)
+	if (api_return_err0(h, req, xerr, pretty, media_out, 0) < 0)
 	    goto done;
+	goto ok;
+    }
+    if (ret == 0){
 	if (api_return_err0(h, req, xerr, pretty, media_out, 0) < 0)
 	    goto done;
 	goto ok;
     }
-
-    size_t veclen;
-    cxobj **vec = NULL;
-    while ((x = xml_child_each(xbot, x, CX_ELMNT)) != NULL){
-    ret = xpath_vec(x, nsc, "edit", &vec, &veclen);
-	if (xml_flag(x, XML_FLAG_MARK)){
-	    xml_flag_reset(x, XML_FLAG_MARK);
+    if (xml_child_nr_type(xpatch0, CX_ELMNT) != 1 ||
+	(xpatch = xml_find_type(xpatch0, NULL, "yang-patch", CX_ELMNT)) == NULL){
+	if (netconf_malformed_message_xml(&xerr, "The message-body MUST contain exactly one yang-patch") < 0)
+	    goto done;
+	if (api_return_err0(h, req, xerr, pretty, media_out, 0) < 0)
+	    goto done;
+	goto ok;
+    }
+    if ((patchid = xml_find_body(xpatch, "patch-id")) == NULL){
+	if (netconf_missing_element_xml(&xerr, "protocol", "patch-id", NULL) < 0)
+	    goto done;
+	if (api_return_err0(h, req, xerr, pretty, media_out, 0) < 0)
+	    goto done;
+	goto ok;
+    }
+    /* Translate all edits, in order, to one edit-config tree */
+    if ((xtop = xml_new(NETCONF_INPUT_CONFIG, NULL, CX_ELMNT)) == NULL)
+	goto done;
+    xedit = NULL;
+    while ((xedit = xml_child_each(xpatch, xedit, CX_ELMNT)) != NULL){
+	if (strcmp(xml_name(xedit), "edit") != 0)
 	    continue;
+	if ((ret = yang_patch_edit2xml(h, xedit, api_path, yspec, "running", xtop, &xerr)) < 0)
+	    goto done;
+	if (ret == 0){
+	    if (yang_patch_status_reply(h, req, patchid, xml_find_body(xedit, "edit-id"),
+					xerr, pretty, media_out) < 0)
+		goto done;
+	    goto ok;
 	}
+	if (ret == 2) /* Overlapping edits */
+	    break;
     }
-    path_orig_1 = cbuf_new();
-    if (path_orig_1 == NULL) {
-        goto done;
-    } else {
-        cbuf_append_str(path_orig_1, restconf_uripath(h));
+    /* RFC8040 Sec 1.4: update startup, see api_data_write */
+    startup = (IETF_DS_NONE == ds) &&
+	if_feature(yspec, "ietf-netconf", "startup") &&
+	!clicon_option_bool(h, "CLICON_RESTCONF_STARTUP_DONTUPDATE");
+    if (xedit != NULL){
+	if ((ret = yang_patch_ordered(h, xpatch, api_path, yspec, startup, &xerr, &editid)) < 0)
+	    goto done;
+	if (yang_patch_status_reply(h, req, patchid, editid, ret?NULL:xerr, pretty, media_out) < 0)
+	    goto done;
+	goto ok;
     }
-
-    // Loop through the edits
-    for (int i = 0; i < veclen; i++) {
-        cxobj **tmp_vec = NULL;
-        size_t tmp_veclen = 0;
-
-        cxobj *xn = vec[i];
-		clicon_log_xml(LOG_DEBUG, xn, "%s %d xn:", __FUNCTION__, __LINE__);
-        // Get target
-        cbuf *target_val = cbuf_new();
-        ret = yang_patch_get_xval(nsc, xn, target_val, "target");
-        if (ret < 0) {
-            goto done;
-        }
-        // Get operation
-        cbuf *op_val = cbuf_new();
-        ret = yang_patch_get_xval(nsc, xn, op_val, "operation");
-        if (ret < 0) {
-            goto done;
-        }
-        // Get "point" and "where" for insert operations
-        cbuf *point_val = NULL;
-        cbuf *where_val = cbuf_new();
-        if (strcmp(cbuf_get(op_val), "insert") == 0) {
-            point_val = cbuf_new();
-            ret = yang_patch_get_xval(nsc, xn, point_val, "point");
-            if (ret < 0) {
-                goto done;
-            }
-            where_val = cbuf_new();
-            ret = yang_patch_get_xval(nsc, xn, where_val, "where");
-            if (ret < 0) {
-                goto done;
-            }
-        }
-
-        // Construct request URI
-        cbuf* simple_patch_request_uri = cbuf_new();
-        cbuf_append_str(simple_patch_request_uri, cbuf_get(path_orig_1));
-
-        cbuf* api_path_target = cbuf_new();
-        cbuf_append_str(api_path_target, api_path);
-        if (strcmp(cbuf_get(op_val), "merge") == 0) {
-            cbuf_append_str(api_path_target, cbuf_get(target_val));
-            cbuf_append_str(simple_patch_request_uri, cbuf_get(target_val));
-        }
-
-        if (xerr)
-	        xml_free(xerr);
-        if ((xtop = xml_new(NETCONF_INPUT_CONFIG, NULL, CX_ELMNT)) == NULL)
-	        goto done;
-
-        // Get key field
-        /* Translate api_path to xml in the form of xtop/xbot */
-        xbot_tmp = xtop;
-	    if ((ret = api_path2xml(cbuf_get(api_path_target), yspec, xtop, YC_DATANODE, 1, &xbot_tmp, &ybot, &xerr)) < 0)
-	        goto done;
-	    if (ret == 0){ /* validation failed */
-	        if (api_return_err0(h, req, xerr, pretty, media_out, 0) < 0)
-	    	goto done;
-	        goto ok;
-	    }
-        char *key_node_id = xml_name(xbot_tmp);
-        char *path = NULL;
-        if ((path = restconf_param_get(h, "REQUEST_URI")) != NULL){
-            for (int i1 = 0; i1 <pi; i1++)
-	        path = index(path+1, '/');
-        }
-        const char colon[2] = ":";
-        char *modname = strtok(&(path[1]), colon);
-
-        cxobj **key_vec = NULL;
-
-        key_vec = xml_childvec_get(xbot_tmp);
-        cxobj *key_xn = NULL;
-        if (key_vec != NULL) {
-            key_xn = key_vec[0];
-        }
-        // Get values (for "delete" and "remove", there are no values)
-        xpath_vec(xn, nsc, "value", &tmp_vec, &tmp_veclen);
-        key_node_id = NULL;
-
-        // Loop through the values
-        for (int j = 0; j < tmp_veclen; j++) {
-            cxobj *values_xn = tmp_vec[j];
-            cxobj** values_child_vec = xml_childvec_get(values_xn);
-            if (key_node_id == NULL)
-                key_node_id = xml_name(*values_child_vec);
-
-            cbuf *patch_header = cbuf_new();
-            if (patch_header == NULL) {
-                goto done;
-            }
-            cbuf_append_str(patch_header, modname);
-            cbuf_append_str(patch_header, ":");
-            cbuf_append_str(patch_header, key_node_id);
-            cxobj *x_simple_patch = xml_new(cbuf_get(patch_header), NULL, CX_ELMNT);
-            if (x_simple_patch == NULL)
-                goto done;
-            int value_vec_len = xml_child_nr(*values_child_vec);
-            cxobj** value_vec = xml_childvec_get(*values_child_vec);
-            // For "replace", delete the item and then POST it
-            // TODO - in an ordered list, insert it into its original position
-            if (strcmp(cbuf_get(op_val),"replace") == 0) {
-                ret = yang_patch_do_replace(h, req, pi, qvec, pretty, media_out, ds, simple_patch_request_uri, target_val, value_vec_len, value_vec, x_simple_patch);
-                if (ret != 0) {
-                    goto done;
-                }
-            }
-            // For "create", put all the data values into a single POST request
-            if (strcmp(cbuf_get(op_val),"create") == 0) {
-                ret = yang_patch_do_create(h, req, pi, qvec, pretty, media_out, ds, simple_patch_request_uri, value_vec_len, value_vec, x_simple_patch);
-                if (ret != 0) {
-                    goto done;
-                }
-            }
-            // For "insert", make a api_data_post request
-            if (strcmp(cbuf_get(op_val), "insert") == 0) {
-                ret = yang_patch_do_insert(h, req, pi, pretty, media_out, ds, simple_patch_request_uri, value_vec_len, value_vec, x_simple_patch, where_val, api_path, point_val);
-                if (ret != 0) {
-                    goto done;
-                }
-            }
-            // For merge", make single simple patch requests for each value
-            if (strcmp(cbuf_get(op_val),"merge") == 0) {
-                ret = yang_patch_do_merge(h, req, pcvec, pi, qvec, pretty, media_out, ds, simple_patch_request_uri, value_vec_len, value_vec, x_simple_patch, key_xn);
-                if (ret != 0) {
-                    goto done;
-                }
-            }
-            cbuf_free(patch_header);
-            yang_patch_free_mem((void *)x_simple_patch); // Using xml_free() causes crash
-        }
-        if ((strcmp(cbuf_get(op_val), "delete") == 0) ||
-            (strcmp(cbuf_get(op_val), "remove") == 0)) {
-               cbuf_append_str(simple_patch_request_uri, cbuf_get(target_val));
-                if (strcmp(cbuf_get(op_val), "delete") == 0) {
-                    // TODO - send error
-                } else {
-                    // TODO - do not send error
-                }
-                api_data_delete(h, req, cbuf_get(simple_patch_request_uri), pi, pretty, YANG_DATA_JSON, ds); 
-        }
-        cbuf_free(simple_patch_request_uri);
-        cbuf_free(api_path_target);
-        cbuf_free(target_val);
-        cbuf_free(op_val);
-        cbuf_free(point_val);
-        cbuf_free(where_val);
+    if ((cbx = cbuf_new()) == NULL){
+	clicon_err(OE_UNIX, errno, "cbuf_new");
+	goto done;
     }
+    cprintf(cbx, "<edit-config");
+    if (startup)
+	cprintf(cbx, " copystartup=\"true\"");
+    cprintf(cbx, " autocommit=\"true\"");
+    cprintf(cbx, "><target><candidate /></target>");
+    cprintf(cbx, "<default-operation>none</default-operation>");
+    if (clicon_xml2cbuf(cbx, xtop, 0, 0, -1) < 0)
+	goto done;
+    cprintf(cbx, "</edit-config>");
+    if ((ret = yang_patch_rpc(h, cbuf_get(cbx), &xret)) < 0)
+	goto done;
+    /* The failing edit is not known, report as global error */
+    if (yang_patch_status_reply(h, req, patchid, NULL, ret?NULL:xret, pretty, media_out) < 0)
+	goto done;
  ok:
     retval = 0;
  done:
-    cbuf_free(path_orig_1);
-    yang_patch_free_mem((void *)vec);
-	yang_patch_free_mem((void *)xpath);
-    if (nsc)
-	xml_nsctx_free(nsc);
-    if (xret)
-	xml_free(xret);
-    if (xerr)
-	xml_free(xerr);
-    if (xretcom)
-	xml_free(xretcom);
-    if (xretdis)
-	xml_free(xretdis);
+    clicon_debug(1, "%s retval:%d", __FUNCTION__, retval);
+    if (xpatch0)
+	xml_free(xpatch0);
     if (xtop)
 	xml_free(xtop);
-    if (xdata0)
-	xml_free(xdata0);
-     if (cbx)
-	cbuf_free(cbx); 
+    if (xerr)
+	xml_free(xerr);
+    if (xret)
+	xml_free(xret);
+    if (cbx)
+	cbuf_free(cbx);
     return retval;
 }
-#endif // YANG_PATCH
 
 /*! Generic REST PUT  method 
  * @param[in]  h        Clixon handle
@@ -1340,7 +1403,7 @@ api_data_put(clicon_handle h,
 			  media_in, media_out, 0, ds);
 } 
 
-/*! Generic REST PATCH method for plain patch 
+/*! Generic REST PATCH method for plain patch and YANG patch
  * @param[in]  h        Clixon handle
  * @param[in]  req      Generic Www handle
  * @param[in]  api_path According to restconf (Sec 3.5.3.1 in rfc8040)
@@ -1356,6 +1419,7 @@ api_data_put(clicon_handle h,
  * resource within the target resource.
  * NOTE:    If the target resource instance does not exist, the server MUST NOT
  *   create it. (CANT BE DONE WITH NETCONF)
+ * YANG patch media types are handled by api_data_yang_patch, see RFC8072
  */
 int
 api_data_patch(clicon_handle h,
@@ -1381,14 +1445,9 @@ api_data_patch(clicon_handle h,
 	break;
     case YANG_PATCH_JSON: 	/* RFC 8072 patch */
     case YANG_PATCH_XML:
-#ifdef YANG_PATCH
 	ret = api_data_yang_patch(h, req, api_path0, pcvec, pi, qvec, data, pretty,
-			     media_out, ds);
-#else
-	ret = restconf_notimplemented(h, req, pretty, media_out);
-#endif
+				  media_in, media_out, ds);
 	break;
-    break;
     default:
 	ret = restconf_unsupported_media(h, req, pretty, media_out);
 	break;
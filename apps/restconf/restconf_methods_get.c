@@ -62,6 +62,299 @@
 #include "restconf_api.h"
 #include "restconf_err.h"
 #include "restconf_methods_get.h"
+#include "restconf_cache.h"
+
+/*! Parse a fields expression into paths relative to the target resource
+ * RFC 8040 4.8.3:
+ *   fields-expr = path "(" fields-expr ")" / path ";" fields-expr / path
+ *   path = api-identifier [ "/" path ]
+ * Eg "a(b;c/d);e" gives the paths "a/b", "a/c/d" and "e"
+ * @param[in]     str     Fields expression
+ * @param[in,out] i       Position in str
+ * @param[in]     prefix  Path of enclosing parenthesis or NULL on top-level
+ * @param[in]     paths   Vector where paths are added
+ * @retval        1       OK
+ * @retval        0       Syntax error
+ * @retval       -1       Error
+ */
+static int
+api_fields_parse(char *str,
+		 int  *i,
+		 char *prefix,
+		 cvec *paths)
+{
+    int   retval = -1;
+    cbuf *cb = NULL;
+    int   start;
+    char  c;
+    int   ret;
+
+    if ((cb = cbuf_new()) == NULL){
+	clicon_err(OE_UNIX, errno, "cbuf_new");
+	goto done;
+    }
+    while (1){
+	cbuf_reset(cb);
+	if (prefix)
+	    cprintf(cb, "%s/", prefix);
+	start = *i;
+	while ((c = str[*i]) != '\0' && c != '(' && c != ')' && c != ';'){
+	    cprintf(cb, "%c", c);
+	    (*i)++;
+	}
+	/* Empty paths, and paths beginning or ending with '/' */
+	if (*i == start || str[start] == '/' || str[*i-1] == '/')
+	    goto fail;
+	if (c == '('){
+	    (*i)++;
+	    if ((ret = api_fields_parse(str, i, cbuf_get(cb), paths)) < 0)
+		goto done;
+	    if (ret == 0 || str[*i] != ')')
+		goto fail;
+	    (*i)++;
+	    c = str[*i];
+	}
+	else if (cvec_add_string(paths, NULL, cbuf_get(cb)) < 0){
+	    clicon_err(OE_UNIX, errno, "cvec_add_string");
+	    goto done;
+	}
+	if (c != ';')
+	    break;
+	(*i)++;
+    }
+    retval = 1;
+ done:
+    if (cb)
+	cbuf_free(cb);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Translate the fields query parameter to an xpath union of the selected nodes
+ * The xpath is used as filter in the backend request, so that only the selected
+ * nodes (and the keys of their list ancestors) are copied from the datastore and
+ * returned, instead of the whole target subtree.
+ * @param[in]     yspec     Yang spec
+ * @param[in]     api_path  Api-path of target resource, or NULL for datastore root
+ * @param[in]     fields    Fields expression, see RFC 8040 4.8.3
+ * @param[out]    xpathp    Xpath union (use free() to deallocate)
+ * @param[in,out] nscp      Namespace context, namespaces of fields are added
+ * @param[out]    xerr      Netconf error message
+ * @retval        1         OK
+ * @retval        0         Invalid fields expression, netconf error in xerr
+ * @retval       -1         Error
+ * @code
+ *   api_path: /example:x/y=1, fields: a(b;c)
+ *   xpath:    /ex:x/ex:y[ex:k='1']/ex:a/ex:b | /ex:x/ex:y[ex:k='1']/ex:a/ex:c
+ * @endcode
+ */
+static int
+api_fields2xpath(yang_stmt *yspec,
+		 char      *api_path,
+		 char      *fields,
+		 char     **xpathp,
+		 cvec     **nscp,
+		 cxobj    **xerr)
+{
+    int     retval = -1;
+    cvec   *paths = NULL;
+    cbuf   *cbp = NULL;
+    cbuf   *cbx = NULL;
+    char   *xpath1 = NULL;
+    cvec   *nsc1 = NULL;
+    cg_var *cv;
+    cg_var *cvn;
+    int     i = 0;
+    int     ret;
+
+    if ((paths = cvec_new(0)) == NULL){
+	clicon_err(OE_UNIX, errno, "cvec_new");
+	goto done;
+    }
+    if ((ret = api_fields_parse(fields, &i, NULL, paths)) < 0)
+	goto done;
+    if (ret == 0 || fields[i] != '\0'){
+	if (netconf_bad_attribute_xml(xerr, "application",
+				      "fields", "Invalid fields expression") < 0)
+	    goto done;
+	goto fail;
+    }
+    if ((cbp = cbuf_new()) == NULL ||
+	(cbx = cbuf_new()) == NULL){
+	clicon_err(OE_UNIX, errno, "cbuf_new");
+	goto done;
+    }
+    cv = NULL;
+    while ((cv = cvec_each(paths, cv)) != NULL){
+	cbuf_reset(cbp);
+	cprintf(cbp, "%s/%s", api_path?api_path:"", cv_string_get(cv));
+	if ((ret = api_path2xpath(cbuf_get(cbp), yspec, &xpath1, &nsc1, xerr)) < 0)
+	    goto done;
+	if (ret == 0)
+	    goto fail;
+	if (cbuf_len(cbx))
+	    cprintf(cbx, " | ");
+	cprintf(cbx, "%s", xpath1);
+	free(xpath1);
+	xpath1 = NULL;
+	if (*nscp == NULL){
+	    *nscp = nsc1;
+	    nsc1 = NULL;
+	    continue;
+	}
+	cvn = NULL;
+	while ((cvn = cvec_each(nsc1, cvn)) != NULL)
+	    if (xml_nsctx_get(*nscp, cv_name_get(cvn)) == NULL &&
+		xml_nsctx_add(*nscp, cv_name_get(cvn), cv_string_get(cvn)) < 0)
+		goto done;
+	xml_nsctx_free(nsc1);
+	nsc1 = NULL;
+    }
+    if ((*xpathp = strdup(cbuf_get(cbx))) == NULL){
+	clicon_err(OE_UNIX, errno, "strdup");
+	goto done;
+    }
+    retval = 1;
+ done:
+    if (paths)
+	cvec_free(paths);
+    if (cbp)
+	cbuf_free(cbp);
+    if (cbx)
+	cbuf_free(cbx);
+    if (xpath1)
+	free(xpath1);
+    if (nsc1)
+	xml_nsctx_free(nsc1);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Get list pagination query parameters: offset, limit and direction
+ * See draft-ietf-netconf-list-pagination
+ * @param[in]  qvec    Vector of query string (QUERY_STRING)
+ * @param[in]  page    Page structure to fill in
+ * @param[out] pagep   Set to page if any pagination parameter is given, else NULL
+ * @param[out] xerr    Netconf error message if invalid
+ * @retval     1       OK
+ * @retval     0       Invalid parameter, netconf error in xerr
+ * @retval    -1       Error
+ */
+static int
+api_data_page(cvec          *qvec,
+	      netconf_page  *page,
+	      netconf_page **pagep,
+	      cxobj        **xerr)
+{
+    int   retval = -1;
+    char *attr;
+    char *reason = NULL;
+    int   ret;
+
+    *pagep = NULL;
+    if ((attr = cvec_find_str(qvec, "offset")) != NULL){
+	if ((ret = parse_uint32(attr, &page->np_offset, &reason)) < 0){
+	    clicon_err(OE_XML, errno, "parse_uint32");
+	    goto done;
+	}
+	if (ret == 0){
+	    if (netconf_bad_attribute_xml(xerr, "application",
+					  "offset", "Unrecognized value of offset attribute") < 0)
+		goto done;
+	    goto fail;
+	}
+	*pagep = page;
+    }
+    if ((attr = cvec_find_str(qvec, "limit")) != NULL &&
+	strcmp(attr, "unbounded") != 0){
+	if ((ret = parse_uint32(attr, &page->np_limit, &reason)) < 0){
+	    clicon_err(OE_XML, errno, "parse_uint32");
+	    goto done;
+	}
+	if (ret == 0 || page->np_limit == 0){
+	    if (netconf_bad_attribute_xml(xerr, "application",
+					  "limit", "Unrecognized value of limit attribute") < 0)
+		goto done;
+	    goto fail;
+	}
+	*pagep = page;
+    }
+    if ((attr = cvec_find_str(qvec, "direction")) != NULL){
+	if (strcmp(attr, "backwards") == 0)
+	    page->np_reverse = 1;
+	else if (strcmp(attr, "forwards") != 0){
+	    if (netconf_bad_attribute_xml(xerr, "application",
+					  "direction", "Unrecognized value of direction attribute") < 0)
+		goto done;
+	    goto fail;
+	}
+	*pagep = page;
+    }
+    retval = 1;
+ done:
+    if (reason)
+	free(reason);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/* State of a GET reply body that is encoded and sent in parts */
+typedef struct {
+    cxobj    *gb_xret;  /* Reply from backend, contains the encoded nodes */
+    cxobj   **gb_xvec;  /* Vector of nodes to encode */
+    json_enc *gb_jenc;  /* JSON encoder, or NULL */
+    xml_enc  *gb_xenc;  /* XML encoder, or NULL */
+} api_get_body;
+
+/*! Encode next part of a streamed GET reply body
+ * @param[in]  arg    GET body state
+ * @param[out] cb     Buffer to append encoded data to
+ * @param[in]  maxlen Approximate size of part
+ * @retval     1      More remains
+ * @retval     0      Done
+ * @retval    -1      Error
+ * @see restconf_body_fn
+ */
+static int
+api_get_body_next(void  *arg,
+		  cbuf  *cb,
+		  size_t maxlen)
+{
+    api_get_body *gb = (api_get_body *)arg;
+
+    if (gb->gb_jenc)
+	return json_enc_next(gb->gb_jenc, cb, maxlen);
+    if (gb->gb_xenc)
+	return xml_enc_next(gb->gb_xenc, cb, maxlen);
+    return 0;
+}
+
+/*! Free state of a streamed GET reply body
+ * @param[in]  arg    GET body state
+ * @see restconf_body_free_fn
+ */
+static int
+api_get_body_free(void *arg)
+{
+    api_get_body *gb = (api_get_body *)arg;
+
+    if (gb->gb_jenc)
+	json_enc_free(gb->gb_jenc);
+    if (gb->gb_xenc)
+	xml_enc_free(gb->gb_xenc);
+    if (gb->gb_xvec)
+	free(gb->gb_xvec);
+    if (gb->gb_xret)
+	xml_free(gb->gb_xret);
+    free(gb);
+    return 0;
+}
 
 /*! Generic GET (both HEAD and GET)
  * According to restconf 
@@ -104,6 +397,7 @@ api_data_get2(clicon_handle  h,
 {
     int        retval = -1;
     char      *xpath = NULL;
+    char      *xfields = NULL; /* xpath union of fields query parameter */
     cbuf      *cbx = NULL;
     yang_stmt *yspec;
     cxobj     *xret = NULL;
@@ -122,12 +416,40 @@ api_data_get2(clicon_handle  h,
     cxobj     *xtop = NULL;
     cxobj     *xbot = NULL;
     yang_stmt *y = NULL;
+    cbuf      *cbkey = NULL;
+    uint64_t   etag;
+    netconf_page  page0 = {0,};
+    netconf_page *page = NULL;
+    int        top = 0;     /* Encode data root including top object */
+    size_t     maxlen;
+    json_enc  *jenc = NULL;
+    xml_enc   *xenc = NULL;
+    api_get_body *gb;
     
     clicon_debug(1, "%s", __FUNCTION__);
     if ((yspec = clicon_dbspec_yang(h)) == NULL){
 	clicon_err(OE_FATAL, 0, "No DB_SPEC");
 	goto done;
     }
+    /* Only config data is cached, state data may change without notice */
+    if (restconf_cache_enabled(h) &&
+	(attr = cvec_find_str(qvec, "content")) != NULL &&
+	strcmp(attr, "config") == 0){
+	if ((cbkey = restconf_cache_key(h, api_path, qvec, pretty, media_out)) == NULL)
+	    goto done;
+	if ((ret = restconf_cache_get(h, cbuf_get(cbkey), &cbx, &etag)) < 0)
+	    goto done;
+	if (ret == 1)
+	    goto reply;
+    }
+    /* Check for list pagination attributes */
+    if ((ret = api_data_page(qvec, &page0, &page, &xerr)) < 0)
+	goto done;
+    if (ret == 0){
+	if (api_return_err0(h, req, xerr, pretty, media_out, 0) < 0)
+	    goto done;
+	goto ok;
+    }
     /* strip /... from start */
     for (i=0; i<pi; i++)
 	api_path = index(api_path+1, '/');
@@ -136,8 +458,9 @@ api_data_get2(clicon_handle  h,
 	    goto done;
 	/* Translate api-path to xml, but to validate the api-path, note: strict=1 
 	 * xtop and xbot unnecessary for this function but needed by function
+	 * With pagination, the target may be a whole list, ie without keys
 	 */
-	if ((ret = api_path2xml(api_path, yspec, xtop, YC_DATANODE, 1, &xbot, &y, &xerr)) < 0)
+	if ((ret = api_path2xml(api_path, yspec, xtop, YC_DATANODE, page==NULL, &xbot, &y, &xerr)) < 0)
 	    goto done;
 	/* Translate api-path to xpath: xpath (cbpath) and namespace context (nsc) */
 	if (ret != 0 &&
@@ -181,13 +504,31 @@ api_data_get2(clicon_handle  h,
 	    }
 	}
     }
-
-    clicon_debug(1, "%s path:%s", __FUNCTION__, xpath);
+    /* Check for fields attribute, only the selected nodes are retrieved */
+    if ((attr = cvec_find_str(qvec, "fields")) != NULL){
+	clicon_debug(1, "%s fields=%s", __FUNCTION__, attr);
+	if (page){ /* A page is a slice of the target list, not of the fields */
+	    if (netconf_bad_attribute_xml(&xerr, "application",
+					  "fields", "Fields cannot be combined with list pagination") < 0)
+		goto done;
+	    if (api_return_err0(h, req, xerr, pretty, media_out, 0) < 0)
+		goto done;
+	    goto ok;
+	}
+	if ((ret = api_fields2xpath(yspec, api_path, attr, &xfields, &nsc, &xerr)) < 0)
+	    goto done;
+	if (ret == 0){
+	    if (api_return_err0(h, req, xerr, pretty, media_out, 0) < 0)
+		goto done;
+	    goto ok;
+	}
+    }
+    clicon_debug(1, "%s path:%s", __FUNCTION__, xfields?xfields:xpath);
     switch (content){
     case CONTENT_CONFIG:
     case CONTENT_NONCONFIG:
     case CONTENT_ALL:
-	ret = clicon_rpc_get(h, xpath, nsc, content, depth, &xret);
+	ret = clicon_rpc_get_page(h, xfields?xfields:xpath, nsc, content, depth, page, &xret);
 	break;
     default:
 	clicon_err(OE_XML, EINVAL, "Invalid content attribute %d", content);
@@ -218,18 +559,13 @@ api_data_get2(clicon_handle  h,
     if ((cbx = cbuf_new()) == NULL)
 	goto done;
     if (xpath==NULL || strcmp(xpath,"/")==0){ /* Special case: data root */
-	switch (media_out){
-	case YANG_DATA_XML:
-	    if (clicon_xml2cbuf(cbx, xret, 0, pretty, -1) < 0) /* Dont print top object?  */
-		goto done;
-	    break;
-	case YANG_DATA_JSON:
-	    if (xml2json_cbuf(cbx, xret, pretty) < 0)
-		goto done;
-	    break;
-	default:
-	    break;
+	if ((xvec = malloc(sizeof(cxobj *))) == NULL){
+	    clicon_err(OE_UNIX, errno, "malloc");
+	    goto done;
 	}
+	xvec[0] = xret;
+	xlen = 1;
+	top = 1;
     }
     else{
 	if (xpath_vec(xret, nsc, "%s", &xvec, &xlen, xpath) < 0){
@@ -252,8 +588,7 @@ api_data_get2(clicon_handle  h,
 		goto done;
 	    goto ok;
 	}
-	switch (media_out){
-	case YANG_DATA_XML:
+	if (media_out == YANG_DATA_XML)
 	    for (i=0; i<xlen; i++){
 		char *prefix;
 		x = xvec[i];
@@ -265,26 +600,76 @@ api_data_get2(clicon_handle  h,
 		    if (namespace && xmlns_set(x, prefix, namespace) < 0)
 			goto done;
 		}
-		if (clicon_xml2cbuf(cbx, x, 0, pretty, -1) < 0) /* Dont print top object?  */
-		    goto done;
 	    }
-	    break;
-	case YANG_DATA_JSON:
-	    /* In: <x xmlns="urn:example:clixon">0</x>
-	     * Out: {"example:x": {"0"}}
-	     */
-	    if (xml2json_cbuf_vec(cbx, xvec, xlen, pretty) < 0)
-		goto done;
-	    break;
-	default:
-	    break;
+    }
+    /* Encode the first part of the body. Cached and HEAD replies are encoded in full
+     * In: <x xmlns="urn:example:clixon">0</x>
+     * Out: {"example:x": {"0"}}
+     */
+    maxlen = (cbkey || head) ? 0 : RESTCONF_BODY_CHUNK;
+    switch (media_out){
+    case YANG_DATA_XML:
+	if ((xenc = xml_enc_new(xvec, xlen, pretty)) == NULL)
+	    goto done;
+	if ((ret = xml_enc_next(xenc, cbx, maxlen)) < 0)
+	    goto done;
+	break;
+    case YANG_DATA_JSON:
+	if ((jenc = json_enc_new(xvec, xlen, pretty, top)) == NULL)
+	    goto done;
+	if ((ret = json_enc_next(jenc, cbx, maxlen)) < 0)
+	    goto done;
+	break;
+    default:
+	ret = 0;
+	break;
+    }
+    if (ret == 1){
+	/* Large body: send the rest as it is encoded instead of encoding all of it first.
+	 * No ETag since it is computed over the whole body */
+	if ((gb = malloc(sizeof(*gb))) == NULL){
+	    clicon_err(OE_UNIX, errno, "malloc");
+	    goto done;
+	}
+	gb->gb_xret = xret;
+	gb->gb_xvec = xvec;
+	gb->gb_jenc = jenc;
+	gb->gb_xenc = xenc;
+	xret = NULL;
+	xvec = NULL;
+	jenc = NULL;
+	xenc = NULL;
+	if (restconf_reply_header(req, "Content-Type", "%s", restconf_media_int2str(media_out)) < 0){
+	    api_get_body_free(gb);
+	    goto done;
+	}
+	if (restconf_reply_header(req, "Cache-Control", "no-cache") < 0){
+	    api_get_body_free(gb);
+	    goto done;
 	}
+	ret = restconf_reply_send_stream(req, 200, cbx, api_get_body_next, api_get_body_free, gb);
+	cbx = NULL; /* consumed */
+	if (ret < 0)
+	    goto done;
+	goto ok;
     }
     clicon_debug(1, "%s cbuf:%s", __FUNCTION__, cbuf_get(cbx));
+    etag = restconf_etag(cbx);
+    if (cbkey &&
+	restconf_cache_put(h, cbuf_get(cbkey), cbx, etag) < 0)
+	goto done;
+ reply:
     if (restconf_reply_header(req, "Content-Type", "%s", restconf_media_int2str(media_out)) < 0)
 	goto done;
     if (restconf_reply_header(req, "Cache-Control", "no-cache") < 0)
 	goto done;
+    if ((ret = restconf_etag_header(h, req, etag)) < 0)
+	goto done;
+    if (ret == 1){ /* If-None-Match */
+	if (restconf_reply_send(req, 304, NULL, 0) < 0)
+	    goto done;
+	goto ok;
+    }
     if (restconf_reply_send(req, 200, cbx, head) < 0)
 	goto done;
     cbx = NULL;
@@ -294,18 +679,26 @@ api_data_get2(clicon_handle  h,
     clicon_debug(1, "%s retval:%d", __FUNCTION__, retval);
     if (xpath)
 	free(xpath);
+    if (xfields)
+	free(xfields);
     if (nsc)
 	xml_nsctx_free(nsc);
     if (xtop)
         xml_free(xtop);
     if (cbx)
         cbuf_free(cbx);
+    if (jenc)
+	json_enc_free(jenc);
+    if (xenc)
+	xml_enc_free(xenc);
     if (xret)
 	xml_free(xret);
     if (xerr)
 	xml_free(xerr);
     if (xvec)
 	free(xvec);
+    if (cbkey)
+	cbuf_free(cbkey);
     return retval;
 }
 
@@ -64,6 +64,7 @@
 
 /* restconf */
 #include "restconf_lib.h"       /* generic shared with plugins */
+#include "restconf_api.h"       /* generic not shared with plugins */
 #ifdef HAVE_LIBEVHTP
 #include <event2/buffer.h> /* evbuffer */
 #define EVHTP_DISABLE_REGEX
@@ -76,6 +77,12 @@
 #include <nghttp2/nghttp2.h>
 #endif
 #include "restconf_native.h"    /* Restconf-openssl mode specific headers*/
+#ifdef HAVE_LIBNGHTTP2
+#include "restconf_nghttp2.h"   /* http/2 */
+#endif
+
+/* Forward */
+static int restconf_conn_write_cb(int s, void *arg);
 
 restconf_stream_data *
 restconf_stream_data_new(restconf_conn *rc,
@@ -92,19 +99,26 @@ restconf_stream_data_new(restconf_conn *rc,
     sd->sd_fd = -1;
     if ((sd->sd_indata = cbuf_new()) == NULL){
 	clicon_err(OE_UNIX, errno, "cbuf_new");
-	return NULL;
+	goto err;
     }
     if ((sd->sd_outp_hdrs = cvec_new(0)) == NULL){
 	clicon_err(OE_UNIX, errno, "cvec_new");
-	return NULL;
+	goto err;
     }
     if ((sd->sd_outp_buf = cbuf_new()) == NULL){
 	clicon_err(OE_UNIX, errno, "cbuf_new");
-	return NULL;
+	goto err;
+    }
+    if ((sd->sd_inp_hdrs = cvec_new(0)) == NULL){
+	clicon_err(OE_UNIX, errno, "cvec_new");
+	goto err;
     }
     sd->sd_conn = rc;
     INSQ(sd, rc->rc_streams);
     return sd;
+ err: /* Free partly built stream, it is not yet in the connection list */
+    restconf_stream_free(sd);
+    return NULL;
 }
 
 restconf_stream_data *
@@ -137,16 +151,61 @@ restconf_stream_free(restconf_stream_data *sd)
 	cbuf_free(sd->sd_outp_buf);
     if (sd->sd_body)
 	cbuf_free(sd->sd_body);
+    if (sd->sd_body_free)
+	(*sd->sd_body_free)(sd->sd_body_arg);
     if (sd->sd_path)
 	free(sd->sd_path);
     if (sd->sd_settings2)
 	free(sd->sd_settings2);
     if (sd->sd_qvec)
 	cvec_free(sd->sd_qvec);
+    if (sd->sd_inp_hdrs)
+	cvec_free(sd->sd_inp_hdrs);
     free(sd);
     return 0;
 }
 
+/*! Produce next part of a streamed reply body into the stream body buffer
+ * Data already sent (up to sd_body_offset) is removed first. When the last part is
+ * produced, the body is terminated with \r\n as in restconf_reply_send and the producer
+ * is freed.
+ * @param[in]  sd     Restconf stream with a body producer
+ * @param[in]  maxlen Approximate size of part, 0 means all the rest
+ * @retval     1      More parts remain
+ * @retval     0      Body done, no producer remains
+ * @retval    -1      Error
+ * @see restconf_reply_send_stream
+ */
+int
+restconf_stream_body_next(restconf_stream_data *sd,
+			  size_t                maxlen)
+{
+    int ret;
+
+    if (sd->sd_body_fn == NULL)
+	return 0;
+    if (sd->sd_body == NULL &&
+	(sd->sd_body = cbuf_new()) == NULL){
+	clicon_err(OE_UNIX, errno, "cbuf_new");
+	return -1;
+    }
+    if (sd->sd_body_offset){
+	cbuf_reset(sd->sd_body);
+	sd->sd_body_offset = 0;
+    }
+    if ((ret = (*sd->sd_body_fn)(sd->sd_body_arg, sd->sd_body, maxlen)) < 0)
+	return -1;
+    if (ret == 1)
+	return 1;
+    cprintf(sd->sd_body, "\r\n");
+    if (sd->sd_body_free)
+	(*sd->sd_body_free)(sd->sd_body_arg);
+    sd->sd_body_fn = NULL;
+    sd->sd_body_free = NULL;
+    sd->sd_body_arg = NULL;
+    return 0;
+}
+
 /*! Create restconf connection struct
  */
 restconf_conn *
@@ -178,6 +237,7 @@ restconf_conn_free(restconf_conn *rc)
 	return -1;
     }
 #ifdef HAVE_LIBNGHTTP2
+    http2_exec_cancel(rc);
     if (rc->rc_ngsession)
 	nghttp2_session_del(rc->rc_ngsession);
 #endif
@@ -191,10 +251,360 @@ restconf_conn_free(restconf_conn *rc)
 	if (sd)
 	    restconf_stream_free(sd);
     }
+    if (rc->rc_outp_wait)
+	clixon_event_unreg_fd_write(rc->rc_s, restconf_conn_write_cb);
+    if (rc->rc_outp)
+	cbuf_free(rc->rc_outp);
     free(rc);
     return 0;
 }
 
+/*! Suspend or resume reading of requests on a connection depending on its output
+ *
+ * Reading is suspended while a http/1 reply body is written, while more than
+ * RESTCONF_OUTP_MAX bytes are queued for output, and when the connection is to be closed.
+ * @param[in]  rc   Restconf connection
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+restconf_conn_read_update(restconf_conn *rc)
+{
+    int    off;
+    size_t len = 0;
+
+    if (rc->rc_outp)
+	len = cbuf_len(rc->rc_outp) - rc->rc_outp_offset;
+    off = rc->rc_body_sd != NULL || rc->rc_close || len > RESTCONF_OUTP_MAX;
+    if (off && !rc->rc_read_off){
+	clicon_debug(1, "%s %d suspend reading, %zu bytes queued", __FUNCTION__, rc->rc_s, len);
+	clixon_event_unreg_fd(rc->rc_s, restconf_connection);
+	rc->rc_read_off = 1;
+    }
+    else if (!off && rc->rc_read_off){
+	clicon_debug(1, "%s %d resume reading", __FUNCTION__, rc->rc_s);
+	if (clixon_event_reg_fd(rc->rc_s, restconf_connection, (void*)rc, "restconf client socket") < 0)
+	    return -1;
+	rc->rc_read_off = 0;
+    }
+    return 0;
+}
+
+/*! Close a connection when its queued output, eg an error reply, has been written
+ *
+ * If output remains, reading is suspended and the connection is closed and freed from
+ * restconf_conn_write_cb when the output queue is empty.
+ * @param[in]  rc   Restconf connection, may be freed
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+int
+restconf_conn_close(restconf_conn *rc)
+{
+    int retval = -1;
+
+    if (rc->rc_outp && rc->rc_outp_offset < cbuf_len(rc->rc_outp)){
+	rc->rc_close = 1;
+	if (restconf_conn_read_update(rc) < 0)
+	    goto done;
+	goto ok;
+    }
+    if (rc->rc_ssl != NULL){
+	SSL_free(rc->rc_ssl);
+	rc->rc_ssl = NULL;
+#ifdef HAVE_LIBEVHTP
+	if (rc->rc_evconn)
+	    rc->rc_evconn->ssl = NULL;
+#endif
+    }
+    if (!rc->rc_read_off)
+	clixon_event_unreg_fd(rc->rc_s, restconf_connection);
+    if (close(rc->rc_s) < 0){
+	clicon_err(OE_UNIX, errno, "close");
+	goto done;
+    }
+    if (restconf_conn_free(rc) < 0)
+	goto done;
+ ok:
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Write queued output to connection socket until all is written or the socket would block
+ *
+ * If the socket would block, a write event is registered and the rest is written when the
+ * socket is writable. 
+ * @param[in]  rc   Restconf connection
+ * @retval     1    All output written (or discarded if connection was reset)
+ * @retval     0    Output remains in queue, waiting for socket to be writable
+ * @retval    -1    Error
+ */
+static int
+restconf_conn_flush(restconf_conn *rc)
+{
+    int     retval = -1;
+    char   *buf;
+    size_t  buflen;
+    ssize_t len;
+    int     er;
+    int     sslerr;
+
+    while (rc->rc_outp_offset < cbuf_len(rc->rc_outp)){
+	buf = cbuf_get(rc->rc_outp) + rc->rc_outp_offset;
+	buflen = cbuf_len(rc->rc_outp) - rc->rc_outp_offset;
+	if (rc->rc_ssl){
+	    if ((len = SSL_write(rc->rc_ssl, buf, buflen)) <= 0){
+		er = errno;
+		sslerr = SSL_get_error(rc->rc_ssl, len);
+		clicon_debug(1, "%s SSL_write errno:%d sslerr:%d", __FUNCTION__, er, sslerr);
+		switch (sslerr){
+		case SSL_ERROR_WANT_WRITE:           /* 3 */
+		case SSL_ERROR_WANT_READ:            /* 2 */
+		    goto wait;
+		    break;
+		case SSL_ERROR_SYSCALL:              /* 5 */
+		    if (er == EAGAIN || er == EWOULDBLOCK)
+			goto wait;
+		    if (er == ECONNRESET || er == EPIPE)
+			goto reset;
+		    clicon_err(OE_RESTCONF, er, "SSL_write %d", er);
+		    goto done;
+		    break;
+		default:
+		    clicon_err(OE_SSL, 0, "SSL_write");
+		    goto done;
+		    break;
+		}
+	    }
+	}
+	else if ((len = write(rc->rc_s, buf, buflen)) < 0){
+	    if (errno == EINTR)
+		continue;
+	    if (errno == EAGAIN || errno == EWOULDBLOCK)
+		goto wait;
+	    if (errno == ECONNRESET || errno == EPIPE)
+		goto reset;
+	    clicon_err(OE_UNIX, errno, "write");
+	    goto done;
+	}
+	rc->rc_outp_offset += len;
+    }
+ flushed:
+    cbuf_reset(rc->rc_outp);
+    rc->rc_outp_offset = 0;
+    if (rc->rc_outp_wait){
+	clixon_event_unreg_fd_write(rc->rc_s, restconf_conn_write_cb);
+	rc->rc_outp_wait = 0;
+    }
+    retval = 1;
+ done:
+    return retval;
+ wait:
+    clicon_debug(1, "%s %d would block, %zu bytes queued", __FUNCTION__,
+		 rc->rc_s, cbuf_len(rc->rc_outp) - rc->rc_outp_offset);
+    if (rc->rc_outp_wait == 0){
+	if (clixon_event_reg_fd_write(rc->rc_s, restconf_conn_write_cb, rc, "restconf output") < 0)
+	    goto done;
+	rc->rc_outp_wait = 1;
+    }
+    retval = 0;
+    goto done;
+ reset: /* Discard output, the connection is closed when the read side detects the reset */
+    clicon_debug(1, "%s %d Connection reset by peer", __FUNCTION__, rc->rc_s);
+    rc->rc_outp_reset = 1;
+    goto flushed;
+}
+
+/*! Connection socket is writable, write queued output
+ * @param[in]  s    Socket
+ * @param[in]  arg  Restconf connection
+ * @see restconf_conn_flush where this callback is registered
+ */
+static int
+restconf_conn_write_cb(int   s,
+		       void *arg)
+{
+    restconf_conn *rc = (restconf_conn *)arg;
+    int            ret;
+#ifdef HAVE_LIBNGHTTP2
+    nghttp2_error  ngerr;
+#endif
+
+    if ((ret = restconf_conn_flush(rc)) < 0)
+	return -1;
+    /* Output queue is empty: close connection after error reply */
+    if (ret == 1 && rc->rc_close)
+	return restconf_conn_close(rc);
+    if (restconf_conn_read_update(rc) < 0)
+	return -1;
+    /* Output queue is empty: resume a streamed http/1 reply body */
+    if (ret == 1 && rc->rc_body_sd != NULL){
+	if (restconf_conn_body(rc, rc->rc_body_sd) < 0)
+	    return -1;
+    }
+#ifdef HAVE_LIBNGHTTP2
+    /* Output queue is empty: resume http/2 frames held back by nghttp2 */
+    if (ret == 1 && rc->rc_ngsession && nghttp2_session_want_write(rc->rc_ngsession)){
+	if ((ngerr = nghttp2_session_send(rc->rc_ngsession)) != 0){
+	    clicon_err(OE_NGHTTP2, ngerr, "nghttp2_session_send");
+	    return -1;
+	}
+    }
+#endif
+    return 0;
+}
+
+/*! Write data on a restconf connection without blocking
+ *
+ * The data is appended to the connection output queue, and as much as possible is written
+ * directly. The rest is written from the event loop when the socket is writable.
+ * Output is written in order, also interleaved with later calls.
+ * @param[in]  rc     Restconf connection
+ * @param[in]  buf    Data to write
+ * @param[in]  buflen Length of buf
+ * @retval     0      OK, data written or queued
+ * @retval    -1      Error
+ */
+int
+restconf_conn_write(restconf_conn *rc,
+		    const char    *buf,
+		    size_t         buflen)
+{
+    int   retval = -1;
+    cbuf *cb = NULL;
+
+    /* Two problems with debugging buffers from libevent that this fixes:
+     * 1. they are not "strings" in the sense they are not NULL-terminated
+     * 2. they are often very long
+     */
+    if (clicon_debug_get()) { 
+	char *dbgstr = NULL;
+	size_t sz;
+	sz = buflen>256?256:buflen; /* Truncate to 256 */
+	if ((dbgstr = malloc(sz+1)) == NULL){
+	    clicon_err(OE_UNIX, errno, "malloc");
+	    goto done;
+	}
+	memcpy(dbgstr, buf, sz);
+	dbgstr[sz] = '\0';
+	clicon_debug(1, "%s buflen:%zu buf:%s", __FUNCTION__, buflen, dbgstr);
+	free(dbgstr);
+    }
+    if (rc->rc_outp_reset)
+	goto ok;
+    /* Remove already written output from the queue before appending */
+    if (rc->rc_outp_offset > 0){
+	if ((cb = cbuf_new()) == NULL){
+	    clicon_err(OE_UNIX, errno, "cbuf_new");
+	    goto done;
+	}
+	if (cbuf_append_buf(cb, cbuf_get(rc->rc_outp) + rc->rc_outp_offset,
+			    cbuf_len(rc->rc_outp) - rc->rc_outp_offset) < 0){
+	    clicon_err(OE_UNIX, errno, "cbuf_append_buf");
+	    goto done;
+	}
+	cbuf_free(rc->rc_outp);
+	rc->rc_outp = cb;
+	cb = NULL;
+	rc->rc_outp_offset = 0;
+    }
+    if (rc->rc_outp == NULL &&
+	(rc->rc_outp = cbuf_new()) == NULL){
+	clicon_err(OE_UNIX, errno, "cbuf_new");
+	goto done;
+    }
+    if (cbuf_append_buf(rc->rc_outp, (void*)buf, buflen) < 0){
+	clicon_err(OE_UNIX, errno, "cbuf_append_buf");
+	goto done;
+    }
+    if (restconf_conn_flush(rc) < 0)
+	goto done;
+    /* Stop reading requests if the peer does not read replies */
+    if (restconf_conn_read_update(rc) < 0)
+	goto done;
+ ok:
+    retval = 0;
+ done:
+    if (cb)
+	cbuf_free(cb);
+    return retval;
+}
+
+/*! Write a streamed http/1.1 reply body using chunked transfer coding
+ *
+ * Parts of the body are produced and written as long as the socket accepts them.
+ * If the socket would block, reading new requests on the connection is suspended and
+ * writing is resumed from restconf_conn_write_cb when the socket is writable.
+ * @param[in]  rc     Restconf connection
+ * @param[in]  sd     Stream with reply body, first part in sd_body, rest from sd_body_fn
+ * @retval     0      OK, body written or to be resumed
+ * @retval    -1      Error
+ * @see restconf_reply_send_stream
+ */
+int
+restconf_conn_body(restconf_conn        *rc,
+		   restconf_stream_data *sd)
+{
+    int    retval = -1;
+    cbuf  *cb = NULL;
+    size_t len;
+    int    eof = 0;
+
+    if ((cb = cbuf_new()) == NULL){
+	clicon_err(OE_UNIX, errno, "cbuf_new");
+	goto done;
+    }
+    while (rc->rc_outp == NULL || cbuf_len(rc->rc_outp) == 0){
+	if (rc->rc_outp_reset){ /* Discard the rest */
+	    eof++;
+	    break;
+	}
+	if (sd->sd_body && (len = cbuf_len(sd->sd_body) - sd->sd_body_offset) > 0){
+	    cbuf_reset(cb);
+	    cprintf(cb, "%zx\r\n", len);
+	    if (cbuf_append_buf(cb, cbuf_get(sd->sd_body) + sd->sd_body_offset, len) < 0){
+		clicon_err(OE_UNIX, errno, "cbuf_append_buf");
+		goto done;
+	    }
+	    cprintf(cb, "\r\n");
+	    sd->sd_body_offset += len;
+	    if (restconf_conn_write(rc, cbuf_get(cb), cbuf_len(cb)) < 0)
+		goto done;
+	}
+	else if (sd->sd_body_fn == NULL){
+	    if (restconf_conn_write(rc, "0\r\n\r\n", strlen("0\r\n\r\n")) < 0)
+		goto done;
+	    eof++;
+	    break;
+	}
+	else if (restconf_stream_body_next(sd, RESTCONF_BODY_CHUNK) < 0)
+	    goto done;
+    }
+    if (eof){
+	if (sd->sd_body_free)
+	    (*sd->sd_body_free)(sd->sd_body_arg);
+	sd->sd_body_fn = NULL;
+	sd->sd_body_free = NULL;
+	sd->sd_body_arg = NULL;
+	if (sd->sd_body){
+	    cbuf_free(sd->sd_body);
+	    sd->sd_body = NULL;
+	}
+	sd->sd_body_offset = 0;
+	rc->rc_body_sd = NULL;
+    }
+    else /* Wait for socket, dont read new requests meanwhile */
+	rc->rc_body_sd = sd;
+    if (restconf_conn_read_update(rc) < 0) /* Suspend or resume reading requests */
+	goto done;
+    retval = 0;
+ done:
+    if (cb)
+	cbuf_free(cb);
+    return retval;
+}
+
 /*! Given SSL connection, get peer certificate one-line name
  * @param[in]  ssl      SSL session
  * @param[out] oneline  Cert name one-line
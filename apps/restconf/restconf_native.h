@@ -55,6 +55,13 @@ extern "C" {
 #ifndef _RESTCONF_NATIVE_H_
 #define _RESTCONF_NATIVE_H_
 
+/*
+ * Constants
+ */
+/* Max number of bytes queued for output on a connection. Above this, no more requests
+ * are read from the connection until the queue has been written */
+#define RESTCONF_OUTP_MAX (4*1024*1024)
+
 /*
  * Types
  */
@@ -82,6 +89,11 @@ typedef struct  {
     void                 *sd_req;       /* Lib-specific request, eg evhtp_request_t * */
     int                   sd_upgrade2;  /* Upgrade to http/2 */
     uint8_t              *sd_settings2; /* Settings for upgrade to http/2 request */
+    cvec                 *sd_inp_hdrs;  /* Received http/2 request headers, set as params on exec */
+    int                   sd_exec;      /* Http/2 request received, waiting to be executed */
+    restconf_body_fn     *sd_body_fn;   /* Produce next part of streamed body, NULL if none */
+    restconf_body_free_fn *sd_body_free; /* Free sd_body_arg */
+    void                 *sd_body_arg;  /* Argument of streamed body producer */
 } restconf_stream_data;
 
 /* Restconf connection handle 
@@ -95,6 +107,16 @@ typedef struct restconf_conn {
     clicon_handle       rc_h;         /* Clixon handle */
     SSL                *rc_ssl;       /* Structure for SSL connection */
     restconf_stream_data *rc_streams; /* List of http/2 session streams */
+    cbuf               *rc_outp;      /* Output queue: data not yet written to socket */
+    size_t              rc_outp_offset; /* Start of unwritten data in rc_outp */
+    int                 rc_outp_wait; /* Write event registered, waiting for socket writable */
+    int                 rc_outp_reset; /* Connection reset by peer, discard output */
+    int                 rc_close;     /* Close connection when output queue is written */
+    int                 rc_read_off;  /* Reading of requests is suspended */
+    int                 rc_ssl_want;  /* SSL op waiting for socket: SSL_ERROR_WANT_READ/WRITE */
+    struct timeval      rc_ssl_start; /* Start of TLS handshake, for statistics */
+    int                 rc_exec_sched; /* Write event registered to execute http/2 requests */
+    restconf_stream_data *rc_body_sd; /* Http/1 stream whose body is written, reading suspended */
     /* Decision to keep lib-specific data here, otherwise new struct necessary
      * drawback is specific includes need to go everywhere */
 #ifdef HAVE_LIBEVHTP
@@ -116,6 +138,7 @@ typedef struct {
                                    eg inet:ipv4-address or inet:ipv6-address */
     char         *rs_addrstr;   /* Address as string, eg 127.0.0.1, ::1 */
     uint16_t      rs_port;      /* Protocol port */
+    int           rs_worker;    /* Worker process accepting on this socket (if several) */
 } restconf_socket;
 
 /* Restconf handle 
@@ -125,6 +148,8 @@ typedef struct {
     SSL_CTX         *rh_ctx;       /* SSL context */
     restconf_socket *rh_sockets;   /* List of restconf server (ready for accept) sockets */
     void            *rh_arg;       /* Packet specific handle (eg evhtp) */
+    int              rh_workers;   /* Number of worker processes */
+    uint32_t         rh_cache_size; /* Max number of cached GET responses, 0: disabled */
 } restconf_native_handle;
 
 /*
@@ -133,11 +158,16 @@ typedef struct {
 restconf_stream_data *restconf_stream_data_new(restconf_conn *rc, int32_t stream_id);
 restconf_stream_data *restconf_stream_find(restconf_conn *rc, int32_t id);
 int               restconf_stream_free(restconf_stream_data *sd);
+int               restconf_stream_body_next(restconf_stream_data *sd, size_t maxlen);
 restconf_conn    *restconf_conn_new(clicon_handle h, int s);
 int               restconf_conn_free(restconf_conn *rc);
+int               restconf_conn_close(restconf_conn *rc);
+int               restconf_conn_write(restconf_conn *rc, const char *buf, size_t buflen);
+int               restconf_conn_body(restconf_conn *rc, restconf_stream_data *sd);
 int               ssl_x509_name_oneline(SSL *ssl, char **oneline);
 
 int restconf_close_ssl_socket(restconf_conn *rc, int shutdown); /* XXX in restconf_main_native.c */
+int restconf_connection(int s, void *arg); /* XXX in restconf_main_native.c */
     
 #endif /* _RESTCONF_NATIVE_H_ */
 
@@ -42,8 +42,9 @@
   *    on_data_chunk_recv_callback
   *       get indata
   *    on_frame_recv_callback NGHTTP2_FLAG_END_STREAM
-  *       get method and call handler
-  *       create rr
+  *       mark sd for execution and schedule it
+  * http2_exec_cb() from event loop when socket is writable, one stream at a time
+  *       translate headers, get method and call handler
  */
 
 #ifdef HAVE_CONFIG_H
@@ -104,6 +105,9 @@
 
 #define ARRLEN(x) (sizeof(x) / sizeof(x[0]))
 
+/* Forward */
+static int nghttp2_hdr2clixon(clicon_handle h, char *name, char *value);
+
 /*! Map http2 frame types in nghttp2
  * I had expected it in in libnghttp2 but havent found it
  */
@@ -166,7 +170,9 @@ nghttp2_print_headers(nghttp2_nv *nva,
  * `nghttp2_session_send()` to send data to the remote endpoint.  If
  * the application uses solely `nghttp2_session_mem_send()` instead,
  * this callback function is unnecessary.
- * XXX see buf_write
+ * What cannot be written without blocking is queued on the connection and written when
+ * the socket is writable. Until then no more data is accepted.
+ * @see restconf_conn_write
  */
 static ssize_t
 session_send_callback(nghttp2_session *session,
@@ -175,92 +181,16 @@ session_send_callback(nghttp2_session *session,
 		      int              flags,
 		      void            *user_data)
 {
-    int            retval = -1;
     restconf_conn *rc = (restconf_conn *)user_data;
-    int            er;
-    ssize_t        len;
-    ssize_t        totlen = 0;
-    int            s;
-    SSL           *ssl; 
-    int            sslerr;
     
     clicon_debug(1, "%s buflen:%zu", __FUNCTION__, buflen);
-    s = rc->rc_s;
-    ssl = rc->rc_ssl;
-    while (totlen < buflen){
-	if (ssl){
-	    if ((len = SSL_write(ssl, buf+totlen, buflen-totlen)) <= 0){
-		er = errno;
-		sslerr = SSL_get_error(ssl, len);
-		clicon_debug(1, "%s errno:;%d sslerr:%d", __FUNCTION__, errno, sslerr);
-		switch (sslerr){
-		case SSL_ERROR_WANT_WRITE:           /* 3 */
-		    clicon_debug(1, "%s write SSL_ERROR_WANT_WRITE", __FUNCTION__);
-		    usleep(1000);
-		    continue;
-		    break;
-		case SSL_ERROR_SYSCALL:              /* 5 */
-		    if (er == ECONNRESET) {/* Connection reset by peer */
-			if (ssl)
-			    SSL_free(ssl);
-			close(s);
-			// XXX			clixon_event_unreg_fd(s, restconf_connection);
-			goto ok; /* Close socket and ssl */
-		    }
-		    else if (er == EAGAIN){
-			/* same as want_write above, but different behaviour on different 
-			 * platforms, linux here, freebsd want_write, or possibly differnt
-			 * ssl lib versions?
-			 */
-			clicon_debug(1, "%s write EAGAIN", __FUNCTION__);
-			usleep(1000);
-			continue;
-		    }
-		    else{
-			clicon_err(OE_RESTCONF, er, "SSL_write %d", er);
-			goto done;
-		    }
-		    break;
-		default:
-		    clicon_err(OE_SSL, 0, "SSL_write");
-		    goto done;
-		    break;
-		}
-		goto done;
-	    }
-	}
-	else{
-	    if ((len = write(s, buf+totlen, buflen-totlen)) < 0){
-		if (errno == EAGAIN){
-		    clicon_debug(1, "%s write EAGAIN", __FUNCTION__);
-		    usleep(10000);
-		    continue;
-		}
-#if 1
-		else if (errno == ECONNRESET) {/* Connection reset by peer */
-		    close(s);
-		    // XXX		    clixon_event_unreg_fd(s, restconf_connection);
-		    goto ok; /* Close socket and ssl */
-		}
-#endif
-		else{
-		    clicon_err(OE_UNIX, errno, "write");
-		    goto done;
-		}
-	    }
-	    assert(len != 0);
-	}
-	totlen += len;
-    } /* while */
- ok:
-    retval = 0;
- done:
-    if (retval < 0){
-	clicon_debug(1, "%s retval:%d", __FUNCTION__, retval);
-	return retval;
-    }
-    clicon_debug(1, "%s retval:%zd", __FUNCTION__, totlen);
-    return totlen;
+    /* Socket is full: let nghttp2 keep the frames until the output queue is written,
+     * see restconf_conn_write_cb */
+    if (rc->rc_outp_wait)
+	return NGHTTP2_ERR_WOULDBLOCK;
+    if (restconf_conn_write(rc, (const char *)buf, buflen) < 0)
+	return NGHTTP2_ERR_CALLBACK_FAILURE;
+    return buflen;
 }
 
 /*! Invoked when |session| wants to receive data from the remote peer.  
@@ -344,8 +274,9 @@ restconf_nghttp2_path(restconf_stream_data *sd)
     return retval; /* void */
 }
 
-/*! data callback, just pass pointer to cbuf
- * XXX handle several chunks with cbuf 
+/*! data callback, copy next chunk of body
+ * Called by nghttp2 for each DATA frame, where length is limited by frame size and flow
+ * control window, so a large body is sent in several chunks as the peer opens its window
  */
 static ssize_t
 restconf_sd_read(nghttp2_session     *session,
@@ -377,7 +308,15 @@ restconf_sd_read(nghttp2_session     *session,
     *data_flags |= NGHTTP2_DATA_FLAG_EOF;
     return len;
 #endif
-    assert(cbuf_len(cb) > sd->sd_body_offset);
+    /* Produce next part of a streamed body when previous part is sent */
+    while (cbuf_len(cb) <= sd->sd_body_offset && sd->sd_body_fn != NULL){
+	if (restconf_stream_body_next(sd, RESTCONF_BODY_CHUNK) < 0)
+	    return NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE;
+    }
+    if (cbuf_len(cb) <= sd->sd_body_offset){ /* Empty body */
+	*data_flags |= NGHTTP2_DATA_FLAG_EOF;
+	return 0;
+    }
     remain = cbuf_len(cb) - sd->sd_body_offset;
     clicon_debug(1, "%s length:%zu totlen:%d, offset:%zu remain:%zu",
 		 __FUNCTION__,
@@ -388,7 +327,8 @@ restconf_sd_read(nghttp2_session     *session,
 
     if (remain <= length){
 	len = remain;
-	*data_flags |= NGHTTP2_DATA_FLAG_EOF;
+	if (sd->sd_body_fn == NULL) /* Last part */
+	    *data_flags |= NGHTTP2_DATA_FLAG_EOF;
     }
     else{
 	len = length;
@@ -481,8 +421,10 @@ http2_exec(restconf_conn        *rc,
      * server MUST NOT send a Content-Length header field in any 2xx
      * (Successful) response to a CONNECT request (Section 4.3.6 of
      * [RFC7231]).
+     * A 304 (Not Modified) has no body, and a Content-Length would be of the full response.
      */
-    if (sd->sd_code != 204 && sd->sd_code > 199)
+    if (sd->sd_code != 204 && sd->sd_code != 304 && sd->sd_code > 199 &&
+	sd->sd_body_fn == NULL) /* Streamed body: length not known, end of stream ends body */
 	if (restconf_reply_header(sd, "Content-Length", "%zu", sd->sd_body_len) < 0)
 	    goto done;	
     if (sd->sd_code){
@@ -498,6 +440,122 @@ http2_exec(restconf_conn        *rc,
     return retval;
 }
 
+/*! Get next received http/2 request to execute on a connection, ie the oldest
+ * @param[in]  rc   Restconf connection
+ * @retval     sd   Stream with request waiting to be executed
+ * @retval     NULL No request waiting
+ */
+static restconf_stream_data *
+http2_exec_next(restconf_conn *rc)
+{
+    restconf_stream_data *sd;
+    restconf_stream_data *sd0 = NULL;
+
+    if ((sd = rc->rc_streams) != NULL){
+	do {
+	    if (sd->sd_exec)
+		sd0 = sd; /* New streams are inserted first, take last found */
+	    sd = NEXTQ(restconf_stream_data *, sd);
+	} while (sd && sd != rc->rc_streams);
+    }
+    return sd0;
+}
+
+/*! Connection socket is writable: execute one received http/2 request and send its response
+ *
+ * Requests are executed from the event loop one at a time instead of directly when their
+ * frames are received. The callback stays registered while requests are waiting, so that
+ * each turn of the event loop executes one request per connection, and serves I/O on
+ * other connections in between. This interleaves requests, it does not execute them
+ * concurrently.
+ * @param[in]  s    Connection socket
+ * @param[in]  arg  Restconf connection
+ * @see http2_exec_schedule
+ * @note The backend exchange of a request is synchronous, a slow backend call blocks all
+ * streams and connections of the process until it returns
+ */
+static int
+http2_exec_cb(int   s,
+	      void *arg)
+{
+    int                   retval = -1;
+    restconf_conn        *rc = (restconf_conn *)arg;
+    restconf_stream_data *sd;
+    cg_var               *cv;
+    char                 *query;
+    nghttp2_error         ngerr;
+
+    if ((sd = http2_exec_next(rc)) == NULL){
+	if (http2_exec_cancel(rc) < 0)
+	    goto done;
+	goto ok;
+    }
+    clicon_debug(1, "%s %d", __FUNCTION__, sd->sd_stream_id);
+    sd->sd_exec = 0;
+    /* Map headers of this stream to request parameters */
+    cv = NULL;
+    while ((cv = cvec_each(sd->sd_inp_hdrs, cv)) != NULL)
+	if (nghttp2_hdr2clixon(rc->rc_h, cv_name_get(cv), cv_string_get(cv)) < 0)
+	    goto done;
+    /* Query vector, ie the ?a=x&b=y stuff */
+    if ((query = restconf_param_get(rc->rc_h, "REQUEST_URI")) != NULL &&
+	(query = index(query, '?')) != NULL){
+	query++;
+	if (strlen(query) &&
+	    uri_str2cvec(query, '&', '=', 1, &sd->sd_qvec) < 0)
+	    goto done;
+    }
+    if (http2_exec(rc, sd, rc->rc_ngsession, sd->sd_stream_id) < 0)
+	goto done;
+    /* Parameters are cleared also if the path was not handled */
+    if (restconf_param_del_all(rc->rc_h) < 0)
+	goto done;
+    /* Send response, note sd may be freed when stream is closed */
+    if ((ngerr = nghttp2_session_send(rc->rc_ngsession)) != 0){
+	clicon_err(OE_NGHTTP2, ngerr, "nghttp2_session_send");
+	goto done;
+    }
+    /* Deregister when no more requests are waiting */
+    if (http2_exec_next(rc) == NULL &&
+	http2_exec_cancel(rc) < 0)
+	goto done;
+ ok:
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Schedule execution of received http/2 requests on a connection, if not already done
+ * Execution is made from a write callback of the connection socket, not from a timeout,
+ * since timeouts are only called when no socket is ready.
+ * @param[in]  rc   Restconf connection
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+int
+http2_exec_schedule(restconf_conn *rc)
+{
+    if (rc->rc_exec_sched || http2_exec_next(rc) == NULL)
+	return 0;
+    if (clixon_event_reg_fd_write(rc->rc_s, http2_exec_cb, rc, "http/2 request") < 0)
+	return -1;
+    rc->rc_exec_sched = 1;
+    return 0;
+}
+
+/*! Cancel scheduled execution of http/2 requests, eg when connection is closed
+ * @param[in]  rc   Restconf connection
+ */
+int
+http2_exec_cancel(restconf_conn *rc)
+{
+    if (rc->rc_exec_sched){
+	clixon_event_unreg_fd_write(rc->rc_s, http2_exec_cb);
+	rc->rc_exec_sched = 0;
+    }
+    return 0;
+}
+
 /*! A frame is received
  */
 static int
@@ -508,7 +566,6 @@ on_frame_recv_callback(nghttp2_session     *session,
     int                   retval = -1;
     restconf_conn        *rc = (restconf_conn *)user_data;
     restconf_stream_data *sd = NULL;
-    char                 *query;
     
     clicon_debug(1, "%s %s %d", __FUNCTION__, 
 		 clicon_int2str(nghttp2_frame_type_map, frame->hd.type),
@@ -523,15 +580,9 @@ on_frame_recv_callback(nghttp2_session     *session,
 	     */
 	    if ((sd = nghttp2_session_get_stream_user_data(session, frame->hd.stream_id)) == NULL)
 		return 0;
-	    /* Query vector, ie the ?a=x&b=y stuff */
-	    query = restconf_param_get(rc->rc_h, "REQUEST_URI");
-	    if ((query = index(query, '?')) != NULL){
-		query++;
-		if (strlen(query) &&
-		    uri_str2cvec(query, '&', '=', 1, &sd->sd_qvec) < 0)
-		    goto done;
-	    }
-	    if (http2_exec(rc, sd, session, frame->hd.stream_id) < 0)
+	    /* Execute later from event loop, not while receiving frames */
+	    sd->sd_exec = 1;
+	    if (http2_exec_schedule(rc) < 0)
 		goto done;
 	}
 	break;
@@ -626,9 +677,15 @@ on_stream_close_callback(nghttp2_session   *session,
 			 nghttp2_error_code error_code,
 			 void              *user_data)
 {
-    //    restconf_conn *rc = (restconf_conn *)user_data;
+    restconf_conn        *rc = (restconf_conn *)user_data;
+    restconf_stream_data *sd;
 
     clicon_debug(1, "%s %d %s", __FUNCTION__, error_code, nghttp2_strerror(error_code));
+    /* Stream is done, or reset by peer before it was executed */
+    if ((sd = restconf_stream_find(rc, stream_id)) != NULL){
+	DELQ(sd, rc->rc_streams, restconf_stream_data *);
+	restconf_stream_free(sd);
+    }
 #ifdef NOTNEEDED /* XXX think this is not necessary? */
     if (error_code){
 	if (restconf_close_ssl_socket(rc, 0) < 0)
@@ -711,14 +768,19 @@ on_header_callback(nghttp2_session     *session,
 		   void               *user_data)
 {
     int                   retval = -1;
-    restconf_conn      *rc = (restconf_conn *)user_data;
+    restconf_stream_data *sd;
 
     switch (frame->hd.type){
     case NGHTTP2_HEADERS:
 	assert (frame->headers.cat == NGHTTP2_HCAT_REQUEST);
 	clicon_debug(1, "%s HEADERS %s %s", __FUNCTION__, name, value);
- 	if (nghttp2_hdr2clixon(rc->rc_h, (char*)name, (char*)value) < 0)
+	/* Save in stream, other streams may be received before this is executed */
+	if ((sd = nghttp2_session_get_stream_user_data(session, frame->hd.stream_id)) == NULL)
+	    break;
+	if (cvec_add_string(sd->sd_inp_hdrs, (char*)name, (char*)value) < 0){
+	    clicon_err(OE_RESTCONF, errno, "cvec_add_string");
 	    goto done;
+	}
 	break;
     default:
 	clicon_debug(1, "%s %s %s", __FUNCTION__, clicon_int2str(nghttp2_frame_type_map, frame->hd.type), name);
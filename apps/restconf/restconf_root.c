@@ -69,6 +69,7 @@
 #include "restconf_methods.h"
 #include "restconf_methods_get.h"
 #include "restconf_methods_post.h"
+#include "restconf_cache.h"
 
 /*! Determine the root of the RESTCONF API by accessing /.well-known
  * @param[in]  h        Clicon handle
@@ -523,6 +524,10 @@ api_root_restconf(clicon_handle        h,
 	goto done;
     if (ret == 0)
 	goto ok;
+    /* Own changes invalidate cached GET responses directly, not only by notification */
+    if (strcmp(request_method, "GET") != 0 && strcmp(request_method, "HEAD") != 0 &&
+	restconf_cache_clear(h) < 0)
+	goto done;
     if (strcmp(api_resource, "yang-library-version")==0){
 	if (api_yang_library_version(h, req, pretty, media_out) < 0)
 	    goto done;
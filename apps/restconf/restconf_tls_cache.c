@@ -0,0 +1,491 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+
+  Copyright (C) 2009-2019 Olof Hagsand
+  Copyright (C) 2020-2021 Olof Hagsand and Rubicon Communications, LLC(Netgate)
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2,
+  indicate your decision by deleting the provisions above and replace them with the
+  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+  *
+  * TLS session cache and session tickets shared by native restconf workers
+  *
+  * The SSL context is created by the master process before the workers are forked.
+  * The following is set up at that point and inherited by all workers:
+  * - A shared memory table of serialized TLS sessions. OpenSSL's internal cache is
+  *   per process, which means a client would only resume a session if it happens
+  *   to connect to the same worker.
+  *   Each slot is protected by a sequence number (seqlock): a writer makes it odd while
+  *   writing, and a reader treats a changed or odd number as a cache miss.
+  *   Thus no process can block another, also not if it dies while writing.
+  * - A random secret from which session ticket keys are derived for each rotation
+  *   period. All workers compute the same keys without communicating.
+  * - Handshake counters, also in shared memory, updated with atomic operations.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "clixon_config.h" /* generated by config & autoconf */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <syslog.h>
+#include <sys/time.h>
+#include <sys/mman.h>
+
+#include <openssl/ssl.h>
+#include <openssl/rand.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#endif
+
+/* cligen */
+#include <cligen/cligen.h>
+
+/* clicon */
+#include <clixon/clixon.h>
+
+#include "restconf_tls_cache.h"
+
+/* Max size of a serialized session in the shared cache. Larger sessions, eg with
+ * long client certificate chains, are not cached */
+#define TLS_CACHE_SESSION_MAX 2048
+
+/* Size of ticket secret and derived keys */
+#define TLS_TICKET_SECRET_LEN 32
+
+/* Shared session cache slot */
+struct tls_cache_slot {
+    volatile uint32_t ts_seq;     /* Sequence number, odd while written */
+    uint32_t          ts_idlen;   /* Length of session id, 0 if empty */
+    time_t            ts_expire;  /* Session expires at this time */
+    uint32_t          ts_derlen;  /* Length of serialized session */
+    unsigned char     ts_id[SSL_MAX_SSL_SESSION_ID_LENGTH];
+    unsigned char     ts_der[TLS_CACHE_SESSION_MAX];
+};
+
+/* Handshake and cache counters shared by all processes */
+struct tls_stats {
+    pid_t             tt_pid;           /* Process that created the shared memory */
+    volatile uint64_t tt_handshakes;    /* Completed handshakes */
+    volatile uint64_t tt_resumed;       /* Of which resumed sessions */
+    volatile uint64_t tt_latency_us;    /* Sum of handshake time in us */
+    volatile uint64_t tt_latency_max;   /* Max handshake time in us */
+    volatile uint64_t tt_cache_hits;    /* Session found in shared cache */
+    volatile uint64_t tt_cache_misses;  /* Session not found (or expired) */
+    volatile uint64_t tt_cache_stores;  /* Sessions stored in shared cache */
+    uint32_t          tt_nslots;        /* Number of cache slots that follow */
+    struct tls_cache_slot tt_slots[];
+};
+
+/* Shared memory, created before workers are forked */
+static struct tls_stats *_tls_shm = NULL;
+static size_t            _tls_shm_len = 0;
+
+/* Ticket key derivation secret and rotation period in seconds */
+static unsigned char     _tls_ticket_secret[TLS_TICKET_SECRET_LEN];
+static uint32_t          _tls_ticket_rotation = 0;
+
+/*! Hash a session id to a cache slot (FNV-1a)
+ */
+static struct tls_cache_slot *
+tls_cache_slot(const unsigned char *id,
+	       unsigned int         idlen)
+{
+    uint32_t     hash = 2166136261u;
+    unsigned int i;
+
+    for (i=0; i<idlen; i++){
+	hash ^= id[i];
+	hash *= 16777619u;
+    }
+    return &_tls_shm->tt_slots[hash % _tls_shm->tt_nslots];
+}
+
+/*! A new session is established, store it in the shared cache
+ * @param[in]  ssl   SSL connection
+ * @param[in]  sess  New session
+ * @retval     0     Session reference not kept, OpenSSL frees it
+ */
+static int
+tls_cache_new_cb(SSL         *ssl,
+		 SSL_SESSION *sess)
+{
+    struct tls_cache_slot *slot;
+    const unsigned char   *id;
+    unsigned int           idlen;
+    unsigned char         *p;
+    int                    len;
+    uint32_t               seq;
+
+    id = SSL_SESSION_get_id(sess, &idlen);
+    if (idlen == 0 || idlen > SSL_MAX_SSL_SESSION_ID_LENGTH)
+	return 0;
+    if ((len = i2d_SSL_SESSION(sess, NULL)) <= 0 || len > TLS_CACHE_SESSION_MAX)
+	return 0;
+    slot = tls_cache_slot(id, idlen);
+    /* Take slot, if another process is writing, drop this session */
+    seq = slot->ts_seq;
+    if ((seq & 1) || !__sync_bool_compare_and_swap(&slot->ts_seq, seq, seq+1))
+	return 0;
+    p = slot->ts_der;
+    slot->ts_derlen = i2d_SSL_SESSION(sess, &p);
+    memcpy(slot->ts_id, id, idlen);
+    slot->ts_idlen = idlen;
+    slot->ts_expire = SSL_SESSION_get_time(sess) + SSL_SESSION_get_timeout(sess);
+    __sync_synchronize();
+    slot->ts_seq = seq+2;
+    __sync_fetch_and_add(&_tls_shm->tt_cache_stores, 1);
+    return 0;
+}
+
+/*! Look up a session from a client's session id in the shared cache
+ * @param[in]  ssl   SSL connection
+ * @param[in]  id    Session id
+ * @param[in]  idlen Length of session id
+ * @param[out] copy  Set to 0: the session is not referenced by the cache
+ * @retval     sess  Session, freed by OpenSSL
+ * @retval     NULL  Not found, make full handshake
+ */
+static SSL_SESSION *
+tls_cache_get_cb(SSL                 *ssl,
+		 const unsigned char *id,
+		 int                  idlen,
+		 int                 *copy)
+{
+    struct tls_cache_slot *slot;
+    SSL_SESSION           *sess = NULL;
+    unsigned char          der[TLS_CACHE_SESSION_MAX];
+    const unsigned char   *p;
+    uint32_t               seq;
+    uint32_t               derlen;
+    int                    match;
+
+    *copy = 0;
+    if (idlen <= 0 || idlen > SSL_MAX_SSL_SESSION_ID_LENGTH)
+	goto miss;
+    slot = tls_cache_slot(id, idlen);
+    seq = slot->ts_seq;
+    if (seq & 1)
+	goto miss;
+    __sync_synchronize();
+    match = slot->ts_idlen == idlen &&
+	memcmp(slot->ts_id, id, idlen) == 0 &&
+	slot->ts_expire > time(NULL);
+    derlen = slot->ts_derlen;
+    if (match && derlen <= TLS_CACHE_SESSION_MAX)
+	memcpy(der, slot->ts_der, derlen);
+    __sync_synchronize();
+    if (!match || slot->ts_seq != seq || derlen > TLS_CACHE_SESSION_MAX)
+	goto miss;
+    p = der;
+    if ((sess = d2i_SSL_SESSION(NULL, &p, derlen)) == NULL)
+	goto miss;
+    __sync_fetch_and_add(&_tls_shm->tt_cache_hits, 1);
+    return sess;
+ miss:
+    __sync_fetch_and_add(&_tls_shm->tt_cache_misses, 1);
+    return NULL;
+}
+
+/*! A session is removed, eg invalid or after failure, remove it from the shared cache
+ */
+static void
+tls_cache_remove_cb(SSL_CTX     *ctx,
+		    SSL_SESSION *sess)
+{
+    struct tls_cache_slot *slot;
+    const unsigned char   *id;
+    unsigned int           idlen;
+    uint32_t               seq;
+
+    id = SSL_SESSION_get_id(sess, &idlen);
+    if (idlen == 0 || idlen > SSL_MAX_SSL_SESSION_ID_LENGTH)
+	return;
+    slot = tls_cache_slot(id, idlen);
+    seq = slot->ts_seq;
+    if ((seq & 1) || !__sync_bool_compare_and_swap(&slot->ts_seq, seq, seq+1))
+	return;
+    if (slot->ts_idlen == idlen && memcmp(slot->ts_id, id, idlen) == 0)
+	slot->ts_idlen = 0;
+    __sync_synchronize();
+    slot->ts_seq = seq+2;
+}
+
+/*! Derive session ticket key name, cipher key and hmac key of a rotation period
+ * @param[in]  period   Rotation period number
+ * @param[out] name     Key name sent in ticket (16 bytes)
+ * @param[out] aeskey   AES-256 key (32 bytes)
+ * @param[out] hmackey  HMAC-SHA256 key (32 bytes)
+ * @retval     0        OK
+ * @retval    -1        Error
+ */
+static int
+tls_ticket_keys(uint64_t       period,
+		unsigned char *name,
+		unsigned char *aeskey,
+		unsigned char *hmackey)
+{
+    unsigned char data[9];
+    unsigned char md[EVP_MAX_MD_SIZE];
+    unsigned int  mdlen;
+    int           i;
+
+    for (i=0; i<8; i++)
+	data[i+1] = (period >> (8*i)) & 0xff;
+    data[0] = 'n';
+    if (HMAC(EVP_sha256(), _tls_ticket_secret, TLS_TICKET_SECRET_LEN, data, sizeof(data), md, &mdlen) == NULL)
+	return -1;
+    memcpy(name, md, 16);
+    data[0] = 'a';
+    if (HMAC(EVP_sha256(), _tls_ticket_secret, TLS_TICKET_SECRET_LEN, data, sizeof(data), aeskey, &mdlen) == NULL)
+	return -1;
+    data[0] = 'h';
+    if (HMAC(EVP_sha256(), _tls_ticket_secret, TLS_TICKET_SECRET_LEN, data, sizeof(data), hmackey, &mdlen) == NULL)
+	return -1;
+    return 0;
+}
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+typedef EVP_MAC_CTX tls_hmac_ctx;
+#else
+typedef HMAC_CTX tls_hmac_ctx;
+#endif
+
+/*! Initialize ticket HMAC with key
+ */
+static int
+tls_ticket_hmac_init(tls_hmac_ctx  *hctx,
+		     unsigned char *hmackey)
+{
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    OSSL_PARAM params[2];
+
+    params[0] = OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, "SHA256", 0);
+    params[1] = OSSL_PARAM_construct_end();
+    return EVP_MAC_init(hctx, hmackey, 32, params) == 1 ? 0 : -1;
+#else
+    return HMAC_Init_ex(hctx, hmackey, 32, EVP_sha256(), NULL) == 1 ? 0 : -1;
+#endif
+}
+
+/*! Encrypt or decrypt a session ticket with keys of current (or previous) period
+ * @param[in]     ssl      SSL connection
+ * @param[in,out] name     Key name, set on encrypt, checked on decrypt
+ * @param[in,out] iv       Initialization vector, set on encrypt
+ * @param[in]     ctx      Cipher context to initialize
+ * @param[in]     hctx     HMAC context to initialize
+ * @param[in]     enc      1: encrypt (new ticket), 0: decrypt
+ * @retval        2        Decrypt OK with previous key, issue a new ticket
+ * @retval        1        OK
+ * @retval        0        Decrypt: key not found, make full handshake
+ * @retval       -1        Error
+ */
+static int
+tls_ticket_key_cb(SSL            *ssl,
+		  unsigned char   name[16],
+		  unsigned char  *iv,
+		  EVP_CIPHER_CTX *ctx,
+		  tls_hmac_ctx   *hctx,
+		  int             enc)
+{
+    unsigned char keyname[16];
+    unsigned char aeskey[32];
+    unsigned char hmackey[32];
+    uint64_t      period;
+    int           i;
+
+    period = time(NULL) / _tls_ticket_rotation;
+    if (enc){
+	if (tls_ticket_keys(period, name, aeskey, hmackey) < 0)
+	    return -1;
+	if (RAND_bytes(iv, EVP_CIPHER_iv_length(EVP_aes_256_cbc())) != 1)
+	    return -1;
+	if (EVP_EncryptInit_ex(ctx, EVP_aes_256_cbc(), NULL, aeskey, iv) != 1)
+	    return -1;
+	if (tls_ticket_hmac_init(hctx, hmackey) < 0)
+	    return -1;
+	return 1;
+    }
+    /* Accept tickets encrypted in this or previous period */
+    for (i=0; i<2 && period >= i; i++){
+	if (tls_ticket_keys(period - i, keyname, aeskey, hmackey) < 0)
+	    return -1;
+	if (memcmp(keyname, name, sizeof(keyname)) != 0)
+	    continue;
+	if (tls_ticket_hmac_init(hctx, hmackey) < 0)
+	    return -1;
+	if (EVP_DecryptInit_ex(ctx, EVP_aes_256_cbc(), NULL, aeskey, iv) != 1)
+	    return -1;
+	return i==0 ? 1 : 2;
+    }
+    return 0;
+}
+
+/*! Set up TLS session cache and session tickets of an SSL context
+ *
+ * Must be called before restconf workers are forked, so that shared memory and ticket
+ * secret are the same in all workers.
+ * @param[in]  ctx       SSL context
+ * @param[in]  size      Number of sessions in shared cache, 0 disables server cache
+ * @param[in]  timeout   Session lifetime in seconds
+ * @param[in]  tickets   Enable session tickets
+ * @param[in]  rotation  Ticket key rotation in seconds
+ * @retval     0         OK
+ * @retval    -1         Error
+ */
+int
+restconf_tls_cache_init(SSL_CTX *ctx,
+			uint32_t size,
+			uint32_t timeout,
+			int      tickets,
+			uint32_t rotation)
+{
+    int   retval = -1;
+    void *p;
+
+    clicon_debug(1, "%s size:%u timeout:%u tickets:%d rotation:%u", __FUNCTION__,
+		 size, timeout, tickets, rotation);
+    if (_tls_shm != NULL){
+	clicon_err(OE_SSL, EEXIST, "TLS session cache already initialized");
+	goto done;
+    }
+    _tls_shm_len = sizeof(struct tls_stats) + size*sizeof(struct tls_cache_slot);
+    if ((p = mmap(NULL, _tls_shm_len, PROT_READ|PROT_WRITE,
+		  MAP_SHARED|MAP_ANONYMOUS, -1, 0)) == MAP_FAILED){
+	clicon_err(OE_UNIX, errno, "mmap");
+	goto done;
+    }
+    _tls_shm = (struct tls_stats *)p; /* Anonymous mapping is zero-filled */
+    _tls_shm->tt_pid = getpid();
+    _tls_shm->tt_nslots = size;
+    SSL_CTX_set_timeout(ctx, timeout);
+    if (size){
+	SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_NO_INTERNAL);
+	SSL_CTX_sess_set_new_cb(ctx, tls_cache_new_cb);
+	SSL_CTX_sess_set_get_cb(ctx, tls_cache_get_cb);
+	SSL_CTX_sess_set_remove_cb(ctx, tls_cache_remove_cb);
+    }
+    else
+	SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+    if (tickets){
+	if (RAND_bytes(_tls_ticket_secret, sizeof(_tls_ticket_secret)) != 1){
+	    clicon_err(OE_SSL, 0, "RAND_bytes");
+	    goto done;
+	}
+	_tls_ticket_rotation = rotation?rotation:3600;
+	SSL_CTX_clear_options(ctx, SSL_OP_NO_TICKET);
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+	SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx, tls_ticket_key_cb);
+#else
+	SSL_CTX_set_tlsext_ticket_key_cb(ctx, tls_ticket_key_cb);
+#endif
+    }
+    else
+	SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! A TLS handshake is complete, update counters
+ * @param[in]  ssl   SSL connection
+ * @param[in]  t0    Time when handshake started
+ */
+int
+restconf_tls_handshake_done(SSL            *ssl,
+			    struct timeval *t0)
+{
+    struct timeval t;
+    uint64_t       us;
+    uint64_t       max;
+    int            resumed;
+
+    if (_tls_shm == NULL)
+	return 0;
+    gettimeofday(&t, NULL);
+    timersub(&t, t0, &t);
+    us = t.tv_sec*1000000ULL + t.tv_usec;
+    resumed = SSL_session_reused(ssl);
+    __sync_fetch_and_add(&_tls_shm->tt_handshakes, 1);
+    if (resumed)
+	__sync_fetch_and_add(&_tls_shm->tt_resumed, 1);
+    __sync_fetch_and_add(&_tls_shm->tt_latency_us, us);
+    while ((max = _tls_shm->tt_latency_max) < us &&
+	   !__sync_bool_compare_and_swap(&_tls_shm->tt_latency_max, max, us))
+	;
+    clicon_debug(1, "%s %s %lluus", __FUNCTION__, resumed?"resumed":"full",
+		 (unsigned long long)us);
+    return 0;
+}
+
+/*! Log TLS handshake and session cache counters of all workers
+ */
+int
+restconf_tls_stats_log(void)
+{
+    struct tls_stats *ts;
+    uint64_t          n;
+
+    if ((ts = _tls_shm) == NULL)
+	return 0;
+    n = ts->tt_handshakes;
+    clicon_log(LOG_INFO, "TLS handshakes: %llu resumed: %llu (%llu%%) avg: %lluus max: %lluus cache hits: %llu misses: %llu stores: %llu",
+	       (unsigned long long)n,
+	       (unsigned long long)ts->tt_resumed,
+	       (unsigned long long)(n ? ts->tt_resumed*100/n : 0),
+	       (unsigned long long)(n ? ts->tt_latency_us/n : 0),
+	       (unsigned long long)ts->tt_latency_max,
+	       (unsigned long long)ts->tt_cache_hits,
+	       (unsigned long long)ts->tt_cache_misses,
+	       (unsigned long long)ts->tt_cache_stores);
+    return 0;
+}
+
+/*! Free shared memory, the process that created it logs counters first
+ */
+int
+restconf_tls_cache_exit(void)
+{
+    if (_tls_shm == NULL)
+	return 0;
+    if (_tls_shm->tt_pid == getpid())
+	restconf_tls_stats_log();
+    munmap(_tls_shm, _tls_shm_len);
+    _tls_shm = NULL;
+    _tls_shm_len = 0;
+    explicit_bzero(_tls_ticket_secret, sizeof(_tls_ticket_secret));
+    return 0;
+}
@@ -54,6 +54,12 @@ int xmldb_get(clicon_handle h, const char *db, cvec *nsc, char *xpath, cxobj **x
 int xmldb_get0(clicon_handle h, const char *db, yang_bind yb,
 	       cvec *nsc, const char *xpath,
 	       int copy, cxobj **xtop, modstate_diff_t *msd, cxobj **xerr); 
+int xmldb_get0_page(clicon_handle h, const char *db, yang_bind yb,
+		    cvec *nsc, const char *xpath, netconf_page *page,
+		    cxobj **xtop, cxobj **xerr);
+int xmldb_get0_filter(clicon_handle h, const char *db, yang_bind yb,
+		      cvec *nsc, const char *xpath, netconf_page *page,
+		      xml_copy_filter_t *fn, void *arg, cxobj **xtop, cxobj **xerr);
 int xmldb_get0_clear(clicon_handle h, cxobj *x);
 int xmldb_get0_free(clicon_handle h, cxobj **xp);
 int xmldb_put(clicon_handle h, const char *db, enum operation_type op, cxobj *xt, char *username, cbuf *cbret); /* in clixon_datastore_write.[ch] */
@@ -74,6 +80,8 @@ cxobj *xmldb_cache_get(clicon_handle h, const char *db);
 int xmldb_modified_get(clicon_handle h, const char *db);
 int xmldb_modified_set(clicon_handle h, const char *db, int value);
 int xmldb_empty_get(clicon_handle h, const char *db);
+uint64_t xmldb_generation_get(clicon_handle h, const char *db);
+int xmldb_generation_inc(clicon_handle h, const char *db);
 int xmldb_dump(clicon_handle h, FILE *f, cxobj *xt);
 int xmldb_print(clicon_handle h, FILE *f);
 
@@ -38,8 +38,11 @@
 #ifndef _CLIXON_HASH_H_
 #define _CLIXON_HASH_H_
 
+/*! Hash entry. 
+ * The table itself, as returned by clicon_hash_init, is opaque, only entries
+ * are accessed directly.
+ */
 struct clicon_hash {
-    qelem_t	h_qelem;
     char       *h_key;
     size_t	h_vlen;
     void       *h_val;
@@ -54,10 +57,12 @@ clicon_hash_t  clicon_hash_add (clicon_hash_t *head, const char *key, void *val,
 int            clicon_hash_del (clicon_hash_t *head, const char *key);
 int            clicon_hash_dump(clicon_hash_t *head, FILE *f);
 int            clicon_hash_keys(clicon_hash_t *hash, char ***vector, size_t *nkeys);
+clicon_hash_t  clicon_hash_next(clicon_hash_t *hash, clicon_hash_t hprev);
+size_t         clicon_hash_len(clicon_hash_t *hash);
 
 /*
  *   Macros to iterate over hash contents.
- *   XXX A bit crude. Just as easy for app to loop through the keys itself.
+ *   Does not allocate, see clicon_hash_next
  *
  *  Example:
  *     char *k;
@@ -69,15 +74,13 @@ int            clicon_hash_keys(clicon_hash_t *hash, char ***vector, size_t *nke
  * 
  *     clicon_hash_each(h, k) {
  *       printf ("%s = %s\n", k, (char *)clicon_hash_value(h, k, NULL));
- *     } hash_each_end();
+ *     } clicon_hash_each_end(h);
 */
-#define clicon_hash_each(__hash__, __key__) 					\
+#define clicon_hash_each(__hash__, __key__) 				\
 {									\
-    int __i__;								\
-    size_t __n__;							\
-    char **__k__ = hash_keys((__hash__),&__n__);			\
-    if (__k__) {							\
-        for(__i__ = 0; __i__ < __n__ && ((__key__) = __k__[__i__]); __i__++)
-#define clicon_hash_each_end(__hash__)	 if (__k__) free(__k__);  } }
+    clicon_hash_t __h__ = NULL;						\
+    while ((__h__ = clicon_hash_next((__hash__), __h__)) != NULL &&	\
+	   ((__key__) = __h__->h_key) != NULL)
+#define clicon_hash_each_end(__hash__)	}
 
 #endif /* _CLIXON_HASH_H_ */
@@ -40,12 +40,20 @@
 #ifndef _CLIXON_JSON_H
 #define _CLIXON_JSON_H
 
+/*
+ * Types
+ */
+typedef struct json_enc json_enc; /* Incremental JSON encoder, opaque */
+
 /*
  * Prototypes
  */
 int json2xml_decode(cxobj *x, cxobj **xerr);
 int xml2json_cbuf(cbuf *cb, cxobj *x, int pretty);
 int xml2json_cbuf_vec(cbuf *cb, cxobj **vec, size_t veclen, int pretty);
+json_enc *json_enc_new(cxobj **vec, size_t veclen, int pretty, int top);
+int json_enc_next(json_enc *je, cbuf *cb, size_t maxlen);
+int json_enc_free(json_enc *je);
 int xml2json(FILE *f, cxobj *x, int pretty);
 int xml2json_cb(FILE *f, cxobj *x, int pretty, clicon_output_cb *fn);
 int json_print(FILE *f, cxobj *x);
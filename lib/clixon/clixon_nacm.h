@@ -56,13 +56,20 @@ enum nacm_access{
 /*
  * Prototypes
  */
-int nacm_rpc(char *rpc, char *module, char *username, cxobj *xnacm, cbuf *cbret);
+int nacm_rpc(clicon_handle h, char *rpc, char *module, char *username, cxobj *xnacm, cbuf *cbret);
 int nacm_datanode_read(clicon_handle h, cxobj *xt, cxobj **xvec, size_t xlen, char *username,
 		       cxobj *nacm_xtree);
+int nacm_datanode_read_get(clicon_handle h, const char *db, cvec *nsc, const char *xpath,
+			   netconf_page *page, char *username, cxobj *xnacm,
+			   cxobj **xret, cxobj **xerr);
+int nacm_datanode_read_node(clicon_handle h, cxobj *x, char *username, cxobj *xnacm,
+			    cxobj **xcp);
 int nacm_datanode_write(clicon_handle h, cxobj *xr, cxobj *xt,
 			enum nacm_access access,
 			char *username, cxobj *xnacm, cbuf *cbret);
 int nacm_access_pre(clicon_handle h, char *peername, char *username, cxobj **xnacmp);
+int nacm_load_external(clicon_handle h);
+int nacm_program_reset(clicon_handle h);
 int verify_nacm_user(clicon_handle h, enum nacm_credentials_t cred, char *peername, char *nacmname, cbuf *cbret);
 
 #endif /* _CLIXON_NACM_H */
@@ -83,6 +83,18 @@ enum netconf_content{
 };
 typedef enum netconf_content netconf_content;
 
+/*! List pagination, see draft-ietf-netconf-list-pagination
+ * Clixon extension: offset, limit and direction attributes of <get> and <get-config>,
+ * and query parameters in restconf.
+ * A page is a slice of the nodes selected by the xpath filter, in document order
+ */
+struct netconf_page{
+    uint32_t np_offset;  /* Number of nodes to skip */
+    uint32_t np_limit;   /* Max number of nodes, 0 means unbounded */
+    int      np_reverse; /* direction=backwards: skip and count from the last node */
+};
+typedef struct netconf_page netconf_page;
+
 /*
  * Macros
  */
@@ -136,6 +148,7 @@ char *netconf_db_find(cxobj *xn, char *name);
 int netconf_err2cb(cxobj *xerr, cbuf *cberr);
 const netconf_content netconf_content_str2int(char *str);
 const char *netconf_content_int2str(netconf_content nr);
+int   netconf_page_vec(cxobj **vec, size_t *veclen, netconf_page *page);
 int netconf_hello_server(clicon_handle h, cbuf *cb, uint32_t session_id);
 int netconf_hello_req(clicon_handle h, cbuf *cb);
 int clixon_netconf_error_fn(const char *fn, const int line, cxobj *xerr, const char *fmt, const char *arg);
@@ -6,6 +6,13 @@
 #ifndef _CLIXON_NETNS_H_
 #define _CLIXON_NETNS_H_
 
+/*
+ * Constants
+ */
+/* Flag to clixon_netns_socket: set SO_REUSEPORT so that several sockets (eg in different
+ * processes) can bind the same address and port. Not passed to socket(2) */
+#define CLIXON_SOCK_REUSEPORT 0x40000000
+
 /*
  * Prototypes
  */
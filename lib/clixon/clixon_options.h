@@ -117,7 +117,8 @@ enum datastore_cache{
  */
 enum regexp_mode{
     REGEXP_POSIX,
-    REGEXP_LIBXML2
+    REGEXP_LIBXML2,
+    REGEXP_DFA
 };
 
 /*
@@ -84,6 +84,9 @@ int api_path2xml(char *api_path, yang_stmt *yspec, cxobj *xtop,
 		 yang_class nodeclass, int strict,
 		 cxobj **xpathp, yang_stmt **ypathp, cxobj **xerr);
 int xml2api_path_1(cxobj *x, cbuf *cb);
+int clixon_path_free(clixon_path *cplist);
+int clixon_instance_id_compile(yang_stmt *yt, char *path, clixon_path **cplistp);
+int clixon_xml_find_instance_id_compiled(cxobj *xt, yang_stmt *yt, clixon_path *cplist, struct clixon_xml_vec **xvec);
 #if defined(__GNUC__) && __GNUC__ >= 3
 int clixon_xml_find_api_path(cxobj *xt, yang_stmt *yt, cxobj ***xvec, int *xlen, const char *format,
 		     ...) __attribute__ ((format (printf, 5, 6)));;
@@ -95,6 +95,7 @@ int clicon_msg_rcv(int s, struct clicon_msg **msg, int *eof);
 
 int clicon_msg_rcv1(int s, cbuf *cb, int *eof);
 
+int send_msg_notify(int s, char *event);
 int send_msg_notify_xml(clicon_handle h, int s, cxobj *xev);
 
 int send_msg_reply(int s, char *data, uint32_t datalen);
@@ -46,4 +46,9 @@ int regex_compile(clicon_handle h, char *regexp, void **recomp);
 int regex_exec(clicon_handle h, void *recomp, char *string);
 int regex_free(clicon_handle h, void *recomp);
 
+int regex_dfa_compile(char **patterns, int *inverts, int npatterns, void **recomp);
+int regex_dfa_match(void *recomp, char *str, size_t len, uint64_t *mask);
+int regex_dfa_exec(void *recomp, char *str);
+int regex_dfa_free(void *recomp);
+
 #endif  /* _CLIXON_REGEX_H_ */
@@ -58,6 +58,15 @@
  */
 #define EVENT_RFC5277_NAMESPACE "urn:ietf:params:xml:ns:netmod:notification"
 
+/* Built-in backend stream of clixon-lib:datastore-changed notifications,
+ * enabled by CLICON_STREAM_DATASTORE
+ */
+#define CLIXON_DATASTORE_STREAM "CLIXON-DATASTORE"
+
+/* RFC 8639 subscribed notifications and RFC 8641 YANG-Push, enabled by CLICON_YANG_PUSH */
+#define SUBSCRIBED_NOTIFICATIONS_NAMESPACE "urn:ietf:params:xml:ns:yang:ietf-subscribed-notifications"
+#define YANG_PUSH_NAMESPACE "urn:ietf:params:xml:ns:yang:ietf-yang-push"
+
 /*
  * Types
  */
@@ -65,28 +74,33 @@
  * @param[in]  h     Clicon handle
  * @param[in]  op    Operation: 0 OK, 1 Close
  * @param[in]  event Event as XML
+ * @param[in]  evstr Event encoded as XML string, same for all subscribers of an event
  * @param[in]  arg   Extra argument provided in stream_ss_add
  * @see stream_ss_add
  */
-typedef	int (*stream_fn_t)(clicon_handle h, int op, cxobj *event, void *arg);
+typedef	int (*stream_fn_t)(clicon_handle h, int op, cxobj *event, char *evstr, void *arg);
 
 struct stream_subscription{
     qelem_t                     ss_q;   /* queue header */
     char                       *ss_stream; /* Name of associated stream */
     char                       *ss_xpath;  /* Filter selector as xpath */
+    struct xpath_tree          *ss_xptree; /* Parsed filter, NULL if no filter */
+    char                       *ss_index;  /* Name of event element filter requires, or NULL */
     struct timeval              ss_starttime; /* Replay starttime */
     struct timeval              ss_stoptime; /* Replay stoptime */
     stream_fn_t                 ss_fn;     /* Callback when event occurs */
     void                       *ss_arg;    /* Callback argument */
 };
 
-/* Replay time-series */
-struct stream_replay{
-    qelem_t        r_q;   /* queue header */
-    struct timeval r_tv;  /* time index */
-    cxobj         *r_xml; /* event in xml form */
+/* Vector of subscriptions, value of the event stream subscription index */
+struct stream_ss_vec{
+    struct stream_subscription **sv_vec;
+    size_t                       sv_len;
 };
 
+/* Replay store: ring of encoded events with a time index, see clixon_stream.c */
+struct stream_replay;
+
 /* See RFC8040 9.3, stream list, no replay support for now
  */
 struct event_stream{
@@ -94,9 +108,12 @@ struct event_stream{
     char                *es_name; /* name of notification event stream */
     char                *es_description;
     struct stream_subscription *es_subscription;
+    clicon_hash_t       *es_index; /* Subscriptions by ss_index, value is struct stream_ss_vec */
+    struct stream_ss_vec es_noindex; /* Subscriptions without ss_index, match any event */
+    uint64_t             es_ss_rm_nr; /* Nr of removed subscriptions, to detect removal in callbacks */
     int                  es_replay_enabled; /* set if replay is enables */
     struct timeval       es_retention; /* replay retention - how much to save */
-    struct stream_replay *es_replay;
+    struct stream_replay *es_replay; /* Replay store, NULL if replay not enabled */
 
 };
 typedef struct event_stream event_stream_t;
@@ -127,7 +144,7 @@ int stream_notify(clicon_handle h, char *stream, const char *event, ...);
 #endif
 
 /* Replay */
-int stream_replay_add(event_stream_t *es, struct timeval *tv, cxobj *xv);
+int stream_replay_add(event_stream_t *es, struct timeval *tv, char *evstr);
 int stream_replay_trigger(clicon_handle h, char *stream, stream_fn_t fn, void *arg);
 
 /* Experimental publish streams using SSE. CLIXON_PUBLISH_STREAMS should be set */
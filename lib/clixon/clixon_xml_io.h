@@ -40,6 +40,11 @@
 #ifndef _CLIXON_XML_IO_H_
 #define _CLIXON_XML_IO_H_
 
+/*
+ * Types
+ */
+typedef struct xml_enc xml_enc; /* Incremental XML encoder, opaque */
+
 /*
  * Prototypes
  */
@@ -48,6 +53,9 @@ int clicon_xml2file(FILE *f, cxobj *x, int level, int prettyprint);
 int xml_print(FILE *f, cxobj *xn);
 int clicon_xml2cbuf(cbuf *cb, cxobj *x, int level, int prettyprint, int32_t depth);
 char *clicon_xml2str(cxobj *x);
+xml_enc *xml_enc_new(cxobj **vec, size_t veclen, int pretty);
+int xml_enc_next(xml_enc *xe, cbuf *cb, size_t maxlen);
+int xml_enc_free(xml_enc *xe);
 int xmltree2cbuf(cbuf *cb, cxobj *x, int level);
 
 int clixon_xml_parse_file(FILE *f, yang_bind yb, yang_stmt *yspec, cxobj **xt, cxobj **xerr);
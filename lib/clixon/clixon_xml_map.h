@@ -46,6 +46,15 @@
 /* Declared in clixon_yang_internal */
 typedef enum yang_class yang_class;
 
+/* Return values of copy filter, see xml_copy_marked_filter */
+#define XML_COPY_SKIP 0x00 /* Node and subtree are not copied */
+#define XML_COPY_KEEP 0x01 /* Node is kept for its own sake */
+#define XML_COPY_ANY  0x02 /* Node is kept if an ancestor or descendant is kept */
+#define XML_COPY_TREE 0x04 /* Decision holds for whole subtree, no further filtering */
+
+/* Copy filter: return XML_COPY_* value, or -1 on error */
+typedef int (xml_copy_filter_t)(cxobj *x, void *arg);
+
 /*
  * Prototypes
  */
@@ -76,6 +85,8 @@ int assign_namespace_body(cxobj *x0, cxobj *x1);
 int xml_merge(cxobj *x0, cxobj *x1, yang_stmt *yspec, char **reason);
 int yang_enum_int_value(cxobj *node, int32_t *val);
 int xml_copy_marked(cxobj *x0, cxobj *x1);
+int xml_copy_marked_filter(cxobj *x0, cxobj *x1, xml_copy_filter_t *fn, void *arg);
+int xml_copy_filter(cxobj *x0, cxobj *x1, xml_copy_filter_t *fn, void *arg);
 int yang_check_when_xpath(cxobj *xn, cxobj *xp, yang_stmt *yn, int *hit, int *nrp, char **xpathp);
 
 #endif  /* _CLIXON_XML_MAP_H_ */
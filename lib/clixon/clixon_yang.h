@@ -61,6 +61,7 @@
 #define YANG_FLAG_INDEX 0x08  /* This yang node under list is (extra) index. --> you can access
 			       * list elements using this index with binary search */
 #endif
+#define YANG_FLAG_LAZY  0x10  /* Module header stub not yet loaded, see CLICON_YANG_LAZY */
 
 /*
  * Types
@@ -230,6 +231,7 @@ int        yn_insert(yang_stmt *ys_parent, yang_stmt *ys_child);
 int        yn_insert1(yang_stmt *ys_parent, yang_stmt *ys_child);
 yang_stmt *yn_each(yang_stmt *yn, yang_stmt *ys);
 char      *yang_key2str(int keyword);
+int        yang_str2key(char *str);
 int        ys_module_by_xml(yang_stmt *ysp, struct xml *xt, yang_stmt **ymodp);
 yang_stmt *ys_module(yang_stmt *ys);
 int        ys_real_module(yang_stmt *ys, yang_stmt **ymod);
@@ -58,6 +58,10 @@ int        yang_spec_parse_module(clicon_handle h, const char *module,
 				  const char *revision, yang_stmt *yspec);
 int        yang_spec_parse_file(clicon_handle h, char *filename, yang_stmt *yspec);
 int        yang_spec_load_dir(clicon_handle h, char *dir, yang_stmt *yspec);
+yang_stmt *yang_lazy_each(yang_stmt *yspec, yang_stmt *yprev);
+yang_stmt *yang_lazy_load(yang_stmt *yspec, yang_stmt *ystub);
+yang_stmt *yang_lazy_find(yang_stmt *yspec, enum rfc_6020 keyword, const char *arg);
+int        yang_lazy_free(yang_stmt *yspec);
 int        ys_parse_date_arg(char *datearg, uint32_t *dateint);
 cg_var    *ys_parse(yang_stmt *ys, enum cv_type cvtype);
 int        ys_parse_sub(yang_stmt *ys, char *extra);
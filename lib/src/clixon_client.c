@@ -218,7 +218,8 @@ clixon_client_hello(int sock)
     }
     cprintf(msg, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>");
     cprintf(msg, "<hello xmlns=\"%s\">", NETCONF_BASE_NAMESPACE);
-    cprintf(msg, "<capabilities><capability>%s</capability></capabilities>", NETCONF_BASE_CAPABILITY_1_1);
+    /* Only base:1.0 since messages are sent with end-of-message framing, see clicon_msg_send1 */
+    cprintf(msg, "<capabilities><capability>%s</capability></capabilities>", NETCONF_BASE_CAPABILITY_1_0);
     cprintf(msg, "</hello>");
     if (clicon_msg_send1(sock, msg) < 0)
 	goto done;
@@ -75,6 +75,8 @@
 #include "clixon_plugin.h"
 #include "clixon_options.h"
 #include "clixon_data.h"
+#include "clixon_netconf_lib.h"
+#include "clixon_xml_map.h"
 #include "clixon_datastore.h"
 #include "clixon_datastore_write.h"
 #include "clixon_datastore_read.h"
@@ -245,6 +247,8 @@ xmldb_copy(clicon_handle h,
 	goto done;
     if (clicon_file_copy(fromfile, tofile) < 0)
 	goto done;
+    if (xmldb_generation_inc(h, to) < 0)
+	goto done;
     retval = 0;
  done:
     if (fromfile)
@@ -419,6 +423,8 @@ xmldb_delete(clicon_handle h,
 	    clicon_err(OE_DB, errno, "truncate %s", filename);
 	    goto done;
 	}
+    if (xmldb_generation_inc(h, db) < 0)
+	goto done;
     retval = 0;
  done:
     if (filename)
@@ -454,7 +460,9 @@ xmldb_create(clicon_handle h,
 	clicon_err(OE_UNIX, errno, "open(%s)", filename);
 	goto done;
     }
-   retval = 0;
+    if (xmldb_generation_inc(h, db) < 0)
+	goto done;
+    retval = 0;
  done:
     if (filename)
 	free(filename);
@@ -563,6 +571,49 @@ xmldb_modified_set(clicon_handle h,
     return 0;
 }
 
+/*! Get generation of datastore
+ *
+ * The generation is incremented each time the datastore is written, ie by xmldb_put,
+ * xmldb_copy (to), xmldb_delete and xmldb_create, and is used to detect changes without
+ * comparing content.
+ * @param[in]  h     Clicon handle
+ * @param[in]  db    Database name
+ * @retval     gen   Generation, 0 if never written by this process
+ */
+uint64_t
+xmldb_generation_get(clicon_handle h,
+		     const char   *db)
+{
+    clicon_hash_t *cdat = clicon_data(h);
+    char           key[64];
+    void          *p;
+
+    snprintf(key, sizeof(key), "xmldb-generation-%s", db);
+    if ((p = clicon_hash_value(cdat, key, NULL)) == NULL)
+	return 0;
+    return *(uint64_t*)p;
+}
+
+/*! Increment generation of datastore, ie mark it as changed
+ * @param[in]  h     Clicon handle
+ * @param[in]  db    Database name
+ * @retval     0     OK
+ * @retval    -1     Error
+ * @see xmldb_generation_get
+ */
+int
+xmldb_generation_inc(clicon_handle h,
+		     const char   *db)
+{
+    clicon_hash_t *cdat = clicon_data(h);
+    char           key[64];
+    uint64_t       gen;
+
+    gen = xmldb_generation_get(h, db) + 1;
+    snprintf(key, sizeof(key), "xmldb-generation-%s", db);
+    return clicon_hash_add(cdat, key, &gen, sizeof(gen))==NULL?-1:0;
+}
+
 /* Print the datastore meta-info to file
  */
 int
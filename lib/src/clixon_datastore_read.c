@@ -72,9 +72,9 @@
 #include "clixon_xpath_ctx.h"
 #include "clixon_xpath.h"
 #include "clixon_json.h"
+#include "clixon_netconf_lib.h"
 #include "clixon_nacm.h"
 #include "clixon_path.h"
-#include "clixon_netconf_lib.h"
 #include "clixon_yang_module.h"
 #include "clixon_yang_parse_lib.h"
 #include "clixon_xml_map.h"
@@ -737,6 +737,145 @@ xmldb_get_nocache(clicon_handle    h,
     goto done;
 }
 
+/*! Check if a child node has a given name and namespace
+ * @param[in]  x     XML node
+ * @param[in]  name  Local name
+ * @param[in]  ns    Namespace or NULL for any
+ */
+static int
+xmldb_page_match(cxobj *x,
+		 char  *name,
+		 char  *ns)
+{
+    char *ns1 = NULL;
+
+    if (xml_type(x) != CX_ELMNT || strcmp(xml_name(x), name) != 0)
+	return 0;
+    if (ns == NULL)
+	return 1;
+    if (xml2ns(x, xml_prefix(x), &ns1) < 0 || ns1 == NULL)
+	return 0;
+    return strcmp(ns, ns1) == 0;
+}
+
+/*! Get a page of the nodes selected by xpath
+ *
+ * If the xpath is a location path whose last step is a plain name, eg /a/b[k='1']/c, 
+ * list entries are contiguous in the sorted children of the parent. Then only the parent
+ * is looked up and the entries of the page are accessed by index, so that the cost is
+ * proportional to the page size, not the list size.
+ * Otherwise the xpath is evaluated and the result vector is reduced.
+ * @param[in]  xt     XML tree
+ * @param[in]  nsc    XML namespace context of xpath
+ * @param[in]  xpath  xpath
+ * @param[in]  page   Offset, limit and direction
+ * @param[out] xvecp  Vector of nodes, free with free()
+ * @param[out] xlenp  Length of vector
+ * @retval     0      OK
+ * @retval    -1      Error
+ * @see netconf_page_vec
+ */
+static int
+xmldb_page_vec(cxobj        *xt,
+	       cvec         *nsc,
+	       const char   *xpath,
+	       netconf_page *page,
+	       cxobj      ***xvecp,
+	       size_t       *xlenp)
+{
+    int        retval = -1;
+    char      *step;
+    char      *xpath0 = NULL;
+    char      *prefix = NULL;
+    char      *name = NULL;
+    char      *ns = NULL;
+    cxobj    **xpvec = NULL;
+    size_t     xplen = 0;
+    cxobj     *xp;
+    cxobj     *x;
+    int        first;
+    int        last;
+    int        nr;
+    size_t     len;
+    int        i;
+
+    if (xpath == NULL ||
+	strchr(xpath, '|') != NULL ||
+	(step = strrchr(xpath, '/')) == NULL ||
+	*(step+1) == '\0' ||
+	strpbrk(step, "[]()*'\"@.") != NULL){
+	if (xpath_vec(xt, nsc, "%s", xvecp, xlenp, xpath?xpath:"/") < 0)
+	    goto done;
+	if (netconf_page_vec(*xvecp, xlenp, page) < 0)
+	    goto done;
+	goto ok;
+    }
+    if ((xpath0 = strndup(xpath, step-xpath)) == NULL){
+	clicon_err(OE_UNIX, errno, "strndup");
+	goto done;
+    }
+    if (nodeid_split(step+1, &prefix, &name) < 0)
+	goto done;
+    if (prefix && (ns = xml_nsctx_get(nsc, prefix)) == NULL){
+	clicon_err(OE_XML, ENOENT, "No namespace for prefix %s", prefix);
+	goto done;
+    }
+    if (strlen(xpath0) == 0)
+	xp = xt;
+    else{
+	if (xpath_vec(xt, nsc, "%s", &xpvec, &xplen, xpath0) < 0)
+	    goto done;
+	if (xplen != 1){ /* Several parents, a page spans them */
+	    if (xpath_vec(xt, nsc, "%s", xvecp, xlenp, xpath) < 0)
+		goto done;
+	    if (netconf_page_vec(*xvecp, xlenp, page) < 0)
+		goto done;
+	    goto ok;
+	}
+	xp = xpvec[0];
+    }
+    /* Children are sorted, find first and last entry */
+    nr = xml_child_nr(xp);
+    for (first=0; first<nr; first++)
+	if (xmldb_page_match(xml_child_i(xp, first), name, ns))
+	    break;
+    for (last=nr-1; last>=first; last--)
+	if (xmldb_page_match(xml_child_i(xp, last), name, ns))
+	    break;
+    *xlenp = 0;
+    len = last - first + 1;
+    if (page->np_offset >= len)
+	goto ok;
+    len -= page->np_offset;
+    if (page->np_limit && page->np_limit < len)
+	len = page->np_limit;
+    if (page->np_reverse)
+	first = last - page->np_offset - len + 1;
+    else
+	first += page->np_offset;
+    if ((*xvecp = malloc(len*sizeof(cxobj*))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	goto done;
+    }
+    for (i=first; i<first+len; i++){
+	x = xml_child_i(xp, i);
+	if (xmldb_page_match(x, name, ns))
+	    (*xvecp)[(*xlenp)++] = x;
+    }
+ ok:
+    retval = 0;
+ done:
+    if (xpath0)
+	free(xpath0);
+    if (prefix)
+	free(prefix);
+    if (name)
+	free(name);
+    if (xpvec)
+	free(xpvec);
+    return retval;
+}
+
 /*! Get content of database using xpath. return a set of matching sub-trees
  * The function returns a minimal tree that includes all sub-trees that match
  * xpath.
@@ -746,6 +885,9 @@ xmldb_get_nocache(clicon_handle    h,
  * @param[in]  yb     How to bind yang to XML top-level when parsing
  * @param[in]  nsc    External XML namespace context, or NULL
  * @param[in]  xpath  String with XPATH syntax. or NULL for all
+ * @param[in]  page   If set, only copy a page of the nodes matching xpath
+ * @param[in]  fn     If set, copy filter, see xml_copy_marked_filter
+ * @param[in]  arg    Argument to copy filter
  * @param[out] xret   Single return XML tree. Free with xml_free()
  * @param[out] msdiff If set, return modules-state differences
  * @param[out] xerr   XML error if retval is 0
@@ -756,12 +898,15 @@ xmldb_get_nocache(clicon_handle    h,
  * @see xmldb_get  the generic API function
  */
 static int
-xmldb_get_cache(clicon_handle    h,
-		const char      *db, 
-		yang_bind        yb,
-		cvec            *nsc,
-		const char      *xpath,
-		cxobj          **xtop,
+xmldb_get_cache(clicon_handle      h,
+		const char        *db, 
+		yang_bind          yb,
+		cvec              *nsc,
+		const char        *xpath,
+		netconf_page      *page,
+		xml_copy_filter_t *fn,
+		void              *arg,
+		cxobj            **xtop,
 		modstate_diff_t *msdiff,
 		cxobj          **xerr)
 
@@ -822,7 +967,11 @@ xmldb_get_cache(clicon_handle    h,
      *   a) for every node that is found, copy to new tree
      *   b) if config dont dont state data
      */
-    if (xpath_vec(x0t, nsc, "%s", &xvec, &xlen, xpath?xpath:"/") < 0)
+    if (page){
+	if (xmldb_page_vec(x0t, nsc, xpath, page, &xvec, &xlen) < 0)
+	    goto done;
+    }
+    else if (xpath_vec(x0t, nsc, "%s", &xvec, &xlen, xpath?xpath:"/") < 0)
 	goto done;
 
     /* Make new tree by copying top-of-tree from x0t to x1t */
@@ -831,10 +980,11 @@ xmldb_get_cache(clicon_handle    h,
     xml_flag_set(x1t, XML_FLAG_TOP);    
     xml_spec_set(x1t, xml_spec(x0t));
     
-    if (xlen < 1000){
+    if (xlen < 1000 && fn == NULL){
 	/* This is optimized for the case when the tree is large and xlen is small
 	 * If the tree is large and xlen too, then the other is better.
 	 * This only works if yang bind
+	 * A filter needs the top-down copy, since it decides on ancestors before descendants
 	 */
 	for (i=0; i<xlen; i++){
 	    x0 = xvec[i];
@@ -852,11 +1002,17 @@ xmldb_get_cache(clicon_handle    h,
 	    xml_flag_set(x0, XML_FLAG_MARK);
 	    xml_apply_ancestor(x0, (xml_applyfn_t*)xml_flag_set, (void*)XML_FLAG_CHANGE);
 	}
-	if (xml_copy_marked(x0t, x1t) < 0) /* config */
+	if (fn){
+	    if (xml_copy_marked_filter(x0t, x1t, fn, arg) < 0)
+		goto done;
+	}
+	else if (xml_copy_marked(x0t, x1t) < 0) /* config */
 	    goto done;
 	if (xml_apply(x0t, CX_ELMNT, (xml_applyfn_t*)xml_flag_reset, (void*)(XML_FLAG_MARK|XML_FLAG_CHANGE)) < 0)
 	    goto done;
-	if (xml_apply(x1t, CX_ELMNT, (xml_applyfn_t*)xml_flag_reset, (void*)(XML_FLAG_MARK|XML_FLAG_CHANGE)) < 0)
+	/* Marks set by the filter are kept in x1t */
+	if (fn == NULL &&
+	    xml_apply(x1t, CX_ELMNT, (xml_applyfn_t*)xml_flag_reset, (void*)(XML_FLAG_MARK|XML_FLAG_CHANGE)) < 0)
 	    goto done;
     }
     /* Remove global defaults from cache 
@@ -1112,12 +1268,143 @@ xmldb_get0(clicon_handle    h,
 	 * Add default values in copy, return copy
 	 * Copy deleted by xmldb_free
 	 */
-	retval = xmldb_get_cache(h, db, yb, nsc, xpath, xret, msdiff, xerr);
+	retval = xmldb_get_cache(h, db, yb, nsc, xpath, NULL, NULL, NULL, xret, msdiff, xerr);
 	break;
     }
     return retval;
 }
 
+/*! Get a page of the nodes selected by xpath, eg a range of list entries
+ *
+ * Only the nodes of the page (and their ancestors and list keys) are copied
+ * from the cached datastore, see xmldb_page_vec.
+ * @param[in]  h      Clicon handle
+ * @param[in]  db     Name of datastore, eg "running"
+ * @param[in]  yb     How to bind yang to XML top-level when parsing
+ * @param[in]  nsc    External XML namespace context, or NULL
+ * @param[in]  xpath  String with XPATH syntax. or NULL for all
+ * @param[in]  page   Offset, limit and direction of page
+ * @param[out] xret   Single return XML tree. Free with xml_free()
+ * @param[out] xerr   XML error if retval is 0
+ * @retval     -1     General error, check specific clicon_errno, clicon_suberrno
+ * @retval     0      Parse OK but yang assigment not made (or only partial) and xerr set
+ * @retval     1      OK
+ * @code
+ *   netconf_page page = {100, 20, 0};
+ *   if (xmldb_get0_page(h, "running", YB_MODULE, nsc, "/ex:x/ex:y", &page, &xt, &xerr) < 0)
+ *      err;
+ * @endcode
+ * @note The returned tree is always a copy
+ * @see xmldb_get0
+ */
+int 
+xmldb_get0_page(clicon_handle    h, 
+		const char      *db, 
+		yang_bind        yb,
+		cvec            *nsc,
+		const char      *xpath,
+		netconf_page    *page,
+		cxobj          **xret,
+		cxobj          **xerr)
+{
+    int     retval = -1;
+    cxobj **xvec = NULL;
+    size_t  xlen;
+    cxobj  *x;
+    int     i;
+
+    if (clicon_datastore_cache(h) != DATASTORE_NOCACHE)
+	return xmldb_get_cache(h, db, yb, nsc, xpath, page, NULL, NULL, xret, NULL, xerr);
+    /* No cache: read matching tree and remove nodes outside of page */
+    if ((retval = xmldb_get_nocache(h, db, yb, nsc, xpath, xret, NULL, xerr)) != 1)
+	goto done;
+    retval = -1;
+    if (xpath_vec(*xret, nsc, "%s", &xvec, &xlen, xpath?xpath:"/") < 0)
+	goto done;
+    for (i=0; i<xlen; i++)
+	xml_flag_set(xvec[i], XML_FLAG_MARK);
+    if (netconf_page_vec(xvec, &xlen, page) < 0)
+	goto done;
+    for (i=0; i<xlen; i++)
+	xml_flag_reset(xvec[i], XML_FLAG_MARK);
+    free(xvec);
+    xvec = NULL;
+    if (xpath_vec(*xret, nsc, "%s", &xvec, &xlen, xpath?xpath:"/") < 0)
+	goto done;
+    for (i=0; i<xlen; i++){
+	x = xvec[i];
+	if (xml_flag(x, XML_FLAG_MARK) && xml_purge(x) < 0)
+	    goto done;
+    }
+    retval = 1;
+ done:
+    if (xvec)
+	free(xvec);
+    return retval;
+}
+
+/*! Get a copy of the nodes selected by xpath, copied through a filter
+ *
+ * As xmldb_get0 with copy, but each node is given to a copy filter before it is copied
+ * from the cached datastore, so that eg nodes denied by access control are never copied.
+ * @param[in]  h      Clicon handle
+ * @param[in]  db     Name of datastore, eg "running"
+ * @param[in]  yb     How to bind yang to XML top-level when parsing
+ * @param[in]  nsc    External XML namespace context, or NULL
+ * @param[in]  xpath  String with XPATH syntax. or NULL for all
+ * @param[in]  page   If set, only copy a page of the nodes matching xpath
+ * @param[in]  fn     Copy filter, see xml_copy_marked_filter
+ * @param[in]  arg    Argument to copy filter
+ * @param[out] xret   Single return XML tree. Free with xml_free()
+ * @param[out] xerr   XML error if retval is 0
+ * @retval     -1     General error, check specific clicon_errno, clicon_suberrno
+ * @retval     0      Parse OK but yang assigment not made (or only partial) and xerr set
+ * @retval     1      OK
+ * @note Nodes kept by the filter for their own sake are marked with XML_FLAG_MARK in xret
+ * @note Default values are added after the copy, and are not given to the filter
+ * @see xmldb_get0
+ */
+int 
+xmldb_get0_filter(clicon_handle      h, 
+		  const char        *db, 
+		  yang_bind          yb,
+		  cvec              *nsc,
+		  const char        *xpath,
+		  netconf_page      *page,
+		  xml_copy_filter_t *fn,
+		  void              *arg,
+		  cxobj            **xret,
+		  cxobj            **xerr)
+{
+    int    retval = -1;
+    cxobj *x0t = NULL;
+    cxobj *x1t = NULL;
+
+    if (clicon_datastore_cache(h) != DATASTORE_NOCACHE)
+	return xmldb_get_cache(h, db, yb, nsc, xpath, page, fn, arg, xret, NULL, xerr);
+    /* No cache: read matching tree and copy it through the filter */
+    if (page)
+	retval = xmldb_get0_page(h, db, yb, nsc, xpath, page, &x0t, xerr);
+    else
+	retval = xmldb_get_nocache(h, db, yb, nsc, xpath, &x0t, NULL, xerr);
+    if (retval != 1)
+	goto done;
+    retval = -1;
+    if ((x1t = xml_new(xml_name(x0t), NULL, CX_ELMNT)) == NULL)
+	goto done;
+    if (xml_copy_filter(x0t, x1t, fn, arg) < 0)
+	goto done;
+    *xret = x1t;
+    x1t = NULL;
+    retval = 1;
+ done:
+    if (x0t)
+	xml_free(x0t);
+    if (x1t)
+	xml_free(x1t);
+    return retval;
+}
+
 /*! Clear cached xml tree obtained with xmldb_get0, if zerocopy
  *
  * @param[in]  h    Clicon handle
@@ -71,8 +71,8 @@
 #include "clixon_xpath_ctx.h"
 #include "clixon_xpath.h"
 #include "clixon_json.h"
-#include "clixon_nacm.h"
 #include "clixon_netconf_lib.h"
+#include "clixon_nacm.h"
 #include "clixon_yang_type.h"
 #include "clixon_yang_module.h"
 #include "clixon_xml_nsctx.h"
@@ -1129,6 +1129,8 @@ xmldb_put(clicon_handle       h,
      */
     if (xmodst && xml_purge(xmodst) < 0)
 	goto done;
+    if (xmldb_generation_inc(h, db) < 0)
+	goto done;
     retval = 1;
  done:
     if (f != NULL)
@@ -74,7 +74,7 @@
 struct event_data{
     struct event_data *e_next;     /* next in list */
     int (*e_fn)(int, void*);            /* function */
-    enum {EVENT_FD, EVENT_TIME} e_type;        /* type of event */
+    enum {EVENT_FD, EVENT_FD_WRITE, EVENT_TIME} e_type; /* type of event */
     int e_fd;                      /* File descriptor */
     struct timeval e_time;         /* Timeout */
     void *e_arg;                   /* function argument */
@@ -160,23 +160,15 @@ clicon_sig_ignore_get(void)
     return _clicon_sig_ignore;
 }
 
-/*! Register a callback function to be called on input on a file descriptor.
- *
- * @param[in]  fd  File descriptor
- * @param[in]  fn  Function to call when input available on fd
- * @param[in]  arg Argument to function fn
- * @param[in]  str Describing string for logging
- * @code
- * int fn(int fd, void *arg){
- * }
- * clixon_event_reg_fd(fd, fn, (void*)42, "call fn on input on fd");
- * @endcode 
+/*! Register a file descriptor callback of a given type
+ * @see clixon_event_reg_fd, clixon_event_reg_fd_write
  */
-int
-clixon_event_reg_fd(int   fd, 
-		    int (*fn)(int, void*), 
-		    void *arg, 
-		    char *str)
+static int
+event_reg_fd(int   fd, 
+	     int (*fn)(int, void*), 
+	     void *arg, 
+	     char *str,
+	     int   type)
 {
     struct event_data *e;
 
@@ -189,30 +181,27 @@ clixon_event_reg_fd(int   fd,
     e->e_fd = fd;
     e->e_fn = fn;
     e->e_arg = arg;
-    e->e_type = EVENT_FD;
+    e->e_type = type;
     e->e_next = ee;
     ee = e;
     clicon_debug(2, "%s, registering %s", __FUNCTION__, e->e_string);
     return 0;
 }
 
-/*! Deregister a file descriptor callback
- * @param[in]  s   File descriptor
- * @param[in]  fn  Function to call when input available on fd
- * Note: deregister when exactly function and socket match, not argument
- * @see clixon_event_reg_fd
- * @see clixon_event_unreg_timeout
+/*! Deregister a file descriptor callback of a given type
+ * @see clixon_event_unreg_fd, clixon_event_unreg_fd_write
  */
-int
-clixon_event_unreg_fd(int   s, 
-		      int (*fn)(int, void*))
+static int
+event_unreg_fd(int   s, 
+	       int (*fn)(int, void*),
+	       int   type)
 {
     struct event_data *e, **e_prev;
     int found = 0;
 
     e_prev = &ee;
     for (e = ee; e; e = e->e_next){
-	if (fn == e->e_fn && s == e->e_fd) {
+	if (fn == e->e_fn && s == e->e_fd && type == e->e_type) {
 	    found++;
 	    *e_prev = e->e_next;
 	    _ee_unreg++;
@@ -224,6 +213,74 @@ clixon_event_unreg_fd(int   s,
     return found?0:-1;
 }
 
+/*! Register a callback function to be called on input on a file descriptor.
+ *
+ * @param[in]  fd  File descriptor
+ * @param[in]  fn  Function to call when input available on fd
+ * @param[in]  arg Argument to function fn
+ * @param[in]  str Describing string for logging
+ * @code
+ * int fn(int fd, void *arg){
+ * }
+ * clixon_event_reg_fd(fd, fn, (void*)42, "call fn on input on fd");
+ * @endcode 
+ */
+int
+clixon_event_reg_fd(int   fd, 
+		    int (*fn)(int, void*), 
+		    void *arg, 
+		    char *str)
+{
+    return event_reg_fd(fd, fn, arg, str, EVENT_FD);
+}
+
+/*! Deregister a file descriptor callback
+ * @param[in]  s   File descriptor
+ * @param[in]  fn  Function to call when input available on fd
+ * Note: deregister when exactly function and socket match, not argument
+ * @see clixon_event_reg_fd
+ * @see clixon_event_unreg_timeout
+ */
+int
+clixon_event_unreg_fd(int   s, 
+		      int (*fn)(int, void*))
+{
+    return event_unreg_fd(s, fn, EVENT_FD);
+}
+
+/*! Register a callback function to be called when a file descriptor is writable
+ *
+ * Typically used for non-blocking sockets where a write returned EAGAIN: the
+ * remaining output is queued and written by fn when the socket is ready.
+ * The callback is called as long as the fd is writable, so deregister it when
+ * there is nothing more to write.
+ * @param[in]  fd  File descriptor
+ * @param[in]  fn  Function to call when fd is writable
+ * @param[in]  arg Argument to function fn
+ * @param[in]  str Describing string for logging
+ * @see clixon_event_unreg_fd_write
+ */
+int
+clixon_event_reg_fd_write(int   fd, 
+			  int (*fn)(int, void*), 
+			  void *arg, 
+			  char *str)
+{
+    return event_reg_fd(fd, fn, arg, str, EVENT_FD_WRITE);
+}
+
+/*! Deregister a file descriptor write callback
+ * @param[in]  s   File descriptor
+ * @param[in]  fn  Function to call when fd is writable
+ * @see clixon_event_reg_fd_write
+ */
+int
+clixon_event_unreg_fd_write(int   s, 
+			    int (*fn)(int, void*))
+{
+    return event_unreg_fd(s, fn, EVENT_FD_WRITE);
+}
+
 /*! Call a callback function at an absolute time
  * @param[in]  t   Absolute (not relative!) timestamp when callback is called
  * @param[in]  fn  Function to call at time t
@@ -343,10 +400,12 @@ clixon_event_loop(clicon_handle h)
     struct timeval     t0;
     struct timeval     tnull = {0,};
     fd_set             fdset;
+    fd_set             wrset;
     int                retval = -1;
 
     while (clixon_exit_get() != 1){
 	FD_ZERO(&fdset);
+	FD_ZERO(&wrset);
 	if (clicon_sig_child_get()){
 	    /* Go through processes and wait for child processes */
 	    if (clixon_process_waitpid(h) < 0)
@@ -356,16 +415,18 @@ clixon_event_loop(clicon_handle h)
 	for (e=ee; e; e=e->e_next)
 	    if (e->e_type == EVENT_FD)
 		FD_SET(e->e_fd, &fdset);
+	    else if (e->e_type == EVENT_FD_WRITE)
+		FD_SET(e->e_fd, &wrset);
 	if (ee_timers != NULL){
 	    gettimeofday(&t0, NULL);
 	    timersub(&ee_timers->e_time, &t0, &t); 
 	    if (t.tv_sec < 0)
-		n = select(FD_SETSIZE, &fdset, NULL, NULL, &tnull); 
+		n = select(FD_SETSIZE, &fdset, &wrset, NULL, &tnull); 
 	    else
-		n = select(FD_SETSIZE, &fdset, NULL, NULL, &t); 
+		n = select(FD_SETSIZE, &fdset, &wrset, NULL, &t); 
 	}
 	else
-	    n = select(FD_SETSIZE, &fdset, NULL, NULL, NULL);
+	    n = select(FD_SETSIZE, &fdset, &wrset, NULL, NULL);
 	if (clixon_exit_get() == 1){
 	    break;
 	}
@@ -420,7 +481,8 @@ clixon_event_loop(clicon_handle h)
 		break;
 	    }
 	    e_next = e->e_next;
-	    if(e->e_type == EVENT_FD && FD_ISSET(e->e_fd, &fdset)){
+	    if ((e->e_type == EVENT_FD && FD_ISSET(e->e_fd, &fdset)) ||
+		(e->e_type == EVENT_FD_WRITE && FD_ISSET(e->e_fd, &wrset))){
 		clicon_debug(2, "%s: FD_ISSET: %s", __FUNCTION__, e->e_string);
 		if ((*e->e_fn)(e->e_fd, e->e_arg) < 0){
 		    clicon_debug(1, "%s Error in: %s", __FUNCTION__, e->e_string);
@@ -37,10 +37,19 @@
 
 
 /*
- * A simple implementation of a associative array style data store. Keys
+ * An implementation of a associative array style data store. Keys
  * are always strings while values can be some arbitrary data referenced
  * by void*.
  *
+ * The table uses open addressing with linear probing over a power-of-two
+ * slot array that is grown (and shrunk) automatically, so it scales from a
+ * handful of options to millions of application index entries. Keys are
+ * hashed with SipHash-1-3 using a per-process random key, which gives a good
+ * distribution also for anagram-like keys and makes collisions hard to
+ * provoke from external input (eg http headers).
+ * Deletion uses backward shift instead of tombstones, so probe sequences
+ * never degrade over time.
+ *
  * XXX: functions such as hash_keys(), hash_value() etc are currently returning
  * pointers to the actual data storage. Should probably make copies.
  *
@@ -48,34 +57,20 @@
  *
  *  int main()
  *  {
- *    char **s;
  *    int n;
- *    size_t slen;
- *    clicon_hash_t *hash = hash_init();
+ *    clicon_hash_t *hash = clicon_hash_init();
+ *    clicon_hash_t  h = NULL;
  *
  *    n = 234;
- *    hash_add(hash, "APA", &n, sizeof(n));
- *    hash_dump(hash, stdout);
- *
- *    puts("----");
- *
- *    hash_add(hash, "BEPA", "hoppla Polle!", strlen("hoppla Polle!")+1);
- *    puts((char *)hash_value(hash, "BEPA", NULL));
- *    hash_dump(hash, stdout);
- *    
- *    puts("----");
- *
- *    n = 33;
- *    hash_add(hash, "CEPA", &n, sizeof(n));
- *    hash_dump(hash, stdout);
+ *    clicon_hash_add(hash, "APA", &n, sizeof(n));
+ *    clicon_hash_add(hash, "BEPA", "hoppla Polle!", strlen("hoppla Polle!")+1);
+ *    puts((char *)clicon_hash_value(hash, "BEPA", NULL));
  *
- *    puts("----");
- *    
- *    hash_del(hash, "APA");
- *    hash_dump(hash, stdout);
- *
- *    hash_free(hash);
+ *    while ((h = clicon_hash_next(hash, h)) != NULL)
+ *       printf("%s\n", h->h_key);
  *
+ *    clicon_hash_del(hash, "APA");
+ *    clicon_hash_free(hash);
  *    return 0;
  * }
  */
@@ -88,6 +83,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
 #include <inttypes.h>
 
 /* cligen */
@@ -98,38 +96,191 @@
 #include "clixon_err.h"
 #include "clixon_hash.h"
 
-#define HASH_SIZE	1031	/* Number of hash buckets. Should be a prime */ 
+#define HASH_SIZE_MIN	16	/* Initial number of slots. Must be a power of two */
 #define align4(s) (((s)/4)*4 + 4)
 
-/*! A very simplistic algorithm to calculate a hash bucket index
+/*! Hash table slot, the hash value is cached to avoid key compares when probing
+ */
+struct hash_slot {
+    uint64_t      hs_hash;
+    clicon_hash_t hs_entry;  /* NULL if slot is empty */
+};
+
+/*! Hash table. Handed out to callers as an opaque clicon_hash_t *
+ * Opaque so that the slot array can be re-allocated on resize without
+ * invalidating the caller's reference.
+ */
+struct hash_table {
+    struct hash_slot *ht_slots;
+    size_t            ht_size;   /* Number of slots, power of two */
+    size_t            ht_len;    /* Number of entries */
+};
+
+/* SipHash key, initialized once per process */
+static uint64_t _hash_k0 = 0;
+static uint64_t _hash_k1 = 0;
+static int      _hash_seeded = 0;
+
+/*! Get random SipHash key, fallback to time and pid if no urandom
  */
-static uint32_t
-hash_bucket(const char *str)
+static void
+hash_seed(void)
 {
-    uint32_t n = 0;
+    int      fd;
+    uint64_t k[2] = {0, 0};
 
-    while(*str)
-	n += (uint32_t)*str++;
-    return n % HASH_SIZE;
+    if ((fd = open("/dev/urandom", O_RDONLY)) >= 0){
+	if (read(fd, k, sizeof(k)) != sizeof(k))
+	    k[0] = k[1] = 0;
+	close(fd);
+    }
+    if (k[0] == 0 && k[1] == 0){
+	k[0] = (uint64_t)time(NULL) ^ ((uint64_t)getpid() << 32);
+	k[1] = (uint64_t)(uintptr_t)&k ^ 0x736f6d6570736575ULL;
+    }
+    _hash_k0 = k[0];
+    _hash_k1 = k[1];
+    _hash_seeded++;
+}
+
+#define ROTL64(x, b) (uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
+
+#define SIPROUND				\
+    do {					\
+	v0 += v1; v1 = ROTL64(v1, 13);		\
+	v1 ^= v0; v0 = ROTL64(v0, 32);		\
+	v2 += v3; v3 = ROTL64(v3, 16);		\
+	v3 ^= v2;				\
+	v0 += v3; v3 = ROTL64(v3, 21);		\
+	v3 ^= v0;				\
+	v2 += v1; v1 = ROTL64(v1, 17);		\
+	v1 ^= v2; v2 = ROTL64(v2, 32);		\
+    } while (0)
+
+/*! Compute SipHash-1-3 of a string key
+ * @param[in]  str  Null-terminated key
+ * @param[out] len  Length of key (strlen)
+ * @retval     hash 64-bit hash value
+ */
+static uint64_t
+hash_key(const char *str,
+	 size_t     *len)
+{
+    const uint8_t *p = (const uint8_t *)str;
+    size_t         n;
+    size_t         i;
+    int            j;
+    uint64_t       v0 = _hash_k0 ^ 0x736f6d6570736575ULL;
+    uint64_t       v1 = _hash_k1 ^ 0x646f72616e646f6dULL;
+    uint64_t       v2 = _hash_k0 ^ 0x6c7967656e657261ULL;
+    uint64_t       v3 = _hash_k1 ^ 0x7465646279746573ULL;
+    uint64_t       m;
+
+    n = strlen(str);
+    *len = n;
+    for (i = 0; i + 8 <= n; i += 8){
+	m = 0;
+	for (j = 7; j >= 0; j--)
+	    m = (m << 8) | p[i+j];
+	v3 ^= m;
+	SIPROUND;
+	v0 ^= m;
+    }
+    m = (uint64_t)n << 56;
+    for (j = (int)(n - i) - 1; j >= 0; j--)
+	m |= (uint64_t)p[i+j] << (8*j);
+    v3 ^= m;
+    SIPROUND;
+    v0 ^= m;
+    v2 ^= 0xff;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+/*! Find slot of key, either the slot holding it or the empty slot ending the probe
+ * @param[in]  ht    Hash table
+ * @param[in]  key   Key
+ * @param[in]  hv    Hash value of key
+ * @retval     i     Slot index
+ */
+static size_t
+hash_slot_find(struct hash_table *ht,
+	       const char        *key,
+	       uint64_t           hv)
+{
+    size_t            mask = ht->ht_size - 1;
+    size_t            i;
+    struct hash_slot *hs;
+
+    i = hv & mask;
+    while ((hs = &ht->ht_slots[i])->hs_entry != NULL){
+	if (hs->hs_hash == hv && strcmp(hs->hs_entry->h_key, key) == 0)
+	    break;
+	i = (i + 1) & mask;
+    }
+    return i;
+}
+
+/*! Re-allocate slot array and re-insert all entries
+ * @param[in]  ht    Hash table
+ * @param[in]  size  New number of slots, power of two and larger than number of entries
+ * @retval     0     OK
+ * @retval    -1     Error
+ */
+static int
+hash_resize(struct hash_table *ht,
+	    size_t             size)
+{
+    struct hash_slot *old = ht->ht_slots;
+    size_t            osize = ht->ht_size;
+    size_t            i;
+    size_t            j;
+
+    if ((ht->ht_slots = calloc(size, sizeof(struct hash_slot))) == NULL){
+	clicon_err(OE_UNIX, errno, "calloc");
+	ht->ht_slots = old;
+	return -1;
+    }
+    ht->ht_size = size;
+    for (i = 0; i < osize; i++){
+	if (old[i].hs_entry == NULL)
+	    continue;
+	j = old[i].hs_hash & (size - 1);
+	while (ht->ht_slots[j].hs_entry != NULL)
+	    j = (j + 1) & (size - 1);
+	ht->ht_slots[j] = old[i];
+    }
+    free(old);
+    return 0;
 }
 
 /*! Initialize hash table.
  *
  * @retval  hash  Pointer to new hash table.
  * @retval  NULL  Error
- * @see hash_free  For freeing the hash-table
+ * @see clicon_hash_free  For freeing the hash-table
  */
 clicon_hash_t *
 clicon_hash_init(void)
 {
-  clicon_hash_t *hash;
-
-  if ((hash = (clicon_hash_t *)malloc(sizeof(clicon_hash_t) * HASH_SIZE)) == NULL){
-      clicon_err(OE_UNIX, errno, "malloc");
-      return NULL;
-  }
-  memset(hash, 0, sizeof(clicon_hash_t)*HASH_SIZE);
-  return hash;
+    struct hash_table *ht;
+
+    if (!_hash_seeded)
+	hash_seed();
+    if ((ht = malloc(sizeof(*ht))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	return NULL;
+    }
+    memset(ht, 0, sizeof(*ht));
+    if ((ht->ht_slots = calloc(HASH_SIZE_MIN, sizeof(struct hash_slot))) == NULL){
+	clicon_err(OE_UNIX, errno, "calloc");
+	free(ht);
+	return NULL;
+    }
+    ht->ht_size = HASH_SIZE_MIN;
+    return (clicon_hash_t *)ht;
 }
 
 /*! Free hash table.
@@ -141,18 +292,21 @@ clicon_hash_init(void)
 int
 clicon_hash_free(clicon_hash_t *hash)
 {
-    int i;
-    clicon_hash_t tmp;
-    for (i = 0; i < HASH_SIZE; i++) {
-	while (hash[i]) {
-	    tmp = hash[i];
-	    DELQ(tmp, hash[i], clicon_hash_t);
-	    free(tmp->h_key);
-	    free(tmp->h_val);
-	    free(tmp);
-	}
+    struct hash_table *ht = (struct hash_table *)hash;
+    clicon_hash_t      h;
+    size_t             i;
+
+    if (ht == NULL)
+	return 0;
+    for (i = 0; i < ht->ht_size; i++) {
+	if ((h = ht->ht_slots[i].hs_entry) == NULL)
+	    continue;
+	if (h->h_val)
+	    free(h->h_val);
+	free(h); /* key is allocated together with entry */
     }
-    free(hash);
+    free(ht->ht_slots);
+    free(ht);
     return 0;
 }
 
@@ -167,19 +321,10 @@ clicon_hash_t
 clicon_hash_lookup(clicon_hash_t *hash, 
 		   const char    *key)
 {
-    uint32_t      bkt;
-    clicon_hash_t h;
+    struct hash_table *ht = (struct hash_table *)hash;
+    size_t             len;
 
-    bkt = hash_bucket(key);
-    h = hash[bkt];
-    if (h) {
-	do {
-	    if (!strcmp(h->h_key, key))
-		return h;
-	    h = NEXTQ(clicon_hash_t, h);
-	} while (h != hash[bkt]);
-    }
-    return NULL;
+    return ht->ht_slots[hash_slot_find(ht, key, hash_key(key, &len))].hs_entry;
 }
 
 /*! Get value of hash
@@ -218,6 +363,8 @@ clicon_hash_value(clicon_hash_t *hash,
  * @retval    hash   New hash structure on success
  * @retval    NULL   Error
  * @note special case val is NULL and vlen==0
+ * @note Adding a new key may move other entries in the table, do not add while
+ *       iterating with clicon_hash_next
  */
 clicon_hash_t
 clicon_hash_add(clicon_hash_t *hash, 
@@ -225,9 +372,12 @@ clicon_hash_add(clicon_hash_t *hash,
 		void          *val, 
 		size_t         vlen)
 {
-    void         *newval = NULL;
-    clicon_hash_t h;
-    clicon_hash_t new = NULL;
+    struct hash_table *ht = (struct hash_table *)hash;
+    void              *newval = NULL;
+    clicon_hash_t      h;
+    uint64_t           hv;
+    size_t             len;
+    size_t             i;
     
     if (hash == NULL){
 	clicon_err(OE_UNIX, EINVAL, "hash is NULL");
@@ -237,55 +387,48 @@ clicon_hash_add(clicon_hash_t *hash,
     if ((val == NULL && vlen != 0) ||
 	(val != NULL && vlen == 0)){
 	clicon_err(OE_UNIX, EINVAL, "Mismatch in value and length, only one is zero");
-	goto catch;
-    }
-    /* If variable exist, don't allocate a new. just replace value */
-    h = clicon_hash_lookup(hash, key);
-    if (h == NULL) {
-	if ((new = (clicon_hash_t)malloc(sizeof(*new))) == NULL){
-	    clicon_err(OE_UNIX, errno, "malloc");
-	    goto catch;
-	}
-	memset(new, 0, sizeof(*new));
-	
-	new->h_key = strdup(key);
-	if (new->h_key == NULL){
-	    clicon_err(OE_UNIX, errno, "strdup");
-	    goto catch;
-	}
-	
-	h = new;
+	return NULL;
     }
-    
     if (vlen){
 	/* Make copy of value. aligned */
 	newval = malloc(align4(vlen+3)); 
 	if (newval == NULL){
 	    clicon_err(OE_UNIX, errno, "malloc");
-	    goto catch;
+	    return NULL;
 	}
 	memcpy(newval, val, vlen);
     }
-    
+    hv = hash_key(key, &len);
+    i = hash_slot_find(ht, key, hv);
+    /* If variable exist, don't allocate a new. just replace value */
+    if ((h = ht->ht_slots[i].hs_entry) == NULL){
+	/* Keep load factor below 3/4 */
+	if ((ht->ht_len + 1) * 4 > ht->ht_size * 3){
+	    if (hash_resize(ht, ht->ht_size * 2) < 0)
+		goto catch;
+	    i = hash_slot_find(ht, key, hv);
+	}
+	/* Key is allocated together with the entry */
+	if ((h = malloc(sizeof(*h) + len + 1)) == NULL){
+	    clicon_err(OE_UNIX, errno, "malloc");
+	    goto catch;
+	}
+	memset(h, 0, sizeof(*h));
+	h->h_key = (char *)(h + 1);
+	memcpy(h->h_key, key, len + 1);
+	ht->ht_slots[i].hs_hash = hv;
+	ht->ht_slots[i].hs_entry = h;
+	ht->ht_len++;
+    }
     /* Free old value if existing variable */
-    if (h->h_val)
+    else if (h->h_val)
 	free(h->h_val);
     h->h_val = newval;
     h->h_vlen =  vlen;
-
-    /* Add to list only if new variable */
-    if (new)
-	INSQ(h, hash[hash_bucket(key)]);
-
     return h;
-
 catch:
-    if (new) {
-	if (new->h_key)
-	    free(new->h_key);
-	free(new);
-    }
-
+    if (newval)
+	free(newval);
     return NULL;
 }
 
@@ -301,25 +444,100 @@ int
 clicon_hash_del(clicon_hash_t *hash, 
 		const char    *key)
 {
-    clicon_hash_t h;
+    struct hash_table *ht = (struct hash_table *)hash;
+    clicon_hash_t      h;
+    size_t             mask;
+    size_t             len;
+    size_t             i;
+    size_t             j;
+    size_t             k;
 
     if (hash == NULL){
 	clicon_err(OE_UNIX, EINVAL, "hash is NULL");
 	return -1;
     }
-    h = clicon_hash_lookup(hash, key);
-    if (h == NULL)
+    i = hash_slot_find(ht, key, hash_key(key, &len));
+    if ((h = ht->ht_slots[i].hs_entry) == NULL)
 	return -1;
-    
-    DELQ(h, hash[hash_bucket(key)], clicon_hash_t);
-  
-    free(h->h_key);
-    free(h->h_val);
+    if (h->h_val)
+	free(h->h_val);
     free(h);
-
+    ht->ht_len--;
+    /* Backward shift: move following entries of the probe sequence into the hole */
+    mask = ht->ht_size - 1;
+    j = i;
+    while (1){
+	ht->ht_slots[i].hs_entry = NULL;
+	while (1){
+	    j = (j + 1) & mask;
+	    if (ht->ht_slots[j].hs_entry == NULL)
+		goto shrink;
+	    k = ht->ht_slots[j].hs_hash & mask; /* home slot of entry at j */
+	    /* Move unless home slot is cyclically in (i, j] */
+	    if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+		continue;
+	    break;
+	}
+	ht->ht_slots[i] = ht->ht_slots[j];
+	i = j;
+    }
+ shrink:
+    /* Release memory when the table has become sparse */
+    if (ht->ht_size > HASH_SIZE_MIN && ht->ht_len * 8 < ht->ht_size)
+	(void)hash_resize(ht, ht->ht_size / 2); /* failure is harmless */
     return 0;
 }
 
+/*! Iterate through hash entries without allocating
+ *
+ * @param[in] hash   Hash table
+ * @param[in] hprev  Previous entry, or NULL on init
+ * @retval    h      Next entry
+ * @retval    NULL   No more entries
+ * @code
+ *   clicon_hash_t h = NULL;
+ *   while ((h = clicon_hash_next(hash, h)) != NULL)
+ *      printf("%s\n", h->h_key);
+ * @endcode
+ * @note The table must not be modified (add or delete) while iterating, 
+ *       except for changing values of existing keys with clicon_hash_add
+ * @note Order of entries is arbitrary and may differ between runs
+ */
+clicon_hash_t
+clicon_hash_next(clicon_hash_t *hash,
+		 clicon_hash_t  hprev)
+{
+    struct hash_table *ht = (struct hash_table *)hash;
+    size_t             i = 0;
+    size_t             len;
+
+    if (ht == NULL)
+	return NULL;
+    if (hprev != NULL){
+	i = hash_slot_find(ht, hprev->h_key, hash_key(hprev->h_key, &len));
+	if (ht->ht_slots[i].hs_entry != hprev)
+	    return NULL; /* table modified */
+	i++;
+    }
+    for (; i < ht->ht_size; i++)
+	if (ht->ht_slots[i].hs_entry != NULL)
+	    return ht->ht_slots[i].hs_entry;
+    return NULL;
+}
+
+/*! Return number of entries in hash table
+ *
+ * @param[in] hash  Hash table
+ * @retval    n     Number of entries
+ */
+size_t
+clicon_hash_len(clicon_hash_t *hash)
+{
+    struct hash_table *ht = (struct hash_table *)hash;
+
+    return ht ? ht->ht_len : 0;
+}
+
 /*! Return vector of keys in hash table
  *
  * @param[in]   hash  	Hash table
@@ -328,48 +546,36 @@ clicon_hash_del(clicon_hash_t *hash,
  * @retval      0       OK
  * @retval     -1       Error
  * @note: vector needs to be deallocated with free
+ * @see clicon_hash_next  For iterating without allocating a vector
  */
 int
 clicon_hash_keys(clicon_hash_t *hash, 
 		 char        ***vector,
 		 size_t        *nkeys)
 {
-    int           retval = -1;
-    int           bkt;
-    clicon_hash_t h;
-    char        **tmp;
-    char        **keys = NULL;
+    struct hash_table *ht = (struct hash_table *)hash;
+    size_t             i;
+    char             **keys = NULL;
 
     if (hash == NULL){
 	clicon_err(OE_UNIX, EINVAL, "hash is NULL");
 	return -1;
     }
     *nkeys = 0;
-    for (bkt = 0; bkt < HASH_SIZE; bkt++) {
-	h = hash[bkt];
-	do {
-	    if (h == NULL)
-		break;
-	    tmp = realloc(keys, ((*nkeys)+1) * sizeof(char *));
-	    if (tmp == NULL){
-		clicon_err(OE_UNIX, errno, "realloc");
-		goto catch;
-	    }
-	    keys = tmp;
-	    keys[*nkeys] = h->h_key;
-	    (*nkeys)++;
-	    h = NEXTQ(clicon_hash_t, h);
-	} while (h != hash[bkt]);
+    if (ht->ht_len){
+	if ((keys = malloc(ht->ht_len * sizeof(char *))) == NULL){
+	    clicon_err(OE_UNIX, errno, "malloc");
+	    return -1;
+	}
+	for (i = 0; i < ht->ht_size; i++)
+	    if (ht->ht_slots[i].hs_entry)
+		keys[(*nkeys)++] = ht->ht_slots[i].hs_entry->h_key;
     }
-    if (vector){
+    if (vector)
 	*vector = keys;
-	keys = NULL;
-    }
-    retval = 0;
-catch:
-    if (keys)
+    else if (keys)
 	free(keys);
-    return retval;
+    return 0;
 }
 
 /*! Dump contents of hash to FILE pointer.
@@ -383,26 +589,9 @@ int
 clicon_hash_dump(clicon_hash_t *hash, 
 		 FILE          *f)
 {
-    int    retval = -1;
-    int    i;
-    char **keys = NULL;
-    void  *val;
-    size_t klen;
-    size_t vlen;
+    clicon_hash_t h = NULL;
     
-    if (hash == NULL)
-	goto ok;
-    if (clicon_hash_keys(hash, &keys, &klen) < 0)
-	goto done;
-    for(i = 0; i < klen; i++) {
-	val = clicon_hash_value(hash, keys[i], &vlen);
-	printf("%s =\t 0x%p , length %zu\n", keys[i], val, vlen);
-    }
-
- ok:
-    retval = 0;
- done:
-    if (keys)
-	free(keys);
-    return retval;
+    while ((h = clicon_hash_next(hash, h)) != NULL)
+	fprintf(f, "%s =\t 0x%p , length %zu\n", h->h_key, h->h_val, h->h_vlen);
+    return 0;
 }
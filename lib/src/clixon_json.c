@@ -662,72 +662,40 @@ nullchild(cbuf      *cb,
     return retval;
 }
 
-/*! Do the actual work of translating XML to JSON 
- * @param[out]   cb        Cligen text buffer containing json on exit
- * @param[in]    x         XML tree structure containing XML to translate
- * @param[in]    yp        Parent yang spec needed for body
- * @param[in]    arraytype Does x occur in a array (of its parent) and how?
- * @param[in]    level     Indentation level
- * @param[in]    pretty    Pretty-print output (2 means debug)
- * @param[in]    flat      Dont print NO_ARRAY object name (for _vec call)
- * @param[in]    bodystr   Set if value is string, 0 otherwise. Only if body
- *
- * @note Does not work with XML attributes
- * The following matrix explains how the mapping is done.
- * You need to understand what arraytype means (no/first/middle/last)
- * and what childtype is (null,body,any)
-  +----------+--------------+--------------+--------------+
-  |array,leaf| null         | body         | any          |
-  +----------+--------------+--------------+--------------+
-  |no        | <a/>         |<a>1</a>      |<a><b/></a>   |
-  |          |              |              |              |
-  |  json:   |\ta:null      |\ta:          |\ta:{\n       |
-  |          |              |              |\n}           |
-  +----------+--------------+--------------+--------------+
-  |first     |<a/><a..      |<a>1</a><a..  |<a><b/></a><a.|
-  |          |              |              |              |
-  |  json:   |\ta:[\n\tnull |\ta:[\n\t     |\ta:[\n\t{\n  |
-  |          |              |              |\n\t}         |
-  +----------+--------------+--------------+--------------+
-  |middle    |..a><a/><a..  |.a><a>1</a><a.|              |
-  |          |              |              |              |
-  |  json:   |\tnull        |\t            |\t{a          |
-  |          |              |              |\n\t}         |
-  +----------+--------------+--------------+--------------+
-  |last      |..a></a>      |..a><a>1</a>  |              |
-  |          |              |              |              |
-  |  json:   |\tnull        |\t            |\t{a          |
-  |          |\n\t]         |\n\t]         |\n\t}\t]      |
-  +----------+--------------+--------------+--------------+
+/*! Print the beginning of a JSON object, ie name and opening brackets
+ * @param[out]    cb        Cligen text buffer
+ * @param[in]     x         XML tree structure containing XML to translate
+ * @param[in]     arraytype Does x occur in a array (of its parent) and how?
+ * @param[in,out] level     Indentation level, in: of x, out: of children of x
+ * @param[in]     pretty    Pretty-print output (2 means debug)
+ * @param[in]     flat      Dont print NO_ARRAY object name (for _vec call)
+ * @param[in,out] modname0  Ancestor module name, out: module name passed to children
+ * @see xml2json1_cbuf
  */
-static int 
-xml2json1_cbuf(cbuf                   *cb,
-	       cxobj                  *x,
-	       enum array_element_type arraytype,
-	       int                     level,
-	       int                     pretty,
-	       int                     flat,
-	       char                   *modname0)
+static int
+xml2json1_pre(cbuf                   *cb,
+	      cxobj                  *x,
+	      enum array_element_type arraytype,
+	      int                    *level,
+	      int                     pretty,
+	      int                     flat,
+	      char                  **modname0)
 {
     int              retval = -1;
-    int              i;
-    cxobj           *xc;
     cxobj           *xp;
     enum childtype   childt;
-    enum array_element_type xc_arraytype;
     yang_stmt       *ys;
     yang_stmt       *ymod = NULL; /* yang module */
-    int              commas;
     char            *modname = NULL;
 
     if ((ys = xml_spec(x)) != NULL){
 	if (ys_real_module(ys, &ymod) < 0)
 	    goto done;
 	modname = yang_argument_get(ymod);
-	if (modname0 && strcmp(modname, modname0) == 0)
+	if (*modname0 && strcmp(modname, *modname0) == 0)
 	    modname=NULL;
 	else
-	    modname0 = modname; /* modname0 is ancestor ns passed to child */
+	    *modname0 = modname; /* modname0 is ancestor ns passed to child */
     }
     childt = child_type(x);
     if (pretty==2)
@@ -742,7 +710,7 @@ xml2json1_cbuf(cbuf                   *cb,
 	break;
     case NO_ARRAY:
 	if (!flat){
-	    cprintf(cb, "%*s\"", pretty?(level*JSON_INDENT):0, "");
+	    cprintf(cb, "%*s\"", pretty?(*level*JSON_INDENT):0, "");
 	    if (modname) 
 		cprintf(cb, "%s:", modname);
 	    cprintf(cb, "%s\":%s", xml_name(x), pretty?" ":"");
@@ -763,14 +731,14 @@ xml2json1_cbuf(cbuf                   *cb,
 	break;
     case FIRST_ARRAY:
     case SINGLE_ARRAY:
-	cprintf(cb, "%*s\"", pretty?(level*JSON_INDENT):0, "");
+	cprintf(cb, "%*s\"", pretty?(*level*JSON_INDENT):0, "");
 	if (modname)
 	    cprintf(cb, "%s:", modname);
 	cprintf(cb, "%s\":%s", xml_name(x), pretty?" ":"");
-	level++;
+	(*level)++;
 	cprintf(cb, "[%s%*s", 
 		pretty?"\n":"",
-		pretty?(level*JSON_INDENT):0, "");
+		pretty?(*level*JSON_INDENT):0, "");
 	switch (childt){
 	case NULL_CHILD:
 	    if (nullchild(cb, x, ys) < 0)
@@ -787,9 +755,9 @@ xml2json1_cbuf(cbuf                   *cb,
 	break;
     case MIDDLE_ARRAY:
     case LAST_ARRAY:
-	level++;
+	(*level)++;
 	cprintf(cb, "%*s", 
-		pretty?(level*JSON_INDENT):0, "");
+		pretty?(*level*JSON_INDENT):0, "");
 	switch (childt){
 	case NULL_CHILD:
 	    if (nullchild(cb, x, ys) < 0)
@@ -807,29 +775,29 @@ xml2json1_cbuf(cbuf                   *cb,
     default:
 	break;
     }
-    /* Check for typed sub-body if:
-     * arraytype=* but child-type is BODY_CHILD 
-     * This is code for writing <a>42</a> as "a":42 and not "a":"42"
-     */
-    commas = xml_child_nr_notype(x, CX_ATTR) - 1;
-    for (i=0; i<xml_child_nr(x); i++){
-	xc = xml_child_i(x, i);
-	if (xml_type(xc) == CX_ATTR)
-	    continue; /* XXX Only xmlns attributes mapped */
+    retval = 0;
+ done:
+    return retval;
+}
 
-	xc_arraytype = array_eval(i?xml_child_i(x,i-1):NULL, 
-				xc, 
-				xml_child_i(x, i+1));
-	if (xml2json1_cbuf(cb, 
-			   xc, 
-			   xc_arraytype,
-			   level+1, pretty, 0, modname0) < 0)
-	    goto done;
-	if (commas > 0) {
-	    cprintf(cb, ",%s", pretty?"\n":"");
-	    --commas;
-	}
-    }
+/*! Print the end of a JSON object, ie closing brackets
+ * @param[out]   cb        Cligen text buffer
+ * @param[in]    x         XML tree structure containing XML to translate
+ * @param[in]    arraytype Does x occur in a array (of its parent) and how?
+ * @param[in]    level     Indentation level as returned by xml2json1_pre
+ * @param[in]    pretty    Pretty-print output (2 means debug)
+ * @see xml2json1_cbuf
+ */
+static int
+xml2json1_post(cbuf                   *cb,
+	       cxobj                  *x,
+	       enum array_element_type arraytype,
+	       int                     level,
+	       int                     pretty)
+{
+    enum childtype childt;
+
+    childt = child_type(x);
     switch (arraytype){
     case BODY_ARRAY:
 	break;
@@ -846,7 +814,6 @@ xml2json1_cbuf(cbuf                   *cb,
 	default:
 	    break;
 	}
-	level--;
 	break;
     case FIRST_ARRAY:
     case MIDDLE_ARRAY:
@@ -858,7 +825,6 @@ xml2json1_cbuf(cbuf                   *cb,
 	    cprintf(cb, "%s%*s}", 
 		    pretty?"\n":"",
 		    pretty?(level*JSON_INDENT):0, "");
-	    level--;
 	    break;
 	default:
 	    break;
@@ -887,6 +853,90 @@ xml2json1_cbuf(cbuf                   *cb,
     default:
 	break;
     }
+    return 0;
+}
+
+/*! Do the actual work of translating XML to JSON 
+ * @param[out]   cb        Cligen text buffer containing json on exit
+ * @param[in]    x         XML tree structure containing XML to translate
+ * @param[in]    yp        Parent yang spec needed for body
+ * @param[in]    arraytype Does x occur in a array (of its parent) and how?
+ * @param[in]    level     Indentation level
+ * @param[in]    pretty    Pretty-print output (2 means debug)
+ * @param[in]    flat      Dont print NO_ARRAY object name (for _vec call)
+ * @param[in]    bodystr   Set if value is string, 0 otherwise. Only if body
+ *
+ * @note Does not work with XML attributes
+ * The following matrix explains how the mapping is done.
+ * You need to understand what arraytype means (no/first/middle/last)
+ * and what childtype is (null,body,any)
+  +----------+--------------+--------------+--------------+
+  |array,leaf| null         | body         | any          |
+  +----------+--------------+--------------+--------------+
+  |no        | <a/>         |<a>1</a>      |<a><b/></a>   |
+  |          |              |              |              |
+  |  json:   |\ta:null      |\ta:          |\ta:{\n       |
+  |          |              |              |\n}           |
+  +----------+--------------+--------------+--------------+
+  |first     |<a/><a..      |<a>1</a><a..  |<a><b/></a><a.|
+  |          |              |              |              |
+  |  json:   |\ta:[\n\tnull |\ta:[\n\t     |\ta:[\n\t{\n  |
+  |          |              |              |\n\t}         |
+  +----------+--------------+--------------+--------------+
+  |middle    |..a><a/><a..  |.a><a>1</a><a.|              |
+  |          |              |              |              |
+  |  json:   |\tnull        |\t            |\t{a          |
+  |          |              |              |\n\t}         |
+  +----------+--------------+--------------+--------------+
+  |last      |..a></a>      |..a><a>1</a>  |              |
+  |          |              |              |              |
+  |  json:   |\tnull        |\t            |\t{a          |
+  |          |\n\t]         |\n\t]         |\n\t}\t]      |
+  +----------+--------------+--------------+--------------+
+ * @see json_enc_next  Incremental variant
+ */
+static int
+xml2json1_cbuf(cbuf                   *cb,
+	       cxobj                  *x,
+	       enum array_element_type arraytype,
+	       int                     level,
+	       int                     pretty,
+	       int                     flat,
+	       char                   *modname0)
+{
+    int              retval = -1;
+    int              i;
+    cxobj           *xc;
+    enum array_element_type xc_arraytype;
+    int              commas;
+
+    if (xml2json1_pre(cb, x, arraytype, &level, pretty, flat, &modname0) < 0)
+	goto done;
+    /* Check for typed sub-body if:
+     * arraytype=* but child-type is BODY_CHILD 
+     * This is code for writing <a>42</a> as "a":42 and not "a":"42"
+     */
+    commas = xml_child_nr_notype(x, CX_ATTR) - 1;
+    for (i=0; i<xml_child_nr(x); i++){
+	xc = xml_child_i(x, i);
+	if (xml_type(xc) == CX_ATTR)
+	    continue; /* XXX Only xmlns attributes mapped */
+
+	xc_arraytype = array_eval(i?xml_child_i(x,i-1):NULL, 
+				xc, 
+				xml_child_i(x, i+1));
+	if (xml2json1_cbuf(cb, 
+			   xc, 
+			   xc_arraytype,
+			   level+1, pretty, 0, modname0) < 0)
+	    goto done;
+	if (commas > 0) {
+	    cprintf(cb, ",%s", pretty?"\n":"");
+	    --commas;
+	}
+    }
+    if (xml2json1_post(cb, x, arraytype, level, pretty) < 0)
+	goto done;
     retval = 0;
  done:
     return retval;
@@ -1008,6 +1058,207 @@ xml2json_cbuf_vec(cbuf      *cb,
     return retval;
 }
 
+/*
+ * Incremental JSON encoding
+ * Same output as xml2json_cbuf / xml2json_cbuf_vec but produced in pieces, so that
+ * a large tree can be sent without first rendering all of it into one buffer.
+ */
+
+/* One XML node being encoded, ie the state of one recursion level of xml2json1_cbuf */
+struct json_frame {
+    cxobj                  *jf_x;         /* XML node, NULL for the (virtual) root */
+    enum array_element_type jf_arraytype; /* Array type of node */
+    int                     jf_level;     /* Indentation level after xml2json1_pre */
+    char                   *jf_modname;   /* Module name passed to children */
+    int                     jf_i;         /* Index of next child */
+    int                     jf_n;         /* Number of children printed */
+};
+
+/* Incremental JSON encoder handle */
+struct json_enc {
+    cxobj             **je_vec;      /* Vector of XML nodes to encode (not owned) */
+    size_t              je_veclen;   /* Length of vector */
+    int                 je_pretty;   /* Pretty-print output */
+    int                 je_top;      /* Encode as xml2json_cbuf, else xml2json_cbuf_vec */
+    int                 je_started;  /* Opening brace printed */
+    struct json_frame  *je_frames;   /* Stack of frames, [0] is root */
+    int                 je_nframes;  /* Number of frames on stack */
+    int                 je_maxframes;/* Allocated frames */
+};
+
+/*! Create an incremental JSON encoder
+ * @param[in]  vec    Vector of XML nodes. Not copied, must be kept until encoder is freed
+ * @param[in]  veclen Length of vector
+ * @param[in]  pretty Set if output is pretty-printed
+ * @param[in]  top    If set, vec is one node encoded as xml2json_cbuf, else as xml2json_cbuf_vec
+ * @retval     je     Encoder handle, free with json_enc_free
+ * @retval     NULL   Error
+ * @code
+ *   json_enc *je;
+ *   if ((je = json_enc_new(vec, veclen, 0, 0)) == NULL)
+ *      goto done;
+ *   while ((ret = json_enc_next(je, cb, 16384)) > 0){
+ *      send(cb); cbuf_reset(cb);
+ *   }
+ *   json_enc_free(je);
+ * @endcode
+ */
+json_enc *
+json_enc_new(cxobj **vec,
+	     size_t  veclen,
+	     int     pretty,
+	     int     top)
+{
+    json_enc *je = NULL;
+
+    if (top && veclen != 1){
+	clicon_err(OE_XML, EINVAL, "top mode requires exactly one node");
+	return NULL;
+    }
+    if ((je = malloc(sizeof(*je))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	return NULL;
+    }
+    memset(je, 0, sizeof(*je));
+    je->je_vec = vec;
+    je->je_veclen = veclen;
+    je->je_pretty = pretty;
+    je->je_top = top;
+    return je;
+}
+
+/*! Free an incremental JSON encoder, the XML nodes are not freed
+ * @param[in]  je     JSON encoder
+ */
+int
+json_enc_free(json_enc *je)
+{
+    if (je->je_frames)
+	free(je->je_frames);
+    free(je);
+    return 0;
+}
+
+/*! Push a node on the encoder stack and print its beginning
+ * @param[in]  je        JSON encoder
+ * @param[out] cb        Cligen buffer to write to
+ * @param[in]  x         XML node
+ * @param[in]  arraytype Array type of x
+ * @param[in]  level     Indentation level of x
+ * @param[in]  modname   Ancestor module name
+ */
+static int
+json_enc_push(json_enc               *je,
+	      cbuf                   *cb,
+	      cxobj                  *x,
+	      enum array_element_type arraytype,
+	      int                     level,
+	      char                   *modname)
+{
+    struct json_frame *jf;
+
+    if (je->je_nframes == je->je_maxframes){
+	je->je_maxframes = je->je_maxframes ? 2*je->je_maxframes : 16;
+	if ((je->je_frames = realloc(je->je_frames,
+				     je->je_maxframes*sizeof(struct json_frame))) == NULL){
+	    clicon_err(OE_UNIX, errno, "realloc");
+	    return -1;
+	}
+    }
+    jf = &je->je_frames[je->je_nframes++];
+    memset(jf, 0, sizeof(*jf));
+    jf->jf_x = x;
+    jf->jf_arraytype = arraytype;
+    jf->jf_level = level;
+    jf->jf_modname = modname;
+    if (x != NULL &&
+	xml2json1_pre(cb, x, arraytype, &jf->jf_level, je->je_pretty, 0, &jf->jf_modname) < 0)
+	return -1;
+    return 0;
+}
+
+/*! Encode the next part of JSON output
+ * Appends to cb until its length reaches maxlen (or encoding is done). The output may
+ * exceed maxlen by the size of one leaf.
+ * @param[in]  je     JSON encoder
+ * @param[out] cb     Cligen buffer to append to
+ * @param[in]  maxlen Stop when cb is at least this long, 0 means encode all
+ * @retval     1      More output remains, call again
+ * @retval     0      Done, all output is written
+ * @retval    -1      Error
+ * @see xml2json1_cbuf  Recursive variant
+ */
+int
+json_enc_next(json_enc *je,
+	      cbuf     *cb,
+	      size_t    maxlen)
+{
+    int                     pretty = je->je_pretty;
+    struct json_frame      *jf;
+    cxobj                  *x;
+    cxobj                  *xc;
+    size_t                  i;
+    enum array_element_type arraytype;
+
+    if (!je->je_started){
+	je->je_started++;
+	if (!je->je_top && je->je_veclen == 0){
+	    cprintf(cb, "{}"); /* As nullchild with no yang */
+	    return 0;
+	}
+	cprintf(cb, "{%s", pretty?"\n":"");
+	if (json_enc_push(je, cb, NULL, NO_ARRAY, je->je_top?0:1, NULL) < 0)
+	    return -1;
+    }
+    while (je->je_nframes){
+	if (maxlen && cbuf_len(cb) >= maxlen)
+	    return 1;
+	jf = &je->je_frames[je->je_nframes-1];
+	if ((x = jf->jf_x) == NULL){ /* Root: children are the vector */
+	    if ((i = jf->jf_i) < je->je_veclen){
+		jf->jf_i++;
+		if (jf->jf_n++)
+		    cprintf(cb, ",%s", pretty?"\n":"");
+		if (je->je_top)
+		    arraytype = NO_ARRAY;
+		else
+		    arraytype = array_eval(i?je->je_vec[i-1]:NULL,
+					   je->je_vec[i],
+					   i+1<je->je_veclen?je->je_vec[i+1]:NULL);
+		if (json_enc_push(je, cb, je->je_vec[i], arraytype, jf->jf_level+1, NULL) < 0)
+		    return -1;
+		continue;
+	    }
+	    if (je->je_top)
+		cprintf(cb, "%s}%s", pretty?"\n":"", pretty?"\n":"");
+	    else
+		cprintf(cb, "%s%*s}", 
+			pretty?"\n":"",
+			pretty?(jf->jf_level*JSON_INDENT):0, "");
+	    je->je_nframes--;
+	    break;
+	}
+	/* Find next non-attribute child */
+	while ((xc = xml_child_i(x, jf->jf_i)) != NULL && xml_type(xc) == CX_ATTR)
+	    jf->jf_i++;
+	if (xc != NULL){
+	    i = jf->jf_i++;
+	    if (jf->jf_n++)
+		cprintf(cb, ",%s", pretty?"\n":"");
+	    arraytype = array_eval(i?xml_child_i(x, i-1):NULL, 
+				   xc, 
+				   xml_child_i(x, i+1));
+	    if (json_enc_push(je, cb, xc, arraytype, jf->jf_level+1, jf->jf_modname) < 0)
+		return -1;
+	    continue;
+	}
+	if (xml2json1_post(cb, x, jf->jf_arraytype, jf->jf_level, pretty) < 0)
+	    return -1;
+	je->je_nframes--;
+    }
+    return 0;
+}
+
 /*! Translate from xml tree to JSON and print to file using a callback
  * @param[in]  f      File to print to
  * @param[in]  x      XML tree to translate from
@@ -48,6 +48,9 @@
 #include <stdint.h>
 #include <assert.h>
 #include <syslog.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 /* cligen */
 #include <cligen/cligen.h>
@@ -61,15 +64,17 @@
 #include "clixon_handle.h"
 #include "clixon_yang.h"
 #include "clixon_xml.h"
+#include "clixon_xml_io.h"
 #include "clixon_options.h"
 #include "clixon_data.h"
 #include "clixon_netconf_lib.h"
 #include "clixon_xpath_ctx.h"
 #include "clixon_xpath.h"
 #include "clixon_yang_module.h"
-#include "clixon_datastore.h"
+#include "clixon_yang_parse_lib.h"
 #include "clixon_xml_nsctx.h"
 #include "clixon_xml_map.h"
+#include "clixon_datastore.h"
 #include "clixon_path.h"
 #include "clixon_xml_vec.h"
 #include "clixon_nacm.h"
@@ -77,94 +82,883 @@
 /* NACM namespace for use with xml namespace contexts and xpath */
 #define NACM_NS "urn:ietf:params:xml:ns:yang:ietf-netconf-acm"
 
-/*! Match nacm access operations according to RFC8341 3.4.4.  
- * Incoming RPC Message Validation Step 7 (c)
- *  The rule's "access-operations" leaf has the "exec" bit set or
- *  has the special value "*".
- * @param[in] mode  Primary mode, eg read, create, update, delete, exec
- * @param[in] mode2 Secondary mode, eg "write"
- * @retval 0  No match
- * @retval 1  Match
- * @note access_operations is bit-fields
+/* Access-operations bit of a nacm access, compiled from the access-operations leaf */
+#define NACM_ACCESS_BIT(a) (1 << (a))
+#define NACM_ACCESS_ALL    (NACM_ACCESS_BIT(NACM_CREATE) | NACM_ACCESS_BIT(NACM_READ) | \
+			    NACM_ACCESS_BIT(NACM_UPDATE) | NACM_ACCESS_BIT(NACM_DELETE) | \
+			    NACM_ACCESS_BIT(NACM_EXEC))
+#define NACM_ACCESS_WRITE  (NACM_ACCESS_BIT(NACM_CREATE) | NACM_ACCESS_BIT(NACM_UPDATE) | \
+			    NACM_ACCESS_BIT(NACM_DELETE))
+
+/* Rule-type of a compiled rule, RFC8341 rule-type choice */
+enum nacm_rule_type{
+    NR_ANY,          /* No rule-type, matches all data nodes and protocol operations */
+    NR_RPC,          /* protocol-operation: rpc-name */
+    NR_NOTIFICATION, /* notification: notification-name */
+    NR_PATH,         /* data-node: path */
+};
+
+/* Action of a compiled rule */
+enum nacm_action{
+    NR_NOACTION,
+    NR_PERMIT,
+    NR_DENY,
+};
+
+/* Compiled NACM rule */
+struct nacm_rule{
+    char               *nr_module;   /* module-name, NULL if "*" */
+    enum nacm_rule_type nr_type;
+    char               *nr_rpc;      /* rpc-name, NULL if "*" */
+    clixon_path        *nr_path;     /* Compiled path if NR_PATH, NULL if it does not resolve */
+    int                 nr_access;   /* access-operations as NACM_ACCESS_BIT mask */
+    enum nacm_action    nr_action;
+};
+
+/* Compiled NACM rule-list */
+struct nacm_rlist{
+    cvec               *nl_groups;   /* Group names of rule-list */
+    struct nacm_rule   *nl_rules;    /* Rules in order */
+    int                 nl_len;
+};
+
+/* Per-user rule program: the rules of all rule-lists matching the groups of the user, in
+ * order. Created on first access of a user */
+struct nacm_user{
+    qelem_t             nu_qelem;    /* List header */
+    char               *nu_name;     /* User name */
+    struct nacm_rule  **nu_rules;    /* Rules of user in order (pointers into program) */
+    int                 nu_len;
+    clicon_hash_t      *nu_cache;    /* Decision cache of schema node and access */
+};
+
+/* Decision cache entry of a (user, schema node, access) */
+struct nacm_decision{
+    int                 nd_rule;     /* First matching rule without path, nu_len if none */
+    char               *nd_module;   /* Module name of schema node, direct pointer into yang */
+};
+
+/* Compiled NACM program, made from a NACM tree 
+ * The program of the handle owns its NACM tree, which is returned by nacm_access_pre and
+ * reused across requests. It is rebuilt only when the NACM data changes, ie the nacm
+ * subtree of running differs after a write, or a new external tree is loaded.
+ */
+struct nacm_prog{
+    cxobj              *np_xnacm;    /* NACM tree, root is "nacm", or NULL if no NACM config */
+    cxobj              *np_xtree;    /* NACM tree owned by program (same as np_xnacm), or NULL */
+    cxobj              *np_src;      /* External NACM tree compiled from, NULL if internal */
+    uint64_t            np_gen;      /* Generation of running last checked, if internal */
+    int                 np_enabled;  /* enable-nacm is true */
+    cvec               *np_members;  /* Group membership as (user-name, group) pairs */
+    struct nacm_rlist  *np_rlists;   /* Rule-lists in order */
+    int                 np_rlen;
+    struct nacm_user   *np_users;    /* Per-user programs */
+    clicon_hash_t      *np_uniform;  /* Cache of schema nodes whose subtree is in one module */
+};
+
+/*! Compile nacm access-operations bits to an access mask
+ * @param[in] access_operations  access-operations bits, eg "read create" or "*"
+ * @retval    mask               Mask of NACM_ACCESS_BIT
+ * @note "write" is accepted as short-hand for create+update+delete
  */
 static int
-match_access(char *access_operations,
-	     char *mode,
-	     char *mode2)
+nacm_access_mask(char *access_operations)
 {
-    if (access_operations==NULL)
+    int    mask = 0;
+    char **vec = NULL;
+    int    nvec;
+    int    i;
+
+    if (access_operations == NULL)
 	return 0;
-    if (strcmp(access_operations,"*")==0)
-	return 1;
-    if (strstr(access_operations, mode)!=NULL)
-	return 1;
-    if (mode2 && strstr(access_operations, mode2)!=NULL)
-	return 1;
-    return 0;
+    if ((vec = clicon_strsep(access_operations, " \t\n", &nvec)) == NULL)
+	return 0;
+    for (i=0; i<nvec; i++){
+	if (strcmp(vec[i], "*") == 0)
+	    mask |= NACM_ACCESS_ALL;
+	else if (strcmp(vec[i], "create") == 0)
+	    mask |= NACM_ACCESS_BIT(NACM_CREATE);
+	else if (strcmp(vec[i], "read") == 0)
+	    mask |= NACM_ACCESS_BIT(NACM_READ);
+	else if (strcmp(vec[i], "update") == 0)
+	    mask |= NACM_ACCESS_BIT(NACM_UPDATE);
+	else if (strcmp(vec[i], "delete") == 0)
+	    mask |= NACM_ACCESS_BIT(NACM_DELETE);
+	else if (strcmp(vec[i], "exec") == 0)
+	    mask |= NACM_ACCESS_BIT(NACM_EXEC);
+	else if (strcmp(vec[i], "write") == 0)
+	    mask |= NACM_ACCESS_WRITE;
+    }
+    free(vec);
+    return mask;
 }
 
-/*! Match nacm single rule. Either match with access or deny. Or not match.
- * @param[in]  rpc    rpc name
- * @param[in]  module Yang module name
+/*! Compile a single NACM rule
  * @param[in]  xrule  NACM rule XML tree
- * @param[out] cbret  Cligen buffer result. Set to an error msg if retval=0.
- * @retval -1  Error
- * @retval  0  Matching rule AND Not access and cbret set
- * @retval  1  Matching rule AND Access
- * @retval  2  No matching rule Goto step 10
- * @see RFC8341 3.4.4.  Incoming RPC Message Validation
- 7.(cont) A rule matches if all of the following criteria are met: 
-        *  The rule's "module-name" leaf is "*" or equals the name of
-           the YANG module where the protocol operation is defined.
-
-        *  Either (1) the rule does not have a "rule-type" defined or
-           (2) the "rule-type" is "protocol-operation" and the
-           "rpc-name" is "*" or equals the name of the requested
-           protocol operation.
-
-        *  The rule's "access-operations" leaf has the "exec" bit set or
-           has the special value "*".
+ * @param[in]  yspec  YANG spec, for resolving data-node paths
+ * @param[out] nr     Compiled rule
+ * @retval     0      OK
+ * @retval    -1      Error
+ * A rule without module-name never matches and is compiled with an empty access mask.
+ * A path which does not resolve to YANG never matches, as in earlier versions.
  */
 static int
-nacm_rule_rpc(char         *rpc,
-	      char         *module,
-	      cxobj        *xrule)
+nacm_rule_compile(cxobj            *xrule,
+		  yang_stmt        *yspec,
+		  struct nacm_rule *nr)
 {
     int    retval = -1;
-    char  *module_rule; /* rule module name */
-    char  *rpc_rule;
-    char  *access_operations;
+    char  *module;
+    char  *rpc;
+    char  *action;
+    cxobj *pathobj;
+    char  *path;
     
-    /*  7a) The rule's "module-name" leaf is "*" or equals the name of
-	the YANG module where the protocol operation is defined. */
-    if ((module_rule = xml_find_body(xrule, "module-name")) == NULL)
-	goto nomatch;
-    if (strcmp(module_rule,"*") && strcmp(module_rule,module))
-	goto nomatch;
-    /*  7b) Either (1) the rule does not have a "rule-type" defined or
-	(2) the "rule-type" is "protocol-operation" and the
-	"rpc-name" is "*" or equals the name of the requested
-	protocol operation. */
-    if ((rpc_rule = xml_find_body(xrule, "rpc-name")) == NULL){
-	if (xml_find_body(xrule, "path") || xml_find_body(xrule, "notification-name"))
-	    goto nomatch;
-    }
-    if (rpc_rule && (strcmp(rpc_rule, "*") && strcmp(rpc_rule, rpc)))
-	goto nomatch;
-    /* 7c) The rule's "access-operations" leaf has the "exec" bit set or
-	has the special value "*". */
-    access_operations = xml_find_body(xrule, "access-operations");
-    if (!match_access(access_operations, "exec", NULL))
-	goto nomatch;
-    retval = 1;
+    if ((module = xml_find_body(xrule, "module-name")) == NULL)
+	goto ok;
+    if (strcmp(module, "*") && (nr->nr_module = strdup(module)) == NULL){
+	clicon_err(OE_UNIX, errno, "strdup");
+	goto done;
+    }
+    if ((rpc = xml_find_body(xrule, "rpc-name")) != NULL){
+	nr->nr_type = NR_RPC;
+	if (strcmp(rpc, "*") && (nr->nr_rpc = strdup(rpc)) == NULL){
+	    clicon_err(OE_UNIX, errno, "strdup");
+	    goto done;
+	}
+    }
+    else if ((pathobj = xml_find_type(xrule, NULL, "path", CX_ELMNT)) != NULL){
+	nr->nr_type = NR_PATH;
+	/* See https://github.com/clicon/clixon/issues/129 for non-canonical paths */
+	path = clixon_trim2(xml_body(pathobj), " \t\n");
+	if (clixon_instance_id_compile(yspec, path, &nr->nr_path) < 0)
+	    goto done;
+    }
+    else if (xml_find_body(xrule, "notification-name") != NULL)
+	nr->nr_type = NR_NOTIFICATION;
+    else
+	nr->nr_type = NR_ANY;
+    if ((action = xml_find_body(xrule, "action")) != NULL){
+	if (strcmp(action, "deny") == 0)
+	    nr->nr_action = NR_DENY;
+	else if (strcmp(action, "permit") == 0)
+	    nr->nr_action = NR_PERMIT;
+    }
+    nr->nr_access = nacm_access_mask(xml_find_body(xrule, "access-operations"));
+ ok:
+    retval = 0;
  done:
     return retval;
- nomatch:
+}
+
+/*! Free a compiled NACM program
+ * @param[in]  np   NACM program
+ */
+static int
+nacm_prog_free(struct nacm_prog *np)
+{
+    struct nacm_rlist *nl;
+    struct nacm_rule  *nr;
+    struct nacm_user  *nu;
+    int                i;
+    int                j;
+
+    while ((nu = np->np_users) != NULL) {
+	DELQ(nu, np->np_users, struct nacm_user *);
+	if (nu->nu_name)
+	    free(nu->nu_name);
+	if (nu->nu_rules)
+	    free(nu->nu_rules);
+	if (nu->nu_cache)
+	    clicon_hash_free(nu->nu_cache);
+	free(nu);
+    }
+    for (i=0; i<np->np_rlen; i++){
+	nl = &np->np_rlists[i];
+	for (j=0; j<nl->nl_len; j++){
+	    nr = &nl->nl_rules[j];
+	    if (nr->nr_module)
+		free(nr->nr_module);
+	    if (nr->nr_rpc)
+		free(nr->nr_rpc);
+	    if (nr->nr_path)
+		clixon_path_free(nr->nr_path);
+	}
+	if (nl->nl_rules)
+	    free(nl->nl_rules);
+	if (nl->nl_groups)
+	    cvec_free(nl->nl_groups);
+    }
+    if (np->np_rlists)
+	free(np->np_rlists);
+    if (np->np_members)
+	cvec_free(np->np_members);
+    if (np->np_uniform)
+	clicon_hash_free(np->np_uniform);
+    if (np->np_xtree)
+	xml_free(np->np_xtree);
+    free(np);
+    return 0;
+}
+
+/*! Compile a NACM tree into a NACM program
+ * Group membership and rule-lists are resolved here once, instead of xpath lookups in the
+ * NACM tree on every access validation. Data-node paths are parsed and bound to YANG.
+ * @param[in]  h      Clicon handle
+ * @param[in]  xnacm  NACM XML tree, root should be "nacm", or NULL for an empty program
+ * @param[out] npp    NACM program, free with nacm_prog_free
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+nacm_prog_compile(clicon_handle      h,
+		  cxobj             *xnacm,
+		  struct nacm_prog **npp)
+{
+    int                retval = -1;
+    struct nacm_prog  *np = NULL;
+    struct nacm_rlist *nl;
+    cvec              *nsc = NULL;
+    cxobj            **gvec = NULL; /* groups */
+    size_t             glen;
+    cxobj            **rlistvec = NULL; /* rule-list */
+    size_t             rlistlen;
+    cxobj            **rvec = NULL; /* rules */
+    size_t             rlen;
+    cxobj             *x;
+    char              *gname;
+    char              *enabled;
+    yang_stmt         *yspec;
+    int                i;
+    int                j;
+
+    yspec = clicon_dbspec_yang(h);
+    if ((np = malloc(sizeof(*np))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	goto done;
+    }
+    memset(np, 0, sizeof(*np));
+    if ((np->np_members = cvec_new(0)) == NULL){
+	clicon_err(OE_UNIX, errno, "cvec_new");
+	goto done;
+    }
+    if ((np->np_uniform = clicon_hash_init()) == NULL)
+	goto done;
+    np->np_xnacm = xnacm;
+    if (xnacm == NULL)
+	goto ok;
+    np->np_enabled = (enabled = xml_find_body(xnacm, "enable-nacm")) != NULL &&
+	strcmp(enabled, "true") == 0;
+    /* Create namespace context for with nacm namespace as default */
+    if ((nsc = xml_nsctx_init(NULL, NACM_NS)) == NULL)
+	goto done;
+    if (xpath_vec(xnacm, nsc, "groups/group", &gvec, &glen) < 0)
+	goto done;
+    for (i=0; i<glen; i++){
+	if ((gname = xml_find_body(gvec[i], "name")) == NULL)
+	    continue;
+	x = NULL;
+	while ((x = xml_child_each(gvec[i], x, CX_ELMNT)) != NULL) {
+	    if (strcmp(xml_name(x), "user-name") != 0 || xml_body(x) == NULL)
+		continue;
+	    if (cvec_add_string(np->np_members, xml_body(x), gname) < 0){
+		clicon_err(OE_UNIX, errno, "cvec_add_string");
+		goto done;
+	    }
+	}
+    }
+    if (xpath_vec(xnacm, nsc, "rule-list", &rlistvec, &rlistlen) < 0)
+	goto done;
+    if (rlistlen && (np->np_rlists = calloc(rlistlen, sizeof(*np->np_rlists))) == NULL){
+	clicon_err(OE_UNIX, errno, "calloc");
+	goto done;
+    }
+    np->np_rlen = rlistlen;
+    for (i=0; i<rlistlen; i++){
+	nl = &np->np_rlists[i];
+	if ((nl->nl_groups = cvec_new(0)) == NULL){
+	    clicon_err(OE_UNIX, errno, "cvec_new");
+	    goto done;
+	}
+	x = NULL;
+	while ((x = xml_child_each(rlistvec[i], x, CX_ELMNT)) != NULL) {
+	    if (strcmp(xml_name(x), "group") != 0 || xml_body(x) == NULL)
+		continue;
+	    if (cvec_add_string(nl->nl_groups, xml_body(x), NULL) < 0){
+		clicon_err(OE_UNIX, errno, "cvec_add_string");
+		goto done;
+	    }
+	}
+	if (xpath_vec(rlistvec[i], nsc, "rule", &rvec, &rlen) < 0)
+	    goto done;
+	if (rlen && (nl->nl_rules = calloc(rlen, sizeof(*nl->nl_rules))) == NULL){
+	    clicon_err(OE_UNIX, errno, "calloc");
+	    goto done;
+	}
+	nl->nl_len = rlen;
+	for (j=0; j<rlen; j++)
+	    if (nacm_rule_compile(rvec[j], yspec, &nl->nl_rules[j]) < 0)
+		goto done;
+	if (rvec){
+	    free(rvec);
+	    rvec = NULL;
+	}
+    }
+ ok:
+    *npp = np;
+    np = NULL;
     retval = 0;
-    goto done;
+ done:
+    if (np)
+	nacm_prog_free(np);
+    if (nsc)
+	xml_nsctx_free(nsc);
+    if (gvec)
+	free(gvec);
+    if (rlistvec)
+	free(rlistvec);
+    if (rvec)
+	free(rvec);
+    return retval;
+}
+
+/*! Get the NACM program of the handle
+ * @param[in]  h    Clicon handle
+ * @retval     np   NACM program or NULL
+ */
+static struct nacm_prog *
+nacm_prog_handle(clicon_handle h)
+{
+    clicon_hash_t *cdat = clicon_data(h);
+    void          *p;
+
+    if ((p = clicon_hash_value(cdat, "nacm_prog", NULL)) != NULL)
+	return *(struct nacm_prog **)p;
+    return NULL;
+}
+
+/*! Set the NACM program of the handle
+ * @param[in]  h    Clicon handle
+ * @param[in]  np   NACM program or NULL
+ */
+static int
+nacm_prog_handle_set(clicon_handle     h,
+		     struct nacm_prog *np)
+{
+    clicon_hash_t *cdat = clicon_data(h);
+
+    if (clicon_hash_add(cdat, "nacm_prog", &np, sizeof(np)) == NULL)
+	return -1;
+    return 0;
+}
+
+/*! Replace the NACM program of the handle with one compiled from a NACM tree
+ * @param[in]  h      Clicon handle
+ * @param[in]  xt     NACM XML tree with "nacm" as child of top, or NULL. Consumed
+ * @param[in]  xsrc   External NACM tree xt is copied from, NULL if internal
+ * @param[in]  gen    Generation of running datastore xt is read from, if internal
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+nacm_prog_load(clicon_handle h,
+	       cxobj        *xt,
+	       cxobj        *xsrc,
+	       uint64_t      gen)
+{
+    int               retval = -1;
+    struct nacm_prog *np = NULL;
+    cxobj            *xnacm = NULL;
+    cvec             *nsc = NULL;
+
+    if (xt != NULL){
+	if ((nsc = xml_nsctx_init(NULL, NACM_NS)) == NULL)
+	    goto done;
+	if ((xnacm = xpath_first(xt, nsc, "nacm")) != NULL){
+	    if (xml_rootchild_node(xt, xnacm) < 0)
+		goto done;
+	    xt = NULL;
+	}
+    }
+    if (nacm_prog_compile(h, xnacm, &np) < 0){
+	if (xnacm)
+	    xml_free(xnacm);
+	goto done;
+    }
+    np->np_xtree = xnacm;
+    np->np_src = xsrc;
+    np->np_gen = gen;
+    if (nacm_program_reset(h) < 0)
+	goto done;
+    if (nacm_prog_handle_set(h, np) < 0)
+	goto done;
+    np = NULL;
+    retval = 0;
+ done:
+    if (np)
+	nacm_prog_free(np);
+    if (xt)
+	xml_free(xt);
+    if (nsc)
+	xml_nsctx_free(nsc);
+    return retval;
+}
+
+/*! Check if two NACM trees are equal, ie have the same nodes and values in the same order
+ * @param[in]  x0   XML tree
+ * @param[in]  x1   XML tree
+ * @retval     1    Equal
+ * @retval     0    Not equal
+ */
+static int
+nacm_tree_equal(cxobj *x0,
+		cxobj *x1)
+{
+    cxobj *xc0 = NULL;
+    cxobj *xc1 = NULL;
+    char  *b0;
+    char  *b1;
+
+    if (x0 == NULL || x1 == NULL)
+	return x0 == x1;
+    if (strcmp(xml_name(x0), xml_name(x1)) != 0)
+	return 0;
+    b0 = xml_body(x0);
+    b1 = xml_body(x1);
+    if ((b0 == NULL) != (b1 == NULL) || (b0 && strcmp(b0, b1) != 0))
+	return 0;
+    do {
+	xc0 = xml_child_each(x0, xc0, CX_ELMNT);
+	xc1 = xml_child_each(x1, xc1, CX_ELMNT);
+	if (xc0 && xc1 && !nacm_tree_equal(xc0, xc1))
+	    return 0;
+    } while (xc0 && xc1);
+    return xc0 == xc1;
+}
+
+/*! Get NACM program for a NACM tree
+ * Use the program of the handle if it is bound to xnacm (see nacm_access_pre), otherwise
+ * compile a temporary program.
+ * @param[in]  h      Clicon handle
+ * @param[in]  xnacm  NACM XML tree, root should be "nacm"
+ * @param[out] npp    NACM program
+ * @param[out] tmpp   Set to temporary program if compiled, free with nacm_prog_free
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+nacm_prog_get(clicon_handle      h,
+	      cxobj             *xnacm,
+	      struct nacm_prog **npp,
+	      struct nacm_prog **tmpp)
+{
+    struct nacm_prog *np;
+
+    *tmpp = NULL;
+    if ((np = nacm_prog_handle(h)) == NULL || np->np_xnacm != xnacm){
+	if (nacm_prog_compile(h, xnacm, &np) < 0)
+	    return -1;
+	*tmpp = np;
+    }
+    *npp = np;
+    return 0;
+}
+
+/*! Free the compiled NACM program of the handle, eg on exit
+ * @param[in]  h    Clicon handle
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+int
+nacm_program_reset(clicon_handle h)
+{
+    struct nacm_prog *np;
+
+    if ((np = nacm_prog_handle(h)) != NULL){
+	nacm_prog_free(np);
+	if (nacm_prog_handle_set(h, NULL) < 0)
+	    return -1;
+    }
+    return 0;
+}
+
+/*! Get the per-user program, create it by resolving the groups of the user if not found
+ * @param[in]  np       NACM program
+ * @param[in]  username User name
+ * @param[out] nup      Per-user program 
+ * @retval     0        OK
+ * @retval    -1        Error
+ * @see RFC8341 3.4.5 steps 3-5: find the user's groups and the rule-lists with those groups
+ */
+static int
+nacm_user_get(struct nacm_prog  *np,
+	      char              *username,
+	      struct nacm_user **nup)
+{
+    int                retval = -1;
+    struct nacm_user  *nu;
+    struct nacm_rlist *nl;
+    struct nacm_rule **rules;
+    cg_var            *cv;
+    int                i;
+    int                j;
+
+    if ((nu = np->np_users) != NULL){
+	do {
+	    if (strcmp(nu->nu_name, username) == 0){
+		*nup = nu;
+		goto ok;
+	    }
+	    nu = NEXTQ(struct nacm_user *, nu);
+	} while (nu && nu != np->np_users);
+    }
+    if ((nu = malloc(sizeof(*nu))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	goto done;
+    }
+    memset(nu, 0, sizeof(*nu));
+    ADDQ(nu, np->np_users);
+    if ((nu->nu_name = strdup(username)) == NULL){
+	clicon_err(OE_UNIX, errno, "strdup");
+	goto done;
+    }
+    if ((nu->nu_cache = clicon_hash_init()) == NULL)
+	goto done;
+    for (i=0; i<np->np_rlen; i++){
+	nl = &np->np_rlists[i];
+	/* Does any of the user's groups match this rule-list */
+	cv = NULL;
+	while ((cv = cvec_each(np->np_members, cv)) != NULL) {
+	    if (strcmp(cv_name_get(cv), username) == 0 &&
+		cvec_find(nl->nl_groups, cv_string_get(cv)) != NULL)
+		break;
+	}
+	if (cv == NULL || nl->nl_len == 0)
+	    continue;
+	if ((rules = realloc(nu->nu_rules, (nu->nu_len+nl->nl_len)*sizeof(*rules))) == NULL){
+	    clicon_err(OE_UNIX, errno, "realloc");
+	    goto done;
+	}
+	nu->nu_rules = rules;
+	for (j=0; j<nl->nl_len; j++)
+	    nu->nu_rules[nu->nu_len++] = &nl->nl_rules[j];
+    }
+    *nup = nu;
+ ok:
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Match module-name of a rule with a module name
+ * @param[in]  nr     Compiled rule
+ * @param[in]  module Module name, or NULL if not known
+ * @retval     1      Match: module-name is "*" or equal to module, or module is not known
+ * @retval     0      No match
+ */
+static int
+nacm_rule_module(struct nacm_rule *nr,
+		 char             *module)
+{
+    return nr->nr_module == NULL || module == NULL || strcmp(nr->nr_module, module) == 0;
+}
+
+/*! Check if a node is or is a descendant of one of the instances of a path rule
+ * @param[in]  xn   XML node
+ * @param[in]  xv   Instances of path in request tree, or NULL
+ */
+static int
+nacm_path_match(cxobj       *xn,
+		clixon_xvec *xv)
+{
+    cxobj *xp;
+    int    i;
+
+    if (xv == NULL)
+	return 0;
+    for (i=0; i<clixon_xvec_len(xv); i++){
+	xp = clixon_xvec_i(xv, i);
+	if (xn == xp || xml_isancestor(xn, xp))
+	    return 1;
+    }
+    return 0;
+}
+
+/*! Look up the instances of data-node paths of the user's rules in a request tree
+ * @param[in]  nu     Per-user program
+ * @param[in]  xt     XML request root tree
+ * @param[in]  access NACM access, only rules with that access are looked up
+ * @param[in]  yspec  YANG spec
+ * @param[out] xpvp   Vector of instances, one per user rule. Free with nacm_path_free
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+nacm_path_bind(struct nacm_user  *nu,
+	       cxobj             *xt,
+	       enum nacm_access   access,
+	       yang_stmt         *yspec,
+	       clixon_xvec     ***xpvp)
+{
+    int               retval = -1;
+    clixon_xvec     **xpv = NULL;
+    struct nacm_rule *nr;
+    int               i;
+
+    if ((xpv = calloc(nu->nu_len+1, sizeof(*xpv))) == NULL){
+	clicon_err(OE_UNIX, errno, "calloc");
+	goto done;
+    }
+    for (i=0; i<nu->nu_len; i++){
+	nr = nu->nu_rules[i];
+	if (nr->nr_type != NR_PATH || nr->nr_path == NULL ||
+	    (nr->nr_access & NACM_ACCESS_BIT(access)) == 0)
+	    continue;
+	if (clixon_xml_find_instance_id_compiled(xt, yspec, nr->nr_path, &xpv[i]) < 0)
+	    goto done;
+    }
+    *xpvp = xpv;
+    xpv = NULL;
+    retval = 0;
+ done:
+    if (xpv)
+	free(xpv);
+    return retval;
+}
+
+static int
+nacm_path_free(clixon_xvec **xpv,
+	       int           len)
+{
+    int i;
+
+    for (i=0; i<len; i++)
+	if (xpv[i])
+	    clixon_xvec_free(xpv[i]);
+    free(xpv);
+    return 0;
+}
+
+/*! Get the decision cache entry of a schema node and access, compute it if not found
+ * The entry contains the first rule without path matching the schema node. A path rule
+ * can only override the decision if it comes before that rule.
+ * @param[in]  nu     Per-user program
+ * @param[in]  ys     YANG schema node
+ * @param[in]  access NACM access
+ * @param[out] ndp    Decision cache entry
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+nacm_decision_get(struct nacm_user      *nu,
+		  yang_stmt             *ys,
+		  enum nacm_access       access,
+		  struct nacm_decision **ndp)
+{
+    int                   retval = -1;
+    char                  key[64];
+    struct nacm_decision *nd;
+    struct nacm_decision  nd0;
+    struct nacm_rule     *nr;
+    yang_stmt            *ymod = NULL;
+    clicon_hash_t         hv;
+    int                   i;
+
+    snprintf(key, sizeof(key), "%p/%d", ys, access);
+    if ((nd = clicon_hash_value(nu->nu_cache, key, NULL)) == NULL){
+	if (ys_real_module(ys, &ymod) < 0)
+	    goto done;
+	nd0.nd_module = ymod?yang_argument_get(ymod):NULL;
+	nd0.nd_rule = nu->nu_len;
+	for (i=0; i<nu->nu_len; i++){
+	    nr = nu->nu_rules[i];
+	    if ((nr->nr_access & NACM_ACCESS_BIT(access)) == 0 || nr->nr_type != NR_ANY)
+		continue;
+	    if (nacm_rule_module(nr, nd0.nd_module))
+		break;
+	}
+	nd0.nd_rule = i;
+	if ((hv = clicon_hash_add(nu->nu_cache, key, &nd0, sizeof(nd0))) == NULL)
+	    goto done;
+	nd = hv->h_val;
+    }
+    *ndp = nd;
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Find the first rule of the user matching a data node
+ * @param[in]  nu     Per-user program
+ * @param[in]  xn     XML node (requested node)
+ * @param[in]  access NACM access
+ * @param[in]  xpv    Instances of path rules, see nacm_path_bind
+ * @param[in]  yspec  YANG spec
+ * @param[out] ndp    Decision cache entry, or NULL if xn has no YANG spec
+ * @param[out] rulep  Index of matching rule, or nu_len if no rule matches
+ * @retval     0      OK
+ * @retval    -1      Error
+ * @see RFC8341 3.4.5 step 6: rule matching for data nodes
+ */
+static int
+nacm_node_rule(struct nacm_user      *nu,
+	       cxobj                 *xn,
+	       enum nacm_access       access,
+	       clixon_xvec          **xpv,
+	       yang_stmt             *yspec,
+	       struct nacm_decision **ndp,
+	       int                   *rulep)
+{
+    int                   retval = -1;
+    struct nacm_decision *nd = NULL;
+    struct nacm_rule     *nr;
+    yang_stmt            *ys;
+    yang_stmt            *ymod = NULL;
+    char                 *module;
+    int                   i;
+    int                   len;
+
+    if ((ys = xml_spec(xn)) != NULL){
+	if (nacm_decision_get(nu, ys, access, &nd) < 0)
+	    goto done;
+	module = nd->nd_module;
+	len = nd->nd_rule;  /* Only path rules before it need to be checked */
+    }
+    else {
+	/* ymod is NULL (xn is "config") Can this breach the NACM rule? */
+	if (ys_module_by_xml(yspec, xn, &ymod) < 0)
+	    goto done;
+	module = ymod?yang_argument_get(ymod):NULL;
+	len = nu->nu_len;
+    }
+    for (i=0; i<len; i++){
+	nr = nu->nu_rules[i];
+	if ((nr->nr_access & NACM_ACCESS_BIT(access)) == 0 || !nacm_rule_module(nr, module))
+	    continue;
+	if (nr->nr_type == NR_ANY)
+	    break;
+	if (nr->nr_type == NR_PATH && nacm_path_match(xn, xpv[i]))
+	    break;
+    }
+    *ndp = nd;
+    *rulep = i;
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Check if all data nodes in a schema subtree belong to the same module
+ * Augments from other modules makes a subtree non-uniform. Cached per schema node.
+ * @param[in]  np      NACM program
+ * @param[in]  ys      YANG schema node
+ * @param[out] uniform 1 if all data descendants are in the same module as ys, 0 if not
+ * @retval     0       OK
+ * @retval    -1       Error
+ */
+static int
+nacm_subtree_uniform(struct nacm_prog *np,
+		     yang_stmt        *ys,
+		     int              *uniform)
+{
+    int            retval = -1;
+    char           key[32];
+    int           *up;
+    int            u = 1;
+    yang_stmt     *ymod = NULL;
+    yang_stmt     *ycmod;
+    yang_stmt     *yc;
+    enum rfc_6020  keyw;
+
+    snprintf(key, sizeof(key), "%p", ys);
+    if ((up = clicon_hash_value(np->np_uniform, key, NULL)) != NULL){
+	*uniform = *up;
+	goto ok;
+    }
+    if (ys_real_module(ys, &ymod) < 0)
+	goto done;
+    yc = NULL;
+    while (u && (yc = yn_each(ys, yc)) != NULL) {
+	keyw = yang_keyword_get(yc);
+	if (!yang_datanode(yc) && keyw != Y_CHOICE && keyw != Y_CASE)
+	    continue;
+	ycmod = NULL;
+	if (ys_real_module(yc, &ycmod) < 0)
+	    goto done;
+	if (ycmod != ymod)
+	    u = 0;
+	else if (nacm_subtree_uniform(np, yc, &u) < 0)
+	    goto done;
+    }
+    if (clicon_hash_add(np->np_uniform, key, &u, sizeof(u)) == NULL)
+	goto done;
+    *uniform = u;
+ ok:
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Check if the rule decision of a data node is the decision of all its descendants
+ * If so, the subtree need not be visited node by node.
+ * Rules before the matching rule did not match the node. They can only match a descendant
+ * with a path instance below the node, or if they are for a module augmenting the subtree.
+ * The matching rule (or no rule) applies to all descendants unless it is module-specific
+ * and the subtree contains augments.
+ * @param[in]  np     NACM program
+ * @param[in]  nu     Per-user program
+ * @param[in]  xn     XML node (requested node)
+ * @param[in]  nd     Decision cache entry of xn
+ * @param[in]  rule   Index of rule matching xn, or nu_len if none
+ * @param[in]  access NACM access
+ * @param[in]  xpv    Instances of path rules, see nacm_path_bind
+ * @retval     1      Decision of xn holds for the whole subtree
+ * @retval     0      No, descendants need to be checked
+ * @retval    -1      Error
+ */
+static int
+nacm_subtree_decided(struct nacm_prog     *np,
+		     struct nacm_user     *nu,
+		     cxobj                *xn,
+		     struct nacm_decision *nd,
+		     int                   rule,
+		     enum nacm_access      access,
+		     clixon_xvec         **xpv)
+{
+    struct nacm_rule *nr;
+    int               uniform = -1;
+    int               i;
+    int               j;
+
+    if (nd == NULL)
+	return 0;
+    for (i=0; i<rule; i++){
+	nr = nu->nu_rules[i];
+	if ((nr->nr_access & NACM_ACCESS_BIT(access)) == 0 ||
+	    (nr->nr_type != NR_ANY && nr->nr_type != NR_PATH))
+	    continue;
+	if (nacm_rule_module(nr, nd->nd_module)){
+	    for (j=0; xpv[i] && j<clixon_xvec_len(xpv[i]); j++)
+		if (xml_isancestor(clixon_xvec_i(xpv[i], j), xn))
+		    return 0;
+	}
+	else {
+	    if (uniform == -1 && nacm_subtree_uniform(np, xml_spec(xn), &uniform) < 0)
+		return -1;
+	    if (uniform == 0)
+		return 0;
+	}
+    }
+    if (rule < nu->nu_len && nu->nu_rules[rule]->nr_module != NULL){
+	if (uniform == -1 && nacm_subtree_uniform(np, xml_spec(xn), &uniform) < 0)
+	    return -1;
+	if (uniform == 0)
+	    return 0;
+    }
+    return 1;
 }
 
 /*! Process nacm incoming RPC message validation steps
+ * @param[in]  h        Clicon handle
  * @param[in]  module   Yang module name
  * @param[in]  rpc      rpc name
  * @param[in]  username User name of requestor
@@ -178,31 +972,21 @@ nacm_rule_rpc(char         *rpc,
  * @see nacm_datanode_read
  */
 int
-nacm_rpc(char         *rpc,
+nacm_rpc(clicon_handle h,
+	 char         *rpc,
 	 char         *module,
 	 char         *username,
 	 cxobj        *xnacm,
 	 cbuf         *cbret)
 {
-    int     retval = -1;
-    cxobj  *xrule;
-    cxobj **gvec = NULL; /* groups */
-    size_t  glen;
-    cxobj  *rlist;
-    cxobj **rlistvec = NULL; /* rule-list */
-    size_t  rlistlen;
-    cxobj **rvec = NULL; /* rules */
-    size_t  rlen;
-    int     i, j;
-    char   *exec_default = NULL;
-    char   *gname;
-    char   *action;
-    int     match= 0;
-    cvec   *nsc = NULL;
+    int               retval = -1;
+    char             *exec_default = NULL;
+    struct nacm_prog *np = NULL;
+    struct nacm_prog *tmp = NULL;
+    struct nacm_user *nu = NULL;
+    struct nacm_rule *nr;
+    int               i;
     
-    /* Create namespace context for with nacm namespace as default */
-    if ((nsc = xml_nsctx_init(NULL, NACM_NS)) == NULL)
-	goto done;
     /* 3.   If the requested operation is the NETCONF <close-session>
        protocol operation, then the protocol operation is permitted.
     */
@@ -215,60 +999,46 @@ nacm_rpc(char         *rpc,
        transport layer.)	       */
     if (username == NULL)
 	goto step10;
-
-    /* User's group */
-    if (xpath_vec(xnacm, nsc, "groups/group[user-name='%s']", &gvec, &glen, username) < 0)
+    /* 5. If no groups are found, continue with step 10. 
+       6. Process all rule-list entries, in the order they appear in the
+       configuration.  If a rule-list's "group" leaf-list does not
+       match any of the user's groups, proceed to the next rule-list
+       entry. 
+       Steps 4-6 are resolved in the per-user program */
+    if (nacm_prog_get(h, xnacm, &np, &tmp) < 0)
 	goto done;
-    /* 5. If no groups are found, continue with step 10. */
-    if (glen == 0)
-	goto step10;
-    /* 6. Process all rule-list entries, in the order they appear in the
-        configuration.  If a rule-list's "group" leaf-list does not
-        match any of the user's groups, proceed to the next rule-list
-        entry. */
-    if (xpath_vec(xnacm, nsc, "rule-list", &rlistvec, &rlistlen) < 0)
+    if (nacm_user_get(np, username, &nu) < 0)
 	goto done;
-    for (i=0; i<rlistlen; i++){
-	rlist = rlistvec[i];
-	/* Loop through user's group to find match in this rule-list */
-	for (j=0; j<glen; j++){
-	    gname = xml_find_body(gvec[j], "name");
-	    if (xpath_first(rlist, nsc, ".[group='%s']", gname)!=NULL)
-		break; /* found */
-	}
-	if (j==glen) /* not found */
+    /* 7. For each rule-list entry found, process all rules, in order,
+       until a rule that matches the requested access operation is
+       found. A rule matches if all of the following criteria are met: 
+       a) The rule's "module-name" leaf is "*" or equals the name of
+       the YANG module where the protocol operation is defined. 
+       b) Either (1) the rule does not have a "rule-type" defined or
+       (2) the "rule-type" is "protocol-operation" and the
+       "rpc-name" is "*" or equals the name of the requested
+       protocol operation. 
+       c) The rule's "access-operations" leaf has the "exec" bit set or
+       has the special value "*". */
+    for (i=0; i<nu->nu_len; i++){
+	nr = nu->nu_rules[i];
+	if ((nr->nr_access & NACM_ACCESS_BIT(NACM_EXEC)) == 0)
 	    continue;
-	/* 7. For each rule-list entry found, process all rules, in order,
-	   until a rule that matches the requested access operation is
-	   found. 
-	*/
-	if (xpath_vec(rlist, nsc, "rule", &rvec, &rlen) < 0)
-	    goto done;
-	for (j=0; j<rlen; j++){
-	    xrule = rvec[j];
-	    if ((match = nacm_rule_rpc(rpc, module, xrule)) < 0)
-		goto done;
-	    if (match)
-		break;
-	}
-	if (match)
+	if (nr->nr_module && strcmp(nr->nr_module, module))
+	    continue;
+	if (nr->nr_type == NR_ANY ||
+	    (nr->nr_type == NR_RPC && (nr->nr_rpc == NULL || strcmp(nr->nr_rpc, rpc) == 0)))
 	    break;
-	if (rvec){
-	    free(rvec);
-	    rvec=NULL;
-	}
     }
-    if (match){
-	if ((action = xml_find_body(xrule, "action")) == NULL)
-	    goto step10;
-	if (strcmp(action, "deny")==0){
+    if (i < nu->nu_len){
+	nr = nu->nu_rules[i];
+	if (nr->nr_action == NR_DENY){
 	    if (netconf_access_denied(cbret, "application", "access denied") < 0)
 		goto done;
 	    goto deny;
 	}
-	else if (strcmp(action, "permit")==0)
+	else if (nr->nr_action == NR_PERMIT)
 	    goto permit;
-
     }
  step10:
     /*   10.  If the requested protocol operation is defined in a YANG module
@@ -295,14 +1065,8 @@ nacm_rpc(char         *rpc,
     retval = 1;
  done:
     clicon_debug(1, "%s retval:%d (0:deny 1:permit)", __FUNCTION__, retval);
-    if (nsc)
-	xml_nsctx_free(nsc);
-    if (gvec)
-	free(gvec);
-    if (rlistvec)
-	free(rlistvec);
-    if (rvec)
-	free(rvec);
+    if (tmp)
+	nacm_prog_free(tmp);
     return retval;
  deny: /* Here, cbret must contain a netconf error msg */
     assert(cbuf_len(cbret));
@@ -310,344 +1074,72 @@ nacm_rpc(char         *rpc,
     goto done;
 }
 
-/* Local struct for keeping preparation/compiled data in NACM data path code */
-struct prepvec{
-    qelem_t       pv_q;
-    cxobj        *pv_xrule;
-    clixon_xvec  *pv_xpathvec;
-};
-typedef struct prepvec prepvec;
-
-/*! Delete all Upgrade callbacks
- */
-int
-prepvec_free(prepvec *pv_list)
-{
-    prepvec *pv;
-
-    while((pv = pv_list) != NULL) {
-	DELQ(pv, pv_list, prepvec *);
-	if (pv->pv_xpathvec)
-	    clixon_xvec_free(pv->pv_xpathvec);
-	free(pv);
-    }
-    return 0;
-}
-
-prepvec *
-prepvec_add(prepvec  **pv_listp,
-	    cxobj     *xrule)
-{
-    prepvec *pv;
-
-    if ((pv = malloc(sizeof(*pv))) == NULL){
-	clicon_err(OE_UNIX, errno, "malloc");
-	return NULL;
-    }
-    memset(pv, 0, sizeof(*pv));
-    ADDQ(pv, *pv_listp);
-    pv->pv_xrule = xrule;
-    if ((pv->pv_xpathvec = clixon_xvec_new()) == NULL)
-	return NULL;
-    return pv;
-}
-
-/*! Prepare datastructures before running through XML tree
- * Save rules in a "cache"
- * These rules match:
- *  - user/group
- *  - have read access-op, etc
- * Also make instance-id lookups on top object for each rule. Assume at most one result
- */
-static int
-nacm_datanode_prepare(clicon_handle     h,
-		      cxobj            *xt,
-		      enum nacm_access  access,
-		      cxobj           **gvec,
-		      size_t            glen,
-		      cxobj           **rlistvec,
-		      size_t            rlistlen,
-		      cvec             *nsc,
-		      prepvec         **pv_listp)
-{
-    int        retval = -1;
-    cxobj     *rlist;
-    int        i;
-    int        j;
-    int        k;
-    char      *gname;
-    cxobj    **rvec = NULL; /* rules */
-    size_t     rlen;	
-    cxobj     *xrule;
-    cxobj     *pathobj;
-    char      *access_operations;
-    char      *path0;         /* Non-canonical path */
-    char      *path=NULL;     /* Canonical path */
-    cvec      *nsc0 = NULL;   /* Non-canonical namespace context */
-    yang_stmt *yspec;
-    cxobj   **xvec = NULL;
-    int       xlen = 0;
-    int       ret;
-    prepvec *pv;
-
-    yspec = clicon_dbspec_yang(h);
-    for (i=0; i<rlistlen; i++){ 	/* Loop through rule list */
-	rlist = rlistvec[i];
-	/* Loop through user's group to find match in this rule-list */
-	for (j=0; j<glen; j++){
-	    gname = xml_find_body(gvec[j], "name");
-	    if (xpath_first(rlist, nsc, ".[group='%s']", gname)!=NULL)
-		break; /* found */
-	}
-	if (j==glen) /* not found */
-	    continue;
-	/* 6. For each rule-list entry found, process all rules, in order,
-	   until a rule that matches the requested access operation is
-	   found. (see 6 sub rules in nacm_rule_datanode
-	*/
-	if (xpath_vec(rlist, nsc, "rule", &rvec, &rlen) < 0)
-	    goto done;
-	for (j=0; j<rlen; j++){ /* Loop through rules */
-	    xrule = rvec[j];
-	    /* 6c) For a "read" access operation, the rule's "access-operations"
-	       leaf has the "read" bit set or has the special value "*" */
-	    access_operations = xml_find_body(xrule, "access-operations");
-	    switch (access){
-	    case NACM_READ: 
-		/* 6c) For a "read" access operation, the rule's "access-operations"
-		   leaf has the "read" bit set or has the special value "*" */
-		if (!match_access(access_operations, "read", NULL))
-		    continue;
-		break;
-	    case NACM_CREATE:
-		/* 6d) For a "create" access operation, the rule's "access-operations" 
-		   leaf has the "create" bit set or has the special value "*". */
-		if (!match_access(access_operations, "create", "write"))
-		    continue;
-		break;
-	    case NACM_DELETE:
-		/* 6e) For a "delete" access operation, the rule's "access-operations" 
-		   leaf has the "delete" bit set or has the  special value "*". */
-		if (!match_access(access_operations, "delete", "write"))
-		    continue;
-		break;
-	    case NACM_UPDATE:
-		/* 6f) For an "update" access operation, the rule's "access-operations"
-		   leaf has the "update" bit set or has the special value "*". */ 
-		if (!match_access(access_operations, "update", "write"))
-		    continue;
-		break;
-	    default:
-		clicon_err(OE_XML, EINVAL, "Access %d unupported (shouldnt happen)", access);
-		goto done;
-		break;
-	    }
-	    /*  6b) Either (1) the rule does not have a "rule-type" defined or
-		(2) the "rule-type" is "data-node" and the "path" matches the
-		requested data node, action node, or notification node. */    
-	    if ((pathobj = xml_find_type(xrule, NULL, "path", CX_ELMNT)) == NULL){
-		if (xml_find_body(xrule, "rpc-name") || xml_find_body(xrule, "notification-name"))
-		    continue;
-		/* Here a new xrule is found, add it */
-		if (prepvec_add(pv_listp, xrule) == NULL)
-		    goto done;
-	    }
-	    else{
-		path0 = clixon_trim2(xml_body(pathobj), " \t\n");
-		/* Get canonical namespace context for nacm paths */
-		if ((path = strdup(path0)) == NULL){
-		    clicon_err(OE_UNIX, errno, "strdup");
-		    goto done;
-		}
-#if 0
-		/* See https://github.com/clicon/clixon/issues/129:
-		 * If this is enabled, you are back to the problem of JSON encodings
-		 */
-		/* Create namespace context for with nacm namespace as default */
-		if (xml_nsctx_node(pathobj, &nsc0) < 0)
-		    goto done;
-		/* instance-id requires canonical paths */
-		if (xpath2canonical(path0, nsc0, yspec, &path, NULL) < 0)
-		    goto done;
-#endif
-		if ((ret = clixon_xml_find_instance_id(xt, yspec, &xvec, &xlen, "%s", path)) < 0)
-		    goto done;
-		if (ret == 0)
-		    continue;
-		/* Here a new xrule is found, add it */
-		if ((pv = prepvec_add(pv_listp, xrule)) == NULL)
-		    goto done;
-		for (k=0; k<xlen; k++){
-		    if (clixon_xvec_append(pv->pv_xpathvec, xvec[k]) < 0)
-			goto done;
-		}
-		if (xvec){
-		    free(xvec);
-		    xvec = NULL;
-		}
-		if (nsc0){
-		    cvec_free(nsc0);
-		    nsc0 = NULL;
-		}
-		if (path){
-		    free(path);
-		    path = NULL;
-		}
-	    }
-	}
-	if (rvec){
-	    free(rvec);
-	    rvec=NULL;
-	}	
-    }
-    retval = 0;
- done:
-    if (xvec)
-	free(xvec);
-    if (path)
-	free(path);
-    if (nsc0)
-	cvec_free(nsc0);
-    return retval;
-}
-
 /*---------------------------------------------------------------
  * Datanode write
  */
 
-/*! Match specific rule to specific requested node
- * @param[in]  xn       XML node (requested node)
- * @param[in]  xrule    NACM rule
- * @param[in]  xp       Xpath match
- * @param[in]  yspec    YANG spec
- * @retval -1  Error
- * @retval  0  OK and rule does not match
- * @retval  1  OK and rule matches deny
- * @retval  2  OK and rule matches permit
- */
-static int
-nacm_data_write_xrule_xml(cxobj       *xn,
-			  cxobj       *xrule,
-			  clixon_xvec *xpathvec,
-			  yang_stmt   *yspec)
-{
-    int        retval = -1;
-    yang_stmt *ymod;
-    char      *module_pattern; /* rule module name */
-    char      *action;
-    cxobj     *xp;
-    int        i;
-
-    if ((module_pattern = xml_find_body(xrule, "module-name")) == NULL)
-	goto nomatch;
-    /* 6a) The rule's "module-name" leaf is "*" or equals the name of
-     * the YANG module where the requested data node is defined. 
-     */
-    if (strcmp(module_pattern, "*") != 0){
-	if (ys_module_by_xml(yspec, xn, &ymod) < 0)
-	    goto done;
-	/* ymod is NULL (xn is "config") Can this breach the NACM rule? */
-	if (ymod && strcmp(yang_argument_get(ymod), module_pattern) != 0)
-	    goto nomatch;
-    }
-    action = xml_find_body(xrule, "action"); /* mandatory */
-    /*  6b) Either (1) the rule does not have a "rule-type" defined or
-	(2) the "rule-type" is "data-node" and the "path" matches the
-	Requested data node, action node, or notification node. */    
-    if (xml_find_type(xrule, NULL, "path", CX_ELMNT) == NULL){
-	if (strcmp(action, "deny")==0)
-	    goto deny;
-	goto permit;
-    }
-    for (i=0; i<clixon_xvec_len(xpathvec); i++){
-	xp = clixon_xvec_i(xpathvec, i);
-	/* Check if ancestor is xp (for every xpathvec?) */
-	if (xn == xp || xml_isancestor(xn, xp)){
-	    if (strcmp(action, "deny")==0)
-		goto deny;
-	    goto permit;
-	}
-    }
-    goto nomatch;
- permit:
-    retval = 2;       /* rule match and permit */
- done:
-    return retval;
- nomatch :  /* rule does not match */
-    retval = 0;
-    goto done;
- deny:      /* rule match and deny */
-    retval = 1;
-    goto done;
-}
-
 /*! Recursive check for NACM write rules among all XML nodes
- * @param[in]  h         Clicon handle
+ * @param[in]  np        NACM program
+ * @param[in]  nu        Per-user program
  * @param[in]  xn        XML node (requested node)
- * @param[in]  rulevec   Precomputed rules that apply to this user group
- * @param[in]  xpathvec  Precomputed xpath results that apply to this XML tree
+ * @param[in]  access    NACM access
+ * @param[in]  xpv       Precomputed path instances that apply to this XML tree
  * @param[in]  defpermit 0 if default deny, 1 is default permit
  * @param[in]  yspec     YANG spec
  * @param[out] cbret     Error message if retval = 0
  * @retval     1         OK and accept
  * @retval     0         Deny and cbret set
  * @retval     -1        Error
- * XXX differentiate between nomatch: default. or match deny, match accept 
  * nomatch: check write-default rules, next v
- * accept:  Hunky dory
+ * accept:  Continue with children, unless the decision holds for the whole subtree
  * deny:    Send error message
  */
 static int
-nacm_datanode_write_recurse(clicon_handle h,
-			    cxobj        *xn,
-			    prepvec      *pv_list,
-			    int           defpermit,
-			    yang_stmt    *yspec,
-			    cbuf         *cbret)
+nacm_datanode_write_recurse(struct nacm_prog *np,
+			    struct nacm_user *nu,
+			    cxobj            *xn,
+			    enum nacm_access  access,
+			    clixon_xvec     **xpv,
+			    int               defpermit,
+			    yang_stmt        *yspec,
+			    cbuf             *cbret)
 {
-    int       retval = -1;
-    cxobj   *x;
-    int      ret = 0;
-    prepvec *pv;
-    
-    pv = pv_list;
-    if (pv){
-	do {
-	    /* return values: -1:Error /0:no match /1: deny /2: permit
-	     */
-	    if ((ret = nacm_data_write_xrule_xml(xn, pv->pv_xrule, pv->pv_xpathvec, yspec)) < 0) 
+    int                   retval = -1;
+    cxobj                *x;
+    int                   ret = 0;
+    int                   rule;
+    struct nacm_decision *nd = NULL;
+
+    if (nacm_node_rule(nu, xn, access, xpv, yspec, &nd, &rule) < 0)
+	goto done;
+    if (rule < nu->nu_len){
+	/* Match and deny: break all traversal and send error back to client */
+	if (nu->nu_rules[rule]->nr_action == NR_DENY){
+	    if (netconf_access_denied(cbret, "application", "access denied") < 0)
 		goto done;
-	    switch(ret){
-	    case 0: /* No match, continue with next rule */
-		break;
-	    case 1: /* Match and deny: break all traversal and send error back to client */
-		if (netconf_access_denied(cbret, "application", "access denied") < 0)
-		    goto done;
-		goto deny;
-		break;
-	    case 2: /* Match and permit: break rule processing but continue recursion */
-		break;
-	    }
-	    if (ret == 2)
-		break;
-	    pv = NEXTQ(prepvec *, pv);
-	} while (pv && pv != pv_list);
+	    goto deny;
+	}
     }
     /* If no rule match, check default rule: if deny then break traversal and send error */
-    if (ret == 0 && !defpermit){
+    else if (!defpermit){
 	if (netconf_access_denied(cbret, "application", "default deny") < 0)
 	    goto done;
 	goto deny;
     }
-    /* If node should be purged, dont recurse and defer removal to caller */
+    /* Permit: no need to check descendants if they all get the same decision */
+    if ((ret = nacm_subtree_decided(np, nu, xn, nd, rule, access, xpv)) < 0)
+	goto done;
+    if (ret == 1)
+	goto accept;
     x = NULL; 	/* Recursively check XML */
     while ((x = xml_child_each(xn, x, CX_ELMNT)) != NULL) {
-	if ((ret = nacm_datanode_write_recurse(h, x, pv_list,
+	if ((ret = nacm_datanode_write_recurse(np, nu, x, access, xpv,
 					       defpermit, yspec, cbret)) < 0)
 	    goto done;
 	if (ret == 0)
 	    goto deny;
     }
+ accept:
     retval = 1; /* accept */
  done:
     return retval;
@@ -682,20 +1174,15 @@ nacm_datanode_write(clicon_handle    h,
 		    cxobj           *xnacm,
 		    cbuf            *cbret)
 {
-    int             retval = -1;
-    cxobj         **gvec = NULL; /* groups */
-    size_t          glen;
-    cxobj         **rlistvec = NULL; /* rule-list */
-    size_t          rlistlen;
-    cxobj         **rvec = NULL; /* rules */
-    char           *write_default = NULL;
-    cvec           *nsc = NULL;
-    int             ret;
-    prepvec        *pv_list = NULL;
+    int               retval = -1;
+    char             *write_default = NULL;
+    int               ret;
+    struct nacm_prog *np = NULL;
+    struct nacm_prog *tmp = NULL;
+    struct nacm_user *nu = NULL;
+    clixon_xvec     **xpv = NULL;
+    yang_stmt        *yspec;
 
-    /* Create namespace context for with nacm namespace as default */
-    if ((nsc = xml_nsctx_init(NULL, NACM_NS)) == NULL)
-	goto done;
     if (xnacm == NULL)
 	goto permit;
     /* write-default (create, update, or delete) has default deny so should never be NULL */
@@ -710,26 +1197,27 @@ nacm_datanode_write(clicon_handle    h,
        transport layer.)	       */
     if (username == NULL)
 	goto step9;
-    /* User's group */
-    if (xpath_vec(xnacm, nsc, "groups/group[user-name='%s']", &gvec, &glen, username) < 0)
+    /* 4. If no groups are found, continue with step 9. 
+       5. Process all rule-list entries, in the order they appear in the
+       configuration.  If a rule-list's "group" leaf-list does not
+       match any of the user's groups, proceed to the next rule-list
+       entry. 
+       Steps 3-5 are resolved in the per-user program */
+    if (nacm_prog_get(h, xnacm, &np, &tmp) < 0)
 	goto done;
-    /* 4. If no groups are found, continue with step 9. */
-    if (glen == 0)
-	goto step9;
-    /* 5. Process all rule-list entries, in the order they appear in the
-        configuration.  If a rule-list's "group" leaf-list does not
-        match any of the user's groups, proceed to the next rule-list
-        entry. */
-    if (xpath_vec(xnacm, nsc, "rule-list", &rlistvec, &rlistlen) < 0)
+    if (nacm_user_get(np, username, &nu) < 0)
 	goto done;
-    /* First run through rules and cache rules as well as lookup objects in xt. 
+    if (nu->nu_len == 0)
+	goto step9;
+    yspec = clicon_dbspec_yang(h);
+    /* First lookup path rule objects in xt. 
      */
-    if (nacm_datanode_prepare(h, xt, access, gvec, glen, rlistvec, rlistlen, nsc, &pv_list) < 0)
+    if (nacm_path_bind(nu, xt, access, yspec, &xpv) < 0)
 	goto done;
     /* Then recursivelyy traverse all requested nodes */
-    if ((ret = nacm_datanode_write_recurse(h, xreq, pv_list,
+    if ((ret = nacm_datanode_write_recurse(np, nu, xreq, access, xpv,
 					   strcmp(write_default, "deny"),
-					   clicon_dbspec_yang(h),
+					   yspec,
 					   cbret)) < 0)
 	goto done;
     if (ret == 0) /* deny */
@@ -755,20 +1243,14 @@ nacm_datanode_write(clicon_handle    h,
 	    goto done;
 	goto deny;
     }
- permit:
-    retval = 1;
- done:
-    clicon_debug(1, "%s retval:%d (0:deny 1:permit)", __FUNCTION__, retval);
-    if (pv_list)
-	prepvec_free(pv_list);
-    if (nsc)
-	xml_nsctx_free(nsc);
-    if (gvec)
-	free(gvec);
-    if (rlistvec)
-	free(rlistvec);
-    if (rvec)
-	free(rvec);
+ permit:
+    retval = 1;
+ done:
+    clicon_debug(1, "%s retval:%d (0:deny 1:permit)", __FUNCTION__, retval);
+    if (xpv)
+	nacm_path_free(xpv, nu->nu_len);
+    if (tmp)
+	nacm_prog_free(tmp);
     return retval;
  deny: /* Here, cbret must contain a netconf error msg */
     assert(cbuf_len(cbret));
@@ -780,37 +1262,15 @@ nacm_datanode_write(clicon_handle    h,
  * Datanode read
  */
 
-/*! Perform NACM action: mark if permit, del if deny
- * @param[in] xrule    NACM rule
- * @param[in] xn       XML node (requested node)
- * @retval    -1       Error
- * @retval    0        OK
- */
-static int
-nacm_data_read_action(cxobj *xrule,
-		      cxobj *xn)
-{
-    int   retval = -1;
-    char *action;
-
-    if ((action = xml_find_body(xrule, "action")) != NULL){
-	if (strcmp(action, "deny")==0)
-	    xml_flag_set(xn, XML_FLAG_DEL);
-	else if (strcmp(action, "permit")==0)
-	    xml_flag_set(xn, XML_FLAG_MARK);
-    }
-    retval = 0;
-    //done:
-    return retval;
-}
-
-/*! Match specific rule to specific requested node
+/*! Recursive check for NACM read rules among all XML nodes
+ * Perform NACM action: mark if permit, del if deny
+ * @param[in]  np       NACM program
+ * @param[in]  nu       Per-user program
  * @param[in]  xn       XML node (requested node)
- * @param[in]  xrule    NACM rule
+ * @param[in]  xpv      Precomputed path instances that apply to this XML tree
  * @param[in]  yspec    YANG spec
+ * @retval  0  OK
  * @retval -1  Error
- * @retval  0  OK and rule does not match
- * @retval  1  OK and rule matches
  * Two distinct cases:
  * (1) read_default is permit
  *     mark all deny rules and remove them
@@ -818,113 +1278,57 @@ nacm_data_read_action(cxobj *xrule,
  *     mark all permit rules and ancestors, remove everything else
  */
 static int
-nacm_data_read_xrule_xml(cxobj        *xn,
-			 cxobj        *xrule,
-			 clixon_xvec  *xpathvec,
-			 yang_stmt    *yspec)
-{
-    int        retval = -1;
-    yang_stmt *ymod;
-    char      *module_pattern; /* rule module name */
-    cxobj     *xp;
-    int        i;
-    
-    if ((module_pattern = xml_find_body(xrule, "module-name")) == NULL)
-	goto nomatch;
-    /* 6a) The rule's "module-name" leaf is "*" or equals the name of
-     * the YANG module where the requested data node is defined. 
-     */
-    if (strcmp(module_pattern, "*") != 0){
-	if (ys_module_by_xml(yspec, xn, &ymod) < 0)
-	    goto done;
-	if (strcmp(yang_argument_get(ymod), module_pattern) != 0)
-	    goto nomatch;
-    }
-    /*  6b) Either (1) the rule does not have a "rule-type" defined or
-	(2) the "rule-type" is "data-node" and the "path" matches the
-	requested data node, action node, or notification node. */    
-    if (xml_find_type(xrule, NULL, "path", CX_ELMNT) == NULL){
-	if (nacm_data_read_action(xrule, xn) < 0)
-	    goto done;
-	goto match;
-    }
-    for (i=0; i<clixon_xvec_len(xpathvec); i++){
-	xp = clixon_xvec_i(xpathvec, i);
-	/* Check if ancestor is xp (for every xpathvec?) */
-	if (xn == xp || xml_isancestor(xn, xp)){
-	    if (nacm_data_read_action(xrule, xn) < 0)
-		goto done;
-	    goto match;
-	}
-    }
- nomatch:
-    retval = 0;
- done:
-    return retval;
- match:
-    retval = 1; /* match */
-    goto done;
-}
-
-/*! Recursive check for NACM read rules among all XML nodes
- * @param[in]  h        Clicon handle
- * @param[in]  xn       XML node (requested node)
- * @param[in]  rulevec  Precomputed rules that apply to this user group
- * @param[in]  xpathvec Precomputed xpath results that apply to this XML tree
- * @param[in]  yspec    YANG spec
- * @retval  0  OK
- * @retval -1  Error
- */
-static int
-nacm_datanode_read_recurse(clicon_handle h,
-			   cxobj        *xn,
-			   prepvec      *pv_list,
-			   yang_stmt    *yspec)
+nacm_datanode_read_recurse(struct nacm_prog *np,
+			   struct nacm_user *nu,
+			   cxobj            *xn,
+			   clixon_xvec     **xpv,
+			   yang_stmt        *yspec)
 {
-    int      retval = -1;
-    cxobj   *x;
-    cxobj   *xprev;
-    int      ret;
-    prepvec *pv;
+    int                   retval = -1;
+    cxobj                *x;
+    cxobj                *xprev;
+    int                   ret;
+    int                   rule;
+    struct nacm_decision *nd = NULL;
     
     if (xml_spec(xn)){ /* Check this node */
-	pv = pv_list;
-	if (pv){
-	    do {
-		if ((ret = nacm_data_read_xrule_xml(xn,
-						    pv->pv_xrule,
-						    pv->pv_xpathvec,
-						    yspec)) < 0) 
-		    goto done;	    
-		if (ret == 1)
-		    break; /* stop at first match */		    
-		pv = NEXTQ(prepvec *, pv);
-	    } while (pv && pv != pv_list);
+	if (nacm_node_rule(nu, xn, NACM_READ, xpv, yspec, &nd, &rule) < 0)
+	    goto done;
+	if (rule < nu->nu_len){ /* stop at first match */
+	    switch (nu->nu_rules[rule]->nr_action){
+	    case NR_DENY:
+		xml_flag_set(xn, XML_FLAG_DEL);
+		break;
+	    case NR_PERMIT:
+		xml_flag_set(xn, XML_FLAG_MARK);
+		break;
+	    default:
+		break;
+	    }
 	}
-
-#if 0 /* 6(A) in algorithm 
-       * If N did not match any rule R, and default rule is deny, remove that subtree */
-	if (strcmp(read_default, "deny") == 0)
-	    if (xml_tree_prune_flagged_sub(xt, XML_FLAG_MARK, 1, NULL) < 0)
-		goto done;
-#endif
+	/* If node should be purged, dont recurse and defer removal to caller */
+	if (xml_flag(xn, XML_FLAG_DEL))
+	    goto ok;
+	/* A marked or unmarked subtree is kept or pruned as a whole */
+	if ((ret = nacm_subtree_decided(np, nu, xn, nd, rule, NACM_READ, xpv)) < 0)
+	    goto done;
+	if (ret == 1)
+	    goto ok;
     }
-
-    /* If node should be purged, dont recurse and defer removal to caller */
-    if (xml_flag(xn, XML_FLAG_DEL) == 0){
-	x = NULL; 	/* Recursively check XML */
-	xprev = NULL;
-	while ((x = xml_child_each(xn, x, CX_ELMNT)) != NULL) {
-	    if (nacm_datanode_read_recurse(h, x, pv_list, yspec) < 0)
+    x = NULL; 	/* Recursively check XML */
+    xprev = NULL;
+    while ((x = xml_child_each(xn, x, CX_ELMNT)) != NULL) {
+	if (nacm_datanode_read_recurse(np, nu, x, xpv, yspec) < 0)
+	    goto done;
+	/* check for delayed remove */
+	if (xml_flag(x, XML_FLAG_DEL)){
+	    if (xml_purge(x) < 0)
 		goto done;
-	    /* check for delayed remove */
-	    if (xml_flag(x, XML_FLAG_DEL)){
-		if (xml_purge(x) < 0)
-		    goto done;
 	    x = xprev;
-	    }
 	}
+	xprev = x;
     }
+ ok:
     retval = 0;
  done:
     return retval;
@@ -970,6 +1374,7 @@ nacm_datanode_read_recurse(clicon_handle h,
  *     3. If N does not match R, and remaining rules, goto 2.
  *     4. If N matches R as deny, remove that subtree
  *     5. If N matches R as accept, mark that node
+ *   5b. If the match (or no match) of N holds for all descendants, skip them
  * 6(A). If N did not match any rule R, and default rule is deny, remove that subtree
  * 7. If remaining nodes, goto 1
  * 8(B) If default rule is deny, recursively remove all subtrees that are not marked
@@ -986,19 +1391,15 @@ nacm_datanode_read(clicon_handle h,
 		   char         *username,
 		   cxobj        *xnacm)
 {
-    int             retval = -1;
-    cxobj         **gvec = NULL; /* groups */
-    size_t          glen;
-    cxobj         **rlistvec = NULL; /* rule-list */
-    size_t          rlistlen;
-    int             i;
-    char           *read_default = NULL;
-    cvec           *nsc = NULL;
-    prepvec        *pv_list = NULL;
+    int               retval = -1;
+    int               i;
+    char             *read_default = NULL;
+    struct nacm_prog *np = NULL;
+    struct nacm_prog *tmp = NULL;
+    struct nacm_user *nu = NULL;
+    clixon_xvec     **xpv = NULL;
+    yang_stmt        *yspec;
     
-    /* Create namespace context for with nacm namespace as default */
-    if ((nsc = xml_nsctx_init(NULL, NACM_NS)) == NULL)
-	goto done;
     /* 3.   Check all the "group" entries to see if any of them contain a
        "user-name" entry that equals the username for the session
        making the request.  (If the "enable-external-groups" leaf is
@@ -1006,29 +1407,33 @@ nacm_datanode_read(clicon_handle h,
        transport layer.)	       */
     if (username == NULL)
 	goto step9;
-    /* User's group */
-    if (xpath_vec(xnacm, nsc, "groups/group[user-name='%s']", &gvec, &glen, username) < 0)
-	goto done;
-    /* 4. If no groups are found (glen=0), continue and check read-default 
+    /* 4. If no groups are found (no rules), continue and check read-default 
           in step 11. */
     /* 5. Process all rule-list entries, in the order they appear in the
         configuration.  If a rule-list's "group" leaf-list does not
         match any of the user's groups, proceed to the next rule-list
-        entry. */
-    if (xpath_vec(xnacm, nsc, "rule-list", &rlistvec, &rlistlen) < 0)
+        entry. 
+        Steps 3-5 are resolved in the per-user program */
+    if (nacm_prog_get(h, xnacm, &np, &tmp) < 0)
+	goto done;
+    if (nacm_user_get(np, username, &nu) < 0)
 	goto done;
     /* read-default has default permit so should never be NULL */
     if ((read_default = xml_find_body(xnacm, "read-default")) == NULL){
 	clicon_err(OE_XML, EINVAL, "No nacm read-default rule");
 	goto done;
     }
-    /* First run through rules and cache rules as well as lookup objects in xt. 
+    /* No rules and default permit: nothing to check */
+    if (nu->nu_len == 0 && strcmp(read_default, "deny") != 0)
+	goto ok;
+    yspec = clicon_dbspec_yang(h);
+    /* First lookup path rule objects in xt. 
      * DANGER: objects could be stale if they are removed?
      */
-    if (nacm_datanode_prepare(h, xt, NACM_READ, gvec, glen, rlistvec, rlistlen, nsc, &pv_list) < 0)
+    if (nacm_path_bind(nu, xt, NACM_READ, yspec, &xpv) < 0)
 	goto done;
     /* Then recursivelyy traverse all nodes */
-    if (nacm_datanode_read_recurse(h, xt, pv_list, clicon_dbspec_yang(h)) < 0)
+    if (nacm_datanode_read_recurse(np, nu, xt, xpv, yspec) < 0)
 	goto done;
 #if 1
     /* Step 8(B) above:
@@ -1059,14 +1464,351 @@ nacm_datanode_read(clicon_handle h,
     retval = 0;
  done:
     clicon_debug(1, "%s retval:%d", __FUNCTION__, retval);
-    if (pv_list)
-	prepvec_free(pv_list);
-    if (nsc)
-	xml_nsctx_free(nsc);
-    if (gvec)
-	free(gvec);
-    if (rlistvec)
-	free(rlistvec);
+    if (xpv)
+	nacm_path_free(xpv, nu->nu_len);
+    if (tmp)
+	nacm_prog_free(tmp);
+    return retval;
+}
+
+/* Read access state of a datastore copy, see nacm_read_filter */
+struct nacm_read{
+    struct nacm_prog  *nr_prog;    /* NACM program */
+    struct nacm_user  *nr_user;    /* Per-user program */
+    clixon_xvec      **nr_xpv;     /* Path instances in source tree, bound on first node */
+    yang_stmt         *nr_yspec;   /* YANG spec */
+    int                nr_defdeny; /* read-default is deny */
+};
+
+/*! Copy filter applying NACM read rules to a datastore node before it is copied
+ * Same decisions as nacm_datanode_read_recurse, but as copy filter return values:
+ * a denied node is not copied, a permitted node is kept, and with read-default deny a
+ * node without matching rule is only kept if an ancestor or descendant is permitted.
+ * @param[in]  x     XML node in source tree
+ * @param[in]  arg   NACM read state
+ * @retval     -1    Error
+ * @retval     r     XML_COPY_* value
+ * @see xml_copy_marked_filter
+ */
+static int
+nacm_read_filter(cxobj *x,
+		 void  *arg)
+{
+    struct nacm_read     *nr = (struct nacm_read *)arg;
+    struct nacm_user     *nu = nr->nr_user;
+    struct nacm_decision *nd = NULL;
+    int                   rule;
+    int                   action = NR_NOACTION;
+    int                   ret;
+
+    if (xml_spec(x) == NULL)
+	return nr->nr_defdeny ? XML_COPY_ANY : XML_COPY_KEEP;
+    if (nr->nr_xpv == NULL &&
+	nacm_path_bind(nu, xml_root(x), NACM_READ, nr->nr_yspec, &nr->nr_xpv) < 0)
+	return -1;
+    if (nacm_node_rule(nu, x, NACM_READ, nr->nr_xpv, nr->nr_yspec, &nd, &rule) < 0)
+	return -1;
+    if (rule < nu->nu_len)
+	action = nu->nu_rules[rule]->nr_action;
+    if (action == NR_DENY)
+	return XML_COPY_SKIP;
+    if ((ret = nacm_subtree_decided(nr->nr_prog, nu, x, nd, rule, NACM_READ, nr->nr_xpv)) < 0)
+	return -1;
+    if (action == NR_PERMIT || !nr->nr_defdeny)
+	return XML_COPY_KEEP | (ret?XML_COPY_TREE:0);
+    return XML_COPY_ANY | (ret?XML_COPY_TREE:0);
+}
+
+/*! Apply NACM read rules to default values added after a filtered datastore copy
+ * Nodes kept by nacm_read_filter are marked, and the marks are reset here.
+ * @param[in]  nr     NACM read state
+ * @param[in]  xn     XML node in copied tree
+ * @param[in]  xpv    Path instances in copied tree, bound on first default node
+ * @param[in]  inkept An ancestor of xn is permitted
+ * @param[out] keptp  Set if any child of xn is kept
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+nacm_read_defaults(struct nacm_read *nr,
+		   cxobj            *xn,
+		   clixon_xvec    ***xpv,
+		   int               inkept,
+		   int              *keptp)
+{
+    int                   retval = -1;
+    struct nacm_user     *nu = nr->nr_user;
+    struct nacm_decision *nd;
+    cxobj                *x;
+    cxobj                *xprev;
+    int                   rule;
+    int                   own;
+    int                   sub;
+    int                   kept = 0;
+
+    x = NULL;
+    xprev = NULL;
+    while ((x = xml_child_each(xn, x, CX_ELMNT)) != NULL) {
+	own = 0;
+	if (xml_flag(x, XML_FLAG_MARK)){
+	    xml_flag_reset(x, XML_FLAG_MARK);
+	    own = 1;
+	}
+	else if (xml_flag(x, XML_FLAG_DEFAULT) && xml_spec(x)){
+	    if (*xpv == NULL &&
+		nacm_path_bind(nu, xml_root(x), NACM_READ, nr->nr_yspec, xpv) < 0)
+		goto done;
+	    if (nacm_node_rule(nu, x, NACM_READ, *xpv, nr->nr_yspec, &nd, &rule) < 0)
+		goto done;
+	    if (rule < nu->nu_len && nu->nu_rules[rule]->nr_action == NR_DENY){
+		if (xml_purge(x) < 0)
+		    goto done;
+		x = xprev;
+		continue;
+	    }
+	    own = rule < nu->nu_len && nu->nu_rules[rule]->nr_action == NR_PERMIT;
+	}
+	if (nacm_read_defaults(nr, x, xpv, inkept || own, &sub) < 0)
+	    goto done;
+	if (nr->nr_defdeny && xml_flag(x, XML_FLAG_DEFAULT) && !inkept && !own && !sub){
+	    if (xml_purge(x) < 0)
+		goto done;
+	    x = xprev;
+	    continue;
+	}
+	kept++;
+	xprev = x;
+    }
+    *keptp = kept;
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Read from a datastore with NACM read access applied while copying
+ *
+ * As xmldb_get0 followed by nacm_datanode_read, but the NACM read rules are applied while
+ * the result is copied from the datastore cache. Denied subtrees are never copied, and
+ * subtrees where the decision is uniform are copied without checking each node.
+ * @param[in]  h        Clicon handle
+ * @param[in]  db       Name of datastore, eg "running"
+ * @param[in]  nsc      External XML namespace context, or NULL
+ * @param[in]  xpath    String with XPATH syntax. or NULL for all
+ * @param[in]  page     If set, only copy a page of the nodes matching xpath
+ * @param[in]  username User name of requestor
+ * @param[in]  xnacm    NACM xml tree
+ * @param[out] xret     Single return XML tree. Free with xml_free()
+ * @param[out] xerr     XML error if retval is 0
+ * @retval     -1       General error
+ * @retval     0        Parse OK but yang assigment not made (or only partial) and xerr set
+ * @retval     1        OK
+ * @see nacm_datanode_read  for the post-filter variant on an existing tree
+ */
+int
+nacm_datanode_read_get(clicon_handle  h,
+		       const char    *db,
+		       cvec          *nsc,
+		       const char    *xpath,
+		       netconf_page  *page,
+		       char          *username,
+		       cxobj         *xnacm,
+		       cxobj        **xret,
+		       cxobj        **xerr)
+{
+    int               retval = -1;
+    struct nacm_read  nr = {0,};
+    struct nacm_prog *tmp = NULL;
+    char             *read_default;
+    cxobj            *xt = NULL;
+    cxobj           **xvec = NULL;
+    size_t            xlen;
+    clixon_xvec     **xpv = NULL;
+    int               kept;
+    int               ret;
+
+    if (username != NULL){
+	if (nacm_prog_get(h, xnacm, &nr.nr_prog, &tmp) < 0)
+	    goto done;
+	if (nacm_user_get(nr.nr_prog, username, &nr.nr_user) < 0)
+	    goto done;
+	if ((read_default = xml_find_body(xnacm, "read-default")) == NULL){
+	    clicon_err(OE_XML, EINVAL, "No nacm read-default rule");
+	    goto done;
+	}
+	nr.nr_defdeny = strcmp(read_default, "deny") == 0;
+	nr.nr_yspec = clicon_dbspec_yang(h);
+    }
+    if (nr.nr_user == NULL ||                          /* Step 9: no user, all is purged */
+	(nr.nr_user->nu_len == 0 && !nr.nr_defdeny)){ /* No rules and default permit */
+	if (page)
+	    ret = xmldb_get0_page(h, db, YB_MODULE, nsc, xpath, page, &xt, xerr);
+	else
+	    ret = xmldb_get0(h, db, YB_MODULE, nsc, xpath, 1, &xt, NULL, xerr);
+	if (ret != 1){
+	    retval = ret;
+	    goto done;
+	}
+	if (nr.nr_user == NULL){
+	    if (xpath_vec(xt, nsc, "%s", &xvec, &xlen, xpath?xpath:"/") < 0)
+		goto done;
+	    if (nacm_datanode_read(h, xt, xvec, xlen, username, xnacm) < 0)
+		goto done;
+	}
+    }
+    else {
+	if ((ret = xmldb_get0_filter(h, db, YB_MODULE, nsc, xpath, page,
+				     nacm_read_filter, &nr, &xt, xerr)) != 1){
+	    retval = ret;
+	    goto done;
+	}
+	if (nacm_read_defaults(&nr, xt, &xpv, 0, &kept) < 0)
+	    goto done;
+    }
+    *xret = xt;
+    xt = NULL;
+    retval = 1;
+ done:
+    clicon_debug(1, "%s retval:%d", __FUNCTION__, retval);
+    if (xt)
+	xml_free(xt);
+    if (xvec)
+	free(xvec);
+    if (xpv)
+	nacm_path_free(xpv, nr.nr_user->nu_len);
+    if (nr.nr_xpv)
+	nacm_path_free(nr.nr_xpv, nr.nr_user->nu_len);
+    if (tmp)
+	nacm_prog_free(tmp);
+    return retval;
+}
+
+/*! Get the read decision of a node given its ancestors, top-down
+ * @param[in]  nr      NACM read state, with path instances bound in the tree of x
+ * @param[in]  x       XML node
+ * @param[out] actionp NR_DENY if x or an ancestor is denied, else NR_PERMIT if x or an
+ *                     ancestor is permitted, else NR_NOACTION
+ * @retval     0       OK
+ * @retval    -1       Error
+ */
+static int
+nacm_read_ancestors(struct nacm_read *nr,
+		    cxobj            *x,
+		    int              *actionp)
+{
+    struct nacm_user     *nu = nr->nr_user;
+    struct nacm_decision *nd = NULL;
+    int                   rule;
+
+    if (x == NULL){
+	*actionp = NR_NOACTION;
+	return 0;
+    }
+    if (nacm_read_ancestors(nr, xml_parent(x), actionp) < 0)
+	return -1;
+    if (*actionp == NR_DENY || xml_spec(x) == NULL)
+	return 0;
+    if (nacm_node_rule(nu, x, NACM_READ, nr->nr_xpv, nr->nr_yspec, &nd, &rule) < 0)
+	return -1;
+    if (rule < nu->nu_len && nu->nu_rules[rule]->nr_action != NR_NOACTION)
+	*actionp = nu->nu_rules[rule]->nr_action;
+    return 0;
+}
+
+/*! Reset marks set by nacm_read_filter in a copied tree
+ * @param[in]  x    XML node
+ * @retval     n    Nr of marked nodes in the subtree of x, including x
+ */
+static int
+nacm_read_unmark(cxobj *x)
+{
+    cxobj *xc = NULL;
+    int    n = 0;
+
+    if (xml_flag(x, XML_FLAG_MARK)){
+	xml_flag_reset(x, XML_FLAG_MARK);
+	n++;
+    }
+    while ((xc = xml_child_each(x, xc, CX_ELMNT)) != NULL)
+	n += nacm_read_unmark(xc);
+    return n;
+}
+
+/*! Copy a node of a datastore tree with NACM read access applied
+ *
+ * The node is readable unless it or an ancestor is denied, or read-default is deny and
+ * neither the node, an ancestor nor a descendant is permitted. Denied descendants are
+ * not copied. Used to check single changed nodes, eg the edits of a commit.
+ * @param[in]  h        Clicon handle
+ * @param[in]  x        XML node in a datastore tree, eg source or target of a transaction
+ * @param[in]  username User name of requestor
+ * @param[in]  xnacm    NACM xml tree
+ * @param[out] xcp      Copy of x without parent, or NULL if x is not readable.
+ *                      Free with xml_free()
+ * @retval     0        OK
+ * @retval    -1        Error
+ * @see nacm_datanode_read_get  to read a datastore
+ */
+int
+nacm_datanode_read_node(clicon_handle h,
+			cxobj        *x,
+			char         *username,
+			cxobj        *xnacm,
+			cxobj       **xcp)
+{
+    int               retval = -1;
+    struct nacm_read  nr = {0,};
+    struct nacm_prog *tmp = NULL;
+    char             *read_default;
+    cxobj            *xc = NULL;
+    int               action;
+    int               n;
+
+    *xcp = NULL;
+    if (username == NULL) /* Step 9: no user, nothing is readable */
+	goto ok;
+    if (nacm_prog_get(h, xnacm, &nr.nr_prog, &tmp) < 0)
+	goto done;
+    if (nacm_user_get(nr.nr_prog, username, &nr.nr_user) < 0)
+	goto done;
+    if ((read_default = xml_find_body(xnacm, "read-default")) == NULL){
+	clicon_err(OE_XML, EINVAL, "No nacm read-default rule");
+	goto done;
+    }
+    nr.nr_defdeny = strcmp(read_default, "deny") == 0;
+    nr.nr_yspec = clicon_dbspec_yang(h);
+    if (nr.nr_user->nu_len == 0){ /* No rules, read-default decides */
+	if (!nr.nr_defdeny && (*xcp = xml_dup(x)) == NULL)
+	    goto done;
+	goto ok;
+    }
+    if (nacm_path_bind(nr.nr_user, xml_root(x), NACM_READ, nr.nr_yspec, &nr.nr_xpv) < 0)
+	goto done;
+    if (nacm_read_ancestors(&nr, x, &action) < 0)
+	goto done;
+    if (action == NR_DENY)
+	goto ok;
+    /* In a permitted subtree only denied nodes are removed */
+    if (action == NR_PERMIT)
+	nr.nr_defdeny = 0;
+    if ((xc = xml_new(xml_name(x), NULL, CX_ELMNT)) == NULL)
+	goto done;
+    if (xml_copy_filter(x, xc, nacm_read_filter, &nr) < 0)
+	goto done;
+    n = nacm_read_unmark(xc);
+    /* With read-default deny, x is only readable if a descendant is permitted */
+    if (nr.nr_defdeny && n == 0)
+	goto ok;
+    *xcp = xc;
+    xc = NULL;
+ ok:
+    retval = 0;
+ done:
+    if (xc)
+	xml_free(xc);
+    if (nr.nr_xpv)
+	nacm_path_free(nr.nr_xpv, nr.nr_user->nu_len);
+    if (tmp)
+	nacm_prog_free(tmp);
     return retval;
 }
 
@@ -1080,49 +1822,34 @@ nacm_datanode_read(clicon_handle h,
  * If retval=0 continue with next NACM step, eg rpc, module, 
  * etc. If retval = 1 access is OK and skip next NACM step.
  * @param[in]  h        Clicon handle
- * @param[in]  xnacm    NACM XML tree, root should be "nacm"
+ * @param[in]  np       NACM program with NACM tree
+ * @param[in]  peername Peer username if any
  * @param[in]  username User name of requestor
  * @retval -1  Error
  * @retval  0  OK but not validated. Need to do NACM step using xnacm
  * @retval  1  OK permitted. You do not need to do next NACM step
- * @code
- *   if ((ret = nacm_access_check(h, mode, xnacm, peername, username)) < 0)
- *     err;
- *   if (ret == 0){
- *      // Next step NACM processing
- *      xml_free(xnacm);
- *   }
- * @endcode
  * @see RFC8341 3.4 Access Control Enforcement Procedures
  */
 static int
-nacm_access_check(clicon_handle h,
-		  cxobj        *xnacm,
-		  char         *peername,
-		  char         *username)
+nacm_access_check(clicon_handle     h,
+		  struct nacm_prog *np,
+		  char             *peername,
+		  char             *username)
 {
     int     retval = -1;
-    char   *enabled;
-    cxobj  *x;
-    cvec  *nsc = NULL;
     char  *recovery_user;
 #ifdef WITH_RESTCONF
     char  *wwwuser;
 #endif    
 
     clicon_debug(1, "%s", __FUNCTION__);
-    if ((nsc = xml_nsctx_init(NULL, NACM_NS)) == NULL)
-	goto done;
     /* Do initial nacm processing common to all access validation in
      * RFC8341 3.4 */
     /* 1.   If the "enable-nacm" leaf is set to "false", then the protocol
      * operation is permitted. 
      * note option CLICON_NACM_DISABLED_ON_EMPTY
     */
-    if ((x = xpath_first(xnacm, nsc, "enable-nacm")) == NULL)
-	goto permit;
-    enabled = xml_body(x);
-    if (strcmp(enabled, "true") != 0)
+    if (!np->np_enabled)
 	goto permit;
     recovery_user=clicon_nacm_recovery_user(h);
     /* 2.   If the requesting session is identified as a recovery session,
@@ -1161,8 +1888,6 @@ nacm_access_check(clicon_handle h,
     }
     retval = 0; /* not permitted yet. continue with next NACM step */
  done:
-    if (nsc)
-	xml_nsctx_free(nsc);
     clicon_debug(1, "%s retval:%d (0:deny 1:permit)", __FUNCTION__, retval);
     return retval;
  permit:
@@ -1170,13 +1895,147 @@ nacm_access_check(clicon_handle h,
     goto done;
 }
 
+/* Identity of the loaded external NACM file, see nacm_external_check
+ * Modification time alone has a resolution of a second on some file systems, and
+ * an editor may replace the file rather than write it.
+ */
+struct nacm_ext_stamp{
+    struct timespec es_mtim; /* Modification time */
+    off_t           es_size; /* Size */
+    ino_t           es_ino;  /* Inode */
+};
+
+/*! Get identity of a file from its status
+ * @param[in]  st   File status, or NULL if the file cannot be accessed
+ * @param[out] es   File identity
+ */
+static void
+nacm_ext_stamp_set(struct stat           *st,
+		   struct nacm_ext_stamp *es)
+{
+    memset(es, 0, sizeof(*es));
+    if (st != NULL){
+	es->es_mtim = st->st_mtim;
+	es->es_size = st->st_size;
+	es->es_ino = st->st_ino;
+    }
+}
+
+/*! Load external NACM file
+ * The file is parsed with the ietf-netconf-acm YANG of the external NACM, which is loaded
+ * on first call. Its identity is recorded, see nacm_external_check.
+ * @param[in]  h    Clicon handle
+ * @retval     0    OK
+ * @retval    -1    Error
+ * @see CLICON_NACM_FILE
+ */
+int
+nacm_load_external(clicon_handle h)
+{
+    int         retval = -1;
+    char       *filename; /* NACM config file */
+    yang_stmt  *yspec = NULL;
+    cxobj      *xt = NULL;
+    struct stat st;
+    FILE       *f = NULL;
+    struct nacm_ext_stamp es;
+
+    filename = clicon_option_str(h, "CLICON_NACM_FILE");
+    if (filename == NULL || strlen(filename)==0){
+	clicon_err(OE_UNIX, errno, "CLICON_NACM_FILE not set in NACM external mode");
+	goto done;
+    }
+    if (stat(filename, &st) < 0){
+	clicon_err(OE_UNIX, errno, "%s", filename);
+	goto done;
+    }
+    if (!S_ISREG(st.st_mode)){
+	clicon_err(OE_UNIX, 0, "%s is not a regular file", filename);
+	goto done;
+    }
+    if ((f = fopen(filename, "r")) == NULL) {
+	clicon_err(OE_UNIX, errno, "configure file: %s", filename);
+	goto done;
+    }
+    if ((yspec = clicon_nacm_ext_yang(h)) == NULL){
+	if ((yspec = yspec_new()) == NULL)
+	    goto done;
+	if (yang_spec_parse_module(h, "ietf-netconf-acm", NULL, yspec) < 0){
+	    ys_free(yspec);
+	    goto done;
+	}
+	if (clicon_nacm_ext_yang_set(h, yspec) < 0){
+	    ys_free(yspec);
+	    goto done;
+	}
+    }
+    /* Read configfile */
+    if (clixon_xml_parse_file(f, YB_MODULE, yspec, &xt, NULL) < 0)
+	goto done;
+    if (xt == NULL){
+	clicon_err(OE_XML, 0, "No xml tree in %s", filename);
+	goto done;
+    }
+    if (clicon_nacm_ext_set(h, xt) < 0)
+	goto done;
+    xt = NULL;
+    nacm_ext_stamp_set(&st, &es);
+    if (clicon_hash_add(clicon_data(h), "nacm_ext_stamp", &es, sizeof(es)) == NULL)
+	goto done;
+    retval = 0;
+ done:
+    if (xt)
+	xml_free(xt);
+    if (f)
+	fclose(f);
+    return retval;
+}
+
+/*! Reload the external NACM file if it is modified since it was loaded
+ * The file is modified if its modification time, size or inode differs. The new identity
+ * is recorded before reloading, so that a file that cannot be loaded is logged once and
+ * not retried until it is modified again. Meanwhile, the loaded NACM tree is kept.
+ * @param[in]  h    Clicon handle
+ * @retval     0    OK
+ */
+static int
+nacm_external_check(clicon_handle h)
+{
+    char                  *filename;
+    struct stat            st;
+    struct nacm_ext_stamp  es;
+    struct nacm_ext_stamp *es0;
+
+    if ((filename = clicon_option_str(h, "CLICON_NACM_FILE")) == NULL ||
+	(es0 = clicon_hash_value(clicon_data(h), "nacm_ext_stamp", NULL)) == NULL)
+	return 0;
+    nacm_ext_stamp_set(stat(filename, &st) < 0 ? NULL : &st, &es);
+    if (es.es_mtim.tv_sec == es0->es_mtim.tv_sec &&
+	es.es_mtim.tv_nsec == es0->es_mtim.tv_nsec &&
+	es.es_size == es0->es_size &&
+	es.es_ino == es0->es_ino)
+	return 0;
+    *es0 = es;
+    clicon_log(LOG_NOTICE, "%s: %s modified, reloading", __FUNCTION__, filename);
+    if (nacm_load_external(h) < 0){
+	clicon_log(LOG_WARNING, "%s: %s, keeping loaded NACM rules", __FUNCTION__, clicon_err_reason);
+	clicon_err_reset();
+    }
+    return 0;
+}
+
 /*! NACM intial pre- access control enforcements 
  * Initial NACM steps and common to all NACM access validation.
  * If retval=0 continue with next NACM step, eg rpc, module, 
  * etc. If retval = 1 access is OK and skip next NACM step.
+ * The NACM tree and its compiled program are kept in the handle and reused across requests.
+ * In internal mode, the nacm subtree of running is only read again when the running
+ * generation has changed, and the program is only recompiled if the subtree differs.
+ * In external mode, the program is recompiled when the NACM file is modified.
  * @param[in]  h        Clicon handle
+ * @param[in]  peername Peer username if any
  * @param[in]  username User name of requestor
- * @param[out] xncam    NACM XML tree, set if retval=0. Free after use
+ * @param[out] xncam    NACM XML tree, set if retval=0. Owned by NACM, do not free
  * @retval -1  Error
  * @retval  0  OK but not validated. Need to do NACM step using xnacm
  * @retval  1  OK permitted. You do not need to do next NACM step.
@@ -1185,10 +2044,10 @@ nacm_access_check(clicon_handle h,
  *   if ((ret = nacm_access_pre(h, peername, username, &xnacm)) < 0)
  *     err;
  *   if (ret == 0){
- *      // Next step NACM processing
- *      xml_free(xnacm);
+ *      // Next step NACM processing using xnacm
  *   }
  * @endcode
+ * @note xnacm is valid until next call, since the tree may be replaced
  * @see RFC8341 3.4 Access Control Enforcement Procedures
  */
 int
@@ -1197,13 +2056,14 @@ nacm_access_pre(clicon_handle  h,
 		char          *username,
 		cxobj        **xnacmp)
 {
-    int    retval = -1;
-    char  *mode;
-    cxobj *x;
-    cxobj *xnacm0 = NULL;
-    cxobj *xnacm = NULL;
-    cvec  *nsc = NULL;
+    int               retval = -1;
+    char             *mode;
+    cxobj            *x = NULL;
+    cxobj            *xt = NULL;
+    uint64_t          gen;
+    struct nacm_prog *np;
     
+    np = nacm_prog_handle(h);
     /* Check clixon option: disabled, external tree or internal */
     mode = clicon_option_str(h, "CLICON_NACM_MODE");
     if (mode == NULL)
@@ -1211,44 +2071,52 @@ nacm_access_pre(clicon_handle  h,
     else if (strcmp(mode, "disabled")==0)
 	goto permit;
     else if (strcmp(mode, "external")==0){
-	if ((x = clicon_nacm_ext(h)))
-	    if ((xnacm0 = xml_dup(x)) == NULL)
+	if (nacm_external_check(h) < 0)
+	    goto done;
+	x = clicon_nacm_ext(h);
+	if (np == NULL || np->np_src != x){
+	    if (x && (xt = xml_dup(x)) == NULL)
 		goto done;
+	    if (nacm_prog_load(h, xt, x, 0) < 0){
+		if (np == NULL)
+		    goto done;
+		/* Keep current program, and do not retry until the file is reloaded */
+		clicon_log(LOG_WARNING, "%s: %s, keeping loaded NACM rules", __FUNCTION__, clicon_err_reason);
+		clicon_err_reset();
+		np->np_src = x;
+	    }
+	}
     }
     else if (strcmp(mode, "internal")==0){
-	if (xmldb_get0(h, "running", YB_MODULE, nsc, "nacm", 1, &xnacm0, NULL, NULL) < 0)
-	    goto done;
+	gen = xmldb_generation_get(h, "running");
+	if (np == NULL || np->np_src != NULL || np->np_gen != gen){
+	    if (xmldb_get0(h, "running", YB_MODULE, NULL, "nacm", 1, &xt, NULL, NULL) < 0)
+		goto done;
+	    /* Running has changed, but recompile only if the NACM data has changed */
+	    if (np && np->np_src == NULL &&
+		nacm_tree_equal(np->np_xnacm, xt?xml_find_type(xt, NULL, "nacm", CX_ELMNT):NULL)){
+		np->np_gen = gen;
+		if (xt)
+		    xml_free(xt);
+	    }
+	    else if (nacm_prog_load(h, xt, NULL, gen) < 0)
+		goto done;
+	}
     }
     else{
 	clicon_err(OE_XML, 0, "Invalid NACM mode: %s", mode);
 	goto done;
     }
-    
-    if ((nsc = xml_nsctx_init(NULL, NACM_NS)) == NULL)
-	goto done;
-    /* If config does not exist then the operation is permitted(?) */
-    if (xnacm0 == NULL)
-	goto permit;
+    np = nacm_prog_handle(h);
     /* If config does not exist then the operation is permitted(?) */
-    if ((xnacm = xpath_first(xnacm0, nsc, "nacm")) == NULL)
+    if (np->np_xnacm == NULL)
 	goto permit;
-    if (xml_rootchild_node(xnacm0, xnacm) < 0)
-	goto done;
-    xnacm0 = NULL;
     /* Initial NACM steps and common to all NACM access validation. */
-    if ((retval = nacm_access_check(h, xnacm, peername, username)) < 0)
+    if ((retval = nacm_access_check(h, np, peername, username)) < 0)
 	goto done;
-    if (retval == 0){ /* if retval == 0 then return an xml nacm tree */
-	*xnacmp = xnacm;
-	xnacm = NULL;
-    }
+    if (retval == 0) /* if retval == 0 then return an xml nacm tree */
+	*xnacmp = np->np_xnacm;
  done:
-    if (nsc)
-	xml_nsctx_free(nsc);
-    if (xnacm0)
-	xml_free(xnacm0);
-    else if (xnacm)
-	xml_free(xnacm);
     return retval;
  permit:
     retval = 1;
@@ -1458,6 +1458,8 @@ netconf_trymerge(cxobj       *x,
  *   validate (8.6)
  *   startup (8.7)
  *   xpath (8.9)
+ * If CLICON_YANG_PUSH is set, also ietf-subscribed-notifications:xpath and
+ * ietf-yang-push:on-change
  * @see netconf_module_load  that is called later
  */
 int
@@ -1480,6 +1482,15 @@ netconf_module_features(clicon_handle h)
     if (clixon_xml_parse_string("<CLICON_FEATURE>ietf-netconf:xpath</CLICON_FEATURE>",
 				YB_PARENT, NULL, &xc, NULL) < 0)
 	goto done;
+    /* Yang-push features used by xpath filters and on-change subscriptions */
+    if (clicon_option_bool(h, "CLICON_YANG_PUSH")){
+	if (clixon_xml_parse_string("<CLICON_FEATURE>ietf-subscribed-notifications:xpath</CLICON_FEATURE>",
+				    YB_PARENT, NULL, &xc, NULL) < 0)
+	    goto done;
+	if (clixon_xml_parse_string("<CLICON_FEATURE>ietf-yang-push:on-change</CLICON_FEATURE>",
+				    YB_PARENT, NULL, &xc, NULL) < 0)
+	    goto done;
+    }
     retval = 0;
  done:
     return retval;
@@ -1509,6 +1520,10 @@ netconf_module_load(clicon_handle h)
     if (clicon_option_bool(h, "CLICON_STREAM_DISCOVERY_RFC8040") &&
 	yang_spec_parse_module(h, "ietf-restconf-monitoring", NULL, yspec)< 0)
 	goto done;
+    /* Load yang-push, RFC 8641, which imports subscribed notifications, RFC 8639 */
+    if (clicon_option_bool(h, "CLICON_YANG_PUSH") &&
+	yang_spec_parse_module(h, "ietf-yang-push", NULL, yspec)< 0)
+	goto done;
     /* YANG module revision change management */
     if (clicon_option_bool(h, "CLICON_XML_CHANGELOG"))
 	if (yang_spec_parse_module(h, "clixon-xml-changelog", NULL, yspec)< 0)
@@ -1626,6 +1641,42 @@ netconf_content_int2str(netconf_content nr)
     return clicon_int2str(netconf_content_map, nr);
 }
 
+/*! Reduce a vector of nodes to a page in place
+ * @param[in,out] vec     Vector of XML nodes, in document order
+ * @param[in,out] veclen  Length of vector
+ * @param[in]     page    Offset, limit and direction of page
+ * @retval        0       OK
+ * @code
+ *   netconf_page page = {10, 5, 0};  # Nodes 10-14
+ *   if (netconf_page_vec(xvec, &xlen, &page) < 0)
+ *      err;
+ * @endcode
+ */
+int
+netconf_page_vec(cxobj       **vec,
+		 size_t       *veclen,
+		 netconf_page *page)
+{
+    size_t start;
+    size_t len;
+
+    if (page->np_offset >= *veclen){
+	*veclen = 0;
+	return 0;
+    }
+    len = *veclen - page->np_offset;
+    if (page->np_limit && page->np_limit < len)
+	len = page->np_limit;
+    if (page->np_reverse)
+	start = *veclen - page->np_offset - len;
+    else
+	start = page->np_offset;
+    if (start)
+	memmove(vec, vec+start, len*sizeof(cxobj*));
+    *veclen = len;
+    return 0;
+}
+
 /*! Create Netconf server hello. Single cap and defer individual to querying modules
 
  * @param[in]  h           Clicon handle
@@ -1687,8 +1738,10 @@ netconf_hello_server(clicon_handle h,
     cprintf(cb, "<capabilities>");
     /* Each peer MUST send at least the base NETCONF capability, "urn:ietf:params:netconf:base:1.1" 
      * RFC 6241 Sec 8.1
+     * Unless configured to only use base:1.0 and thereby end-of-message framing
      */
-    cprintf(cb, "<capability>%s</capability>", NETCONF_BASE_CAPABILITY_1_1);
+    if (clicon_option_int(h, "CLICON_NETCONF_BASE_CAPABILITY") > 0)
+	cprintf(cb, "<capability>%s</capability>", NETCONF_BASE_CAPABILITY_1_1);
     /* A peer MAY include capabilities for previous NETCONF versions, to indicate
        that it supports multiple protocol versions. */
     cprintf(cb, "<capability>%s</capability>", NETCONF_BASE_CAPABILITY_1_0);
@@ -136,6 +136,7 @@ static const map_str2int datastore_cache_map[] = {
 static const map_str2int yang_regexp_map[] = {
     {"posix",               REGEXP_POSIX},
     {"libxml2",             REGEXP_LIBXML2},
+    {"dfa",                 REGEXP_DFA},
     {NULL,                 -1}
 };
 
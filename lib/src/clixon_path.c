@@ -196,7 +196,10 @@ instance_id_parse(char         *path,
     return retval;
 }
 
-static int
+/*! Free a list of clixon-path
+ * @param[in]  cplist   List of clixon-path as returned by eg clixon_instance_id_compile
+ */
+int
 clixon_path_free(clixon_path *cplist)
 {
     clixon_path *cp;
@@ -1755,6 +1758,73 @@ clixon_xml_find_instance_id(cxobj     *xt,
     goto done;
 }
 
+/*! Parse and resolve an instance-id path once, for repeated searches
+ *
+ * Use this instead of clixon_xml_find_instance_id if the same path is searched for in
+ * many XML trees, so that parsing and YANG resolving is made only once.
+ * @param[in]  yt       Yang statement of top symbol (can be yang-spec if top-level)
+ * @param[in]  path     Instance-id path
+ * @param[out] cplistp  Compiled path, free with clixon_path_free
+ * @retval    -1        Error
+ * @retval     0        Non-fatal failure, yang bind failures, etc, cplistp not set
+ * @retval     1        OK with compiled path in cplistp
+ * @code
+ *    clixon_path *cplist = NULL;
+ *    if ((ret = clixon_instance_id_compile(yspec, "/ex:x/ex:y", &cplist)) < 0) 
+ *       goto err;
+ *    if (ret == 1 && clixon_xml_find_instance_id_compiled(xt, yspec, cplist, &xv) < 0)
+ *       goto err;
+ *    clixon_path_free(cplist);
+ * @endcode
+ * @see clixon_xml_find_instance_id
+ */
+int
+clixon_instance_id_compile(yang_stmt    *yt,
+			   char         *path,
+			   clixon_path **cplistp)
+{
+    int          retval = -1;
+    clixon_path *cplist = NULL;
+    int          ret;
+
+    if (instance_id_parse(path, &cplist) < 0)
+	goto done;
+    if ((ret = instance_id_resolve(cplist, yt)) < 0)
+	goto done;
+    if (ret == 0)
+	goto fail;
+    *cplistp = cplist;
+    cplist = NULL;
+    retval = 1;
+ done:
+    if (cplist)
+	clixon_path_free(cplist);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Search XML tree with an instance-id path compiled by clixon_instance_id_compile
+ *
+ * @param[in]  xt       Top xml-tree where to search
+ * @param[in]  yt       Yang statement of top symbol (can be yang-spec if top-level)
+ * @param[in]  cplist   Compiled path
+ * @param[out] xvec     Vector of xml-trees. Free with clixon_xvec_free if set
+ * @retval    -1        Error
+ * @retval     0        Non-fatal failure, xvec not set
+ * @retval     1        OK with found xml nodes in xvec (if any)
+ * @see clixon_instance_id_compile
+ */
+int
+clixon_xml_find_instance_id_compiled(cxobj        *xt,
+				     yang_stmt    *yt,
+				     clixon_path  *cplist,
+				     clixon_xvec **xvec)
+{
+    return clixon_path_search(xt, yt, cplist, xvec);
+}
+
 /*! Given (instance-id) path and YANG, parse path, resolve YANG and return namespace binding
  *
  * Instance-identifier is a subset of XML XPaths and defined in Yang, used in NACM for 
@@ -101,6 +101,20 @@ typedef struct {
     char         *rc_name;	/* Xml/json tag/name */
 } rpc_callback_t;
 
+/*
+ * RPC dispatch entry: all callbacks registered for one (namespace, name) in 
+ * registration order.
+ * Entries are found via a two-level hash: namespace -> name -> entry, built at
+ * registration. Entries are not keyed on yang statements, since yang specs may be
+ * freed and reloaded while callbacks remain registered.
+ */
+typedef struct {
+    char            *re_namespace; /* Namespace of rpc */
+    char            *re_name;      /* Name of rpc */
+    int              re_len;       /* Number of callbacks */
+    rpc_callback_t **re_vec;       /* Callbacks in registration order */
+} rpc_entry_t;
+
 /*
  * Upgrade callbacks for backend upgrade of datastore
  * Register upgrade callbacks in plugin_init() with a module and a "from" and "to"
@@ -121,6 +135,7 @@ typedef struct {
 struct plugin_module_struct {
     clixon_plugin_t    *ms_plugin_list;
     rpc_callback_t     *ms_rpc_callbacks;
+    clicon_hash_t      *ms_rpc_hash;    /* namespace -> (name -> rpc_entry_t*) */
     upgrade_callback_t *ms_upgrade_callbacks;
 };
 typedef struct plugin_module_struct plugin_module_struct;
@@ -814,6 +829,82 @@ rpc_callback_dump(clicon_handle h)
 }
 #endif
 
+/*! Find rpc dispatch entry given namespace and name
+ * @param[in]  ms    Plugin module struct
+ * @param[in]  ns    Namespace
+ * @param[in]  name  RPC name
+ * @retval     re    Dispatch entry
+ * @retval     NULL  Not found
+ */
+static rpc_entry_t *
+rpc_entry_find(plugin_module_struct *ms,
+	       const char           *ns,
+	       const char           *name)
+{
+    void          *p;
+    clicon_hash_t *nh;
+
+    if (ms->ms_rpc_hash == NULL ||
+	(p = clicon_hash_value(ms->ms_rpc_hash, ns, NULL)) == NULL)
+	return NULL;
+    nh = *(clicon_hash_t **)p;
+    if ((p = clicon_hash_value(nh, name, NULL)) == NULL)
+	return NULL;
+    return *(rpc_entry_t **)p;
+}
+
+/*! Find or create rpc dispatch entry given namespace and name
+ * @retval     re    Dispatch entry
+ * @retval     NULL  Error
+ */
+static rpc_entry_t *
+rpc_entry_add(plugin_module_struct *ms,
+	      const char           *ns,
+	      const char           *name)
+{
+    rpc_entry_t   *re = NULL;
+    void          *p;
+    clicon_hash_t *nh = NULL;
+
+    if ((re = rpc_entry_find(ms, ns, name)) != NULL)
+	return re;
+    if (ms->ms_rpc_hash == NULL &&
+	(ms->ms_rpc_hash = clicon_hash_init()) == NULL)
+	goto err;
+    if ((p = clicon_hash_value(ms->ms_rpc_hash, ns, NULL)) != NULL)
+	nh = *(clicon_hash_t **)p;
+    else {
+	if ((nh = clicon_hash_init()) == NULL)
+	    goto err;
+	if (clicon_hash_add(ms->ms_rpc_hash, ns, &nh, sizeof(nh)) == NULL){
+	    clicon_hash_free(nh);
+	    goto err;
+	}
+    }
+    if ((re = malloc(sizeof(*re))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	goto err;
+    }
+    memset(re, 0, sizeof(*re));
+    if ((re->re_namespace = strdup(ns)) == NULL ||
+	(re->re_name = strdup(name)) == NULL){
+	clicon_err(OE_UNIX, errno, "strdup");
+	goto err;
+    }
+    if (clicon_hash_add(nh, name, &re, sizeof(re)) == NULL)
+	goto err;
+    return re;
+ err:
+    if (re){
+	if (re->re_namespace)
+	    free(re->re_namespace);
+	if (re->re_name)
+	    free(re->re_name);
+	free(re);
+    }
+    return NULL;
+}
+
 /*! Register a RPC callback by appending a new RPC to the list
  *
  * @param[in]  h         clicon handle
@@ -833,6 +924,8 @@ rpc_callback_register(clicon_handle  h,
 		      const char    *name)
 {
     rpc_callback_t *rc = NULL;
+    rpc_entry_t    *re;
+    rpc_callback_t **vec;
     plugin_module_struct *ms = plugin_module_struct_get(h);
 
     clicon_debug(1, "%s %s", __FUNCTION__, name);
@@ -853,6 +946,15 @@ rpc_callback_register(clicon_handle  h,
     rc->rc_arg  = arg;
     rc->rc_namespace  = strdup(ns);
     rc->rc_name  = strdup(name);
+    /* Append callback to dispatch entry of (ns, name) */
+    if ((re = rpc_entry_add(ms, ns, name)) == NULL)
+	goto done;
+    if ((vec = realloc(re->re_vec, (re->re_len+1)*sizeof(rpc_callback_t *))) == NULL){
+	clicon_err(OE_UNIX, errno, "realloc");
+	goto done;
+    }
+    re->re_vec = vec;
+    re->re_vec[re->re_len++] = rc;
     ADDQ(rc, ms->ms_rpc_callbacks);
     return 0;
  done:
@@ -872,17 +974,39 @@ static int
 rpc_callback_delete_all(clicon_handle h)
 {
     rpc_callback_t *rc;
+    rpc_entry_t    *re;
+    clicon_hash_t  *nh;
+    clicon_hash_t   hns = NULL;
+    clicon_hash_t   hn;
     plugin_module_struct *ms = plugin_module_struct_get(h);
 
-    if (ms != NULL)
-	while((rc = ms->ms_rpc_callbacks) != NULL) {
-	    DELQ(rc, ms->ms_rpc_callbacks, rpc_callback_t *);
-	    if (rc->rc_namespace)
-		free(rc->rc_namespace);
-	    if (rc->rc_name)
-		free(rc->rc_name);
-	    free(rc);
+    if (ms == NULL)
+	return 0;
+    while((rc = ms->ms_rpc_callbacks) != NULL) {
+	DELQ(rc, ms->ms_rpc_callbacks, rpc_callback_t *);
+	if (rc->rc_namespace)
+	    free(rc->rc_namespace);
+	if (rc->rc_name)
+	    free(rc->rc_name);
+	free(rc);
+    }
+    if (ms->ms_rpc_hash){
+	while ((hns = clicon_hash_next(ms->ms_rpc_hash, hns)) != NULL){
+	    nh = *(clicon_hash_t **)hns->h_val;
+	    hn = NULL;
+	    while ((hn = clicon_hash_next(nh, hn)) != NULL){
+		re = *(rpc_entry_t **)hn->h_val;
+		free(re->re_namespace);
+		free(re->re_name);
+		if (re->re_vec)
+		    free(re->re_vec);
+		free(re);
+	    }
+	    clicon_hash_free(nh);
 	}
+	clicon_hash_free(ms->ms_rpc_hash);
+	ms->ms_rpc_hash = NULL;
+    }
     return 0;
 }
 
@@ -899,6 +1023,8 @@ rpc_callback_delete_all(clicon_handle h)
  * @note that several callbacks can be registered. They need to cooperate on
  * return values, ie if one writes cbret, the other needs to handle that by
  * leaving it, replacing it or amending it.
+ * Lookup is made on (namespace, name). If xe is bound to a yang rpc or action, the
+ * namespace is that of its module, otherwise it is resolved from the XML prefix.
  */
 int
 rpc_callback_call(clicon_handle h,
@@ -908,9 +1034,12 @@ rpc_callback_call(clicon_handle h,
 {
     int            retval = -1;
     rpc_callback_t *rc;
+    rpc_entry_t    *re = NULL;
+    yang_stmt      *ye;
     char           *name;
     char           *prefix;
-    char           *ns;
+    char           *ns = NULL;
+    int             i;
     int             nr = 0; /* How many callbacks */
     plugin_module_struct *ms = plugin_module_struct_get(h);
 
@@ -919,21 +1048,24 @@ rpc_callback_call(clicon_handle h,
 	goto done;
     }
     name = xml_name(xe);
-    prefix = xml_prefix(xe);
-    xml2ns(xe, prefix, &ns);
-    if ((rc = ms->ms_rpc_callbacks) != NULL)
-	do {
-	    if (strcmp(rc->rc_name, name) == 0 &&
-		ns && rc->rc_namespace &&
-		strcmp(rc->rc_namespace, ns) == 0){
-		if (rc->rc_callback(h, xe, cbret, arg, rc->rc_arg) < 0){
-		    clicon_debug(1, "%s Error in: %s", __FUNCTION__, rc->rc_name);
-		    goto done;
-		}
-		nr++;
-	    }
-	    rc = NEXTQ(rpc_callback_t *, rc);
-	} while (rc != ms->ms_rpc_callbacks);
+    if ((ye = xml_spec(xe)) != NULL &&
+	(yang_keyword_get(ye) == Y_RPC || yang_keyword_get(ye) == Y_ACTION))
+	ns = yang_find_mynamespace(ye);
+    if (ns == NULL){
+	prefix = xml_prefix(xe);
+	xml2ns(xe, prefix, &ns);
+    }
+    if (ns != NULL)
+	re = rpc_entry_find(ms, ns, name);
+    /* Note: callbacks may register new callbacks, re-read vector */
+    for (i=0; re != NULL && i<re->re_len; i++){
+	rc = re->re_vec[i];
+	if (rc->rc_callback(h, xe, cbret, arg, rc->rc_arg) < 0){
+	    clicon_debug(1, "%s Error in: %s", __FUNCTION__, rc->rc_name);
+	    goto done;
+	}
+	nr++;
+    }
     retval = nr; /* 0: none found, >0 nr of handlers called */
  done:
     clicon_debug(1, "%s retval:%d", __FUNCTION__, retval);
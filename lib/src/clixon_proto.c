@@ -713,13 +713,12 @@ send_msg_reply(int      s,
 /*! Send a clicon_msg NOTIFY message asynchronously to client
  *
  * @param[in]  s       Socket to communicate with client
- * @param[in]  level
- * @param[in]  event
+ * @param[in]  event   Event encoded as XML string
  * @retval     0       OK
  * @retval     -1      Error
  * @see send_msg_notify_xml
  */
-static int
+int
 send_msg_notify(int           s, 
 		char         *event)
 {
@@ -793,6 +793,33 @@ clicon_rpc_get(clicon_handle   h,
 	       netconf_content content,
 	       int32_t         depth,
 	       cxobj         **xt)
+{
+    return clicon_rpc_get_page(h, xpath, nsc, content, depth, NULL, xt);
+}
+
+/*! Get a page of database configuration and state data
+ * As clicon_rpc_get but only a slice of the nodes selected by xpath is returned,
+ * eg a range of list entries
+ * @param[in]  h         Clicon handle
+ * @param[in]  xpath     XPath in a filter stmt (or NULL/"" for no filter)
+ * @param[in]  nsc       Namespace context for filter
+ * @param[in]  content   Clixon extension: all, config, noconfig. -1 means all
+ * @param[in]  depth     Nr of XML levels to get, -1 is all, 0 is none
+ * @param[in]  page      Clixon extension: offset, limit and direction, or NULL
+ * @param[out] xt        XML tree. Free with xml_free. 
+ *                       Either <config> or <rpc-error>. 
+ * @retval    0          OK
+ * @retval   -1          Error, fatal or xml
+ * @see clicon_rpc_get
+ */
+int
+clicon_rpc_get_page(clicon_handle   h, 
+		    char           *xpath,
+		    cvec           *nsc, /* namespace context for filter */
+		    netconf_content content,
+		    int32_t         depth,
+		    netconf_page   *page,
+		    cxobj         **xt)
 {
     int                retval = -1;
     struct clicon_msg *msg = NULL;
@@ -822,6 +849,14 @@ clicon_rpc_get(clicon_handle   h,
     /* Clixon extension, depth=<level> */
     if (depth != -1)
 	cprintf(cb, " depth=\"%d\"", depth);
+    /* Clixon extension, list pagination */
+    if (page){
+	cprintf(cb, " offset=\"%u\"", page->np_offset);
+	if (page->np_limit)
+	    cprintf(cb, " limit=\"%u\"", page->np_limit);
+	if (page->np_reverse)
+	    cprintf(cb, " direction=\"backwards\"");
+    }
     cprintf(cb, ">");
     if (xpath && strlen(xpath)) {
 	cprintf(cb, "<%s:filter %s:type=\"xpath\" %s:select=\"%s\"",
@@ -35,7 +35,7 @@
   *
   * Clixon regular expression code for Yang type patterns following XML Schema
   * regex. 
-  * Two modes: libxml2 and posix-translation
+  * Three modes: libxml2, posix-translation and built-in dfa
  * @see http://www.w3.org/TR/2004/REC-xmlschema-2-20041028
  */
 
@@ -241,6 +241,9 @@ regex_compile(clicon_handle h,
     case REGEXP_LIBXML2:
 	retval = cligen_regex_libxml2_compile(regexp, recomp);
 	break;
+    case REGEXP_DFA:
+	retval = regex_dfa_compile(&regexp, NULL, 1, recomp);
+	break;
     default:
     	clicon_err(OE_CFG, 0, "clicon_yang_regexp invalid value: %d", clicon_yang_regexp(h));
 	break;
@@ -256,6 +259,11 @@ regex_compile(clicon_handle h,
  * @param[in]  h       Clicon handle
  * @param[in]  recomp  Compiled regular expression 
  * @param[in]  string  Content string to match
+ * @retval     1       Match
+ * @retval     0       No match
+ * @retval    -1       Error
+ * @note In dfa mode, recomp may be a set of patterns compiled with 
+ *       regex_dfa_compile() where invert-match is already applied
  */
 int
 regex_exec(clicon_handle h,
@@ -271,6 +279,9 @@ regex_exec(clicon_handle h,
     case REGEXP_LIBXML2:
 	retval = cligen_regex_libxml2_exec(recomp, string);
 	break;
+    case REGEXP_DFA:
+	retval = regex_dfa_exec(recomp, string);
+	break;
     default:
     	clicon_err(OE_CFG, 0, "clicon_yang_regexp invalid value: %d",
 		   clicon_yang_regexp(h));
@@ -298,6 +309,9 @@ regex_free(clicon_handle h,
     case REGEXP_LIBXML2:
 	retval = cligen_regex_libxml2_free(recomp);
 	break;
+    case REGEXP_DFA:
+	retval = regex_dfa_free(recomp);
+	break;
     default:
     	clicon_err(OE_CFG, 0, "clicon_yang_regexp invalid value: %d", clicon_yang_regexp(h));
 	goto done;
@@ -0,0 +1,1466 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+
+  Copyright (C) 2009-2016 Olof Hagsand and Benny Holmgren
+  Copyright (C) 2017-2019 Olof Hagsand
+  Copyright (C) 2020-2021 Olof Hagsand and Rubicon Communications, LLC(Netgate)
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2,
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+  *
+  * Built-in automaton-based regular expression engine for Yang patterns
+  * following XML Schema regex, see:
+  *   http://www.w3.org/TR/2004/REC-xmlschema-2-20041028/#regexs
+  *
+  * Patterns are parsed into a syntax tree, then compiled to a Thompson NFA,
+  * and finally converted to a DFA by subset construction. Matching is a single
+  * table lookup per input byte, ie linear in the length of the string and
+  * without backtracking.
+  * All patterns of a type are compiled into one automaton where every
+  * accepting state carries a bitmask of the patterns it accepts. In this way
+  * all patterns (including invert-match) are evaluated in a single pass.
+  * If the subset construction exceeds RX_DFA_MAX_STATES, the NFA is kept and
+  * simulated directly instead (still linear, but slower per byte).
+  * Compiled automata are immutable, and shared between types with identical
+  * pattern sets.
+  *
+  * Limitations:
+  * - Input is matched as UTF-8. Any non-ASCII character is matched by ".", by
+  *   negated classes and by letter/mark/number categories (\p{L}, \w, \i, \c,..),
+  *   but non-ASCII characters inside a character class are approximated by
+  *   "any non-ASCII character".
+  * - "^" and "$" are ordinary characters in XSD regexps. However, as in the posix
+  *   translation, a leading "^" and a trailing "$" are accepted as (redundant)
+  *   anchors since they are common in eg openconfig models.
+  */
+
+#ifdef HAVE_CONFIG_H
+#include "clixon_config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#include <cligen/cligen.h>
+
+/* clicon */
+#include "clixon_queue.h"
+#include "clixon_hash.h"
+#include "clixon_handle.h"
+#include "clixon_err.h"
+#include "clixon_log.h"
+#include "clixon_regex.h"
+
+/* Max number of NFA states of a compiled pattern set (after expansion of
+ * counted repetitions) */
+#define RX_NFA_MAX_STATES  65536
+
+/* Max number of DFA states. If exceeded, fall back to NFA simulation */
+#define RX_DFA_MAX_STATES  4096
+
+/* Size of hash table used for DFA state lookup during subset construction */
+#define RX_DFA_HASH_SIZE   8192
+
+/* Max number of patterns in one automaton (bits in accept mask) */
+#define RX_MAX_PATTERNS    64
+
+/*
+ * Character sets. Bit per ASCII character plus a flag for all non-ASCII
+ * (multi-byte UTF-8) characters
+ */
+typedef struct {
+    uint32_t cs_map[4];  /* ASCII 0-127 */
+    int      cs_other;   /* Matches any non-ASCII character */
+} rx_cset;
+
+/* Syntax tree node types */
+enum rx_ntype {
+    RX_N_EMPTY,  /* Matches the empty string */
+    RX_N_SET,    /* Matches one character in set */
+    RX_N_BYTE,   /* Matches one byte of a non-ASCII literal character */
+    RX_N_CAT,    /* Concatenation */
+    RX_N_ALT,    /* Alternation */
+    RX_N_REPEAT  /* Counted repetition: {min,max}, max=-1 is unbounded */
+};
+
+/* Syntax tree node */
+typedef struct rx_node {
+    enum rx_ntype   rn_type;
+    struct rx_node *rn_left;
+    struct rx_node *rn_right;
+    rx_cset         rn_set;   /* RX_N_SET */
+    uint8_t         rn_byte;  /* RX_N_BYTE */
+    int             rn_min;   /* RX_N_REPEAT */
+    int             rn_max;   /* RX_N_REPEAT */
+} rx_node;
+
+/* Parser state, recursive-descent over the XSD regexp grammar */
+typedef struct {
+    char *rp_str;  /* Pattern string */
+    int   rp_i;    /* Current position */
+    int   rp_len;  /* Length of pattern string */
+} rx_parse;
+
+/* NFA state operations */
+enum rx_op {
+    RX_OP_BYTES, /* Consume one byte in byte set, then go to ns_out */
+    RX_OP_SPLIT, /* Epsilon to ns_out and ns_out1 (if >= 0) */
+    RX_OP_MATCH  /* Accepting state for pattern ns_arg */
+};
+
+/* NFA state */
+typedef struct {
+    enum rx_op ns_op;
+    int        ns_out;
+    int        ns_out1;
+    int        ns_arg;   /* Byte set index (BYTES) or pattern index (MATCH) */
+} rx_nstate;
+
+/* Byte set: 256 bits */
+typedef struct {
+    uint32_t bs_map[8];
+} rx_bytes;
+
+/*! Compiled pattern set
+ * Either a DFA (rx_trans != NULL) or an NFA to be simulated
+ */
+struct regex_dfa {
+    int        rx_refcnt;    /* Shared between types with same patterns */
+    char      *rx_key;       /* Key in shared table */
+    int        rx_npatterns; /* Number of patterns */
+    uint64_t   rx_all;       /* Mask of all patterns */
+    uint64_t   rx_invert;    /* Mask of invert-match patterns */
+    /* NFA */
+    rx_nstate *rx_nfa;       /* Vector of NFA states */
+    int        rx_nlen;      /* Number of NFA states */
+    int        rx_nmax;      /* Allocated NFA states */
+    int        rx_nstart;    /* NFA start state */
+    rx_bytes  *rx_bytes;     /* Vector of byte sets referenced by NFA states */
+    int        rx_blen;      /* Number of byte sets */
+    int        rx_bmax;      /* Allocated byte sets */
+    /* DFA */
+    uint8_t    rx_classmap[256]; /* Byte -> equivalence class */
+    int        rx_nclasses;  /* Number of byte equivalence classes */
+    int       *rx_trans;     /* Transition table: [state*nclasses+class], 0 is dead */
+    uint64_t  *rx_accept;    /* Accept mask per DFA state */
+    int        rx_dlen;      /* Number of DFA states (including dead state 0) */
+};
+
+/* Shared table of compiled pattern sets, keyed by pattern set */
+static clicon_hash_t *_rx_shared = NULL;
+
+/*-------------------------- Character sets ---------------------------*/
+
+static void
+cset_add(rx_cset *cs,
+	 int      c)
+{
+    if (c < 128)
+	cs->cs_map[c/32] |= (1U << (c%32));
+    else
+	cs->cs_other = 1;
+}
+
+static void
+cset_add_range(rx_cset *cs,
+	       int      lo,
+	       int      hi)
+{
+    int c;
+
+    for (c = lo; c <= hi && c < 128; c++)
+	cset_add(cs, c);
+    if (hi >= 128)
+	cs->cs_other = 1;
+}
+
+static void
+cset_add_str(rx_cset *cs,
+	     char    *str)
+{
+    while (*str)
+	cset_add(cs, (uint8_t)*str++);
+}
+
+static void
+cset_union(rx_cset *cs,
+	   rx_cset *cs1)
+{
+    int i;
+
+    for (i=0; i<4; i++)
+	cs->cs_map[i] |= cs1->cs_map[i];
+    cs->cs_other |= cs1->cs_other;
+}
+
+static void
+cset_complement(rx_cset *cs)
+{
+    int i;
+
+    for (i=0; i<4; i++)
+	cs->cs_map[i] = ~cs->cs_map[i];
+    cs->cs_other = !cs->cs_other;
+}
+
+static void
+cset_subtract(rx_cset *cs,
+	      rx_cset *cs1)
+{
+    int i;
+
+    for (i=0; i<4; i++)
+	cs->cs_map[i] &= ~cs1->cs_map[i];
+    cs->cs_other = cs->cs_other && !cs1->cs_other;
+}
+
+/* ASCII members of Unicode general categories, see \p{X} */
+#define RX_PUNCT  "!\"#%&'()*,-./:;?@[\\]_{}"
+#define RX_SYMBOL "$+<=>^`|~"
+
+/*! Set character set from Unicode category or block name, eg \p{Lu}
+ * Non-ASCII letters, marks and numbers are approximated by any non-ASCII char
+ * @retval  1  OK
+ * @retval  0  Unknown category
+ */
+static int
+cset_category(rx_cset *cs,
+	      char    *name)
+{
+    memset(cs, 0, sizeof(*cs));
+    if (strncmp(name, "Is", 2) == 0){ /* Block escape */
+	if (strcmp(name, "IsBasicLatin") == 0)
+	    cset_add_range(cs, 0, 127);
+	else
+	    cs->cs_other = 1;
+	return 1;
+    }
+    switch (name[0]){
+    case 'L':
+	if (name[1] == '\0' || name[1] == 'u')
+	    cset_add_range(cs, 'A', 'Z');
+	if (name[1] == '\0' || name[1] == 'l')
+	    cset_add_range(cs, 'a', 'z');
+	if (name[1] != '\0' && strchr("ultmo", name[1]) == NULL)
+	    return 0;
+	cs->cs_other = 1;
+	break;
+    case 'M':
+	if (name[1] != '\0' && strchr("nce", name[1]) == NULL)
+	    return 0;
+	cs->cs_other = 1;
+	break;
+    case 'N':
+	if (name[1] == '\0' || name[1] == 'd')
+	    cset_add_range(cs, '0', '9');
+	if (name[1] != '\0' && strchr("dlo", name[1]) == NULL)
+	    return 0;
+	cs->cs_other = 1;
+	break;
+    case 'P':
+	switch (name[1]){
+	case '\0': cset_add_str(cs, RX_PUNCT); break;
+	case 'c':  cset_add_str(cs, "_"); break;
+	case 'd':  cset_add_str(cs, "-"); break;
+	case 's':  cset_add_str(cs, "([{"); break;
+	case 'e':  cset_add_str(cs, ")]}"); break;
+	case 'i':
+	case 'f':  break;
+	case 'o':  cset_add_str(cs, "!\"#%&'*,./:;?@\\"); break;
+	default:   return 0;
+	}
+	break;
+    case 'Z':
+	if (name[1] == '\0' || name[1] == 's')
+	    cset_add(cs, ' ');
+	if (name[1] != '\0' && strchr("slp", name[1]) == NULL)
+	    return 0;
+	break;
+    case 'S':
+	switch (name[1]){
+	case '\0': cset_add_str(cs, RX_SYMBOL); break;
+	case 'm':  cset_add_str(cs, "+<=>|~"); break;
+	case 'c':  cset_add_str(cs, "$"); break;
+	case 'k':  cset_add_str(cs, "^`"); break;
+	case 'o':  break;
+	default:   return 0;
+	}
+	break;
+    case 'C':
+	if (name[1] == '\0' || name[1] == 'c'){
+	    cset_add_range(cs, 0, 31);
+	    cset_add(cs, 127);
+	}
+	if (name[1] != '\0' && strchr("cfon", name[1]) == NULL)
+	    return 0;
+	break;
+    default:
+	return 0;
+    }
+    if (name[1] != '\0' && name[2] != '\0')
+	return 0;
+    return 1;
+}
+
+/*! Set character set from multi-character escape, eg \d
+ * @retval  1  OK
+ * @retval  0  Not a multi-character escape
+ */
+static int
+cset_escape(rx_cset *cs,
+	    int      c)
+{
+    rx_cset cs1;
+
+    memset(cs, 0, sizeof(*cs));
+    switch (c){
+    case 'd': case 'D':
+	cset_add_range(cs, '0', '9');
+	break;
+    case 's': case 'S':
+	cset_add_str(cs, " \t\n\r");
+	break;
+    case 'i': case 'I': /* XML initial name char */
+	cset_add_range(cs, 'a', 'z');
+	cset_add_range(cs, 'A', 'Z');
+	cset_add_str(cs, "_:");
+	cs->cs_other = 1;
+	break;
+    case 'c': case 'C': /* XML name char */
+	cset_add_range(cs, 'a', 'z');
+	cset_add_range(cs, 'A', 'Z');
+	cset_add_range(cs, '0', '9');
+	cset_add_str(cs, "._:-");
+	cs->cs_other = 1;
+	break;
+    case 'w': case 'W': /* [#x0000-#x10FFFF]-[\p{P}\p{Z}\p{C}] */
+	cset_category(&cs1, "P");
+	cset_union(cs, &cs1);
+	cset_category(&cs1, "Z");
+	cset_union(cs, &cs1);
+	cset_category(&cs1, "C");
+	cset_union(cs, &cs1);
+	cset_complement(cs);
+	break;
+    default:
+	return 0;
+    }
+    if (c >= 'A' && c <= 'Z')
+	cset_complement(cs);
+    return 1;
+}
+
+/*! Translate single character escape, eg \n
+ * @retval  c  Character
+ * @retval -1  Not a single char escape
+ */
+static int
+rx_single_escape(int c)
+{
+    switch (c){
+    case 'n':
+	return '\n';
+    case 'r':
+	return '\r';
+    case 't':
+	return '\t';
+    case '\\': case '|': case '.': case '?': case '*': case '+':
+    case '(': case ')': case '{': case '}': case '-': case '[':
+    case ']': case '^': case '$':
+	return c;
+    default:
+	break;
+    }
+    return -1;
+}
+
+/*-------------------------- Parser ----------------------------------*/
+
+static rx_node *
+rx_node_new(enum rx_ntype type)
+{
+    rx_node *rn;
+
+    if ((rn = malloc(sizeof(*rn))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	return NULL;
+    }
+    memset(rn, 0, sizeof(*rn));
+    rn->rn_type = type;
+    return rn;
+}
+
+static void
+rx_node_free(rx_node *rn)
+{
+    if (rn == NULL)
+	return;
+    rx_node_free(rn->rn_left);
+    rx_node_free(rn->rn_right);
+    free(rn);
+}
+
+static rx_node *
+rx_node_binary(enum rx_ntype type,
+	       rx_node      *left,
+	       rx_node      *right)
+{
+    rx_node *rn;
+
+    if ((rn = rx_node_new(type)) == NULL){
+	rx_node_free(left);
+	rx_node_free(right);
+	return NULL;
+    }
+    rn->rn_left = left;
+    rn->rn_right = right;
+    return rn;
+}
+
+static int
+rx_peek(rx_parse *rp)
+{
+    return rp->rp_i < rp->rp_len ? (uint8_t)rp->rp_str[rp->rp_i] : -1;
+}
+
+/*! Parse escape following backslash into character set
+ * @retval  1  OK
+ * @retval  0  Syntax error
+ */
+static int
+rx_parse_escape(rx_parse *rp,
+		rx_cset  *cs)
+{
+    int   c;
+    char *end;
+    char  name[32];
+    int   len;
+
+    if ((c = rx_peek(rp)) < 0)
+	return 0;
+    rp->rp_i++;
+    if (c == 'p' || c == 'P'){ /* Category escape \p{X} */
+	if (rx_peek(rp) != '{' ||
+	    (end = strchr(rp->rp_str + rp->rp_i, '}')) == NULL)
+	    return 0;
+	len = end - (rp->rp_str + rp->rp_i + 1);
+	if (len <= 0 || len >= sizeof(name))
+	    return 0;
+	memcpy(name, rp->rp_str + rp->rp_i + 1, len);
+	name[len] = '\0';
+	rp->rp_i += len + 2;
+	if (cset_category(cs, name) == 0)
+	    return 0;
+	if (c == 'P')
+	    cset_complement(cs);
+	return 1;
+    }
+    if (cset_escape(cs, c))
+	return 1;
+    memset(cs, 0, sizeof(*cs));
+    if ((c = rx_single_escape(c)) < 0)
+	return 0;
+    cset_add(cs, c);
+    return 1;
+}
+
+/*! Parse character class expression: [...], opening bracket consumed
+ * Handles ranges, negation and class subtraction: [a-z-[aeiou]]
+ * @retval  1  OK
+ * @retval  0  Syntax error
+ */
+static int
+rx_parse_class(rx_parse *rp,
+	       rx_cset  *cs)
+{
+    int     neg = 0;
+    int     c;
+    int     lo;
+    int     hi;
+    int     first = 1;
+    rx_cset cs1;
+
+    memset(cs, 0, sizeof(*cs));
+    if (rx_peek(rp) == '^'){
+	neg++;
+	rp->rp_i++;
+    }
+    while (1){
+	if ((c = rx_peek(rp)) < 0)
+	    return 0;
+	if (c == ']' && !first){
+	    rp->rp_i++;
+	    break;
+	}
+	first = 0;
+	if (c == '-' && rp->rp_i+1 < rp->rp_len && rp->rp_str[rp->rp_i+1] == '['){
+	    /* Subtraction, must be last in group */
+	    rp->rp_i += 2;
+	    if (rx_parse_class(rp, &cs1) == 0)
+		return 0;
+	    if (rx_peek(rp) != ']')
+		return 0;
+	    rp->rp_i++;
+	    if (neg)
+		cset_complement(cs);
+	    cset_subtract(cs, &cs1);
+	    return 1;
+	}
+	rp->rp_i++;
+	if (c == '\\'){
+	    /* Multi-char escapes cannot be range endpoints */
+	    if ((lo = rx_peek(rp)) < 0)
+		return 0;
+	    if ((lo = rx_single_escape(lo)) < 0){
+		if (rx_parse_escape(rp, &cs1) == 0)
+		    return 0;
+		cset_union(cs, &cs1);
+		continue;
+	    }
+	    rp->rp_i++;
+	}
+	else
+	    lo = c;
+	hi = lo;
+	if (rx_peek(rp) == '-' && rp->rp_i+1 < rp->rp_len &&
+	    rp->rp_str[rp->rp_i+1] != ']' && rp->rp_str[rp->rp_i+1] != '['){
+	    rp->rp_i++;
+	    hi = rx_peek(rp);
+	    rp->rp_i++;
+	    if (hi == '\\'){
+		if ((hi = rx_single_escape(rx_peek(rp))) < 0)
+		    return 0;
+		rp->rp_i++;
+	    }
+	    if (hi < lo)
+		return 0;
+	}
+	cset_add_range(cs, lo, hi);
+	/* Skip UTF-8 continuation bytes of non-ASCII character */
+	while ((c = rx_peek(rp)) >= 0x80 && c < 0xc0)
+	    rp->rp_i++;
+    }
+    if (neg)
+	cset_complement(cs);
+    return 1;
+}
+
+static rx_node *rx_parse_regexp(rx_parse *rp, int *ok);
+
+/*! Parse atom: normal char, character class or parenthesized regexp
+ * @param[out] ok  Set to 0 on syntax error
+ */
+static rx_node *
+rx_parse_atom(rx_parse *rp,
+	      int      *ok)
+{
+    rx_node *rn = NULL;
+    rx_node *rn1;
+    int      c;
+
+    c = rx_peek(rp);
+    rp->rp_i++;
+    switch (c){
+    case '(':
+	if ((rn = rx_parse_regexp(rp, ok)) == NULL || *ok == 0)
+	    return rn;
+	if (rx_peek(rp) != ')'){
+	    *ok = 0;
+	    return rn;
+	}
+	rp->rp_i++;
+	break;
+    case '[':
+	if ((rn = rx_node_new(RX_N_SET)) == NULL)
+	    return NULL;
+	if (rx_parse_class(rp, &rn->rn_set) == 0)
+	    *ok = 0;
+	break;
+    case '\\':
+	if ((rn = rx_node_new(RX_N_SET)) == NULL)
+	    return NULL;
+	if (rx_parse_escape(rp, &rn->rn_set) == 0)
+	    *ok = 0;
+	break;
+    case '.':
+	if ((rn = rx_node_new(RX_N_SET)) == NULL)
+	    return NULL;
+	cset_add_str(&rn->rn_set, "\n\r");
+	cset_complement(&rn->rn_set);
+	break;
+    default:
+	if (c < 0x80){
+	    if ((rn = rx_node_new(RX_N_SET)) == NULL)
+		return NULL;
+	    cset_add(&rn->rn_set, c);
+	    break;
+	}
+	/* Non-ASCII literal: concatenation of its UTF-8 bytes */
+	if ((rn = rx_node_new(RX_N_BYTE)) == NULL)
+	    return NULL;
+	rn->rn_byte = c;
+	while ((c = rx_peek(rp)) >= 0x80 && c < 0xc0){
+	    rp->rp_i++;
+	    if ((rn1 = rx_node_new(RX_N_BYTE)) == NULL){
+		rx_node_free(rn);
+		return NULL;
+	    }
+	    rn1->rn_byte = c;
+	    if ((rn = rx_node_binary(RX_N_CAT, rn, rn1)) == NULL)
+		return NULL;
+	}
+	break;
+    }
+    return rn;
+}
+
+/*! Parse quantifier {n}, {n,} or {n,m}, opening brace consumed
+ * @retval  1  OK
+ * @retval  0  Not a quantifier (brace is then a literal)
+ */
+static int
+rx_parse_quantity(rx_parse *rp,
+		  int      *min,
+		  int      *max)
+{
+    int i = rp->rp_i;
+    int n = 0;
+    int m = -1;
+    int digits = 0;
+
+    while (i < rp->rp_len && rp->rp_str[i] >= '0' && rp->rp_str[i] <= '9'){
+	n = n*10 + rp->rp_str[i++] - '0';
+	if (n > RX_NFA_MAX_STATES)
+	    return 0;
+	digits++;
+    }
+    if (digits == 0 || i >= rp->rp_len)
+	return 0;
+    if (rp->rp_str[i] == '}')
+	m = n;
+    else if (rp->rp_str[i] == ','){
+	i++;
+	if (i < rp->rp_len && rp->rp_str[i] >= '0' && rp->rp_str[i] <= '9'){
+	    m = 0;
+	    while (i < rp->rp_len && rp->rp_str[i] >= '0' && rp->rp_str[i] <= '9'){
+		m = m*10 + rp->rp_str[i++] - '0';
+		if (m > RX_NFA_MAX_STATES)
+		    return 0;
+	    }
+	    if (m < n)
+		return 0;
+	}
+	if (i >= rp->rp_len || rp->rp_str[i] != '}')
+	    return 0;
+    }
+    else
+	return 0;
+    rp->rp_i = i+1;
+    *min = n;
+    *max = m;
+    return 1;
+}
+
+/*! Parse branch: sequence of pieces: atom followed by optional quantifier
+ */
+static rx_node *
+rx_parse_branch(rx_parse *rp,
+		int      *ok)
+{
+    rx_node *rn = NULL;
+    rx_node *rn1;
+    rx_node *rq;
+    int      c;
+    int      min;
+    int      max;
+
+    if ((rn = rx_node_new(RX_N_EMPTY)) == NULL)
+	return NULL;
+    while (*ok && (c = rx_peek(rp)) >= 0 && c != '|' && c != ')'){
+	if (c == '?' || c == '*' || c == '+'){ /* Quantifier without atom */
+	    *ok = 0;
+	    break;
+	}
+	if ((rn1 = rx_parse_atom(rp, ok)) == NULL){
+	    rx_node_free(rn);
+	    return NULL;
+	}
+	if (*ok == 0){
+	    rx_node_free(rn1);
+	    break;
+	}
+	min = -1;
+	max = -1;
+	switch (rx_peek(rp)){
+	case '?':
+	    min = 0; max = 1;
+	    rp->rp_i++;
+	    break;
+	case '*':
+	    min = 0; max = -1;
+	    rp->rp_i++;
+	    break;
+	case '+':
+	    min = 1; max = -1;
+	    rp->rp_i++;
+	    break;
+	case '{':
+	    rp->rp_i++;
+	    if (rx_parse_quantity(rp, &min, &max) == 0){
+		*ok = 0;
+		min = -1;
+	    }
+	    break;
+	default:
+	    break;
+	}
+	if (min >= 0){
+	    if ((rq = rx_node_new(RX_N_REPEAT)) == NULL){
+		rx_node_free(rn1);
+		rx_node_free(rn);
+		return NULL;
+	    }
+	    rq->rn_left = rn1;
+	    rq->rn_min = min;
+	    rq->rn_max = max;
+	    rn1 = rq;
+	}
+	if ((rn = rx_node_binary(RX_N_CAT, rn, rn1)) == NULL)
+	    return NULL;
+    }
+    return rn;
+}
+
+/*! Parse regexp: branches separated by '|'
+ */
+static rx_node *
+rx_parse_regexp(rx_parse *rp,
+		int      *ok)
+{
+    rx_node *rn;
+    rx_node *rn1;
+
+    if ((rn = rx_parse_branch(rp, ok)) == NULL)
+	return NULL;
+    while (*ok && rx_peek(rp) == '|'){
+	rp->rp_i++;
+	if ((rn1 = rx_parse_branch(rp, ok)) == NULL){
+	    rx_node_free(rn);
+	    return NULL;
+	}
+	if ((rn = rx_node_binary(RX_N_ALT, rn, rn1)) == NULL)
+	    return NULL;
+    }
+    return rn;
+}
+
+/*-------------------------- NFA ------------------------------------*/
+
+/*! Add NFA state
+ * @retval  i  Index of new state
+ * @retval -1  Error
+ */
+static int
+nfa_state_add(struct regex_dfa *rx,
+	      enum rx_op        op,
+	      int               out,
+	      int               out1,
+	      int               arg)
+{
+    rx_nstate *ns;
+
+    if (rx->rx_nlen >= RX_NFA_MAX_STATES){
+	clicon_err(OE_YANG, 0, "regexp too large, max %d automaton states",
+		   RX_NFA_MAX_STATES);
+	return -1;
+    }
+    if (rx->rx_nlen >= rx->rx_nmax){
+	rx->rx_nmax = rx->rx_nmax ? rx->rx_nmax*2 : 64;
+	if ((rx->rx_nfa = realloc(rx->rx_nfa, rx->rx_nmax*sizeof(rx_nstate))) == NULL){
+	    clicon_err(OE_UNIX, errno, "realloc");
+	    return -1;
+	}
+    }
+    ns = &rx->rx_nfa[rx->rx_nlen];
+    ns->ns_op = op;
+    ns->ns_out = out;
+    ns->ns_out1 = out1;
+    ns->ns_arg = arg;
+    return rx->rx_nlen++;
+}
+
+/*! Add byte set state, share identical byte sets
+ */
+static int
+nfa_bytes_add(struct regex_dfa *rx,
+	      rx_bytes         *bs,
+	      int               out)
+{
+    int i;
+
+    for (i=0; i<rx->rx_blen; i++)
+	if (memcmp(&rx->rx_bytes[i], bs, sizeof(*bs)) == 0)
+	    break;
+    if (i == rx->rx_blen){
+	if (rx->rx_blen >= rx->rx_bmax){
+	    rx->rx_bmax = rx->rx_bmax ? rx->rx_bmax*2 : 16;
+	    if ((rx->rx_bytes = realloc(rx->rx_bytes, rx->rx_bmax*sizeof(rx_bytes))) == NULL){
+		clicon_err(OE_UNIX, errno, "realloc");
+		return -1;
+	    }
+	}
+	rx->rx_bytes[rx->rx_blen++] = *bs;
+    }
+    return nfa_state_add(rx, RX_OP_BYTES, out, -1, i);
+}
+
+static int
+nfa_byte_range(struct regex_dfa *rx,
+	       int               lo,
+	       int               hi,
+	       int               out)
+{
+    rx_bytes bs;
+    int      c;
+
+    memset(&bs, 0, sizeof(bs));
+    for (c=lo; c<=hi; c++)
+	bs.bs_map[c/32] |= (1U << (c%32));
+    return nfa_bytes_add(rx, &bs, out);
+}
+
+/*! Compile a character set to NFA: one ASCII byte or a UTF-8 sequence
+ */
+static int
+nfa_compile_set(struct regex_dfa *rx,
+		rx_cset          *cs,
+		int               next)
+{
+    rx_bytes bs;
+    int      s;
+    int      t1;
+    int      t2;
+    int      t3;
+
+    memset(&bs, 0, sizeof(bs));
+    memcpy(bs.bs_map, cs->cs_map, sizeof(cs->cs_map));
+    if ((s = nfa_bytes_add(rx, &bs, next)) < 0)
+	return -1;
+    if (!cs->cs_other)
+	return s;
+    /* Continuation bytes */
+    if ((t1 = nfa_byte_range(rx, 0x80, 0xbf, next)) < 0 ||
+	(t2 = nfa_byte_range(rx, 0x80, 0xbf, t1)) < 0 ||
+	(t3 = nfa_byte_range(rx, 0x80, 0xbf, t2)) < 0)
+	return -1;
+    /* Lead bytes */
+    if ((t1 = nfa_byte_range(rx, 0xc2, 0xdf, t1)) < 0 ||
+	(t2 = nfa_byte_range(rx, 0xe0, 0xef, t2)) < 0 ||
+	(t3 = nfa_byte_range(rx, 0xf0, 0xf4, t3)) < 0)
+	return -1;
+    if ((s = nfa_state_add(rx, RX_OP_SPLIT, s, t1, 0)) < 0 ||
+	(s = nfa_state_add(rx, RX_OP_SPLIT, s, t2, 0)) < 0 ||
+	(s = nfa_state_add(rx, RX_OP_SPLIT, s, t3, 0)) < 0)
+	return -1;
+    return s;
+}
+
+/*! Compile syntax tree to NFA, right-to-left given continuation state
+ * @param[in]  rx    Compiled pattern set
+ * @param[in]  rn    Syntax tree node
+ * @param[in]  next  State to continue to after rn has matched
+ * @retval     s     Start state of rn
+ * @retval    -1     Error
+ */
+static int
+nfa_compile(struct regex_dfa *rx,
+	    rx_node          *rn,
+	    int               next)
+{
+    int s;
+    int s1;
+    int loop;
+    int i;
+
+    switch (rn->rn_type){
+    case RX_N_EMPTY:
+	return next;
+    case RX_N_SET:
+	return nfa_compile_set(rx, &rn->rn_set, next);
+    case RX_N_BYTE:
+	return nfa_byte_range(rx, rn->rn_byte, rn->rn_byte, next);
+    case RX_N_CAT:
+	if ((s = nfa_compile(rx, rn->rn_right, next)) < 0)
+	    return -1;
+	return nfa_compile(rx, rn->rn_left, s);
+    case RX_N_ALT:
+	if ((s = nfa_compile(rx, rn->rn_left, next)) < 0 ||
+	    (s1 = nfa_compile(rx, rn->rn_right, next)) < 0)
+	    return -1;
+	return nfa_state_add(rx, RX_OP_SPLIT, s, s1, 0);
+    case RX_N_REPEAT:
+	s = next;
+	if (rn->rn_max < 0){ /* x* */
+	    if ((loop = nfa_state_add(rx, RX_OP_SPLIT, -1, next, 0)) < 0)
+		return -1;
+	    if ((s1 = nfa_compile(rx, rn->rn_left, loop)) < 0)
+		return -1;
+	    rx->rx_nfa[loop].ns_out = s1;
+	    s = loop;
+	}
+	else /* x{0,max-min} as nested optionals: (x(x)?)? */
+	    for (i=0; i<rn->rn_max-rn->rn_min; i++){
+		if ((s1 = nfa_compile(rx, rn->rn_left, s)) < 0)
+		    return -1;
+		if ((s = nfa_state_add(rx, RX_OP_SPLIT, s1, next, 0)) < 0)
+		    return -1;
+	    }
+	for (i=0; i<rn->rn_min; i++)
+	    if ((s = nfa_compile(rx, rn->rn_left, s)) < 0)
+		return -1;
+	return s;
+    }
+    return -1;
+}
+
+/*! Add state and its epsilon-closure to a state list
+ * Only consuming (BYTES) and accepting (MATCH) states are added.
+ * @param[in]     rx     Compiled pattern set
+ * @param[in]     s      NFA state
+ * @param[in,out] list   State list
+ * @param[in,out] len    Length of state list
+ * @param[in,out] mark   Per-state generation marks
+ * @param[in]     gen    Current generation
+ * @param[in]     stack  Work stack, at least rx_nlen elements
+ */
+static void
+nfa_closure(struct regex_dfa *rx,
+	    int               s,
+	    int              *list,
+	    int              *len,
+	    unsigned         *mark,
+	    unsigned          gen,
+	    int              *stack)
+{
+    int        sp = 0;
+    rx_nstate *ns;
+
+    stack[sp++] = s;
+    while (sp > 0){
+	s = stack[--sp];
+	if (s < 0 || mark[s] == gen)
+	    continue;
+	mark[s] = gen;
+	ns = &rx->rx_nfa[s];
+	if (ns->ns_op == RX_OP_SPLIT){
+	    /* Push out1 first to preserve order */
+	    stack[sp++] = ns->ns_out1;
+	    stack[sp++] = ns->ns_out;
+	}
+	else
+	    list[(*len)++] = s;
+    }
+}
+
+static int
+int_cmp(const void *a,
+	const void *b)
+{
+    return *(int*)a - *(int*)b;
+}
+
+/*! FNV-1a hash of a sorted NFA state list
+ */
+static uint32_t
+list_hash(int *list,
+	  int  len)
+{
+    uint32_t h = 2166136261U;
+    int      i;
+
+    for (i=0; i<len; i++){
+	h ^= (uint32_t)list[i];
+	h *= 16777619U;
+    }
+    return h % RX_DFA_HASH_SIZE;
+}
+
+/*! Step a state list over one byte
+ */
+static void
+nfa_step(struct regex_dfa *rx,
+	 int              *list,
+	 int               len,
+	 int               c,
+	 int              *next,
+	 int              *nlen,
+	 unsigned         *mark,
+	 unsigned          gen,
+	 int              *stack)
+{
+    int        i;
+    rx_nstate *ns;
+
+    *nlen = 0;
+    for (i=0; i<len; i++){
+	ns = &rx->rx_nfa[list[i]];
+	if (ns->ns_op == RX_OP_BYTES &&
+	    rx->rx_bytes[ns->ns_arg].bs_map[c/32] & (1U << (c%32)))
+	    nfa_closure(rx, ns->ns_out, next, nlen, mark, gen, stack);
+    }
+}
+
+static uint64_t
+nfa_accept(struct regex_dfa *rx,
+	   int              *list,
+	   int               len)
+{
+    uint64_t mask = 0;
+    int      i;
+
+    for (i=0; i<len; i++)
+	if (rx->rx_nfa[list[i]].ns_op == RX_OP_MATCH)
+	    mask |= ((uint64_t)1 << rx->rx_nfa[list[i]].ns_arg);
+    return mask;
+}
+
+/*-------------------------- DFA ------------------------------------*/
+
+/*! Compute byte equivalence classes: bytes not distinguished by any byte set
+ */
+static void
+dfa_classes(struct regex_dfa *rx)
+{
+    int     i;
+    int     c;
+    int     n;
+    int     in;
+    int     renum[512];
+
+    memset(rx->rx_classmap, 0, sizeof(rx->rx_classmap));
+    n = 1;
+    for (i=0; i<rx->rx_blen; i++){
+	memset(renum, 0xff, sizeof(renum));
+	n = 0;
+	for (c=0; c<256; c++){
+	    in = (rx->rx_bytes[i].bs_map[c/32] & (1U << (c%32))) != 0;
+	    if (renum[rx->rx_classmap[c]*2 + in] < 0)
+		renum[rx->rx_classmap[c]*2 + in] = n++;
+	    rx->rx_classmap[c] = renum[rx->rx_classmap[c]*2 + in];
+	}
+    }
+    rx->rx_nclasses = n;
+}
+
+/*! Free DFA part of compiled pattern set
+ */
+static void
+dfa_free(struct regex_dfa *rx)
+{
+    if (rx->rx_trans){
+	free(rx->rx_trans);
+	rx->rx_trans = NULL;
+    }
+    if (rx->rx_accept){
+	free(rx->rx_accept);
+	rx->rx_accept = NULL;
+    }
+    rx->rx_dlen = 0;
+}
+
+/*! Build DFA from NFA by subset construction
+ * DFA states are identified by their sorted NFA state lists.
+ * On success the tables are shrunk to the number of states and the NFA is freed.
+ * @retval  1  OK
+ * @retval  0  Too many states, use NFA simulation
+ * @retval -1  Error
+ */
+static int
+dfa_build(struct regex_dfa *rx)
+{
+    int       retval = -1;
+    int     **sets = NULL;   /* NFA state list per DFA state */
+    int      *setlen = NULL; /* Length of NFA state list per DFA state */
+    int      *buckets = NULL; /* Hash buckets: first DFA state, 0 is end */
+    int      *chain = NULL;  /* Next DFA state in same bucket */
+    uint32_t  h;
+    int      *list = NULL;
+    int       len;
+    unsigned *mark = NULL;
+    unsigned  gen = 0;
+    int      *stack = NULL;
+    int       rep[256];      /* Representative byte per class */
+    int       d;
+    int       e;
+    int       c;
+    int       cl;
+    int      *trans;
+    uint64_t *accept;
+
+    dfa_classes(rx);
+    for (c=255; c>=0; c--)
+	rep[rx->rx_classmap[c]] = c;
+    if ((sets = calloc(RX_DFA_MAX_STATES, sizeof(int*))) == NULL ||
+	(setlen = calloc(RX_DFA_MAX_STATES, sizeof(int))) == NULL ||
+	(buckets = calloc(RX_DFA_HASH_SIZE, sizeof(int))) == NULL ||
+	(chain = calloc(RX_DFA_MAX_STATES, sizeof(int))) == NULL ||
+	(rx->rx_trans = calloc(RX_DFA_MAX_STATES*rx->rx_nclasses, sizeof(int))) == NULL ||
+	(rx->rx_accept = calloc(RX_DFA_MAX_STATES, sizeof(uint64_t))) == NULL ||
+	(list = calloc(rx->rx_nlen, sizeof(int))) == NULL ||
+	(mark = calloc(rx->rx_nlen, sizeof(unsigned))) == NULL ||
+	(stack = calloc(2*rx->rx_nlen+2, sizeof(int))) == NULL){
+	clicon_err(OE_UNIX, errno, "calloc");
+	goto done;
+    }
+    /* State 0 is the dead state (empty list), state 1 is start */
+    rx->rx_dlen = 1;
+    len = 0;
+    nfa_closure(rx, rx->rx_nstart, list, &len, mark, ++gen, stack);
+    e = 0; /* Next DFA state to process */
+    while (1){
+	/* Lookup list among existing states */
+	if (len){
+	    qsort(list, len, sizeof(int), int_cmp);
+	    h = list_hash(list, len);
+	    for (d=buckets[h]; d; d=chain[d])
+		if (setlen[d] == len && memcmp(sets[d], list, len*sizeof(int)) == 0)
+		    break;
+	    if (d == 0){ /* New state */
+		if (rx->rx_dlen >= RX_DFA_MAX_STATES){
+		    dfa_free(rx);
+		    retval = 0;
+		    goto done;
+		}
+		if ((sets[rx->rx_dlen] = malloc(len*sizeof(int))) == NULL){
+		    clicon_err(OE_UNIX, errno, "malloc");
+		    goto done;
+		}
+		d = rx->rx_dlen;
+		memcpy(sets[d], list, len*sizeof(int));
+		setlen[d] = len;
+		chain[d] = buckets[h];
+		buckets[h] = d;
+		rx->rx_accept[d] = nfa_accept(rx, list, len);
+		rx->rx_dlen++;
+	    }
+	}
+	else
+	    d = 0;
+	if (e > 0) /* Transition from e on class cl */
+	    rx->rx_trans[e*rx->rx_nclasses + cl] = d;
+	/* Next transition to compute */
+	if (e == 0){
+	    e = 1;
+	    cl = 0;
+	}
+	else if (++cl == rx->rx_nclasses){
+	    e++;
+	    cl = 0;
+	}
+	if (e >= rx->rx_dlen)
+	    break;
+	nfa_step(rx, sets[e], setlen[e], rep[cl], list, &len, mark, ++gen, stack);
+    }
+    /* Shrink tables to the states built, keep them if realloc fails */
+    if ((trans = realloc(rx->rx_trans, rx->rx_dlen*rx->rx_nclasses*sizeof(int))) != NULL)
+	rx->rx_trans = trans;
+    if ((accept = realloc(rx->rx_accept, rx->rx_dlen*sizeof(uint64_t))) != NULL)
+	rx->rx_accept = accept;
+    /* The NFA is only simulated if there is no DFA */
+    if (rx->rx_nfa){
+	free(rx->rx_nfa);
+	rx->rx_nfa = NULL;
+    }
+    rx->rx_nlen = rx->rx_nmax = 0;
+    if (rx->rx_bytes){
+	free(rx->rx_bytes);
+	rx->rx_bytes = NULL;
+    }
+    rx->rx_blen = rx->rx_bmax = 0;
+    retval = 1;
+ done:
+    if (sets){
+	for (d=0; d<RX_DFA_MAX_STATES; d++)
+	    if (sets[d])
+		free(sets[d]);
+	free(sets);
+    }
+    if (setlen)
+	free(setlen);
+    if (buckets)
+	free(buckets);
+    if (chain)
+	free(chain);
+    if (list)
+	free(list);
+    if (mark)
+	free(mark);
+    if (stack)
+	free(stack);
+    if (retval < 0)
+	dfa_free(rx);
+    return retval;
+}
+
+/*-------------------------- API ------------------------------------*/
+
+/*! Free compiled pattern set, or decrement its reference count if shared
+ * @param[in]  recomp  Compiled pattern set
+ */
+int
+regex_dfa_free(void *recomp)
+{
+    struct regex_dfa *rx = (struct regex_dfa *)recomp;
+
+    if (rx == NULL)
+	return 0;
+    if (--rx->rx_refcnt > 0)
+	return 0;
+    if (rx->rx_key){
+	if (_rx_shared){
+	    clicon_hash_del(_rx_shared, rx->rx_key);
+	    if (clicon_hash_len(_rx_shared) == 0){
+		clicon_hash_free(_rx_shared);
+		_rx_shared = NULL;
+	    }
+	}
+	free(rx->rx_key);
+    }
+    dfa_free(rx);
+    if (rx->rx_nfa)
+	free(rx->rx_nfa);
+    if (rx->rx_bytes)
+	free(rx->rx_bytes);
+    free(rx);
+    return 0;
+}
+
+/*! Compile a set of XSD regexps into a single automaton
+ *
+ * The compiled pattern set is matched with regex_dfa_exec() which returns
+ * true only if the string matches all patterns, and does not match any
+ * invert-match pattern.
+ * Identical pattern sets are compiled once and shared (reference counted).
+ * @param[in]   patterns   Vector of regexp strings in XSD regex format
+ * @param[in]   inverts    Vector of invert-match flags, or NULL
+ * @param[in]   npatterns  Number of patterns (max RX_MAX_PATTERNS)
+ * @param[out]  recomp     Compiled pattern set, free with regex_dfa_free
+ * @retval      1          OK
+ * @retval      0          Invalid regular expression (syntax error)
+ * @retval     -1          Error
+ */
+int
+regex_dfa_compile(char **patterns,
+		  int   *inverts,
+		  int    npatterns,
+		  void **recomp)
+{
+    int               retval = -1;
+    struct regex_dfa *rx = NULL;
+    struct regex_dfa **rxp;
+    cbuf             *cb = NULL;
+    rx_node          *rn = NULL;
+    rx_parse          rp;
+    int               ok = 1;
+    int               i;
+    int               s;
+    int               start = -1;
+
+    if (npatterns < 1 || npatterns > RX_MAX_PATTERNS){
+	clicon_err(OE_YANG, EINVAL, "Number of patterns %d not in range [1:%d]",
+		   npatterns, RX_MAX_PATTERNS);
+	goto done;
+    }
+    /* Lookup shared pattern set */
+    if ((cb = cbuf_new()) == NULL){
+	clicon_err(OE_UNIX, errno, "cbuf_new");
+	goto done;
+    }
+    for (i=0; i<npatterns; i++)
+	cprintf(cb, "%d %zu:%s", inverts?inverts[i]:0, strlen(patterns[i]), patterns[i]);
+    if (_rx_shared == NULL &&
+	(_rx_shared = clicon_hash_init()) == NULL)
+	goto done;
+    if ((rxp = clicon_hash_value(_rx_shared, cbuf_get(cb), NULL)) != NULL){
+	rx = *rxp;
+	rx->rx_refcnt++;
+	*recomp = rx;
+	rx = NULL;
+	retval = 1;
+	goto done;
+    }
+    if ((rx = malloc(sizeof(*rx))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	goto done;
+    }
+    memset(rx, 0, sizeof(*rx));
+    rx->rx_refcnt = 1;
+    rx->rx_npatterns = npatterns;
+    for (i=0; i<npatterns; i++){
+	rx->rx_all |= ((uint64_t)1 << i);
+	if (inverts && inverts[i])
+	    rx->rx_invert |= ((uint64_t)1 << i);
+	rp.rp_str = patterns[i];
+	rp.rp_i = 0;
+	rp.rp_len = strlen(patterns[i]);
+	/* Skip posix-style anchors, patterns are implicitly anchored */
+	if (rp.rp_len && rp.rp_str[0] == '^')
+	    rp.rp_i++;
+	if (rp.rp_len > rp.rp_i && rp.rp_str[rp.rp_len-1] == '$' &&
+	    (rp.rp_len < 2 || rp.rp_str[rp.rp_len-2] != '\\'))
+	    rp.rp_len--;
+	if ((rn = rx_parse_regexp(&rp, &ok)) == NULL)
+	    goto done;
+	if (ok == 0 || rp.rp_i != rp.rp_len){ /* Syntax error or unbalanced ')' */
+	    retval = 0;
+	    goto done;
+	}
+	/* All patterns are implicitly anchored at both ends */
+	if ((s = nfa_state_add(rx, RX_OP_MATCH, -1, -1, i)) < 0)
+	    goto done;
+	if ((s = nfa_compile(rx, rn, s)) < 0)
+	    goto done;
+	rx_node_free(rn);
+	rn = NULL;
+	if (start < 0)
+	    start = s;
+	else if ((start = nfa_state_add(rx, RX_OP_SPLIT, start, s, 0)) < 0)
+	    goto done;
+    }
+    rx->rx_nstart = start;
+    if (dfa_build(rx) < 0)
+	goto done;
+    if ((rx->rx_key = strdup(cbuf_get(cb))) == NULL){
+	clicon_err(OE_UNIX, errno, "strdup");
+	goto done;
+    }
+    if (clicon_hash_add(_rx_shared, rx->rx_key, &rx, sizeof(rx)) == NULL)
+	goto done;
+    *recomp = rx;
+    rx = NULL;
+    retval = 1;
+ done:
+    if (rn)
+	rx_node_free(rn);
+    if (rx){
+	if (rx->rx_key){
+	    free(rx->rx_key);
+	    rx->rx_key = NULL;
+	}
+	regex_dfa_free(rx);
+    }
+    if (cb)
+	cbuf_free(cb);
+    return retval;
+}
+
+/*! Match string against all patterns of a compiled pattern set in one pass
+ * @param[in]  recomp  Compiled pattern set
+ * @param[in]  str     String to match
+ * @param[in]  len     Length of string
+ * @param[out] mask    Bitmask of patterns that match (invert-match not applied)
+ * @retval     0       OK
+ * @retval    -1       Error
+ */
+int
+regex_dfa_match(void     *recomp,
+		char     *str,
+		size_t    len,
+		uint64_t *mask)
+{
+    int               retval = -1;
+    struct regex_dfa *rx = (struct regex_dfa *)recomp;
+    int               d;
+    size_t            i;
+    int              *list = NULL;
+    int              *next = NULL;
+    int              *tmp;
+    int               llen;
+    int               nlen;
+    unsigned         *mark = NULL;
+    unsigned          gen = 0;
+    int              *stack = NULL;
+
+    if (rx->rx_trans){ /* DFA */
+	d = 1;
+	for (i=0; i<len && d; i++)
+	    d = rx->rx_trans[d*rx->rx_nclasses + rx->rx_classmap[(uint8_t)str[i]]];
+	*mask = rx->rx_accept[d];
+	return 0;
+    }
+    /* NFA simulation: work vectors are allocated per call to keep compiled
+     * pattern sets immutable */
+    if ((list = calloc(rx->rx_nlen, sizeof(int))) == NULL ||
+	(next = calloc(rx->rx_nlen, sizeof(int))) == NULL ||
+	(mark = calloc(rx->rx_nlen, sizeof(unsigned))) == NULL ||
+	(stack = calloc(2*rx->rx_nlen+2, sizeof(int))) == NULL){
+	clicon_err(OE_UNIX, errno, "calloc");
+	goto done;
+    }
+    llen = 0;
+    nfa_closure(rx, rx->rx_nstart, list, &llen, mark, ++gen, stack);
+    for (i=0; i<len && llen; i++){
+	nfa_step(rx, list, llen, (uint8_t)str[i], next, &nlen, mark, ++gen, stack);
+	tmp = list; list = next; next = tmp;
+	llen = nlen;
+    }
+    *mask = nfa_accept(rx, list, llen);
+    retval = 0;
+ done:
+    if (list)
+	free(list);
+    if (next)
+	free(next);
+    if (mark)
+	free(mark);
+    if (stack)
+	free(stack);
+    return retval;
+}
+
+/*! Execute compiled pattern set
+ * @param[in]  recomp  Compiled pattern set
+ * @param[in]  str     String to match
+ * @retval     1       Match: all patterns match and no invert-match pattern matches
+ * @retval     0       No match
+ * @retval    -1       Error
+ */
+int
+regex_dfa_exec(void *recomp,
+	       char *str)
+{
+    struct regex_dfa *rx = (struct regex_dfa *)recomp;
+    uint64_t          mask = 0;
+
+    if (regex_dfa_match(rx, str, strlen(str), &mask) < 0)
+	return -1;
+    return ((mask ^ rx->rx_invert) & rx->rx_all) == rx->rx_all;
+}
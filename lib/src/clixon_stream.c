@@ -64,7 +64,11 @@
 #include <errno.h>
 #include <inttypes.h>
 #include <syslog.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <sys/time.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 
 /* cligen */
 #include <cligen/cligen.h>
@@ -89,6 +93,303 @@
 /* Go through and timeout subscription timers [s] */
 #define STREAM_TIMER_TIMEOUT_S 5
 
+/* Replay store file magic and version */
+#define STREAM_REPLAY_MAGIC   0x434c5852 /* CLXR */
+#define STREAM_REPLAY_VERSION 1
+
+/* Replay store header, followed by time index ring and data ring.
+ * Fixed size types, since it may be stored in a file. Entries are counted, and data
+ * offsets are absolute: position in ring is modulo capacity.
+ */
+struct stream_replay_hdr{
+    uint32_t rh_magic;
+    uint32_t rh_version;
+    uint32_t rh_nmax;   /* Capacity of time index */
+    uint32_t rh_pad;
+    uint64_t rh_size;   /* Capacity of data ring in bytes */
+    uint64_t rh_first;  /* Entry nr of oldest event */
+    uint64_t rh_nr;     /* Nr of events */
+    uint64_t rh_tail;   /* Data offset of next event */
+};
+
+/* Time index entry of an event */
+struct stream_replay_entry{
+    int64_t  re_sec;    /* Timestamp */
+    int64_t  re_usec;
+    uint64_t re_off;    /* Data offset of encoded event */
+    uint64_t re_len;    /* Length of encoded event including NULL */
+};
+
+/* Replay store of an event stream
+ * Events are stored encoded in a pre-allocated ring, oldest events are dropped when 
+ * full, either in memory or in a memory-mapped file so that they survive restarts
+ * @see CLICON_STREAM_REPLAY_SIZE, CLICON_STREAM_REPLAY_MAX, CLICON_STREAM_REPLAY_DIR
+ */
+struct stream_replay{
+    struct stream_replay_hdr   *r_hdr;   /* Header */
+    struct stream_replay_entry *r_index; /* Time index ring, rh_nmax entries */
+    char                       *r_data;  /* Data ring, rh_size bytes */
+    void                       *r_mem;   /* Allocated or mapped memory */
+    size_t                      r_memlen;
+    int                         r_mapped; /* r_mem is a mapped file */
+};
+
+/*! Get i:th oldest event entry of replay store
+ */
+static struct stream_replay_entry *
+stream_replay_entry(struct stream_replay *r,
+		    uint64_t              i)
+{
+    return &r->r_index[(r->r_hdr->rh_first + i) % r->r_hdr->rh_nmax];
+}
+
+/*! Check that replay store of a mapped file is consistent
+ * Events are stored back-to-back in the data ring in time order, so each event starts
+ * where the previous ended and the last ends at the tail. A file that was truncated,
+ * or written by another program, is not trusted.
+ * @param[in]  r     Replay store
+ * @param[in]  nmax  Configured capacity of time index
+ * @param[in]  size  Configured capacity of data ring
+ * @retval     1     Consistent
+ * @retval     0     Not consistent
+ */
+static int
+stream_replay_check(struct stream_replay *r,
+		    uint32_t              nmax,
+		    uint64_t              size)
+{
+    struct stream_replay_hdr   *rh = r->r_hdr;
+    struct stream_replay_entry *re;
+    struct stream_replay_entry *prev = NULL;
+    uint64_t                    i;
+    uint64_t                    off;
+
+    if (rh->rh_magic != STREAM_REPLAY_MAGIC ||
+	rh->rh_version != STREAM_REPLAY_VERSION ||
+	rh->rh_nmax != nmax ||
+	rh->rh_size != size ||
+	rh->rh_nr > nmax ||
+	rh->rh_first > UINT64_MAX - nmax)
+	return 0;
+    if (rh->rh_nr == 0)
+	return 1;
+    off = stream_replay_entry(r, 0)->re_off;
+    if (off > rh->rh_tail || rh->rh_tail - off > size)
+	return 0;
+    for (i=0; i<rh->rh_nr; i++){
+	re = stream_replay_entry(r, i);
+	if (re->re_off != off ||
+	    re->re_len == 0 ||
+	    re->re_len > rh->rh_tail - off ||
+	    re->re_usec < 0 || re->re_usec >= 1000000 ||
+	    (prev && (re->re_sec < prev->re_sec ||
+		      (re->re_sec == prev->re_sec && re->re_usec < prev->re_usec))))
+	    return 0;
+	off += re->re_len;
+	if (r->r_data[(off - 1) % size] != '\0') /* Encoded event is NULL-terminated */
+	    return 0;
+	prev = re;
+    }
+    return off == rh->rh_tail;
+}
+
+/*! Get unsigned size option of replay store
+ * @param[in]  h     Clicon handle
+ * @param[in]  name  Option name
+ * @param[out] val   Option value, > 0
+ * @retval     0     OK
+ * @retval    -1     Error, option missing, invalid or 0
+ */
+static int
+stream_replay_option(clicon_handle h,
+		     const char   *name,
+		     uint32_t     *val)
+{
+    int   retval = -1;
+    char *str;
+    char *reason = NULL;
+    int   ret;
+
+    if ((str = clicon_option_str(h, name)) == NULL){
+	clicon_err(OE_CFG, ENOENT, "Option %s not set", name);
+	goto done;
+    }
+    if ((ret = parse_uint32(str, val, &reason)) < 0){
+	clicon_err(OE_CFG, errno, "parse_uint32");
+	goto done;
+    }
+    if (ret == 0 || *val == 0){
+	clicon_err(OE_CFG, EINVAL, "%s: invalid value %s, must be > 0%s%s",
+		   name, str, reason?": ":"", reason?reason:"");
+	goto done;
+    }
+    retval = 0;
+ done:
+    if (reason)
+	free(reason);
+    return retval;
+}
+
+/*! Open replay store of a stream
+ * If CLICON_STREAM_REPLAY_DIR is set, map file <dir>/<stream>.replay and keep its
+ * events if it was created with the same sizes and is consistent, otherwise allocate
+ * memory
+ * @param[in]  h     Clicon handle
+ * @param[in]  name  Name of stream
+ * @param[out] rp    Replay store, free with stream_replay_close
+ * @retval     0     OK
+ * @retval    -1     Error
+ */
+static int
+stream_replay_open(clicon_handle          h,
+		   const char            *name,
+		   struct stream_replay **rp)
+{
+    int                       retval = -1;
+    struct stream_replay     *r = NULL;
+    struct stream_replay_hdr *rh;
+    char                     *dir;
+    cbuf                     *cb = NULL;
+    int                       fd = -1;
+    struct stat               st;
+    uint32_t                  nmax;
+    uint32_t                  size;
+
+    if (stream_replay_option(h, "CLICON_STREAM_REPLAY_MAX", &nmax) < 0 ||
+	stream_replay_option(h, "CLICON_STREAM_REPLAY_SIZE", &size) < 0)
+	goto done;
+    if ((r = malloc(sizeof(*r))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	goto done;
+    }
+    memset(r, 0, sizeof(*r));
+    r->r_memlen = sizeof(*rh) + nmax*sizeof(struct stream_replay_entry) + size;
+    if ((dir = clicon_option_str(h, "CLICON_STREAM_REPLAY_DIR")) != NULL){
+	if ((cb = cbuf_new()) == NULL){
+	    clicon_err(OE_UNIX, errno, "cbuf_new");
+	    goto done;
+	}
+	cprintf(cb, "%s/%s.replay", dir, name);
+	if ((fd = open(cbuf_get(cb), O_RDWR|O_CREAT, S_IRUSR|S_IWUSR)) < 0){
+	    clicon_err(OE_UNIX, errno, "open %s", cbuf_get(cb));
+	    goto done;
+	}
+	if (fstat(fd, &st) < 0){
+	    clicon_err(OE_UNIX, errno, "fstat %s", cbuf_get(cb));
+	    goto done;
+	}
+	if (st.st_size != r->r_memlen &&
+	    ftruncate(fd, r->r_memlen) < 0){
+	    clicon_err(OE_UNIX, errno, "ftruncate %s", cbuf_get(cb));
+	    goto done;
+	}
+	if ((r->r_mem = mmap(NULL, r->r_memlen, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED){
+	    r->r_mem = NULL;
+	    clicon_err(OE_UNIX, errno, "mmap %s", cbuf_get(cb));
+	    goto done;
+	}
+	r->r_mapped = 1;
+    }
+    else if ((r->r_mem = malloc(r->r_memlen)) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	goto done;
+    }
+    rh = r->r_hdr = (struct stream_replay_hdr *)r->r_mem;
+    r->r_index = (struct stream_replay_entry *)(rh + 1);
+    r->r_data = (char*)(r->r_index + nmax);
+    /* Keep events of an existing file if it is consistent, otherwise start empty */
+    if (!r->r_mapped || !stream_replay_check(r, nmax, size)){
+	if (r->r_mapped && st.st_size != 0)
+	    clicon_log(LOG_WARNING, "%s: %s: replay file %s not consistent, events are discarded",
+		       __FUNCTION__, name, cbuf_get(cb));
+	memset(rh, 0, sizeof(*rh));
+	rh->rh_magic = STREAM_REPLAY_MAGIC;
+	rh->rh_version = STREAM_REPLAY_VERSION;
+	rh->rh_nmax = nmax;
+	rh->rh_size = size;
+    }
+    *rp = r;
+    r = NULL;
+    retval = 0;
+ done:
+    if (fd != -1)
+	close(fd);
+    if (cb)
+	cbuf_free(cb);
+    if (r){
+	if (r->r_mem)
+	    free(r->r_mem);
+	free(r);
+    }
+    return retval;
+}
+
+/*! Close replay store, events of a mapped file are kept
+ */
+static int
+stream_replay_close(struct stream_replay *r)
+{
+    if (r->r_mem){
+	if (r->r_mapped)
+	    munmap(r->r_mem, r->r_memlen);
+	else
+	    free(r->r_mem);
+    }
+    free(r);
+    return 0;
+}
+
+/*! Compare timestamp of entry with tv, as timercmp
+ * @retval  <0  Entry is before tv
+ * @retval   0  Same
+ * @retval  >0  Entry is after tv
+ */
+static int
+stream_replay_cmp(struct stream_replay_entry *re,
+		  struct timeval             *tv)
+{
+    if (re->re_sec != tv->tv_sec)
+	return re->re_sec < tv->tv_sec ? -1 : 1;
+    if (re->re_usec != tv->tv_usec)
+	return re->re_usec < tv->tv_usec ? -1 : 1;
+    return 0;
+}
+
+/*! Find oldest event at or after tv using binary search of time index
+ * @retval  i   Entry nr, or number of events if none
+ */
+static uint64_t
+stream_replay_search(struct stream_replay *r,
+		     struct timeval       *tv)
+{
+    uint64_t lo = 0;
+    uint64_t hi = r->r_hdr->rh_nr;
+    uint64_t mid;
+
+    while (lo < hi){
+	mid = lo + (hi - lo)/2;
+	if (stream_replay_cmp(stream_replay_entry(r, mid), tv) < 0)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+    return lo;
+}
+
+/*! Drop events older than tv from replay store
+ */
+static int
+stream_replay_prune(struct stream_replay *r,
+		    struct timeval       *tv)
+{
+    uint64_t n;
+
+    n = stream_replay_search(r, tv);
+    r->r_hdr->rh_first += n;
+    r->r_hdr->rh_nr -= n;
+    return 0;
+}
+
 /*! Find an event notification stream given name
  * @param[in]  h    Clicon handle
  * @param[in]  name Name of stream
@@ -147,6 +448,9 @@ stream_add(clicon_handle   h,
     es->es_replay_enabled = replay_enabled;
     if (retention)
 	es->es_retention = *retention;
+    if (replay_enabled &&
+	stream_replay_open(h, name, &es->es_replay) < 0)
+	goto done;
     clicon_stream_append(h, es);
  ok:
     retval = 0;
@@ -162,7 +466,6 @@ int
 stream_delete_all(clicon_handle h,
 		  int           force)
 {
-    struct stream_replay *r;
     struct stream_subscription *ss;
     event_stream_t       *es;
     event_stream_t       *head = clicon_stream(h);
@@ -176,12 +479,12 @@ stream_delete_all(clicon_handle h,
 	    free(es->es_description);
 	while ((ss = es->es_subscription) != NULL)
 	    stream_ss_rm(h, es, ss, force); /* XXX in some cases leaks memory due to DONT clause in stream_ss_rm() */
-	while ((r = es->es_replay) != NULL){
-	    DELQ(r, es->es_replay, struct stream_replay *);
-	    if (r->r_xml)
-		xml_free(r->r_xml);
-	    free(r);
-	}
+	if (es->es_index)
+	    clicon_hash_free(es->es_index);
+	if (es->es_noindex.sv_vec)
+	    free(es->es_noindex.sv_vec);
+	if (es->es_replay)
+	    stream_replay_close(es->es_replay);
 	free(es);
     }
     return 0;
@@ -247,8 +550,6 @@ stream_timer_setup(int   fd,
     event_stream_t              *es;
     struct stream_subscription  *ss;
     struct stream_subscription  *ss1;
-    struct stream_replay        *r;
-    struct stream_replay        *r1;
     
     clicon_debug(2, "%s", __FUNCTION__);
     /* Go thru callbacks and see if any have timed out, if so remove them 
@@ -276,21 +577,9 @@ stream_timer_setup(int   fd,
 			ss = NEXTQ(struct stream_subscription *, ss);
 		} while (ss && ss != es->es_subscription);
   /* 2) Go throughreplay buffer and remove entries with passed retention time */
-	    if (timerisset(&es->es_retention) &&
-		(r = es->es_replay) != NULL){
+	    if (timerisset(&es->es_retention) && es->es_replay){
 		timersub(&now, &es->es_retention, &tret);
-		do {
-		    if (timercmp(&r->r_tv, &tret, <)){
-			r1 = NEXTQ(struct stream_replay *, r);
-			DELQ(r, es->es_replay, struct stream_replay *);
-			if (r->r_xml)
-			    xml_free(r->r_xml);
-			free(r);
-			r = r1;
-		    }
-		    else
-			r = NEXTQ(struct stream_replay *, r);
-		} while (r && r!=es->es_replay);
+		stream_replay_prune(es->es_replay, &tret);
 	    }
 	    es = NEXTQ(struct event_stream *, es);
 	} while (es && es != clicon_stream(h));
@@ -318,6 +607,150 @@ stream_del()
 }
 #endif
 
+/*! Get name of the event element a subscription filter requires
+ * The filter is evaluated with the notification as both context and root node, so a
+ * location path whose first step is a child name test, eg "event[x='y']" or "/ex:event/x",
+ * can only match if the notification has a child with that name.
+ * The prefix is not used since the filter has no namespace context.
+ * @param[in]  xt    Parsed filter
+ * @retval     name  Name of first step
+ * @retval     NULL  Filter may match any event, eg "//x", "*" or a union
+ */
+static char *
+stream_xpath_index(xpath_tree *xt)
+{
+    while (xt != NULL){
+	switch (xt->xs_type){
+	case XP_EXP:
+	case XP_AND:
+	case XP_RELEX:
+	case XP_ADD:
+	case XP_UNION:
+	case XP_PATHEXPR:
+	case XP_LOCPATH:
+	    if (xt->xs_c1 != NULL)
+		return NULL;
+	    xt = xt->xs_c0;
+	    break;
+	case XP_ABSPATH:
+	case XP_RELLOCPATH: /* leftmost step is first child */
+	    if (xt->xs_int == A_DESCENDANT_OR_SELF)
+		return NULL;
+	    xt = xt->xs_c0;
+	    break;
+	case XP_STEP:
+	    if (xt->xs_int != A_CHILD ||
+		xt->xs_c0 == NULL ||
+		xt->xs_c0->xs_type != XP_NODE)
+		return NULL;
+	    return xt->xs_c0->xs_s1; /* NULL if '*' */
+	default:
+	    return NULL;
+	}
+    }
+    return NULL;
+}
+
+/*! Add subscription to vector
+ */
+static int
+stream_ss_vec_add(struct stream_ss_vec       *sv,
+		  struct stream_subscription *ss)
+{
+    struct stream_subscription **vec;
+
+    if ((vec = realloc(sv->sv_vec, (sv->sv_len+1)*sizeof(*vec))) == NULL){
+	clicon_err(OE_UNIX, errno, "realloc");
+	return -1;
+    }
+    vec[sv->sv_len++] = ss;
+    sv->sv_vec = vec;
+    return 0;
+}
+
+/*! Remove subscription from vector
+ */
+static void
+stream_ss_vec_rm(struct stream_ss_vec       *sv,
+		 struct stream_subscription *ss)
+{
+    size_t i;
+
+    for (i=0; i<sv->sv_len; i++)
+	if (sv->sv_vec[i] == ss){
+	    memmove(&sv->sv_vec[i], &sv->sv_vec[i+1], (sv->sv_len-i-1)*sizeof(ss));
+	    sv->sv_len--;
+	    break;
+	}
+}
+
+/*! Add subscription to the subscription index of a stream
+ * @param[in]  es   Event stream
+ * @param[in]  ss   Subscription
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+stream_ss_index_add(event_stream_t             *es,
+		    struct stream_subscription *ss)
+{
+    struct stream_ss_vec *sv;
+    struct stream_ss_vec  sv0 = {NULL, 0};
+
+    if (ss->ss_index == NULL)
+	return stream_ss_vec_add(&es->es_noindex, ss);
+    if (es->es_index == NULL &&
+	(es->es_index = clicon_hash_init()) == NULL)
+	return -1;
+    if ((sv = clicon_hash_value(es->es_index, ss->ss_index, NULL)) == NULL){
+	if (clicon_hash_add(es->es_index, ss->ss_index, &sv0, sizeof(sv0)) == NULL)
+	    return -1;
+	if ((sv = clicon_hash_value(es->es_index, ss->ss_index, NULL)) == NULL)
+	    return -1;
+    }
+    return stream_ss_vec_add(sv, ss);
+}
+
+/*! Remove subscription from the subscription index of a stream
+ * @param[in]  es   Event stream
+ * @param[in]  ss   Subscription
+ */
+static void
+stream_ss_index_rm(event_stream_t             *es,
+		   struct stream_subscription *ss)
+{
+    struct stream_ss_vec *sv;
+
+    if (ss->ss_index == NULL)
+	stream_ss_vec_rm(&es->es_noindex, ss);
+    else if (es->es_index &&
+	     (sv = clicon_hash_value(es->es_index, ss->ss_index, NULL)) != NULL){
+	stream_ss_vec_rm(sv, ss);
+	if (sv->sv_len == 0){
+	    if (sv->sv_vec)
+		free(sv->sv_vec);
+	    clicon_hash_del(es->es_index, ss->ss_index);
+	}
+    }
+}
+
+/*! Free subscription struct
+ */
+static int
+stream_ss_free(struct stream_subscription *ss)
+{
+    if (ss->ss_stream)
+	free(ss->ss_stream);
+    if (ss->ss_xpath)
+	free(ss->ss_xpath);
+    if (ss->ss_xptree)
+	xpath_tree_free(ss->ss_xptree);
+    if (ss->ss_index)
+	free(ss->ss_index);
+    free(ss);
+    return 0;
+}
+
 /*! Add an event notification callback to a stream given a callback function
  * @param[in]  h        Clicon handle
  * @param[in]  stream   Name of stream
@@ -340,6 +773,7 @@ stream_ss_add(clicon_handle     h,
 {
     event_stream_t             *es;
     struct stream_subscription *ss = NULL;
+    char                       *index;
 
     clicon_debug(1, "%s", __FUNCTION__);
     if ((es = stream_find(h, stream)) == NULL){
@@ -363,13 +797,25 @@ stream_ss_add(clicon_handle     h,
 	clicon_err(OE_CFG, errno, "strdup");
 	goto done;
     }
+    /* Parse filter once, and index subscription on the event element it requires */
+    if (xpath && strlen(xpath)){
+	if (xpath_parse(xpath, &ss->ss_xptree) < 0)
+	    goto done;
+	if ((index = stream_xpath_index(ss->ss_xptree)) != NULL &&
+	    (ss->ss_index = strdup(index)) == NULL){
+	    clicon_err(OE_CFG, errno, "strdup");
+	    goto done;
+	}
+    }
     ss->ss_fn     = fn;
     ss->ss_arg    = arg;
+    if (stream_ss_index_add(es, ss) < 0)
+	goto done;
     ADDQ(ss, es->es_subscription);
     return ss;
   done:
     if (ss)
-	free(ss);
+	stream_ss_free(ss);
     return NULL;
 }
 
@@ -389,15 +835,12 @@ stream_ss_rm(clicon_handle                h,
 {
     clicon_debug(1, "%s", __FUNCTION__);
     DELQ(ss, es->es_subscription, struct stream_subscription *);
+    stream_ss_index_rm(es, ss);
+    es->es_ss_rm_nr++;
     /* Remove from upper layers - close socket etc. */
-    (*ss->ss_fn)(h, 1, NULL, ss->ss_arg);
-    if (force){
-	if (ss->ss_stream)
-	    free(ss->ss_stream);
-	if (ss->ss_xpath)
-	    free(ss->ss_xpath);
-	free(ss);
-    }
+    (*ss->ss_fn)(h, 1, NULL, NULL, ss->ss_arg);
+    if (force)
+	stream_ss_free(ss);
     clicon_debug(1, "%s retval: 0", __FUNCTION__);
     return 0;
 }
@@ -482,11 +925,53 @@ stream_ss_delete(clicon_handle     h,
     return retval;
 }
 
+/*! Check if subscription is still in a stream, ie has not been removed
+ */
+static int
+stream_ss_exists(event_stream_t             *es,
+		 struct stream_subscription *ss0)
+{
+    struct stream_subscription *ss;
+
+    if ((ss = es->es_subscription) != NULL)
+	do {
+	    if (ss == ss0)
+		return 1;
+	    ss = NEXTQ(struct stream_subscription *, ss);
+	} while (ss && ss != es->es_subscription);
+    return 0;
+}
+
+/*! Append subscriptions of a vector to candidate vector
+ */
+static int
+stream_ss_candidates(struct stream_ss_vec          *sv,
+		     struct stream_subscription  ***vecp,
+		     size_t                        *lenp)
+{
+    struct stream_subscription **vec;
+
+    if (sv->sv_len == 0)
+	return 0;
+    if ((vec = realloc(*vecp, (*lenp+sv->sv_len)*sizeof(*vec))) == NULL){
+	clicon_err(OE_UNIX, errno, "realloc");
+	return -1;
+    }
+    memcpy(&vec[*lenp], sv->sv_vec, sv->sv_len*sizeof(*vec));
+    *lenp += sv->sv_len;
+    *vecp = vec;
+    return 0;
+}
+
 /*! Stream notify event and distribute to all registered callbacks
+ * Only subscriptions without index, and those indexed on the name of an element of the
+ * event are candidates, the parsed filter of each candidate is then evaluated on the event.
+ * The event is encoded once and the same string is given to all matching subscriptions.
  * @param[in]  h       Clicon handle
  * @param[in]  stream  Name of event stream. CLICON is predefined as LOG stream
  * @param[in]  tv      Timestamp. Dont notify if subscription has stoptime<tv
  * @param[in]  event   Notification as xml tree
+ * @param[in]  cb      Empty buffer, event is encoded here if any subscription matches
  * @retval  0  OK
  * @retval -1  Error with clicon_err called
  * @see stream_notify
@@ -496,35 +981,75 @@ static int
 stream_notify1(clicon_handle   h, 
 	       event_stream_t *es,
 	       struct timeval *tv,
-	       cxobj          *xevent)
+	       cxobj          *xevent,
+	       cbuf           *cb)
 {
-    int                         retval = -1;
-    struct stream_subscription *ss;
+    int                          retval = -1;
+    struct stream_subscription  *ss;
+    struct stream_subscription **vec = NULL;
+    size_t                       veclen = 0;
+    struct stream_ss_vec        *sv;
+    cxobj                       *x;
+    cxobj                       *xp;
+    xp_ctx                      *xr = NULL;
+    uint64_t                     rmnr;
+    size_t                       i;
+    int                          match;
     
     clicon_debug(2, "%s", __FUNCTION__);
-    /* Go thru all subscriptions and find matches */
-    if ((ss = es->es_subscription) != NULL)
-	do {
-	    if (timerisset(&ss->ss_stoptime) && /* stoptime has passed */
-		timercmp(&ss->ss_stoptime, tv, <)){
-		struct stream_subscription *ss1;
-		ss1 = NEXTQ(struct stream_subscription *, ss);
-		/* Signal to remove stream for upper levels */
-		if (stream_ss_rm(h, es, ss, 1) < 0)
-		    goto done;
-		ss = ss1;
-	    }
-	    else{  /* xpath match */
-		if (ss->ss_xpath == NULL ||
-		    strlen(ss->ss_xpath)==0 ||
-		    xpath_first(xevent, NULL, "%s", ss->ss_xpath) != NULL)
-		    if ((*ss->ss_fn)(h, 0, xevent, ss->ss_arg) < 0)
-			goto done;
-		ss = NEXTQ(struct stream_subscription *, ss);
+    /* Collect candidates. Copied since callbacks may remove subscriptions */
+    if (stream_ss_candidates(&es->es_noindex, &vec, &veclen) < 0)
+	goto done;
+    if (es->es_index){
+	x = NULL;
+	while ((x = xml_child_each(xevent, x, CX_ELMNT)) != NULL) {
+	    /* Only first element of each name */
+	    xp = NULL;
+	    while ((xp = xml_child_each(xevent, xp, CX_ELMNT)) != x)
+		if (strcmp(xml_name(xp), xml_name(x)) == 0)
+		    break;
+	    if (xp != x)
+		continue;
+	    if ((sv = clicon_hash_value(es->es_index, xml_name(x), NULL)) != NULL &&
+		stream_ss_candidates(sv, &vec, &veclen) < 0)
+		goto done;
+	}
+    }
+    rmnr = es->es_ss_rm_nr;
+    for (i=0; i<veclen; i++){
+	ss = vec[i];
+	/* A callback has removed subscriptions, check this one is still there */
+	if (es->es_ss_rm_nr != rmnr && !stream_ss_exists(es, ss))
+	    continue;
+	if (timerisset(&ss->ss_stoptime) && /* stoptime has passed */
+	    timercmp(&ss->ss_stoptime, tv, <)){
+	    /* Signal to remove stream for upper levels */
+	    if (stream_ss_rm(h, es, ss, 1) < 0)
+		goto done;
+	    continue;
+	}
+	if (ss->ss_xptree){ /* xpath match, errors are no match */
+	    if (xpath_tree_eval(xevent, NULL, ss->ss_xptree, 0, &xr) < 0)
+		match = 0;
+	    else
+		match = xr && xr->xc_type == XT_NODESET && xr->xc_size;
+	    if (xr){
+		ctx_free(xr);
+		xr = NULL;
 	    }
-	} while (es->es_subscription && ss != es->es_subscription);
+	    if (!match)
+		continue;
+	}
+	if (cbuf_len(cb) == 0 &&
+	    clicon_xml2cbuf(cb, xevent, 0, 0, -1) < 0)
+	    goto done;
+	if ((*ss->ss_fn)(h, 0, xevent, cbuf_get(cb), ss->ss_arg) < 0)
+	    goto done;
+    }
     retval = 0;
   done:
+    if (vec)
+	free(vec);
     return retval;
 }
 
@@ -590,12 +1115,15 @@ stream_notify(clicon_handle h,
 	goto done;
     if (xml_rootchild(xev, 0, &xev) < 0)
 	goto done;
-    if (stream_notify1(h, es, &tv, xev) < 0)
+    cbuf_reset(cb);
+    if (stream_notify1(h, es, &tv, xev, cb) < 0)
 	goto done;
-    if (es->es_replay_enabled){
-	if (stream_replay_add(es, &tv, xev) < 0)
+    if (es->es_replay){
+	if (cbuf_len(cb) == 0 &&
+	    clicon_xml2cbuf(cb, xev, 0, 0, -1) < 0)
+	    goto done;
+	if (stream_replay_add(es, &tv, cbuf_get(cb)) < 0)
 	    goto done;
-	xev = NULL; /* xml stored in replay_add and should not be freed */
     }
  ok:
     retval = 0;
@@ -659,12 +1187,15 @@ stream_notify_xml(clicon_handle h,
 	goto done;
     if (xml_addsub(xev, xml2) < 0)
 	goto done;
-    if (stream_notify1(h, es, &tv, xev) < 0)
+    cbuf_reset(cb);
+    if (stream_notify1(h, es, &tv, xev, cb) < 0)
 	goto done;
-    if (es->es_replay_enabled){
-	if (stream_replay_add(es, &tv, xev) < 0)
+    if (es->es_replay){
+	if (cbuf_len(cb) == 0 &&
+	    clicon_xml2cbuf(cb, xev, 0, 0, -1) < 0)
+	    goto done;
+	if (stream_replay_add(es, &tv, cbuf_get(cb)) < 0)
 	    goto done;
-	xev = NULL; /* xml stored in replay_add and should not be freed */
     }
  ok:
     retval = 0;
@@ -709,64 +1240,126 @@ stream_replay_notify(clicon_handle               h,
 		     event_stream_t             *es,
 		     struct stream_subscription *ss)
 {
-    int                   retval = -1;
-    struct stream_replay *r;
+    int                         retval = -1;
+    struct stream_replay       *r;
+    struct stream_replay_hdr   *rh;
+    struct stream_replay_entry *re;
+    uint64_t                    i;
+    uint64_t                    off;
+    uint64_t                    len;
+    cbuf                       *cb = NULL;
+    yang_stmt                  *yspec;
+    cxobj                      *xev = NULL;
 
     /* If <startTime> is not present, this is not a replay */
     if (!timerisset(&ss->ss_starttime))
 	goto ok;
-    if (!es->es_replay_enabled)
-	goto ok;
-    /* Get replay linked list */
     if ((r = es->es_replay) == NULL)
 	goto ok;
-    /* First loop to skip until start */
-    do {
-	if (timercmp(&r->r_tv, &ss->ss_starttime, >=))
-	    break;
-	r = NEXTQ(struct stream_replay *, r);
-    } while (r && r!=es->es_replay);
-    if (r == NULL)
-	goto ok; /* No samples to replay */
-    /* Then notify until stop */
-    do {
+    rh = r->r_hdr;
+    yspec = clicon_dbspec_yang(h);
+    if ((cb = cbuf_new()) == NULL){
+	clicon_err(OE_UNIX, errno, "cbuf_new");
+	goto done;
+    }
+    /* Skip until start, then notify until stop */
+    for (i = stream_replay_search(r, &ss->ss_starttime); i < rh->rh_nr; i++){
+	re = stream_replay_entry(r, i);
 	if (timerisset(&ss->ss_stoptime) &&
-	    timercmp(&r->r_tv, &ss->ss_stoptime, >))
+	    stream_replay_cmp(re, &ss->ss_stoptime) > 0)
 	    break;
-	if ((*ss->ss_fn)(h, 0, r->r_xml, ss->ss_arg) < 0)
+	/* Copy encoded event out of ring, in two parts if it wraps */
+	cbuf_reset(cb);
+	off = re->re_off % rh->rh_size;
+	len = re->re_len - 1;
+	if (off + len > rh->rh_size){
+	    cbuf_append_buf(cb, r->r_data + off, rh->rh_size - off);
+	    cbuf_append_buf(cb, r->r_data, len - (rh->rh_size - off));
+	}
+	else
+	    cbuf_append_buf(cb, r->r_data + off, len);
+	if (clixon_xml_parse_string(cbuf_get(cb), YB_NONE, yspec, &xev, NULL) < 0)
+	    goto done;
+	if (xml_rootchild(xev, 0, &xev) < 0)
 	    goto done;
-	r = NEXTQ(struct stream_replay *, r);
-    } while (r && r!=es->es_replay);
+	if ((*ss->ss_fn)(h, 0, xev, cbuf_get(cb), ss->ss_arg) < 0)
+	    goto done;
+	xml_free(xev);
+	xev = NULL;
+    }
  ok:
     retval = 0;
  done:
+    if (xev)
+	xml_free(xev);
+    if (cb)
+	cbuf_free(cb);
     return retval;
 }
 
 /*! Add replay sample to stream with timestamp
- * @param[in] es   Stream
- * @param[in] tv   Timestamp
- * @param[in] xv   XML
+ * The encoded event is copied to the replay ring. Oldest events are dropped if the
+ * time index or data ring is full, an event larger than the ring is not stored.
+ * @param[in] es     Stream
+ * @param[in] tv     Timestamp
+ * @param[in] evstr  Encoded notification
+ * @note The time index must be ordered for search. If the clock has been set back, the
+ * event is stored with the timestamp of the previous event
  */
 int
 stream_replay_add(event_stream_t *es,
 		  struct timeval *tv,
-		  cxobj          *xv)
+		  char           *evstr)
 {
-    int                   retval = -1;
-    struct stream_replay *new;
+    struct stream_replay       *r;
+    struct stream_replay_hdr   *rh;
+    struct stream_replay_entry *re;
+    struct stream_replay_entry *prev;
+    uint64_t                    len;
+    uint64_t                    off;
+    int64_t                     sec;
+    int64_t                     usec;
 
-    if ((new = malloc(sizeof *new)) == NULL){
-	clicon_err(OE_UNIX, errno, "malloc");
-	goto done;
+    if ((r = es->es_replay) == NULL)
+	return 0;
+    rh = r->r_hdr;
+    len = strlen(evstr) + 1;
+    if (len > rh->rh_size){
+	clicon_debug(1, "%s %s: event of %" PRIu64 " bytes larger than replay size, not stored",
+		     __FUNCTION__, es->es_name, len);
+	return 0;
     }
-    memset(new, 0, (sizeof *new));
-    new->r_tv = *tv;
-    new->r_xml = xv;
-    ADDQ(new, es->es_replay);
-    retval = 0;
- done:
-    return retval;
+    /* Drop oldest until there is room in index and data */
+    while (rh->rh_nr &&
+	   (rh->rh_nr == rh->rh_nmax ||
+	    rh->rh_tail + len - stream_replay_entry(r, 0)->re_off > rh->rh_size)){
+	rh->rh_first++;
+	rh->rh_nr--;
+    }
+    off = rh->rh_tail % rh->rh_size;
+    if (off + len > rh->rh_size){
+	memcpy(r->r_data + off, evstr, rh->rh_size - off);
+	memcpy(r->r_data, evstr + rh->rh_size - off, len - (rh->rh_size - off));
+    }
+    else
+	memcpy(r->r_data + off, evstr, len);
+    if (rh->rh_nr && stream_replay_cmp(stream_replay_entry(r, rh->rh_nr-1), tv) > 0){
+	prev = stream_replay_entry(r, rh->rh_nr-1);
+	sec = prev->re_sec;
+	usec = prev->re_usec;
+    }
+    else{
+	sec = tv->tv_sec;
+	usec = tv->tv_usec;
+    }
+    re = stream_replay_entry(r, rh->rh_nr);
+    re->re_sec = sec;
+    re->re_usec = usec;
+    re->re_off = rh->rh_tail;
+    re->re_len = len;
+    rh->rh_tail += len;
+    rh->rh_nr++;
+    return 0;
 }
 
 /* tmp struct for timeout callback containing clicon handle, 
@@ -77,6 +77,7 @@
 #include "clixon_netconf_lib.h"
 #include "clixon_xml_sort.h"
 #include "clixon_yang_type.h"
+#include "clixon_yang_parse_lib.h"
 #include "clixon_xml_bind.h"
 
 /*
@@ -177,7 +178,12 @@ populate_self_parent(cxobj  *xt,
     }
     if (xml2ns(xt, xml_prefix(xt), &ns) < 0)
 	goto done;
-    if ((y = yang_find_datanode(yparent, name)) == NULL){
+    /* Node may be augmented by a module not yet loaded, see CLICON_YANG_LAZY */
+    if ((y = yang_find_datanode(yparent, name)) == NULL &&
+	ns != NULL &&
+	yang_lazy_find(ys_spec(yparent), Y_NAMESPACE, ns) != NULL)
+	y = yang_find_datanode(yparent, name);
+    if (y == NULL){
 	if (_yang_unknown_anydata){
 	    /* Add dummy Y_ANYDATA yang stmt, see ysp_add */
 	    if ((y = yang_anydata_add(yparent, name)) < 0)
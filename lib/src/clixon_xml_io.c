@@ -245,6 +245,103 @@ xml_print(FILE  *f,
     return xml2file_recurse(f, x, 0, 1, fprintf);
 }
 
+/*! Print the start tag of an XML element including its attributes
+ * @param[in,out] cb          Cligen buffer to write to
+ * @param[in]     x           XML element
+ * @param[in]     level       Indentation level for prettyprint
+ * @param[in]     prettyprint Insert \n and spaces tomake the xml more readable.
+ * @param[out]    hasbody     Element has a body child
+ * @param[out]    empty       Element is empty and closed as <a/>, no end tag follows
+ * @see xml2cbuf_etag
+ */
+static int
+xml2cbuf_stag(cbuf  *cb, 
+	      cxobj *x, 
+	      int    level,
+	      int    prettyprint,
+	      int   *hasbody,
+	      int   *empty)
+{
+    cxobj *xc;
+    char  *namespace;
+    int    haselement;
+
+    namespace = xml_prefix(x);
+    if (prettyprint)
+	cprintf(cb, "%*s<", level*XML_INDENT, "");
+    else
+	cbuf_append_str(cb, "<");
+    if (namespace){
+	cbuf_append_str(cb, namespace);
+	cbuf_append_str(cb, ":");
+    }
+    cbuf_append_str(cb, xml_name(x));
+    *hasbody = 0;
+    haselement = 0;
+    xc = NULL;
+    /* print attributes only */
+    while ((xc = xml_child_each(x, xc, -1)) != NULL) 
+	switch (xml_type(xc)){
+	case CX_ATTR:
+	    if (clicon_xml2cbuf(cb, xc, level+1, prettyprint, -1) < 0)
+		return -1;
+	    break;
+	case CX_BODY:
+	    *hasbody=1;
+	    break;
+	case CX_ELMNT:
+	    haselement=1;
+	    break;
+	default:
+	    break;
+	}
+    /* Check for special case <a/> instead of <a></a> */
+    *empty = (*hasbody==0 && haselement==0);
+    if (*empty){
+	cbuf_append_str(cb, "/>");
+	if (prettyprint)
+	    cbuf_append_str(cb, "\n");
+    }
+    else{
+	cbuf_append_str(cb, ">");
+	if (prettyprint && *hasbody == 0)
+	    cbuf_append_str(cb, "\n");
+    }
+    return 0;
+}
+
+/*! Print the end tag of an XML element
+ * @param[in,out] cb          Cligen buffer to write to
+ * @param[in]     x           XML element
+ * @param[in]     level       Indentation level for prettyprint
+ * @param[in]     prettyprint Insert \n and spaces tomake the xml more readable.
+ * @param[in]     hasbody     Element has a body child, as returned by xml2cbuf_stag
+ * @see xml2cbuf_stag
+ */
+static int
+xml2cbuf_etag(cbuf  *cb, 
+	      cxobj *x, 
+	      int    level,
+	      int    prettyprint,
+	      int    hasbody)
+{
+    char  *namespace;
+
+    namespace = xml_prefix(x);
+    if (prettyprint && hasbody == 0)
+	cprintf(cb, "%*s", level*XML_INDENT, "");
+    cbuf_append_str(cb, "</");
+    if (namespace){
+	cbuf_append_str(cb, namespace);
+	cbuf_append_str(cb, ":");
+    }
+    cbuf_append_str(cb, xml_name(x));
+    cbuf_append_str(cb, ">");
+    if (prettyprint)
+	cbuf_append_str(cb, "\n");
+    return 0;
+}
+
 /*! Print an XML tree structure to a cligen buffer and encode chars "<>&"
  *
  * @param[in,out] cb          Cligen buffer to write to
@@ -274,7 +371,7 @@ clicon_xml2cbuf(cbuf   *cb,
     cxobj *xc;
     char  *name;
     int    hasbody;
-    int    haselement;
+    int    empty;
     char  *namespace;
     char  *val;
     
@@ -298,58 +395,17 @@ clicon_xml2cbuf(cbuf   *cb,
 	cprintf(cb, "%s=\"%s\"", name, xml_value(x));
 	break;
     case CX_ELMNT:
-	if (prettyprint)
-	    cprintf(cb, "%*s<", level*XML_INDENT, "");
-	else
-	    cbuf_append_str(cb, "<");
-	if (namespace){
-	    cbuf_append_str(cb, namespace);
-	    cbuf_append_str(cb, ":");
-	}
-	cbuf_append_str(cb, name);
-	hasbody = 0;
-	haselement = 0;
+	if (xml2cbuf_stag(cb, x, level, prettyprint, &hasbody, &empty) < 0)
+	    goto done;
+	if (empty)
+	    break;
 	xc = NULL;
-	/* print attributes only */
 	while ((xc = xml_child_each(x, xc, -1)) != NULL) 
-	    switch (xml_type(xc)){
-	    case CX_ATTR:
-		if (clicon_xml2cbuf(cb, xc, level+1, prettyprint, -1) < 0)
+	    if (xml_type(xc) != CX_ATTR)
+		if (clicon_xml2cbuf(cb, xc, level+1, prettyprint, depth-1) < 0)
 		    goto done;
-		break;
-	    case CX_BODY:
-		hasbody=1;
-		break;
-	    case CX_ELMNT:
-		haselement=1;
-		break;
-	    default:
-		break;
-	    }
-	/* Check for special case <a/> instead of <a></a> */
-	if (hasbody==0 && haselement==0) 
-	    cbuf_append_str(cb, "/>");
-	else{
-	    cbuf_append_str(cb, ">");
-	    if (prettyprint && hasbody == 0)
-		cbuf_append_str(cb, "\n");
-	    xc = NULL;
-	    while ((xc = xml_child_each(x, xc, -1)) != NULL) 
-		if (xml_type(xc) != CX_ATTR)
-		    if (clicon_xml2cbuf(cb, xc, level+1, prettyprint, depth-1) < 0)
-			goto done;
-	    if (prettyprint && hasbody == 0)
-		cprintf(cb, "%*s", level*XML_INDENT, "");
-	    cbuf_append_str(cb, "</");
-	    if (namespace){
-		cbuf_append_str(cb, namespace);
-		cbuf_append_str(cb, ":");
-	    }
-	    cbuf_append_str(cb, name);
-	    cbuf_append_str(cb, ">");
-	}
-	if (prettyprint)
-	    cbuf_append_str(cb, "\n");
+	if (xml2cbuf_etag(cb, x, level, prettyprint, hasbody) < 0)
+	    goto done;
 	break;
     default:
 	break;
@@ -360,6 +416,149 @@ clicon_xml2cbuf(cbuf   *cb,
     return retval;
 }
 
+/*
+ * Incremental XML encoding
+ * Same output as clicon_xml2cbuf of each node in a vector, but produced in pieces.
+ */
+
+/* One XML element being encoded */
+struct xml_frame {
+    cxobj *xf_x;       /* XML element */
+    int    xf_level;   /* Indentation level */
+    int    xf_hasbody; /* Element has body, from xml2cbuf_stag */
+    int    xf_i;       /* Index of next child */
+};
+
+/* Incremental XML encoder handle */
+struct xml_enc {
+    cxobj           **xe_vec;      /* Vector of XML nodes to encode (not owned) */
+    size_t            xe_veclen;   /* Length of vector */
+    size_t            xe_i;        /* Next vector index */
+    int               xe_pretty;   /* Pretty-print output */
+    struct xml_frame *xe_frames;   /* Stack of open elements */
+    int               xe_nframes;  /* Number of frames on stack */
+    int               xe_maxframes;/* Allocated frames */
+};
+
+/*! Create an incremental XML encoder
+ * @param[in]  vec    Vector of XML nodes. Not copied, must be kept until encoder is freed
+ * @param[in]  veclen Length of vector
+ * @param[in]  pretty Set if output is pretty-printed
+ * @retval     xe     Encoder handle, free with xml_enc_free
+ * @retval     NULL   Error
+ * @see json_enc_new
+ */
+xml_enc *
+xml_enc_new(cxobj **vec,
+	    size_t  veclen,
+	    int     pretty)
+{
+    xml_enc *xe;
+
+    if ((xe = malloc(sizeof(*xe))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	return NULL;
+    }
+    memset(xe, 0, sizeof(*xe));
+    xe->xe_vec = vec;
+    xe->xe_veclen = veclen;
+    xe->xe_pretty = pretty;
+    return xe;
+}
+
+/*! Free an incremental XML encoder, the XML nodes are not freed
+ * @param[in]  xe     XML encoder
+ */
+int
+xml_enc_free(xml_enc *xe)
+{
+    if (xe->xe_frames)
+	free(xe->xe_frames);
+    free(xe);
+    return 0;
+}
+
+/*! Print a node, if it is a non-empty element push it on the encoder stack
+ * @param[in]  xe     XML encoder
+ * @param[out] cb     Cligen buffer to write to
+ * @param[in]  x      XML node
+ * @param[in]  level  Indentation level of x
+ */
+static int
+xml_enc_push(xml_enc *xe,
+	     cbuf    *cb,
+	     cxobj   *x,
+	     int      level)
+{
+    struct xml_frame *xf;
+    int               hasbody;
+    int               empty;
+
+    if (xml_type(x) != CX_ELMNT)
+	return clicon_xml2cbuf(cb, x, level, xe->xe_pretty, -1);
+    if (xml2cbuf_stag(cb, x, level, xe->xe_pretty, &hasbody, &empty) < 0)
+	return -1;
+    if (empty)
+	return 0;
+    if (xe->xe_nframes == xe->xe_maxframes){
+	xe->xe_maxframes = xe->xe_maxframes ? 2*xe->xe_maxframes : 16;
+	if ((xe->xe_frames = realloc(xe->xe_frames,
+				     xe->xe_maxframes*sizeof(struct xml_frame))) == NULL){
+	    clicon_err(OE_UNIX, errno, "realloc");
+	    return -1;
+	}
+    }
+    xf = &xe->xe_frames[xe->xe_nframes++];
+    xf->xf_x = x;
+    xf->xf_level = level;
+    xf->xf_hasbody = hasbody;
+    xf->xf_i = 0;
+    return 0;
+}
+
+/*! Encode the next part of XML output
+ * Appends to cb until its length reaches maxlen (or encoding is done). The output may
+ * exceed maxlen by the size of one leaf.
+ * @param[in]  xe     XML encoder
+ * @param[out] cb     Cligen buffer to append to
+ * @param[in]  maxlen Stop when cb is at least this long, 0 means encode all
+ * @retval     1      More output remains, call again
+ * @retval     0      Done, all output is written
+ * @retval    -1      Error
+ * @see clicon_xml2cbuf  Recursive variant
+ */
+int
+xml_enc_next(xml_enc *xe,
+	     cbuf    *cb,
+	     size_t   maxlen)
+{
+    struct xml_frame *xf;
+    cxobj            *xc;
+
+    while (xe->xe_nframes || xe->xe_i < xe->xe_veclen){
+	if (maxlen && cbuf_len(cb) >= maxlen)
+	    return 1;
+	if (xe->xe_nframes == 0){
+	    if (xml_enc_push(xe, cb, xe->xe_vec[xe->xe_i++], 0) < 0)
+		return -1;
+	    continue;
+	}
+	xf = &xe->xe_frames[xe->xe_nframes-1];
+	while ((xc = xml_child_i(xf->xf_x, xf->xf_i)) != NULL && xml_type(xc) == CX_ATTR)
+	    xf->xf_i++;
+	if (xc != NULL){
+	    xf->xf_i++;
+	    if (xml_enc_push(xe, cb, xc, xf->xf_level+1) < 0)
+		return -1;
+	    continue;
+	}
+	if (xml2cbuf_etag(cb, xf->xf_x, xf->xf_level, xe->xe_pretty, xf->xf_hasbody) < 0)
+	    return -1;
+	xe->xe_nframes--;
+    }
+    return 0;
+}
+
 /*! Return an xml tree as a pretty-printed malloced string.
  * @param[in]  x    XML tree
  * @retval     str  Malloced pretty-printed string (should be free:d after use)
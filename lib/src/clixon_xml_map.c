@@ -2170,19 +2170,26 @@ done:
 }
 
 
-/*! Given XML tree x0 with marked nodes, copy marked nodes to new tree x1
- * Two marks are used: XML_FLAG_MARK and XML_FLAG_CHANGE
- *
- * The algorithm works as following:
- * (1) Copy individual nodes marked with XML_FLAG_CHANGE 
- * until nodes marked with XML_FLAG_MARK are reached, where 
- * (2) the complete subtree of that node is copied. 
- * (3) Special case: key nodes in lists are copied if any node in list is marked
- *  @note you may want to check:!yang_config(ys)
+/*! Copy marked nodes of x0 to x1, optionally through a filter
+ * @param[in]  x0    Source XML node
+ * @param[in]  x1    Destination XML node
+ * @param[in]  all   x0 is in a marked subtree: all children of x0 are candidates
+ * @param[in]  fn    Copy filter, or NULL
+ * @param[in]  arg   Argument to filter
+ * @param[in]  kept  An ancestor of x0 is kept by the filter for its own sake
+ * @param[out] keepp Set if a child of x0 is kept, not counting list keys kept for their list
+ * @retval     0     OK
+ * @retval    -1     Error
+ * @see xml_copy_marked
  */
-int
-xml_copy_marked(cxobj *x0, 
-		cxobj *x1)
+static int
+xml_copy_marked_recurse(cxobj             *x0, 
+			cxobj             *x1,
+			int                all,
+			xml_copy_filter_t *fn,
+			void              *arg,
+			int                kept,
+			int               *keepp)
 {
     int        retval = -1;
     int        mark;
@@ -2192,74 +2199,168 @@ xml_copy_marked(cxobj *x0,
     yang_stmt *yt;
     char      *name;
     char      *prefix;
+    int        sel;
+    int        own;
+    int        sub;
+    int        keep = 0;
+    int        r;
 
     assert(x0 && x1);
     yt = xml_spec(x0); /* can be null */
-    xml_spec_set(x1, yt);
-   /* Copy prefix*/
-    if ((prefix = xml_prefix(x0)) != NULL)
-	if (xml_prefix_set(x1, prefix) < 0)
-	    goto done;
-    
-    /* Copy all attributes */
-    x = NULL;
-    while ((x = xml_child_each(x0, x, CX_ATTR)) != NULL) {
-	name = xml_name(x);
-	if ((xcopy = xml_new(name, x1, CX_ATTR)) == NULL)
-	    goto done;
-	if (xml_copy(x, xcopy) < 0) 
+    if (all){ /* Copy node itself, its attributes and body */
+	if (xml_copy_one(x0, x1) < 0)
 	    goto done;
+	x = NULL;
+	while ((x = xml_child_each(x0, x, -1)) != NULL) {
+	    if (xml_type(x) == CX_ELMNT)
+		continue;
+	    if ((xcopy = xml_new(xml_name(x), x1, xml_type(x))) == NULL)
+		goto done;
+	    if (xml_copy(x, xcopy) < 0) 
+		goto done;
+	}
+    }
+    else {
+	xml_spec_set(x1, yt);
+	/* Copy prefix*/
+	if ((prefix = xml_prefix(x0)) != NULL)
+	    if (xml_prefix_set(x1, prefix) < 0)
+		goto done;
+	/* Copy all attributes */
+	x = NULL;
+	while ((x = xml_child_each(x0, x, CX_ATTR)) != NULL) {
+	    name = xml_name(x);
+	    if ((xcopy = xml_new(name, x1, CX_ATTR)) == NULL)
+		goto done;
+	    if (xml_copy(x, xcopy) < 0) 
+		goto done;
+	}
     }
-
     /* Go through children to detect any marked nodes:
      * (3) Special case: key nodes in lists are copied if any 
      * node in list is marked
      */
-    mark = 0;
+    mark = all;
     x = NULL;
-    while ((x = xml_child_each(x0, x, CX_ELMNT)) != NULL) {
-	if (xml_flag(x, XML_FLAG_MARK|XML_FLAG_CHANGE)){
+    while (!mark && (x = xml_child_each(x0, x, CX_ELMNT)) != NULL) {
+	if (xml_flag(x, XML_FLAG_MARK|XML_FLAG_CHANGE))
 	    mark++;
-	    break;
-	}
     }
     x = NULL;
     while ((x = xml_child_each(x0, x, CX_ELMNT)) != NULL) {
 	name = xml_name(x);
-	if (xml_flag(x, XML_FLAG_MARK)){
-	    /* (2) the complete subtree of that node is copied. */
-	    if ((xcopy = xml_new(name, x1, CX_ELMNT)) == NULL)
-		goto done;
-	    if (xml_copy(x, xcopy) < 0) 
-		goto done;
-	    continue; 
-	}
-	if (xml_flag(x, XML_FLAG_CHANGE)){
-	    /*  Copy individual nodes marked with XML_FLAG_CHANGE */
-	    if ((xcopy = xml_new(name, x1, CX_ELMNT)) == NULL)
-		goto done;
-	    if (xml_copy_marked(x, xcopy) < 0) /*  */
-		goto done;
-	}
-	/* (3) Special case: key nodes in lists are copied if any 
-	 * node in list is marked */
+	sel = all || xml_flag(x, XML_FLAG_MARK);
+	iskey = 0;
 	if (mark && yt && yang_keyword_get(yt) == Y_LIST){
 	    /* XXX: I think yang_key_match is suboptimal here */
 	    if ((iskey = yang_key_match(yt, name)) < 0)
 		goto done;
-	    if (iskey){
-		if ((xcopy = xml_new(name, x1, CX_ELMNT)) == NULL)
-		    goto done;
+	}
+	if (!sel && !iskey && !xml_flag(x, XML_FLAG_CHANGE))
+	    continue;
+	r = XML_COPY_KEEP | XML_COPY_TREE;
+	if (fn && (r = fn(x, arg)) < 0)
+	    goto done;
+	if (r == XML_COPY_SKIP)
+	    continue;
+	own = (r & XML_COPY_KEEP) || kept;
+	if ((r & XML_COPY_TREE) && !own && !iskey)
+	    continue; /* Nothing in this subtree is kept */
+	if ((xcopy = xml_new(name, x1, CX_ELMNT)) == NULL)
+	    goto done;
+	sub = 0;
+	if (r & XML_COPY_TREE){
+	    if (sel || iskey){
+		/* (2) the complete subtree of that node is copied. */
 		if (xml_copy(x, xcopy) < 0) 
 		    goto done;
 	    }
+	    /*  (1) Copy individual nodes marked with XML_FLAG_CHANGE */
+	    else if (xml_copy_marked_recurse(x, xcopy, 0, NULL, NULL, 1, &sub) < 0)
+		goto done;
 	}
+	else if (xml_copy_marked_recurse(x, xcopy, sel || iskey, fn, arg, own, &sub) < 0)
+	    goto done;
+	if (fn && (r & XML_COPY_KEEP))
+	    xml_flag_set(xcopy, XML_FLAG_MARK);
+	if (own || sub)
+	    keep++;
+	else if (!iskey && xml_purge(xcopy) < 0) /* Neither it nor any descendant is kept */
+	    goto done;
     }
+    if (keepp)
+	*keepp = keep;
     retval = 0;
  done:
     return retval;
 }
 
+/*! Given XML tree x0 with marked nodes, copy marked nodes to new tree x1
+ * Two marks are used: XML_FLAG_MARK and XML_FLAG_CHANGE
+ *
+ * The algorithm works as following:
+ * (1) Copy individual nodes marked with XML_FLAG_CHANGE 
+ * until nodes marked with XML_FLAG_MARK are reached, where 
+ * (2) the complete subtree of that node is copied. 
+ * (3) Special case: key nodes in lists are copied if any node in list is marked
+ *  @note you may want to check:!yang_config(ys)
+ * @see xml_copy_marked_filter
+ */
+int
+xml_copy_marked(cxobj *x0, 
+		cxobj *x1)
+{
+    return xml_copy_marked_recurse(x0, x1, 0, NULL, NULL, 1, NULL);
+}
+
+/*! Copy marked nodes of x0 to new tree x1 through a filter
+ *
+ * As xml_copy_marked, but every node that would be copied is first given to the filter
+ * fn, ancestors before descendants, which returns one of:
+ *  XML_COPY_SKIP          Node and its subtree are not copied
+ *  XML_COPY_KEEP          Node is kept for its own sake, its children are filtered
+ *  XML_COPY_ANY           Node is kept only if an ancestor or a descendant is kept for its
+ *                         own sake, its children are filtered
+ *  XML_COPY_TREE          Or:ed with KEEP or ANY: the decision holds for the whole subtree,
+ *                         which is copied (or not) without calling the filter further
+ * Nodes kept for their own sake are marked with XML_FLAG_MARK in x1.
+ * This is used to apply access control while copying, so that denied subtrees of the source
+ * tree are never copied.
+ * @param[in]  x0    Source XML tree with marked nodes
+ * @param[in]  x1    Destination XML tree (must exist)
+ * @param[in]  fn    Copy filter
+ * @param[in]  arg   Argument to filter
+ * @retval     0     OK
+ * @retval    -1     Error
+ * @see xml_copy_marked
+ * @see xml_copy_filter  to filter a whole tree
+ */
+int
+xml_copy_marked_filter(cxobj             *x0, 
+		       cxobj             *x1,
+		       xml_copy_filter_t *fn,
+		       void              *arg)
+{
+    return xml_copy_marked_recurse(x0, x1, 0, fn, arg, 0, NULL);
+}
+
+/*! Copy a whole XML tree x0 to new tree x1 through a filter
+ * @param[in]  x0    Source XML tree
+ * @param[in]  x1    Destination XML tree (must exist)
+ * @param[in]  fn    Copy filter, see xml_copy_marked_filter
+ * @param[in]  arg   Argument to filter
+ * @retval     0     OK
+ * @retval    -1     Error
+ */
+int
+xml_copy_filter(cxobj             *x0, 
+		cxobj             *x1,
+		xml_copy_filter_t *fn,
+		void              *arg)
+{
+    return xml_copy_marked_recurse(x0, x1, 1, fn, arg, 0, NULL);
+}
+
 /*! Check when condition 
  * 
  * @param[in]   h    Clixon handle
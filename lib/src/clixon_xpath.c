@@ -590,10 +590,40 @@ xpath_vec_ctx(cxobj      *xcur,
 {
     int         retval = -1;
     xpath_tree *xptree = NULL;
-    xp_ctx      xc = {0,};
     
     if (xpath_parse(xpath, &xptree) < 0)
 	goto done;
+    if (xpath_tree_eval(xcur, nsc, xptree, localonly, xrp) < 0)
+	goto done;
+    retval = 0;
+ done:
+    if (xptree)
+	xpath_tree_free(xptree);
+    return retval;
+}
+
+/*! Given XML tree and a parsed xpath tree, eval it and return xpath context
+ * Same as xpath_vec_ctx but with an xpath parsed in advance, eg when the same xpath is
+ * evaluated many times
+ * @param[in]  xcur   XML-tree where to search
+ * @param[in]  nsc    External XML namespace context, or NULL
+ * @param[in]  xptree XPATH parse tree as returned by xpath_parse
+ * @param[in]  localonly Skip prefix and namespace tests (non-standard)
+ * @param[out] xrp    Return XPATH context
+ * @retval     0      OK
+ * @retval    -1      Error
+ * @see xpath_vec_ctx
+ */
+int
+xpath_tree_eval(cxobj      *xcur, 
+		cvec       *nsc,
+		xpath_tree *xptree,
+		int         localonly,
+		xp_ctx    **xrp)
+{
+    int         retval = -1;
+    xp_ctx      xc = {0,};
+    
     xc.xc_type = XT_NODESET;
     xc.xc_node = xcur;
     xc.xc_initial = xcur;
@@ -601,14 +631,10 @@ xpath_vec_ctx(cxobj      *xcur,
 	goto done;
     if (xp_eval(&xc, xptree, nsc, localonly, xrp) < 0)
 	goto done;
-    if (xc.xc_nodeset){
-	free(xc.xc_nodeset);
-	xc.xc_nodeset = NULL;
-    }
     retval = 0;
  done:
-    if (xptree)
-	xpath_tree_free(xptree);
+    if (xc.xc_nodeset)
+	free(xc.xc_nodeset);
     return retval;
 }
 
@@ -84,6 +84,7 @@
 #include "clixon_yang_parse_lib.h"
 #include "clixon_yang_cardinality.h"
 #include "clixon_yang_type.h"
+#include "clixon_regex.h"
 #include "clixon_yang_internal.h" /* internal included by this file only, not API*/
 
 #ifdef XML_EXPLICIT_INDEX
@@ -636,6 +637,8 @@ ys_free(yang_stmt *ys)
     int i;
     yang_stmt *yc;
 
+    if (ys->ys_keyword == Y_SPEC)
+	yang_lazy_free(ys);
     for (i=0; i<ys->ys_len; i++){
 	if ((yc = ys->ys_stmt[i]) != NULL)
 	    ys_free(yc);
@@ -1407,6 +1410,17 @@ yang_key2str(int keyword)
     return (char*)clicon_int2str(ykmap, keyword);
 }
 
+/*! Map yang keyword string to keyword
+ * @param[in]  str    Yang keyword string, eg "container"
+ * @retval     keyw   Keyword, eg Y_CONTAINER
+ * @retval    -1      Not a yang keyword, eg an extension
+ */
+int
+yang_str2key(char *str)
+{
+    return clicon_str2int(ykmap, str);
+}
+
 /*! Find top data node among all modules by namespace in xml tree
  * @param[in]  yspec    Yang specification
  * @param[in]  xt       XML node
@@ -3507,6 +3521,10 @@ yang_type_cache_free(yang_type_cache *ycache)
 		    cv_void_set(cv, NULL);
 		}
 		break;
+	    case REGEXP_DFA: /* Shared, reference counted */
+		regex_dfa_free(cv_void_get(cv));
+		cv_void_set(cv, NULL);
+		break;
 	    default:
 		break;
 	    }
@@ -553,7 +553,8 @@ yang_find_module_by_prefix_yspec(yang_stmt *yspec,
 	    (yprefix = yang_find(ymod, Y_PREFIX, NULL)) != NULL &&
 	    strcmp(yang_argument_get(yprefix), prefix) == 0)
 	    return ymod;
-    return NULL;
+    /* Not loaded: try lazy modules, see CLICON_YANG_LAZY */
+    return yang_lazy_find(yspec, Y_PREFIX, prefix);
 }
 
 /*! Given a yang spec and a namespace, return yang module 
@@ -577,6 +578,9 @@ yang_find_module_by_namespace(yang_stmt *yspec,
 	if (yang_find(ymod, Y_NAMESPACE, ns) != NULL)
 	    break;
     }
+    /* Not loaded: try lazy modules, see CLICON_YANG_LAZY */
+    if (ymod == NULL)
+	ymod = yang_lazy_find(yspec, Y_NAMESPACE, ns);
  done:
     return ymod;
 }
@@ -613,6 +617,10 @@ yang_find_module_by_namespace_revision(yang_stmt  *yspec,
 		    break; /* return this ymod */
 	    }
     }
+    /* Not loaded: load lazy module and try again, see CLICON_YANG_LAZY */
+    if (ymod == NULL &&
+	yang_lazy_find(yspec, Y_NAMESPACE, ns) != NULL)
+	ymod = yang_find_module_by_namespace_revision(yspec, ns, rev);
  done:
     return ymod;
 }
@@ -654,6 +662,10 @@ yang_find_module_by_name_revision(yang_stmt  *yspec,
 		break; /* return this ymod */
 	}
     }
+    /* Not loaded: load lazy module and try again, see CLICON_YANG_LAZY */
+    if (ymod == NULL &&
+	yang_lazy_find(yspec, Y_MODULE, name) != NULL)
+	ymod = yang_find_module_by_name_revision(yspec, name, rev);
  done:
     return ymod;
 }
@@ -677,5 +689,6 @@ yang_find_module_by_name(yang_stmt *yspec,
 	if ((yang_keyword_get(ymod) == Y_MODULE || yang_keyword_get(ymod) == Y_SUBMODULE) &&
 	    strcmp(yang_argument_get(ymod), name)==0)
 	    return ymod;
-    return NULL;
+    /* Not loaded: try lazy modules, see CLICON_YANG_LAZY */
+    return yang_lazy_find(yspec, Y_MODULE, name);
 }
@@ -797,36 +797,36 @@ yang_parse_file(FILE       *fp,
 		yang_stmt  *yspec)
 {
     char         *buf = NULL;
-    int           i;
-    char          c;
-    int           len;
+    size_t        i;
+    size_t        len;
     yang_stmt    *ymod = NULL;
-    int           ret;
+    size_t        ret;
+    struct stat   st;
 
     len = BUFLEN; /* any number is fine */
+    /* Read regular files in one go (+2: room for null and to detect eof) */
+    if (fstat(fileno(fp), &st) == 0 && S_ISREG(st.st_mode) && st.st_size + 2 > len)
+	len = st.st_size + 2;
     if ((buf = malloc(len)) == NULL){
 	clicon_err(OE_XML, errno, "malloc");
 	goto done;
     }
-    memset(buf, 0, len);
     i = 0; /* position in buf */
-    while (1){ /* read the whole file */
-	if ((ret = fread(&c, 1, 1, fp)) < 0){
-	    clicon_err(OE_XML, errno, "read");
-	    break;
-	}
-	if (ret == 0)
-	    break; /* eof */
+    while ((ret = fread(buf+i, 1, len-1-i, fp)) > 0){ /* read the whole file */
+	i += ret;
 	if (i == len-1){
 	    if ((buf = realloc(buf, 2*len)) == NULL){
 		clicon_err(OE_XML, errno, "realloc");
 		goto done;
 	    }	    
-	    memset(buf+len, 0, len);
 	    len *= 2;
 	}
-	buf[i++] = (char)(c&0xff);
-    } /* read a line */
+    }
+    if (ferror(fp)){
+	clicon_err(OE_XML, errno, "read");
+	goto done;
+    }
+    buf[i] = '\0';
     if ((ymod = yang_parse_str(buf, name, yspec)) < 0)
 	goto done;
   done:
@@ -873,6 +873,55 @@ filename2revision(const char *filename,
     return retval;
 }
 
+/*! Cached yang file listing of one yang directory */
+typedef struct {
+    struct dirent *yd_dp;   /* Sorted .yang files */
+    int            yd_ndp;  /* Number of files */
+} yang_dir_t;
+
+/* Yang directory listings, valid during a top-level yang load, see yang_dir_cache_start */
+static clicon_hash_t *_yang_dir_cache = NULL;
+static int            _yang_dir_refs = 0;
+
+/*! Start caching of yang directory listings
+ * Resolving the imports of many modules would otherwise read and regexp-match every
+ * directory once per import. Calls may be nested (eg lazy loading, see yang_lazy_load), 
+ * the cache is dropped by the outermost stop so that files added in between loads are seen.
+ * @retval  0   OK
+ * @retval -1   Error
+ * @see yang_dir_cache_stop
+ */
+static int
+yang_dir_cache_start(void)
+{
+    if (_yang_dir_refs == 0 &&
+	(_yang_dir_cache = clicon_hash_init()) == NULL)
+	return -1;
+    _yang_dir_refs++;
+    return 0;
+}
+
+/*! Stop caching of yang directory listings
+ * @see yang_dir_cache_start
+ */
+static void
+yang_dir_cache_stop(void)
+{
+    clicon_hash_t he = NULL;
+    yang_dir_t   *yd;
+
+    if (_yang_dir_refs == 0 || --_yang_dir_refs > 0)
+	return;
+    while ((he = clicon_hash_next(_yang_dir_cache, he)) != NULL){
+	yd = *(yang_dir_t **)he->h_val;
+	if (yd->yd_dp)
+	    free(yd->yd_dp);
+	free(yd);
+    }
+    clicon_hash_free(_yang_dir_cache);
+    _yang_dir_cache = NULL;
+}
+
 /*! No specific revision give. Match a yang file given module 
  * @param[in]  h        CLICON handle
  * @param[in]  module   Name of main YANG module. 
@@ -894,27 +943,20 @@ yang_parse_find_match(clicon_handle h,
     int            retval = -1;
     struct dirent *dp = NULL;
     int            ndp;
-    cbuf          *regex = NULL;
     cxobj         *x;
     cxobj         *xc;
     char          *dir;
+    yang_dir_t    *yd;
+    void          *p;
+    size_t         mlen;
+    char          *suffix;
+    int            i;
+    int            match;
 
     /* get clicon config file in xml form */
     if ((x = clicon_conf_xml(h)) == NULL)
 	goto ok;
-    if ((regex = cbuf_new()) == NULL){
-	clicon_err(OE_YANG, errno, "cbuf_new");
-	goto done;
-    }
-    /* RFC 6020: The name of the file SHOULD be of the form:
-     * module-or-submodule-name ['@' revision-date] ( '.yang' / '.yin' )
-     * revision-date ::= 4DIGIT "-" 2DIGIT "-" 2DIGIT
-     */
-    if (revision)
-	cprintf(regex, "^%s@%s(.yang)$", module, revision);
-    else
-	cprintf(regex, "^%s(@[0-9][0-9][0-9][0-9]-[0-9][0-9]-[0-9][0-9])?(.yang)$", 
-		module);
+    mlen = strlen(module);
     xc = NULL;
     while ((xc = xml_child_each(x, xc, CX_ELMNT)) != NULL) {
 	/* Skip if not yang dir */
@@ -922,26 +964,69 @@ yang_parse_find_match(clicon_handle h,
 	    strcmp(xml_name(xc), "CLICON_YANG_MAIN_DIR") != 0)
 	    continue;
 	dir = xml_body(xc);
-	/* get all matching files in this directory */
-	if ((ndp = clicon_file_dirent(dir, 
-				      &dp, 
-				      cbuf_get(regex),
-				      S_IFREG)) < 0)
-	    goto done;
-	/* Entries are sorted, last entry should be most recent date 
+	/* get all yang files in this directory, cached if a yang load is in progress */
+	if (_yang_dir_cache &&
+	    (p = clicon_hash_value(_yang_dir_cache, dir, NULL)) != NULL){
+	    yd = *(yang_dir_t **)p;
+	    ndp = yd->yd_ndp;
+	    dp = yd->yd_dp;
+	}
+	else{
+	    if ((ndp = clicon_file_dirent(dir, &dp, "(.yang)$", S_IFREG)) < 0)
+		goto done;
+	    if (_yang_dir_cache){
+		if ((yd = malloc(sizeof(*yd))) == NULL){
+		    clicon_err(OE_UNIX, errno, "malloc");
+		    free(dp);
+		    goto done;
+		}
+		yd->yd_dp = dp;
+		yd->yd_ndp = ndp;
+		if (clicon_hash_add(_yang_dir_cache, dir, &yd, sizeof(yd)) == NULL){
+		    free(yd);
+		    free(dp);
+		    goto done;
+		}
+	    }
+	}
+	/* RFC 6020: The name of the file SHOULD be of the form:
+	 * module-or-submodule-name ['@' revision-date] ( '.yang' / '.yin' )
+	 * revision-date ::= 4DIGIT "-" 2DIGIT "-" 2DIGIT
+	 * Entries are sorted, last match should be most recent date 
 	 */
-	if (ndp != 0){
-	    cprintf(fbuf, "%s/%s", dir, dp[ndp-1].d_name);
+	for (i = ndp-1; i >= 0; i--){
+	    if (strncmp(dp[i].d_name, module, mlen) != 0)
+		continue;
+	    suffix = dp[i].d_name + mlen;
+	    if (revision)
+		match = suffix[0] == '@' &&
+		    strncmp(suffix+1, revision, strlen(revision)) == 0 &&
+		    strcmp(suffix+1+strlen(revision), ".yang") == 0;
+	    else
+		match = strcmp(suffix, ".yang") == 0 ||
+		    (suffix[0] == '@' &&
+		     isdigit(suffix[1]) && isdigit(suffix[2]) && isdigit(suffix[3]) &&
+		     isdigit(suffix[4]) && suffix[5] == '-' &&
+		     isdigit(suffix[6]) && isdigit(suffix[7]) && suffix[8] == '-' &&
+		     isdigit(suffix[9]) && isdigit(suffix[10]) &&
+		     strcmp(suffix+11, ".yang") == 0);
+	    if (match)
+		break;
+	}
+	if (i >= 0){
+	    cprintf(fbuf, "%s/%s", dir, dp[i].d_name);
 	    retval = 1;
 	    goto done;
 	}
+	if (_yang_dir_cache == NULL && dp){
+	    free(dp);
+	}
+	dp = NULL;
     }
  ok:
     retval = 0;
  done:
-    if (regex)
-	cbuf_free(regex);
-    if (dp)
+    if (_yang_dir_cache == NULL && dp)
 	free(dp);
     return retval;
 }
@@ -1517,6 +1602,8 @@ yang_spec_parse_module(clicon_handle h,
     int         modmin;       /* Existing number of modules */
     char       *base = NULL;;
 
+    if (yang_dir_cache_start() < 0)
+	return -1;
     if (yspec == NULL){
 	clicon_err(OE_YANG, EINVAL, "yang spec is NULL");
 	goto done;
@@ -1538,6 +1625,7 @@ yang_spec_parse_module(clicon_handle h,
  ok:
     retval = 0;
  done:
+    yang_dir_cache_stop();
     if (base)
 	free(base);
     return retval;
@@ -1562,6 +1650,8 @@ yang_spec_parse_file(clicon_handle h,
     int         modmin;       /* Existing number of modules */
     char       *base = NULL;;
 
+    if (yang_dir_cache_start() < 0)
+	return -1;
     /* Apply steps 2.. on new modules, ie ones after modmin. */
     modmin = yang_len_get(yspec);
     /* Find module, and do not load file if module already exists */
@@ -1584,11 +1674,387 @@ yang_spec_parse_file(clicon_handle h,
  ok:
     retval = 0;
  done:
+    yang_dir_cache_stop();
     if (base)
 	free(base);
     return retval;
 }
 
+/*
+ * Lazy loading of modules, see CLICON_YANG_LAZY
+ * Module files found by yang_spec_load_dir are only scanned for their header, which is
+ * kept as a module stub in a separate registry per yang spec. A stub is loaded into the
+ * yang spec (parsed and post-processed) when first referenced via yang_lazy_find.
+ */
+
+/*! Lazy module registry of one yang spec */
+typedef struct {
+    qelem_t        yl_qelem;  /* List header */
+    yang_stmt     *yl_yspec;  /* Yang spec modules are loaded into */
+    clicon_handle  yl_h;      /* Clicon handle, needed for post-processing */
+    yang_stmt     *yl_stubs;  /* Spec of header-only module stubs */
+} yang_lazy_t;
+
+static yang_lazy_t *_yang_lazy_list = NULL;
+
+/*! Find lazy registry of a yang spec
+ * @param[in]  yspec  Yang specification
+ * @retval     yl     Registry
+ * @retval     NULL   No lazy modules registered for this spec
+ */
+static yang_lazy_t *
+yang_lazy_get(yang_stmt *yspec)
+{
+    yang_lazy_t *yl;
+
+    if ((yl = _yang_lazy_list) != NULL){
+	do {
+	    if (yl->yl_yspec == yspec)
+		return yl;
+	    yl = NEXTQ(yang_lazy_t *, yl);
+	} while (yl && yl != _yang_lazy_list);
+    }
+    return NULL;
+}
+
+/*! Read next lexical token of a yang file, skipping whitespace and comments
+ * @param[in]  fp    Open yang file
+ * @param[out] cb    Token string if type is 's'
+ * @retval     's'   String, quoted or unquoted
+ * @retval     c     One of ';', '{', '}' or '+'
+ * @retval     0     End of file
+ */
+static int
+yang_header_token(FILE *fp,
+		  cbuf *cb)
+{
+    int c;
+    int c1;
+    int q;
+
+    cbuf_reset(cb);
+    while ((c = fgetc(fp)) != EOF){
+	if (isspace(c))
+	    continue;
+	if (c == '/'){
+	    if ((c1 = fgetc(fp)) == '/'){ /* Line comment */
+		while ((c = fgetc(fp)) != EOF && c != '\n');
+		continue;
+	    }
+	    if (c1 == '*'){ /* Block comment */
+		c1 = 0;
+		while ((c = fgetc(fp)) != EOF && !(c1 == '*' && c == '/'))
+		    c1 = c;
+		continue;
+	    }
+	    ungetc(c1, fp);
+	}
+	break;
+    }
+    switch (c){
+    case EOF:
+	return 0;
+    case ';': case '{': case '}': case '+':
+	return c;
+    case '"': case '\'':
+	q = c;
+	while ((c = fgetc(fp)) != EOF && c != q){
+	    if (c == '\\' && q == '"' && (c = fgetc(fp)) == EOF)
+		break;
+	    cprintf(cb, "%c", c);
+	}
+	return 's';
+    default:
+	cprintf(cb, "%c", c);
+	while ((c = fgetc(fp)) != EOF){
+	    if (isspace(c) || c == ';' || c == '{' || c == '}'){
+		ungetc(c, fp);
+		break;
+	    }
+	    cprintf(cb, "%c", c);
+	}
+	return 's';
+    }
+}
+
+/*! Scan module header of a yang file without parsing the module body
+ *
+ * Only the header, linkage, meta and revision statements are read: scanning stops at the
+ * first body statement.
+ * @param[in]  filename  Yang file
+ * @param[out] ystub     Module stub with namespace, prefix and (first) revision,
+ *                       NULL if file is a submodule. Free with ys_free
+ * @retval     0         OK
+ * @retval    -1         Error
+ */
+static int
+yang_parse_header(const char *filename,
+		  yang_stmt **ystubp)
+{
+    int           retval = -1;
+    FILE         *fp = NULL;
+    cbuf         *cb = NULL;
+    cbuf         *cbarg = NULL;
+    yang_stmt    *ystub = NULL;
+    yang_stmt    *ys;
+    enum rfc_6020 keyw;
+    int           t;
+    int           depth;
+
+    if ((fp = fopen(filename, "r")) == NULL){
+	clicon_err(OE_YANG, errno, "fopen(%s)", filename);	
+	goto done;
+    }
+    if ((cb = cbuf_new()) == NULL ||
+	(cbarg = cbuf_new()) == NULL){
+	clicon_err(OE_YANG, errno, "cbuf_new");
+	goto done;
+    }
+    if (yang_header_token(fp, cb) != 's' ||
+	(strcmp(cbuf_get(cb), "module") != 0 && strcmp(cbuf_get(cb), "submodule") != 0)){
+	clicon_err(OE_YANG, EINVAL, "%s: expected module or submodule", filename);
+	goto done;
+    }
+    if (strcmp(cbuf_get(cb), "submodule") == 0){
+	*ystubp = NULL;
+	goto ok;
+    }
+    if (yang_header_token(fp, cb) != 's' || yang_header_token(fp, cbarg) != '{'){
+	clicon_err(OE_YANG, EINVAL, "%s: expected module name", filename);
+	goto done;
+    }
+    if ((ystub = ys_new(Y_MODULE)) == NULL)
+	goto done;
+    if (yang_argument_set(ystub, strdup(cbuf_get(cb))) < 0)
+	goto done;
+    if (yang_filename_set(ystub, filename) < 0)
+	goto done;
+    yang_flag_set(ystub, YANG_FLAG_LAZY);
+    /* Loop over top-level statements: keyword [argument] (';' | '{' ... '}') */
+    while ((t = yang_header_token(fp, cb)) == 's'){
+	keyw = yang_str2key(cbuf_get(cb));
+	if (keyw != Y_YANG_VERSION && keyw != Y_NAMESPACE && keyw != Y_PREFIX &&
+	    keyw != Y_IMPORT && keyw != Y_INCLUDE && keyw != Y_ORGANIZATION &&
+	    keyw != Y_CONTACT && keyw != Y_DESCRIPTION && keyw != Y_REFERENCE &&
+	    keyw != Y_REVISION)
+	    break; /* First body statement: done */
+	/* Argument, with string concatenation */
+	cbuf_reset(cbarg);
+	while ((t = yang_header_token(fp, cb)) == 's' || t == '+')
+	    if (t == 's')
+		cprintf(cbarg, "%s", cbuf_get(cb));
+	if ((keyw == Y_NAMESPACE || keyw == Y_PREFIX ||
+	     (keyw == Y_REVISION && yang_find(ystub, Y_REVISION, NULL) == NULL))){
+	    if ((ys = ys_new(keyw)) == NULL)
+		goto done;
+	    if (yang_argument_set(ys, strdup(cbuf_get(cbarg))) < 0 ||
+		yn_insert(ystub, ys) < 0){
+		ys_free(ys);
+		goto done;
+	    }
+	}
+	if (t == '{'){ /* Skip substatements */
+	    depth = 1;
+	    while (depth && (t = yang_header_token(fp, cb)) != 0){
+		if (t == '{')
+		    depth++;
+		else if (t == '}')
+		    depth--;
+	    }
+	}
+	else if (t != ';')
+	    break;
+    }
+    if (yang_find(ystub, Y_NAMESPACE, NULL) == NULL ||
+	yang_find(ystub, Y_PREFIX, NULL) == NULL){
+	clicon_err(OE_YANG, EINVAL, "%s: module %s header lacks namespace or prefix",
+		   filename, yang_argument_get(ystub));
+	goto done;
+    }
+    *ystubp = ystub;
+    ystub = NULL;
+ ok:
+    retval = 0;
+ done:
+    if (ystub)
+	ys_free(ystub);
+    if (cb)
+	cbuf_free(cb);
+    if (cbarg)
+	cbuf_free(cbarg);
+    if (fp)
+	fclose(fp);
+    return retval;
+}
+
+/*! Register a yang file as a lazily loaded module by scanning its header
+ * @param[in]  h         Clicon handle
+ * @param[in]  filename  Yang file
+ * @param[in]  yspec     Yang spec the module is loaded into when referenced
+ * @retval     0         OK, also if file is a submodule which is skipped
+ * @retval    -1         Error
+ */
+static int
+yang_lazy_register(clicon_handle h,
+		   const char   *filename,
+		   yang_stmt    *yspec)
+{
+    int          retval = -1;
+    yang_lazy_t *yl;
+    yang_stmt   *ystub = NULL;
+
+    if (yang_parse_header(filename, &ystub) < 0)
+	goto done;
+    if (ystub == NULL) /* submodule: loaded by its module */
+	goto ok;
+    if ((yl = yang_lazy_get(yspec)) == NULL){
+	if ((yl = malloc(sizeof(*yl))) == NULL){
+	    clicon_err(OE_UNIX, errno, "malloc");
+	    goto done;
+	}
+	memset(yl, 0, sizeof(*yl));
+	if ((yl->yl_stubs = yspec_new()) == NULL){
+	    free(yl);
+	    goto done;
+	}
+	yl->yl_yspec = yspec;
+	yl->yl_h = h;
+	ADDQ(yl, _yang_lazy_list);
+    }
+    if (yang_find(yl->yl_stubs, Y_MODULE, yang_argument_get(ystub)) != NULL)
+	goto ok; /* first file wins */
+    clicon_debug(1, "%s %s", __FUNCTION__, filename);
+    if (yn_insert(yl->yl_stubs, ystub) < 0)
+	goto done;
+    ystub = NULL;
+ ok:
+    retval = 0;
+ done:
+    if (ystub)
+	ys_free(ystub);
+    return retval;
+}
+
+/*! Iterate over module stubs that are not yet loaded
+ *
+ * The stubs have module name as argument, and namespace, prefix and (first) revision
+ * as children. 
+ * @param[in]  yspec  Yang specification
+ * @param[in]  yprev  Previous stub, or NULL on init
+ * @retval     ystub  Next module stub not yet loaded
+ * @retval     NULL   No more stubs
+ * @see CLICON_YANG_LAZY
+ */
+yang_stmt *
+yang_lazy_each(yang_stmt *yspec,
+	       yang_stmt *yprev)
+{
+    yang_lazy_t *yl;
+    yang_stmt   *ystub = yprev;
+
+    if ((yl = yang_lazy_get(yspec)) == NULL)
+	return NULL;
+    while ((ystub = yn_each(yl->yl_stubs, ystub)) != NULL){
+	if (yang_flag_get(ystub, YANG_FLAG_LAZY) == 0)
+	    continue;
+	/* Loaded by other means, eg import */
+	if (yang_find(yspec, Y_MODULE, yang_argument_get(ystub)) != NULL){
+	    yang_flag_reset(ystub, YANG_FLAG_LAZY);
+	    continue;
+	}
+	break;
+    }
+    return ystub;
+}
+
+/*! Load a lazy module stub: parse and post-process it into the yang spec
+ * @param[in]  yspec  Yang specification
+ * @param[in]  ystub  Module stub, see yang_lazy_each
+ * @retval     ymod   Loaded yang module
+ * @retval     NULL   Error
+ */
+yang_stmt *
+yang_lazy_load(yang_stmt *yspec,
+	       yang_stmt *ystub)
+{
+    yang_stmt   *ymod = NULL;
+    yang_lazy_t *yl;
+    char        *name = yang_argument_get(ystub);
+    char        *filename = NULL;
+
+    if ((ymod = yang_find(yspec, Y_MODULE, name)) != NULL){
+	yang_flag_reset(ystub, YANG_FLAG_LAZY);
+	return ymod;
+    }
+    if ((yl = yang_lazy_get(yspec)) == NULL){
+	clicon_err(OE_YANG, EINVAL, "No lazy modules registered for yang spec");
+	return NULL;
+    }
+    /* Reset first so that references during loading do not recurse */
+    yang_flag_reset(ystub, YANG_FLAG_LAZY);
+    clicon_debug(1, "%s %s", __FUNCTION__, name);
+    /* Copy since the stub filename is const and basename(3) may modify its argument */
+    if ((filename = strdup(yang_filename_get(ystub))) == NULL){
+	clicon_err(OE_UNIX, errno, "strdup");
+	goto done;
+    }
+    if (yang_spec_parse_file(yl->yl_h, filename, yspec) < 0)
+	goto done;
+    ymod = yang_find(yspec, Y_MODULE, name);
+ done:
+    if (filename)
+	free(filename);
+    return ymod;
+}
+
+/*! Find a module stub not yet loaded and load it
+ *
+ * Used as fallback when looking up a module in a yang spec fails
+ * @param[in]  yspec   Yang specification
+ * @param[in]  keyword Y_MODULE: match on name, Y_NAMESPACE or Y_PREFIX: match on header
+ * @param[in]  arg     Name, namespace or prefix
+ * @retval     ymod    Loaded yang module
+ * @retval     NULL    Not found or error
+ */
+yang_stmt *
+yang_lazy_find(yang_stmt    *yspec,
+	       enum rfc_6020 keyword,
+	       const char   *arg)
+{
+    yang_stmt *ystub = NULL;
+
+    if (arg == NULL || _yang_lazy_list == NULL)
+	return NULL;
+    while ((ystub = yang_lazy_each(yspec, ystub)) != NULL){
+	if (keyword == Y_MODULE){
+	    if (strcmp(yang_argument_get(ystub), arg) == 0)
+		break;
+	}
+	else if (yang_find(ystub, keyword, arg) != NULL)
+	    break;
+    }
+    if (ystub == NULL)
+	return NULL;
+    return yang_lazy_load(yspec, ystub);
+}
+
+/*! Free lazy module registry of a yang spec
+ * @param[in]  yspec  Yang specification
+ * @retval     0      OK
+ */
+int
+yang_lazy_free(yang_stmt *yspec)
+{
+    yang_lazy_t *yl;
+
+    if ((yl = yang_lazy_get(yspec)) != NULL){
+	DELQ(yl, _yang_lazy_list, yang_lazy_t *);
+	ys_free(yl->yl_stubs);
+	free(yl);
+    }
+    return 0;
+}
+
 /*! Load all yang modules in directory
  * @param[in]  h     Clicon handle
  * @param[in]  dir   Load all yang modules in this directory
@@ -1603,6 +2069,7 @@ yang_spec_parse_file(clicon_handle h,
  * 3) If only x@rev.yang's found, prefer newest (newest revision)
  * There is also an extra failsafe which may not be necessary, which removes
  * the oldest module if 1-3 for some reason fails.
+ * If CLICON_YANG_LAZY is set, modules are not parsed, only registered, see yang_lazy_find
  */
 int
 yang_spec_load_dir(clicon_handle h,
@@ -1625,7 +2092,14 @@ yang_spec_load_dir(clicon_handle h,
     uint32_t       rev0; /* revision in existing module */
     char          *oldbase = NULL;
     int            taken = 0;
+    int            lazy;
+#ifdef POSIX_FADV_WILLNEED
+    int            fd;
+#endif
     
+    if (yang_dir_cache_start() < 0)
+	return -1;
+    lazy = clicon_option_bool(h, "CLICON_YANG_LAZY");
     /* Get yang files names from yang module directory. Note that these
      * are sorted alphatetically:
      * a.yang, 
@@ -1638,6 +2112,17 @@ yang_spec_load_dir(clicon_handle h,
 	goto ok;
     /* Apply post steps on new modules, ie ones after modmin. */
     modmin = yang_len_get(yspec);
+#ifdef POSIX_FADV_WILLNEED
+    /* Let the kernel read all files concurrently while they are parsed one by one */
+    if (!lazy)
+	for (i = 0; i < ndp; i++){
+	    snprintf(filename, MAXPATHLEN-1, "%s/%s", dir, dp[i].d_name);
+	    if ((fd = open(filename, O_RDONLY)) >= 0){
+		(void)posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+		close(fd);
+	    }
+	}
+#endif
     /* Load all yang files in dir */
     for (i = 0; i < ndp; i++) {
 	/* base = module name [+ @rev ] + .yang */
@@ -1681,6 +2166,11 @@ yang_spec_load_dir(clicon_handle h,
 	}
 	/* Create full filename */
 	snprintf(filename, MAXPATHLEN-1, "%s/%s", dir, dp[i].d_name);
+	if (lazy){ /* Only read header, module is loaded when referenced */
+	    if (yang_lazy_register(h, filename, yspec) < 0)
+		goto done;
+	    continue;
+	}
 	if ((ym = yang_parse_filename(filename, yspec)) == NULL)
 	    goto done;
 	revm = 0;
@@ -1709,6 +2199,7 @@ yang_spec_load_dir(clicon_handle h,
  ok:
     retval = 0;
   done:
+    yang_dir_cache_stop();
     if (dp)
 	free(dp);
     if (base)
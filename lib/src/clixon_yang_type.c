@@ -174,6 +174,8 @@ yang_builtin(char *type)
  * The downside is that all accesses to "patterns" must pass via the cache.
  * If calls to yang_type_resolve is made without the cache is set, will be
  * wrong.
+ * In dfa mode, all patterns (max 64) are compiled into a single automaton
+ * that is evaluated in one pass, including invert-match.
  * @see match_regexp  in cligen code
  * @see yang_type_resolve_restrictions  where patterns is set
  */
@@ -188,7 +190,44 @@ compile_pattern2regexp(clicon_handle h,
     void   *re = NULL;
     int     ret;
     char   *pattern;
+    char   *pvec[64];
+    int     ivec[64];
+    int     i;
+    int     j;
 
+    if (clicon_yang_regexp(h) == REGEXP_DFA && cvec_len(patterns) <= 64){
+	i = 0;
+	pcv = NULL;
+	while ((pcv = cvec_each(patterns, pcv)) != NULL){
+	    pvec[i] = cv_string_get(pcv);
+	    ivec[i++] = cv_flag(pcv, V_INVERT)?1:0;
+	}
+	if ((ret = regex_dfa_compile(pvec, ivec, i, &re)) < 0)
+	    goto done;
+	if (ret == 0){ /* Find the failing pattern for the error message */
+	    pattern = pvec[0];
+	    for (j=0; j<i; j++){
+		if ((ret = regex_dfa_compile(&pvec[j], NULL, 1, &re)) < 0)
+		    goto done;
+		if (ret == 0){
+		    pattern = pvec[j];
+		    break;
+		}
+		regex_dfa_free(re);
+		re = NULL;
+	    }
+	    clicon_err(OE_YANG, 0, "regexp compile fail: \"%s\"", pattern);
+	    goto done;
+	}
+	if ((rcv = cvec_add(regexps, CGV_VOID)) == NULL){
+	    clicon_err(OE_UNIX, errno, "cvec_add");
+	    goto done;
+	}
+	cv_void_set(rcv, re);
+	re = NULL;
+	retval = 1;
+	goto done;
+    }
     pcv = NULL;
     while ((pcv = cvec_each(patterns, pcv)) != NULL){
 	pattern = cv_string_get(pcv);
@@ -214,6 +253,8 @@ compile_pattern2regexp(clicon_handle h,
     }
     retval = 1;
  done:
+    if (re)
+	regex_free(h, re);
     return retval;
 }
 
@@ -0,0 +1,128 @@
+#!/usr/bin/env bash
+# Group commit of autocommit edits with CLICON_AUTOCOMMIT_BATCH
+# Concurrent edits are committed in one transaction, and each client gets its own reply.
+# An edit that fails validation gets an error, while the other edits are committed
+# Transactions are counted by the transaction log of the example plugin (-- -t)
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf.xml
+fyang=$dir/example.yang
+flog=$dir/backend.log
+touch $flog
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_DIR>$IETFRFC</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_BACKEND_REGEXP>example_backend.so$</CLICON_BACKEND_REGEXP>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+  <CLICON_AUTOCOMMIT>1</CLICON_AUTOCOMMIT>
+  <CLICON_AUTOCOMMIT_BATCH>500</CLICON_AUTOCOMMIT_BATCH>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module example{
+   yang-version 1.1;
+   namespace "urn:example:clixon";
+   prefix ex;
+   container x {
+      list y {
+         key "a";
+         leaf a {
+            type string;
+         }
+         leaf b {
+            type int8;
+         }
+      }
+   }
+}
+EOF
+
+# Edit y with key $1 and value $2 in background, output in $dir/edit$1.out
+function edit_y(){
+    echo "$DEFAULTHELLO<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><x xmlns=\"urn:example:clixon\"><y><a>$1</a><b>$2</b></y></x></config></edit-config></rpc>]]>]]>" | $clixon_netconf -qf $cfg > $dir/edit$1.out &
+}
+
+new "test params: -f $cfg -l f$flog -- -t"
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+	err
+    fi
+    new "start backend -s init -f $cfg -l f$flog -- -t"
+    start_backend -s init -f $cfg -l f$flog -- -t # -t means transaction logging
+fi
+
+new "wait backend"
+wait_backend
+
+n0=$(grep -c "main_commit add:" $flog)
+
+new "concurrent valid edits"
+edit_y 1 1
+edit_y 2 2
+edit_y 3 3
+wait
+
+for i in 1 2 3; do
+    new "edit $i reply"
+    expectpart "$(cat $dir/edit$i.out)" 0 "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+done
+
+new "concurrent valid edits committed in one transaction"
+n1=$(grep -c "main_commit add:" $flog)
+if [ $((n1 - n0)) -ne 1 ]; then
+    err "1 transaction" "$((n1 - n0)) transactions"
+fi
+
+new "get-config running"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><x xmlns=\"urn:example:clixon\"><y><a>1</a><b>1</b></y><y><a>2</a><b>2</b></y><y><a>3</a><b>3</b></y></x></data></rpc-reply>]]>]]>$"
+
+new "concurrent edits, one invalid"
+edit_y 4 4
+edit_y 5 300
+edit_y 6 6
+wait
+
+new "edit 4 reply"
+expectpart "$(cat $dir/edit4.out)" 0 "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "edit 5 (invalid) reply"
+expectpart "$(cat $dir/edit5.out)" 0 "^<rpc-reply $DEFAULTNS><rpc-error>" --not-- "<ok/>"
+
+new "edit 6 reply"
+expectpart "$(cat $dir/edit6.out)" 0 "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "get-config running without invalid edit"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><get-config><source><running/></source><filter type=\"xpath\" select=\"/ex:x/ex:y[ex:a>3]\" xmlns:ex=\"urn:example:clixon\"/></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><x xmlns=\"urn:example:clixon\"><y><a>4</a><b>4</b></y><y><a>6</a><b>6</b></y></x></data></rpc-reply>]]>]]>$"
+
+new "get-config candidate equals running"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><get-config><source><candidate/></source><filter type=\"xpath\" select=\"/ex:x/ex:y[ex:a=5]\" xmlns:ex=\"urn:example:clixon\"/></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data/></rpc-reply>]]>]]>$"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+	err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -211,6 +211,28 @@ expectpart "$($clixon_cli -1 -U wilma -l o -f $cfg rpc ipv4)" 255 "access-denied
 new "cli rpc as guest"
 expectpart "$($clixon_cli -1 -U guest -l o -f $cfg rpc ipv4)" 255 "access-denied access denied"
 
+# Modify the external NACM file: guest-acl no longer applies to guests
+# No sleep: a change within the same second is detected by size and inode
+cp $nacmfile $dir/nacmfile.orig
+sed -i 's/<group>guest<\/group>/<group>none<\/group>/' $nacmfile
+
+new "cli rpc as guest after NACM file is modified"
+expectpart "$($clixon_cli -1 -U guest -l o -f $cfg rpc ipv4)" 255 "access-denied default deny"
+
+# A file that cannot be loaded is logged, and the loaded rules are kept
+echo "<nacm xmlns=\"urn:ietf:params:xml:ns:yang:ietf-netconf-acm\">" > $nacmfile
+
+new "cli rpc as guest after NACM file is broken: rules kept"
+expectpart "$($clixon_cli -1 -U guest -l o -f $cfg rpc ipv4)" 255 "access-denied default deny"
+
+new "cli rpc as admin after NACM file is broken"
+expectpart "$($clixon_cli -1 -U andy -l o -f $cfg rpc ipv4)" 0 '<x xmlns="urn:example:clixon">ipv4</x><y xmlns="urn:example:clixon">42</y>'
+
+cp $dir/nacmfile.orig $nacmfile
+
+new "cli rpc as guest after NACM file is restored"
+expectpart "$($clixon_cli -1 -U guest -l o -f $cfg rpc ipv4)" 255 "access-denied access denied"
+
 if [ $RC -ne 0 ]; then
     new "Kill restconf daemon"
     stop_restconf
@@ -0,0 +1,172 @@
+#!/usr/bin/env bash
+# Netconf RFC 6242 chunked framing, negotiated by base:1.1 in hello messages
+# Check single and multi-chunk messages, several messages in one input, large messages
+# spanning several reads, invalid framing, and fallback to end-of-message framing
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf.xml
+fyang=$dir/example.yang
+
+# Number of list entries in large message
+nr=1000
+
+cat <<EOF > $fyang
+module example{
+   yang-version 1.1;
+   namespace "urn:example:clixon";
+   prefix ex;
+   container x {
+      list y {
+         key "a";
+         leaf a {
+            type uint32;
+         }
+         leaf b {
+            type string;
+         }
+      }
+   }
+}
+EOF
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_BACKEND_REGEXP>example_backend.so$</CLICON_BACKEND_REGEXP>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+</clixon-config>
+EOF
+
+# Hello with base:1.1 which enables chunked framing
+HELLO11="<hello $DEFAULTNS><capabilities><capability>urn:ietf:params:netconf:base:1.1</capability></capabilities></hello>]]>]]>"
+
+# Frame a message as chunks
+# 1: message
+# 2: chunk size (optional, default whole message as one chunk)
+# Note the trailing LF is removed by command substitution, frame several messages in one
+function chunked()
+{
+    local msg=$1
+    local size=${2:-${#msg}}
+    local i
+    local chunk
+    for (( i=0; i<${#msg}; i+=$size )); do
+	chunk=${msg:$i:$size}
+	printf "\n#%d\n%s" ${#chunk} "$chunk"
+    done
+    printf "\n##\n"
+}
+
+# Send input to netconf and compare output exactly
+# 1: netconf options
+# 2: input (a LF is appended)
+# 3: expected output
+function expectnc()
+{
+    opts=$1
+    input=$2
+    expect=$3
+    ret=$(printf "%s\n" "$input" | $clixon_netconf -q -f $cfg $opts 2> /dev/null)
+    if [ "$ret" != "$expect" ]; then
+	err "$expect" "$ret"
+    fi
+}
+
+new "test params: -f $cfg"
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+	err
+    fi
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+fi
+
+new "wait backend"
+wait_backend
+
+new "netconf server hello advertises base:1.1"
+expecteof "$clixon_netconf -f $cfg" 0 "$DEFAULTHELLO" "<capability>urn:ietf:params:netconf:base:1.1</capability><capability>urn:ietf:params:netconf:base:1.0</capability>"
+
+new "netconf server hello base:1.0 only"
+expecteof "$clixon_netconf -f $cfg -o CLICON_NETCONF_BASE_CAPABILITY=0" 0 "$DEFAULTHELLO" "^<hello $DEFAULTNS><capabilities><capability>urn:ietf:params:netconf:base:1.0</capability><capability>"
+
+REQ="<rpc $DEFAULTNS><get-config><source><candidate/></source></get-config></rpc>"
+REPLY="<rpc-reply $DEFAULTNS><data/></rpc-reply>"
+
+new "netconf chunked rpc one chunk"
+expectnc "" "$HELLO11$(chunked "$REQ")" "$(chunked "$REPLY")"
+
+new "netconf chunked rpc several chunks"
+expectnc "" "$HELLO11$(chunked "$REQ" 7)" "$(chunked "$REPLY")"
+
+new "netconf chunked two rpcs"
+expectnc "" "$HELLO11$(chunked "$REQ" 20; chunked "$REQ")" "$(chunked "$REPLY"; chunked "$REPLY")"
+
+new "netconf chunked base:1.1 client, base:1.0 server uses end-of-message"
+expectnc "-o CLICON_NETCONF_BASE_CAPABILITY=0" "$HELLO11$REQ]]>]]>" "$REPLY]]>]]>"
+
+new "netconf base:1.0 client uses end-of-message"
+expectnc "" "$DEFAULTHELLO$REQ]]>]]>" "$REPLY]]>]]>"
+
+new "netconf chunked invalid chunk-size terminates session"
+expectnc "" "$HELLO11
+#0x10
+$REQ
+##
+$(chunked "$REQ")" ""
+
+new "netconf chunked end-of-message marker is invalid"
+expectnc "" "$HELLO11$REQ]]>]]>" ""
+
+# Large message over several reads in both framings
+XML="<x xmlns=\"urn:example:clixon\">"
+for (( i=0; i<$nr; i++ )); do
+    XML="$XML<y><a>$i</a><b>$i</b></y>"
+done
+XML="$XML</x>"
+EDIT="<rpc $DEFAULTNS><edit-config><target><candidate/></target><config>$XML</config></edit-config></rpc>"
+OK="<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+GETREQ="<rpc $DEFAULTNS><get-config><source><candidate/></source><filter type=\"xpath\" select=\"/ex:x/ex:y[ex:a='$((nr-1))']\" xmlns:ex=\"urn:example:clixon\"/></get-config></rpc>"
+GETREPLY="<rpc-reply $DEFAULTNS><data><x xmlns=\"urn:example:clixon\"><y><a>$((nr-1))</a><b>$((nr-1))</b></y></x></data></rpc-reply>"
+
+new "netconf chunked large edit-config in one chunk"
+expectnc "" "$HELLO11$(chunked "$EDIT"; chunked "$GETREQ")" "$(chunked "$OK"; chunked "$GETREPLY")"
+
+new "netconf discard-changes"
+expectnc "" "$DEFAULTHELLO<rpc $DEFAULTNS><discard-changes/></rpc>]]>]]>" "$OK]]>]]>"
+
+new "netconf chunked large edit-config in many chunks"
+expectnc "" "$HELLO11$(chunked "$EDIT" 1000; chunked "$GETREQ")" "$(chunked "$OK"; chunked "$GETREPLY")"
+
+new "netconf discard-changes"
+expectnc "" "$DEFAULTHELLO<rpc $DEFAULTNS><discard-changes/></rpc>]]>]]>" "$OK]]>]]>"
+
+new "netconf end-of-message large edit-config"
+expectnc "" "$DEFAULTHELLO$EDIT]]>]]>$GETREQ]]>]]>" "$OK]]>]]>$GETREPLY]]>]]>"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+	err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -9,6 +9,7 @@
 # - stream retention time
 # - native vs nchan implementation
 # Focussing on 1-3
+# Also a subscriber that does not read, with CLICON_STREAM_QUEUE_MAX and _POLICY
 # @see test_restconf_notifications.sh
 
 # Magic line must be first in script (see README.md)
@@ -44,6 +45,7 @@ cat <<EOF > $cfg
   <CLICON_STREAM_DISCOVERY_RFC5277>true</CLICON_STREAM_DISCOVERY_RFC5277>
   <CLICON_STREAM_PATH>streams</CLICON_STREAM_PATH>
   <CLICON_STREAM_RETENTION>60</CLICON_STREAM_RETENTION>
+  <CLICON_STREAM_SUBSCRIPTION_STATE>true</CLICON_STREAM_SUBSCRIPTION_STATE>
 </clixon-config>
 EOF
 
@@ -81,6 +83,10 @@ cat <<EOF > $fyang
            description "Event severity description.";
          }
        }
+       leaf val {
+         description "Written by commits to trigger datastore notifications";
+         type int32;
+       }
        container state {
          config false;
          description "state data for the example application (must be here for example get operation)";
@@ -125,12 +131,82 @@ expectwait "$clixon_netconf -D $DBG -qf $cfg" "$DEFAULTHELLO<rpc $DEFAULTNS><cre
 new "netconf EXAMPLE subscription with filter classifier"
 expectwait "$clixon_netconf -D $DBG -qf $cfg" "$DEFAULTHELLO<rpc $DEFAULTNS><create-subscription xmlns=\"urn:ietf:params:xml:ns:netmod:notification\"><stream>EXAMPLE</stream><filter type=\"xpath\" select=\"event[event-class='fault']\"/></create-subscription></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><notification xmlns=\"urn:ietf:params:xml:ns:netconf:notification:1.0\"><eventTime>20" $NCWAIT
 
+new "netconf EXAMPLE subscription with absolute filter"
+expectwait "$clixon_netconf -D $DBG -qf $cfg" "$DEFAULTHELLO<rpc $DEFAULTNS><create-subscription xmlns=\"urn:ietf:params:xml:ns:netmod:notification\"><stream>EXAMPLE</stream><filter type=\"xpath\" select=\"/event/severity\"/></create-subscription></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><notification xmlns=\"urn:ietf:params:xml:ns:netconf:notification:1.0\"><eventTime>20" $NCWAIT
+
+new "netconf EXAMPLE subscription with union filter"
+expectwait "$clixon_netconf -D $DBG -qf $cfg" "$DEFAULTHELLO<rpc $DEFAULTNS><create-subscription xmlns=\"urn:ietf:params:xml:ns:netmod:notification\"><stream>EXAMPLE</stream><filter type=\"xpath\" select=\"nonexist | event\"/></create-subscription></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><notification xmlns=\"urn:ietf:params:xml:ns:netconf:notification:1.0\"><eventTime>20" $NCWAIT
+
 new "netconf NONEXIST subscription"
 expectwait "$clixon_netconf -D $DBG -qf $cfg" "$DEFAULTHELLO<rpc $DEFAULTNS><create-subscription xmlns=\"urn:ietf:params:xml:ns:netmod:notification\"><stream>NONEXIST</stream></create-subscription></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><rpc-error><error-type>application</error-type><error-tag>invalid-value</error-tag><error-severity>error</error-severity><error-message>No such stream</error-message></rpc-error></rpc-reply>]]>]]>$" $NCWAIT
 
 new "netconf EXAMPLE subscription with wrong date"
 expectwait "$clixon_netconf -D $DBG -qf $cfg" "$DEFAULTHELLO<rpc $DEFAULTNS><create-subscription xmlns=\"urn:ietf:params:xml:ns:netmod:notification\"><stream>EXAMPLE</stream><startTime>kallekaka</startTime></create-subscription></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><rpc-error><error-type>application</error-type><error-tag>bad-element</error-tag><error-info><bad-element>startTime</bad-element></error-info><error-severity>error</error-severity><error-message>regexp match fail:" 0
 
+new "netconf EXAMPLE subscription kept open"
+(printf "%s" "$DEFAULTHELLO<rpc $DEFAULTNS><create-subscription xmlns=\"urn:ietf:params:xml:ns:netmod:notification\"><stream>EXAMPLE</stream></create-subscription></rpc>]]>]]>"; sleep 3) | $clixon_netconf -qf $cfg > /dev/null &
+subpid=$!
+sleep 1
+
+new "netconf get subscription state"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"cl:subscriptions\" xmlns:cl=\"http://clicon.org/lib\"/></get></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><subscriptions xmlns=\"http://clicon.org/lib\"><subscription><client>[0-9]*</client><stream>EXAMPLE</stream><queue-depth>0</queue-depth><dropped>0</dropped></subscription></subscriptions></data></rpc-reply>]]>]]>$"
+wait $subpid
+
+# 2. Subscriber that does not read
+# The netconf process of the subscriber is stopped, so that the backend queues the
+# CLIXON-DATASTORE notifications sent to it, one per commit, when its socket is full.
+new "2. Subscriber that does not read"
+
+# Start backend with notification queue policy $1, and a stopped subscriber
+function slow_start(){
+    policy=$1
+    sed -i '/CLICON_STREAM_QUEUE_POLICY/d' $cfg
+    sed -i "s|</clixon-config>|  <CLICON_STREAM_QUEUE_POLICY>$policy</CLICON_STREAM_QUEUE_POLICY>\n</clixon-config>|" $cfg
+    if [ $BE -ne 0 ]; then
+	new "restart backend -s init -f $cfg with queue policy $policy"
+	stop_backend -f $cfg
+	start_backend -s init -f $cfg
+    fi
+    new "waiting"
+    wait_backend
+
+    new "netconf CLIXON-DATASTORE subscription, stopped"
+    (printf "%s" "$DEFAULTHELLO<rpc $DEFAULTNS><create-subscription xmlns=\"urn:ietf:params:xml:ns:netmod:notification\"><stream>CLIXON-DATASTORE</stream></create-subscription></rpc>]]>]]>"; sleep 30) | $clixon_netconf -qf $cfg > /dev/null &
+    slowpid=$!
+    sleep 1
+    kill -STOP $slowpid
+
+    new "commits while subscriber is stopped"
+    edits=""
+    for i in $(seq 1 1000); do
+	edits="$edits<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><val xmlns=\"urn:example:clixon\">$i</val></config></edit-config></rpc>]]>]]>"
+    done
+    echo "$DEFAULTHELLO$edits" | $clixon_netconf -qf $cfg > /dev/null
+}
+
+# Resume and kill the stopped subscriber
+function slow_stop(){
+    kill -CONT $slowpid 2> /dev/null
+    kill $slowpid 2> /dev/null
+    wait $slowpid 2> /dev/null
+}
+
+sed -i "s|</clixon-config>|  <CLICON_STREAM_DATASTORE>true</CLICON_STREAM_DATASTORE>\n  <CLICON_STREAM_QUEUE_MAX>2</CLICON_STREAM_QUEUE_MAX>\n  <CLICON_AUTOCOMMIT>1</CLICON_AUTOCOMMIT>\n</clixon-config>|" $cfg
+
+slow_start drop-oldest
+
+new "drop-oldest: queue is full and notifications are dropped"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"cl:subscriptions\" xmlns:cl=\"http://clicon.org/lib\"/></get></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><subscriptions xmlns=\"http://clicon.org/lib\"><subscription><client>[0-9]*</client><stream>CLIXON-DATASTORE</stream><queue-depth>2</queue-depth><dropped>[1-9][0-9]*</dropped></subscription></subscriptions></data></rpc-reply>]]>]]>$"
+
+slow_stop
+
+slow_start disconnect
+
+new "disconnect: subscriber is disconnected"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"cl:subscriptions\" xmlns:cl=\"http://clicon.org/lib\"/></get></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data/></rpc-reply>]]>]]>$"
+
+slow_stop
+
 #new "netconf EXAMPLE subscription with replay"
 #NOW=$(date +"%Y-%m-%dT%H:%M:%S")
 #sleep 10
@@ -0,0 +1,134 @@
+#!/usr/bin/env bash
+# Netconf server mode: one clixon_netconf process serves many sessions on a unix socket,
+# each session connects with clixon_netconf -C, as it would as ssh subsystem.
+# Check that sessions are separate: own backend session, locks, framing, and close
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf.xml
+fyang=$dir/example.yang
+sock=$dir/netconf.sock
+
+cat <<EOF > $fyang
+module example{
+   yang-version 1.1;
+   namespace "urn:example:clixon";
+   prefix ex;
+   container x {
+      leaf y {
+         type string;
+      }
+   }
+}
+EOF
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_BACKEND_REGEXP>example_backend.so$</CLICON_BACKEND_REGEXP>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+  <CLICON_NETCONF_SOCK>$sock</CLICON_NETCONF_SOCK>
+</clixon-config>
+EOF
+
+new "test params: -f $cfg"
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+	err
+    fi
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+fi
+
+new "wait backend"
+wait_backend
+
+new "start netconf server"
+$clixon_netconf -S -f $cfg &
+pid=$!
+
+new "wait netconf server"
+for (( i=0; i<20; i++ )); do
+    if [ -S $sock ]; then
+	break
+    fi
+    sleep 0.1
+done
+if [ ! -S $sock ]; then
+    err "$sock" "no netconf server socket"
+fi
+
+new "netconf session hello and get-config"
+expecteof "$clixon_netconf -C $sock" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><get-config><source><candidate/></source></get-config></rpc>]]>]]>" "^<hello $DEFAULTNS><capabilities><capability>urn:ietf:params:netconf:base:1.1</capability>.*</capabilities><session-id>[0-9]*</session-id></hello>]]>]]><rpc-reply $DEFAULTNS><data/></rpc-reply>]]>]]>$"
+
+new "netconf session edit-config"
+expecteof "$clixon_netconf -C $sock" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><x xmlns=\"urn:example:clixon\"><y>a</y></x></config></edit-config></rpc>]]>]]>" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "netconf other session sees candidate"
+expecteof "$clixon_netconf -C $sock" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><get-config><source><candidate/></source></get-config></rpc>]]>]]>" "<rpc-reply $DEFAULTNS><data><x xmlns=\"urn:example:clixon\"><y>a</y></x></data></rpc-reply>]]>]]>$"
+
+new "netconf chunked session"
+REQ="<rpc $DEFAULTNS><discard-changes/></rpc>"
+expecteof "$clixon_netconf -C $sock" 0 "<hello $DEFAULTNS><capabilities><capability>urn:ietf:params:netconf:base:1.1</capability></capabilities></hello>]]>]]>
+#${#REQ}
+$REQ
+##" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>$"
+
+new "netconf session lock candidate and keep session open"
+(printf "%s" "$DEFAULTHELLO<rpc $DEFAULTNS><lock><target><candidate/></target></lock></rpc>]]>]]>"; sleep 2) | $clixon_netconf -C $sock > $dir/lock.out &
+lockpid=$!
+sleep 1
+
+new "netconf other session lock denied"
+expecteof "$clixon_netconf -C $sock" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><lock><target><candidate/></target></lock></rpc>]]>]]>" "<rpc-reply $DEFAULTNS><rpc-error><error-type>protocol</error-type><error-tag>lock-denied</error-tag><error-info><session-id>[0-9]*</session-id></error-info>"
+
+new "wait for locking session to end"
+wait $lockpid
+expectpart "$(cat $dir/lock.out)" 0 "<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>"
+
+new "netconf lock after locking session ended"
+expecteof "$clixon_netconf -C $sock" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><lock><target><candidate/></target></lock></rpc>]]>]]>" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "netconf many sessions"
+for (( i=0; i<20; i++ )); do
+    expecteof "$clixon_netconf -C $sock" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><close-session/></rpc>]]>]]>" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+done
+
+new "netconf session with framing error does not stop server"
+expecteof "$clixon_netconf -C $sock" 0 "<hello $DEFAULTNS><capabilities><capability>urn:ietf:params:netconf:base:1.1</capability></capabilities></hello>]]>]]><rpc/>]]>]]>" "^<hello"
+
+new "netconf server still running"
+expecteof "$clixon_netconf -C $sock" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>]]>]]>" "<rpc-reply $DEFAULTNS><data/></rpc-reply>]]>]]>$"
+
+new "stop netconf server"
+kill $pid
+wait $pid
+if [ -S $sock ]; then
+    err "no socket" "$sock"
+fi
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+	err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
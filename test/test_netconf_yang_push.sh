@@ -0,0 +1,175 @@
+#!/usr/bin/env bash
+# RFC 8641 YANG-Push datastore subscriptions of running over netconf
+# Periodic subscription with xpath filter, on-change subscription with sync-on-start,
+# edits of a commit in push-change-update, and delete-subscription
+# NACM read access of the subscriber is applied to periodic and on-change updates
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+# Common NACM scripts
+. ./nacm.sh
+
+cfg=$dir/conf.xml
+fyang=$dir/example.yang
+nacmfile=$dir/nacmfile
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_DIR>$IETFRFC</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_BACKEND_REGEXP>example_backend.so$</CLICON_BACKEND_REGEXP>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+  <CLICON_YANG_PUSH>true</CLICON_YANG_PUSH>
+  <CLICON_NACM_MODE>external</CLICON_NACM_MODE>
+  <CLICON_NACM_FILE>$nacmfile</CLICON_NACM_FILE>
+  <CLICON_NACM_CREDENTIALS>none</CLICON_NACM_CREDENTIALS>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module example{
+   yang-version 1.1;
+   namespace "urn:example:clixon";
+   prefix ex;
+   container x {
+      list y {
+         key "a";
+         leaf a {
+            type string;
+         }
+         leaf b {
+            type string;
+         }
+      }
+   }
+   container z {
+      leaf c {
+         type string;
+      }
+   }
+}
+EOF
+
+# The limited group may not read z, nor b of y
+cat <<EOF > $nacmfile
+   <nacm xmlns="urn:ietf:params:xml:ns:yang:ietf-netconf-acm">
+     <enable-nacm>true</enable-nacm>
+     <read-default>permit</read-default>
+     <write-default>deny</write-default>
+     <exec-default>permit</exec-default>
+     $NGROUPS
+     <rule-list>
+       <name>limited-acl</name>
+       <group>limited</group>
+       <rule>
+         <name>deny-z</name>
+         <module-name>*</module-name>
+         <path xmlns:ex="urn:example:clixon">/ex:z</path>
+         <access-operations>read</access-operations>
+         <action>deny</action>
+       </rule>
+       <rule>
+         <name>deny-b</name>
+         <module-name>*</module-name>
+         <path xmlns:ex="urn:example:clixon">/ex:x/ex:y/ex:b</path>
+         <access-operations>read</access-operations>
+         <action>deny</action>
+       </rule>
+     </rule-list>
+     $NADMIN
+   </nacm>
+EOF
+
+SN="xmlns=\"urn:ietf:params:xml:ns:yang:ietf-subscribed-notifications\""
+YP="xmlns=\"urn:ietf:params:xml:ns:yang:ietf-yang-push\""
+DS="<datastore $YP xmlns:ds=\"urn:ietf:params:xml:ns:yang:ietf-datastores\">ds:running</datastore>"
+FILTER="<datastore-xpath-filter $YP xmlns:ex=\"urn:example:clixon\">/ex:x</datastore-xpath-filter>"
+
+new "test params: -f $cfg"
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+	err
+    fi
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+fi
+
+new "wait backend"
+wait_backend
+
+new "netconf edit x and z"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><x xmlns=\"urn:example:clixon\"><y><a>1</a><b>one</b></y></x><z xmlns=\"urn:example:clixon\"><c>zz</c></z></config></edit-config></rpc>]]>]]><rpc $DEFAULTNS><commit/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "netconf establish-subscription of candidate: not supported"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><establish-subscription $SN><datastore $YP xmlns:ds=\"urn:ietf:params:xml:ns:yang:ietf-datastores\">ds:candidate</datastore><periodic $YP><period>100</period></periodic></establish-subscription></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><rpc-error><error-type>application</error-type><error-tag>operation-not-supported</error-tag>"
+
+new "netconf periodic subscription"
+(printf "%s" "$DEFAULTHELLO<rpc $DEFAULTNS><establish-subscription $SN>$DS$FILTER<periodic $YP><period>50</period></periodic></establish-subscription></rpc>]]>]]>"; sleep 2) | $clixon_netconf -qf $cfg > $dir/periodic.out
+expectpart "$(cat $dir/periodic.out)" 0 "^<rpc-reply $DEFAULTNS><id $SN>[0-9]*</id></rpc-reply>]]>]]>" "<push-update $YP><id>[0-9]*</id><datastore-contents><x xmlns=\"urn:example:clixon\"><y><a>1</a><b>one</b></y></x></datastore-contents></push-update></notification>]]>]]><notification" --not-- "<z"
+
+new "netconf on-change subscription kept open"
+(printf "%s" "$DEFAULTHELLO<rpc $DEFAULTNS><establish-subscription $SN>$DS$FILTER<on-change $YP/></establish-subscription></rpc>]]>]]>"; sleep 3) | $clixon_netconf -qf $cfg > $dir/onchange.out &
+subpid=$!
+sleep 1
+
+new "netconf change x and z"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><x xmlns=\"urn:example:clixon\"><y><a>1</a><b>ett</b></y><y><a>2</a><b>two</b></y></x><z xmlns=\"urn:example:clixon\"><c>yy</c></z></config></edit-config></rpc>]]>]]><rpc $DEFAULTNS><commit/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "netconf delete y"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><x xmlns=\"urn:example:clixon\"><y nc:operation=\"delete\" xmlns:nc=\"urn:ietf:params:xml:ns:netconf:base:1.0\"><a>1</a></y></x></config></edit-config></rpc>]]>]]><rpc $DEFAULTNS><commit/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+wait $subpid
+
+new "check on-change sync-on-start"
+expectpart "$(cat $dir/onchange.out)" 0 "<push-update $YP><id>[0-9]*</id><datastore-contents><x xmlns=\"urn:example:clixon\"><y><a>1</a><b>one</b></y></x></datastore-contents></push-update>"
+
+new "check on-change create and replace"
+expectpart "$(cat $dir/onchange.out)" 0 "<push-change-update $YP><id>[0-9]*</id><datastore-changes><yang-patch><patch-id>0</patch-id>" "<edit><edit-id>edit[0-9]</edit-id><operation>create</operation><target>/example:x/y=2</target><value><y xmlns=\"urn:example:clixon\"><a>2</a><b>two</b></y></value></edit>" "<edit><edit-id>edit[0-9]</edit-id><operation>replace</operation><target>/example:x/y=1/b</target><value><b xmlns=\"urn:example:clixon\">ett</b></value></edit>" --not-- "/example:z"
+
+new "check on-change delete"
+expectpart "$(cat $dir/onchange.out)" 0 "<yang-patch><patch-id>1</patch-id><edit><edit-id>edit1</edit-id><operation>delete</operation><target>/example:x/y=1</target></edit></yang-patch>"
+
+new "netconf periodic subscription as limited user"
+(printf "%s" "$DEFAULTHELLO<rpc $DEFAULTNS><establish-subscription $SN>$DS<periodic $YP><period>50</period></periodic></establish-subscription></rpc>]]>]]>"; sleep 2) | $clixon_netconf -U wilma -qf $cfg > $dir/periodic.out
+expectpart "$(cat $dir/periodic.out)" 0 "^<rpc-reply $DEFAULTNS><id $SN>[0-9]*</id></rpc-reply>]]>]]>" "<push-update $YP><id>[0-9]*</id><datastore-contents><x xmlns=\"urn:example:clixon\"><y><a>2</a></y></x></datastore-contents></push-update>" --not-- "<z" "<b>"
+
+new "netconf on-change subscription as limited user kept open"
+(printf "%s" "$DEFAULTHELLO<rpc $DEFAULTNS><establish-subscription $SN>$DS<on-change $YP><sync-on-start>false</sync-on-start></on-change></establish-subscription></rpc>]]>]]>"; sleep 3) | $clixon_netconf -U wilma -qf $cfg > $dir/onchange.out &
+subpid=$!
+sleep 1
+
+new "netconf change b and z, create y"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><x xmlns=\"urn:example:clixon\"><y><a>2</a><b>zwei</b></y><y><a>3</a><b>drei</b></y></x><z xmlns=\"urn:example:clixon\"><c>xx</c></z></config></edit-config></rpc>]]>]]><rpc $DEFAULTNS><commit/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+wait $subpid
+
+new "check on-change of limited user: only readable edits and values"
+expectpart "$(cat $dir/onchange.out)" 0 "<yang-patch><patch-id>0</patch-id><edit><edit-id>edit1</edit-id><operation>create</operation><target>/example:x/y=3</target><value><y xmlns=\"urn:example:clixon\"><a>3</a></y></value></edit></yang-patch>" --not-- "<b" "/example:z" "edit2"
+
+new "netconf delete-subscription"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><establish-subscription $SN>$DS<on-change $YP><sync-on-start>false</sync-on-start></on-change></establish-subscription></rpc>]]>]]><rpc $DEFAULTNS><delete-subscription $SN><id>4711</id></delete-subscription></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><id $SN>[0-9]*</id></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><rpc-error><error-type>application</error-type><error-tag>invalid-value</error-tag>"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+	err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
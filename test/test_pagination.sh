@@ -0,0 +1,142 @@
+#!/usr/bin/env bash
+# List pagination using the clixon extension attributes offset, limit and direction
+# of netconf get and get-config, and the restconf query parameters with the same names
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf.xml
+fyang=$dir/example.yang
+
+# Number of list entries
+nr=10
+
+cat <<EOF > $fyang
+module example{
+   yang-version 1.1;
+   namespace "urn:example:clixon";
+   prefix ex;
+   container x {
+      list y {
+         key "a";
+         leaf a {
+            type uint32;
+         }
+         leaf b {
+            type string;
+         }
+      }
+   }
+}
+EOF
+
+RESTCONFIG=$(restconf_config none false)
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_FEATURE>clixon-restconf:allow-auth-none</CLICON_FEATURE> <!-- Use auth-type=none -->
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_BACKEND_REGEXP>example_backend.so$</CLICON_BACKEND_REGEXP>
+  <CLICON_RESTCONF_DIR>/usr/local/lib/$APPNAME/restconf</CLICON_RESTCONF_DIR>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+  $RESTCONFIG
+</clixon-config>
+EOF
+
+# Create list entries 0..nr-1
+XML="<x xmlns=\"urn:example:clixon\">"
+for (( i=0; i<$nr; i++ )); do
+    XML="$XML<y><a>$i</a><b>$i</b></y>"
+done
+XML="$XML</x>"
+
+new "test params: -f $cfg"
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+	err
+    fi
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+fi
+
+new "wait backend"
+wait_backend
+
+if [ $RC -ne 0 ]; then
+    new "kill old restconf daemon"
+    stop_restconf_pre
+
+    new "start restconf daemon"
+    start_restconf -f $cfg
+fi
+
+new "wait restconf"
+wait_restconf
+
+new "netconf add $nr entries"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><edit-config><target><candidate/></target><config>$XML</config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "netconf commit"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><commit/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "netconf get-config offset=2 limit=3"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><get-config offset=\"2\" limit=\"3\"><source><running/></source><filter type=\"xpath\" select=\"/ex:x/ex:y\" xmlns:ex=\"urn:example:clixon\"/></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><x xmlns=\"urn:example:clixon\"><y><a>2</a><b>2</b></y><y><a>3</a><b>3</b></y><y><a>4</a><b>4</b></y></x></data></rpc-reply>]]>]]>$"
+
+new "netconf get config backwards limit=2"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><get content=\"config\" limit=\"2\" direction=\"backwards\"><filter type=\"xpath\" select=\"/ex:x/ex:y\" xmlns:ex=\"urn:example:clixon\"/></get></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><x xmlns=\"urn:example:clixon\"><y><a>8</a><b>8</b></y><y><a>9</a><b>9</b></y></x></data></rpc-reply>]]>]]>$"
+
+new "netconf get all offset=8"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><get offset=\"8\"><filter type=\"xpath\" select=\"/ex:x/ex:y\" xmlns:ex=\"urn:example:clixon\"/></get></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><x xmlns=\"urn:example:clixon\"><y><a>8</a><b>8</b></y><y><a>9</a><b>9</b></y></x></data></rpc-reply>]]>]]>$"
+
+new "netconf get-config offset=8 limit=unbounded"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><get-config offset=\"8\" limit=\"unbounded\"><source><running/></source><filter type=\"xpath\" select=\"/ex:x/ex:y\" xmlns:ex=\"urn:example:clixon\"/></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><x xmlns=\"urn:example:clixon\"><y><a>8</a><b>8</b></y><y><a>9</a><b>9</b></y></x></data></rpc-reply>]]>]]>$"
+
+new "netconf get offset beyond end"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><get-config offset=\"$nr\"><source><running/></source><filter type=\"xpath\" select=\"/ex:x/ex:y\" xmlns:ex=\"urn:example:clixon\"/></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data/></rpc-reply>]]>]]>$"
+
+new "netconf get invalid limit"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><get-config limit=\"0\"><source><running/></source></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><rpc-error><error-type>application</error-type><error-tag>bad-attribute</error-tag><error-info><bad-attribute>limit</bad-attribute></error-info>"
+
+new "restconf get offset=1 limit=2"
+expectpart "$(curl $CURLOPTS -X GET $RCPROTO://localhost/restconf/data/example:x/y?offset=1\&limit=2)" 0 "HTTP/$HVER 200" '{"example:y":\[{"a":1,"b":"1"},{"a":2,"b":"2"}\]}'
+
+new "restconf get backwards offset=1 limit=2"
+expectpart "$(curl $CURLOPTS -X GET $RCPROTO://localhost/restconf/data/example:x/y?offset=1\&limit=2\&direction=backwards)" 0 "HTTP/$HVER 200" '{"example:y":\[{"a":7,"b":"7"},{"a":8,"b":"8"}\]}'
+
+new "restconf get offset=8 limit=unbounded"
+expectpart "$(curl $CURLOPTS -X GET $RCPROTO://localhost/restconf/data/example:x/y?offset=8\&limit=unbounded)" 0 "HTTP/$HVER 200" '{"example:y":\[{"a":8,"b":"8"},{"a":9,"b":"9"}\]}'
+
+new "restconf get invalid direction"
+expectpart "$(curl $CURLOPTS -X GET $RCPROTO://localhost/restconf/data/example:x/y?direction=up)" 0 "HTTP/$HVER 400" '"error-tag":"bad-attribute","error-info":{"bad-attribute":"direction"}'
+
+if [ $RC -ne 0 ]; then
+    new "Kill restconf daemon"
+    stop_restconf
+fi
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+	err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+# Set by restconf_config
+unset RESTCONFIG
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -1,9 +1,9 @@
 #!/usr/bin/env bash
 # Regexps appear in Yang string patterns, see RFC7950 Sec 9.4.5
 # in turn defined in http://www.w3.org/TR/2004/REC-xmlschema-2-20041028
-# Current implementation uses posix regex(3) which is not correct so
+# The posix mode uses posix regex(3) which is not correct so
 # a simple mapping is made.
-# Libxml2 has an XSD regex implementation
+# Libxml2 has an XSD regex implementation, and so has the built-in dfa mode
 # Test strings have been generated by:
 #   https://www.browserling.com/tools/text-from-regex
 # This is an unit test, not a clixon system test
@@ -22,11 +22,11 @@ cfg=$dir/pattern.xml
 fyang=$dir/pattern.yang
 
 
-regexlist="posix"
+regexlist="posix dfa"
 if [ "${WITH_LIBXML2}" = yes ] ; then
     regexlist="$regexlist libxml2"
 fi
-# Loop over supported regexps. Always run posix, run libxml2 if configured
+# Loop over supported regexps. Always run posix and dfa, run libxml2 if configured
 for regex in $regexlist; do
     new "pattern tests for regex:$regex"
     
@@ -752,7 +752,14 @@ testrun "p$pnr" false '248:197.7.89/8'
 
 let pnr=47 # '.*[\n].*
 testrun "p$pnr" true 'Ensure all nights are cold'
-testrun "p$pnr" false 'kallefoo'
+if [ $regex = dfa ]; then
+    # XSD semantics: [\n] is a newline, so only a string with a newline is invalid
+    testrun "p$pnr" true 'kallefoo'
+    testrun "p$pnr" false 'kalle
+foo'
+else
+    testrun "p$pnr" false 'kallefoo'
+fi
 testrun "p$pnr" false '01234567890123456789012345678901234567890123456789012345678901234567890123456789zzz'
 
 # CLI tests
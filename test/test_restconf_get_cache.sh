@@ -0,0 +1,127 @@
+#!/usr/bin/env bash
+# Restconf GET response cache and entity-tags
+# Check ETag and If-None-Match, and that cached config responses are invalidated
+# both by restconf writes and by changes made by other clients (netconf)
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+# Cache only in native mode
+if [ "${WITH_RESTCONF}" != "native" ]; then
+    if [ "$s" = $0 ]; then exit 0; else return 0; fi # skip
+fi
+
+APPNAME=example
+
+cfg=$dir/conf.xml
+fyang=$dir/example.yang
+
+cat <<EOF > $fyang
+module example{
+   yang-version 1.1;
+   namespace "urn:example:clixon";
+   prefix ex;
+   container x {
+      leaf y {
+         type string;
+      }
+   }
+}
+EOF
+
+# Default restconf config with cache added
+RESTCONFIG=$(restconf_config none false | sed "s#<pretty>false</pretty>#<pretty>false</pretty><get-cache-size>100</get-cache-size>#")
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_FEATURE>clixon-restconf:allow-auth-none</CLICON_FEATURE> <!-- Use auth-type=none -->
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_BACKEND_REGEXP>example_backend.so$</CLICON_BACKEND_REGEXP>
+  <CLICON_RESTCONF_DIR>/usr/local/lib/$APPNAME/restconf</CLICON_RESTCONF_DIR>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+  <CLICON_STREAM_DATASTORE>true</CLICON_STREAM_DATASTORE>
+  $RESTCONFIG
+</clixon-config>
+EOF
+
+new "test params: -f $cfg"
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+	err
+    fi
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+fi
+
+new "wait backend"
+wait_backend
+
+if [ $RC -ne 0 ]; then
+    new "kill old restconf daemon"
+    stop_restconf_pre
+
+    new "start restconf daemon"
+    start_restconf -f $cfg
+fi
+
+new "wait restconf"
+wait_restconf
+
+new "restconf put y=a"
+expectpart "$(curl $CURLOPTS -X PUT -H "Content-Type: application/yang-data+json" $RCPROTO://localhost/restconf/data/example:x -d '{"example:x":{"y":"a"}}')" 0 "HTTP/$HVER 201"
+
+new "restconf get config y=a"
+ret=$(curl $CURLOPTS -X GET $RCPROTO://localhost/restconf/data/example:x?content=config)
+expectpart "$ret" 0 "HTTP/$HVER 200" '{"example:x":{"y":"a"}}' "ETag: \""
+etag=$(echo "$ret" | grep -i "^etag:" | awk '{print $2}' | tr -d '\r')
+
+new "restconf get config again, cached"
+expectpart "$(curl $CURLOPTS -X GET $RCPROTO://localhost/restconf/data/example:x?content=config)" 0 "HTTP/$HVER 200" '{"example:x":{"y":"a"}}' "ETag: $etag"
+
+new "restconf get If-None-Match: 304"
+expectpart "$(curl $CURLOPTS -X GET -H "If-None-Match: $etag" $RCPROTO://localhost/restconf/data/example:x?content=config)" 0 "HTTP/$HVER 304" "ETag: $etag"
+
+new "restconf put y=b"
+expectpart "$(curl $CURLOPTS -X PUT -H "Content-Type: application/yang-data+json" $RCPROTO://localhost/restconf/data/example:x -d '{"example:x":{"y":"b"}}')" 0 "HTTP/$HVER 204"
+
+new "restconf get config y=b after restconf write"
+expectpart "$(curl $CURLOPTS -X GET -H "If-None-Match: $etag" $RCPROTO://localhost/restconf/data/example:x?content=config)" 0 "HTTP/$HVER 200" '{"example:x":{"y":"b"}}'
+
+new "netconf edit-config y=c"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><x xmlns=\"urn:example:clixon\"><y>c</y></x></config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "netconf commit"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><commit/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "restconf get config y=c after netconf commit"
+expectpart "$(curl $CURLOPTS -X GET $RCPROTO://localhost/restconf/data/example:x?content=config)" 0 "HTTP/$HVER 200" '{"example:x":{"y":"c"}}'
+
+if [ $RC -ne 0 ]; then
+    new "Kill restconf daemon"
+    stop_restconf
+fi
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+	err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+# Set by restconf_config
+unset RESTCONFIG
+
+rm -rf $dir
+
+new "endtest"
+endtest
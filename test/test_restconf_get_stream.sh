@@ -0,0 +1,152 @@
+#!/usr/bin/env bash
+# Restconf GET of a large reply which is encoded and sent in parts
+# Check that the streamed JSON and XML bodies are identical to the complete encoding,
+# and that http/1.1 replies use chunked transfer coding
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf.xml
+fyang=$dir/example.yang
+
+# Number of list entries, large enough for several parts
+nr=2000
+
+cat <<EOF > $fyang
+module example{
+   yang-version 1.1;
+   namespace "urn:example:clixon";
+   prefix ex;
+   container x {
+      list y {
+         key "a";
+         leaf a {
+            type uint32;
+         }
+         leaf b {
+            type string;
+         }
+      }
+   }
+}
+EOF
+
+RESTCONFIG=$(restconf_config none false)
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_FEATURE>clixon-restconf:allow-auth-none</CLICON_FEATURE> <!-- Use auth-type=none -->
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_BACKEND_REGEXP>example_backend.so$</CLICON_BACKEND_REGEXP>
+  <CLICON_RESTCONF_DIR>/usr/local/lib/$APPNAME/restconf</CLICON_RESTCONF_DIR>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+  $RESTCONFIG
+</clixon-config>
+EOF
+
+# Create list entries and the expected replies
+XML="<x xmlns=\"urn:example:clixon\">"
+XMLY=""
+JSONY=""
+for (( i=0; i<$nr; i++ )); do
+    XML="$XML<y><a>$i</a><b>$i</b></y>"
+    XMLY="$XMLY<y xmlns=\"urn:example:clixon\"><a>$i</a><b>$i</b></y>"
+    if [ -n "$JSONY" ]; then
+	JSONY="$JSONY,"
+    fi
+    JSONY="$JSONY{\"a\":$i,\"b\":\"$i\"}"
+done
+XML="$XML</x>"
+
+new "test params: -f $cfg"
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+	err
+    fi
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+fi
+
+new "wait backend"
+wait_backend
+
+if [ $RC -ne 0 ]; then
+    new "kill old restconf daemon"
+    stop_restconf_pre
+
+    new "start restconf daemon"
+    start_restconf -f $cfg
+fi
+
+new "wait restconf"
+wait_restconf
+
+new "netconf add $nr entries"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><edit-config><target><candidate/></target><config>$XML</config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "netconf commit"
+expecteof "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO<rpc $DEFAULTNS><commit/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "restconf get large json list"
+expect="{\"example:y\":[$JSONY]}"
+ret=$(curl -Ssk -X GET $RCPROTO://localhost/restconf/data/example:x/y | tr -d "\r")
+if [ "$ret" != "$expect" ]; then
+    err "$expect" "$ret"
+fi
+
+new "restconf get large json container"
+expect="{\"example:x\":{\"y\":[$JSONY]}}"
+ret=$(curl -Ssk -X GET $RCPROTO://localhost/restconf/data/example:x | tr -d "\r")
+if [ "$ret" != "$expect" ]; then
+    err "$expect" "$ret"
+fi
+
+new "restconf get large xml list"
+expect="$XMLY"
+ret=$(curl -Ssk -X GET -H "Accept: application/yang-data+xml" $RCPROTO://localhost/restconf/data/example:x/y | tr -d "\r")
+if [ "$ret" != "$expect" ]; then
+    err "$expect" "$ret"
+fi
+
+if [ "${WITH_RESTCONF}" = "native" -a "$HVER" = 1.1 ]; then
+    new "restconf get large reply is chunked"
+    expectpart "$(curl $CURLOPTS -X GET $RCPROTO://localhost/restconf/data/example:x)" 0 "HTTP/$HVER 200" "Transfer-Encoding: chunked" --not-- "Content-Length:"
+
+    new "restconf get small reply has content-length"
+    expectpart "$(curl $CURLOPTS -X GET $RCPROTO://localhost/restconf/data/example:x/y=1)" 0 "HTTP/$HVER 200" "Content-Length:" --not-- "Transfer-Encoding:"
+
+    new "restconf head large reply has content-length"
+    expectpart "$(curl $CURLOPTS -I $RCPROTO://localhost/restconf/data/example:x)" 0 "HTTP/$HVER 200" "Content-Length:" --not-- "Transfer-Encoding:"
+fi
+
+if [ $RC -ne 0 ]; then
+    new "Kill restconf daemon"
+    stop_restconf
+fi
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+	err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+# Set by restconf_config
+unset RESTCONFIG
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -182,15 +182,25 @@ expectpart "$(curl $CURLOPTS -X GET -H 'Accept: application/yang-data+json' $RCP
 new 'B.3.2.  "depth" Parameter depth=2'
 expectpart "$(curl $CURLOPTS -X GET -H 'Accept: application/yang-data+json' $RCPROTO://localhost/restconf/data/example-jukebox:jukebox?depth=2)" 0 "HTTP/$HVER 200" '{"example-jukebox:jukebox":{"library":{}}}'
 
-# Maybe this is not correct w [null,null]but I have no good examples
+# The artist list is the third level: it is included but not its albums
 new 'B.3.2.  "depth" Parameter depth=3'
-expectpart "$(curl $CURLOPTS -X GET -H 'Accept: application/yang-data+json' $RCPROTO://localhost/restconf/data/example-jukebox:jukebox?depth=3)" 0 "HTTP/$HVER 200" '{"example-jukebox:jukebox":{"artist":\[null,null\]}}}
-'
+expectpart "$(curl $CURLOPTS -X GET -H 'Accept: application/yang-data+json' $RCPROTO://localhost/restconf/data/example-jukebox:jukebox?depth=3)" 0 "HTTP/$HVER 200" '{"example-jukebox:jukebox":{"library":{"artist":\[' --not-- '"album"'
+
+new 'B.3.3.  "fields" Parameter'
+expectpart "$(curl $CURLOPTS -X GET -H 'Accept: application/yang-data+json' $RCPROTO://localhost/restconf/data/example-jukebox:jukebox?fields=library/artist\(name\))" 0 "HTTP/$HVER 200" '{"example-jukebox:jukebox":{"library":{"artist":\[{"name":"Foo Fighters"},{"name":"Nick Cave and the Bad Seeds"}\]}}}'
+
+new 'B.3.3.  "fields" Parameter union of paths'
+expectpart "$(curl $CURLOPTS -X GET -H 'Accept: application/yang-data+json' $RCPROTO://localhost/restconf/data/example-jukebox:jukebox/library/artist=Nick%20Cave%20and%20the%20Bad%20Seeds?fields=album\(year\)\;name)" 0 "HTTP/$HVER 200" '{"example-jukebox:artist":\[{"name":"Nick Cave and the Bad Seeds","album":\[{"name":"Tender Prey","year":1988},{"name":"The Good Son","year":1990}\]}\]}'
+
+new 'B.3.3.  "fields" Parameter invalid expression'
+expectpart "$(curl $CURLOPTS -X GET -H 'Accept: application/yang-data+json' $RCPROTO://localhost/restconf/data/example-jukebox:jukebox?fields=library\()" 0 "HTTP/$HVER 400" '"error-tag":"bad-attribute","error-info":{"bad-attribute":"fields"}'
+
+new 'B.3.3.  "fields" Parameter unknown node'
+expectpart "$(curl $CURLOPTS -X GET -H 'Accept: application/yang-data+json' $RCPROTO://localhost/restconf/data/example-jukebox:jukebox?fields=xxx)" 0 "HTTP/$HVER 400" '"error-tag":"unknown-element"'
 
 new "restconf DELETE whole datastore"
 expectpart "$(curl $CURLOPTS -X DELETE $RCPROTO://localhost/restconf/data)" 0 "HTTP/$HVER 204"
 
-#new 'B.3.3.  "fields" Parameter'
 
 new 'B.3.4.  "insert" Parameter'
 JSON="{\"example-jukebox:song\":[{\"index\":1,\"id\":\"/example-jukebox:jukebox/library/artist[name='Foo Fighters']/album[name='Wasting Light']/song[name='Rope']\"}]}"
@@ -246,7 +256,6 @@ new 'B.3.5.  "insert/point" leaf-list check order (2,4,3,1)'
 expectpart "$(curl $CURLOPTS -X GET $RCPROTO://localhost/restconf/data/example-jukebox:extra -H 'Accept: application/yang-data+xml')" 0 "HTTP/$HVER 200" '<extra xmlns="http://example.com/ns/example-jukebox">2</extra><extra xmlns="http://example.com/ns/example-jukebox" xmlns:jbox="http://example.com/ns/example-jukebox">4</extra><extra xmlns="http://example.com/ns/example-jukebox">3</extra><extra xmlns="http://example.com/ns/example-jukebox">1</extra>'
 
 new "B.2.2.  Detect Datastore Resource Entity-Tag Change" # XXX done except entity-changed
-new 'B.3.3.  "fields" Parameter'
 new 'B.3.6.  "filter" Parameter'
 new 'B.3.7.  "start-time" Parameter'
 new 'B.3.8.  "stop-time" Parameter'
@@ -0,0 +1,121 @@
+#!/usr/bin/env bash
+# Native restconf TLS session resumption
+# Check that a client resumes its TLS session on a new connection, with session tickets
+# and with the server-side session cache, which is shared by several workers
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+# Only native mode with https
+if [ "${WITH_RESTCONF}" != "native" -o "${RCPROTO}" != https ]; then
+    if [ "$s" = $0 ]; then exit 0; else return 0; fi # skip
+fi
+
+APPNAME=example
+
+cfg=$dir/conf.xml
+fyang=$dir/example.yang
+sess=$dir/tls.sess
+
+cat <<EOF > $fyang
+module example{
+   yang-version 1.1;
+   namespace "urn:example:clixon";
+   prefix ex;
+   leaf x {
+      type string;
+   }
+}
+EOF
+
+# Create config with workers and TLS session options
+# 1: tls-session-tickets true or false
+function tlsconf()
+{
+    tickets=$1
+    RESTCONFIG=$(restconf_config none false | sed "s#<pretty>false</pretty>#<pretty>false</pretty><workers>4</workers><tls-session-tickets>$tickets</tls-session-tickets>#")
+    cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_FEATURE>clixon-restconf:allow-auth-none</CLICON_FEATURE> <!-- Use auth-type=none -->
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_BACKEND_REGEXP>example_backend.so$</CLICON_BACKEND_REGEXP>
+  <CLICON_RESTCONF_DIR>/usr/local/lib/$APPNAME/restconf</CLICON_RESTCONF_DIR>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+  $RESTCONFIG
+</clixon-config>
+EOF
+}
+
+# Connect several times, new connections are spread over the workers
+# 1: TLS version option to openssl s_client, eg -tls1_2
+function tlsresume()
+{
+    tlsv=$1
+    rm -f $sess
+    new "full handshake $tlsv"
+    expectpart "$(echo | openssl s_client $tlsv -connect localhost:443 -sess_out $sess 2>&1)" 0 "New, TLS"
+    for i in $(seq 1 4); do
+	new "resumed handshake $tlsv $i"
+	expectpart "$(echo | openssl s_client $tlsv -connect localhost:443 -sess_in $sess 2>&1)" 0 "Reused, TLS"
+    done
+}
+
+# Without tickets, sessions are resumed from the shared session cache
+for tickets in true false; do
+    tlsconf $tickets
+    new "test params: -f $cfg tickets:$tickets"
+    if [ $BE -ne 0 ]; then
+	new "kill old backend"
+	sudo clixon_backend -zf $cfg
+	if [ $? -ne 0 ]; then
+	    err
+	fi
+	new "start backend -s init -f $cfg"
+	start_backend -s init -f $cfg
+    fi
+
+    new "wait backend"
+    wait_backend
+
+    if [ $RC -ne 0 ]; then
+	new "kill old restconf daemon"
+	stop_restconf_pre
+
+	new "start restconf daemon"
+	start_restconf -f $cfg
+    fi
+
+    new "wait restconf"
+    wait_restconf
+
+    tlsresume -tls1_2
+    tlsresume -tls1_3
+
+    if [ $RC -ne 0 ]; then
+	new "Kill restconf daemon"
+	stop_restconf
+    fi
+
+    if [ $BE -ne 0 ]; then
+	new "Kill backend"
+	# Check if premature kill
+	pid=$(pgrep -u root -f clixon_backend)
+	if [ -z "$pid" ]; then
+	    err "backend already dead"
+	fi
+	# kill backend
+	stop_backend -f $cfg
+    fi
+done
+
+# Set by restconf_config
+unset RESTCONFIG
+
+rm -rf $dir
+
+new "endtest"
+endtest
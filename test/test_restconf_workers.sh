@@ -0,0 +1,140 @@
+#!/usr/bin/env bash
+# Restconf with several worker processes, native and fcgi
+# Check that a master and the workers are started, that requests are served,
+# that a killed worker is restarted, and that all processes terminate
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf.xml
+fyang=$dir/example.yang
+
+# Number of restconf workers
+nworkers=4
+
+cat <<EOF > $fyang
+module example{
+   yang-version 1.1;
+   namespace "urn:example:clixon";
+   prefix ex;
+   container x {
+    list y {
+      key "a";
+      leaf a {
+        type string;
+      }
+      leaf b {
+        type string;
+      }
+    }
+  }
+}
+EOF
+
+# Default restconf config with workers added
+RESTCONFIG=$(restconf_config none false | sed "s#<pretty>false</pretty>#<pretty>false</pretty><workers>$nworkers</workers>#")
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_FEATURE>clixon-restconf:allow-auth-none</CLICON_FEATURE> <!-- Use auth-type=none -->
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_BACKEND_REGEXP>example_backend.so$</CLICON_BACKEND_REGEXP>
+  <CLICON_RESTCONF_DIR>/usr/local/lib/$APPNAME/restconf</CLICON_RESTCONF_DIR>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+  $RESTCONFIG
+</clixon-config>
+EOF
+
+new "test params: -f $cfg"
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+	err
+    fi
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+fi
+
+new "wait backend"
+wait_backend
+
+if [ $RC -ne 0 ]; then
+    new "kill old restconf daemon"
+    stop_restconf_pre
+
+    new "start restconf daemon"
+    start_restconf -f $cfg
+fi
+
+new "wait restconf"
+wait_restconf
+
+new "check master and $nworkers workers"
+sleep $DEMSLEEP
+nproc=$(pgrep -f "clixon_restconf.*$cfg" | wc -l)
+if [ $nproc -lt $((nworkers+1)) ]; then
+    err "$((nworkers+1)) restconf processes" "$nproc"
+fi
+
+# Several requests, on new connections each, spread over the workers
+for i in $(seq 1 10); do
+    new "restconf put $i"
+    expectpart "$(curl $CURLOPTS -X PUT -H "Content-Type: application/yang-data+json" $RCPROTO://localhost/restconf/data/example:x/y=$i -d "{\"example:y\":{\"a\":\"$i\",\"b\":\"$i\"}}")" 0 "HTTP/$HVER 201"
+done
+
+for i in $(seq 1 10); do
+    new "restconf get $i"
+    expectpart "$(curl $CURLOPTS -X GET $RCPROTO://localhost/restconf/data/example:x/y=$i)" 0 "HTTP/$HVER 200" "{\"example:y\":\[{\"a\":\"$i\",\"b\":\"$i\"}\]}"
+done
+
+if [ $RC -ne 0 ]; then
+    new "kill one worker"
+    pid=$(pgrep -n -f "clixon_restconf.*$cfg")
+    sudo kill -9 $pid
+
+    new "check worker restarted"
+    sleep 2
+    nproc=$(pgrep -f "clixon_restconf.*$cfg" | wc -l)
+    if [ $nproc -lt $((nworkers+1)) ]; then
+	err "$((nworkers+1)) restconf processes" "$nproc"
+    fi
+
+    new "restconf get after restart"
+    expectpart "$(curl $CURLOPTS -X GET $RCPROTO://localhost/restconf/data/example:x/y=1)" 0 "HTTP/$HVER 200"
+
+    new "Kill restconf daemon"
+    stop_restconf
+
+    new "check all workers terminated"
+    sleep $DEMSLEEP
+    nproc=$(pgrep -f "clixon_restconf.*$cfg" | wc -l)
+    if [ $nproc -ne 0 ]; then
+	err "0 restconf processes" "$nproc"
+    fi
+fi
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+	err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+# Set by restconf_config
+unset RESTCONFIG
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -1,121 +1,47 @@
 #!/usr/bin/env bash
-# Restconf RFC8072 yang patch 
-# XXX enable YANG_PACTH in include/clixon_custom.h to run this test
-# Use nacm module in example/main/example_restconf.c hardcoded to
-# andy:bar and wilma:bar
+# Restconf RFC8072 yang patch
+# All edits of a patch are applied in one transaction: check success and errors,
+# that no edit is applied if one fails, and insert/move in ordered-by user leaf-lists
+# Overlapping edits are applied in patch order
 
 # Magic line must be first in script (see README.md)
 s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
 
-echo "...skipped: YANG_PATCH NYI"
-if [ "$s" = $0 ]; then exit 0; else return 0; fi
-    
 APPNAME=example
-    
+
 cfg=$dir/conf.xml
-startupdb=$dir/startup_db
 fjukebox=$dir/example-jukebox.yang
-    
+
 # Define default restconfig config: RESTCONFIG
-RESTCONFIG=$(restconf_config user false)
+RESTCONFIG=$(restconf_config none false)
 
 cat <<EOF > $cfg
 <clixon-config xmlns="http://clicon.org/config">
   <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_FEATURE>clixon-restconf:allow-auth-none</CLICON_FEATURE> <!-- Use auth-type=none -->
   <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
   <CLICON_YANG_DIR>$IETFRFC</CLICON_YANG_DIR>
-  <CLICON_YANG_MAIN_DIR>$dir</CLICON_YANG_MAIN_DIR>
+  <CLICON_YANG_MAIN_FILE>$fjukebox</CLICON_YANG_MAIN_FILE>
   <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
-  <CLICON_FEATURE>ietf-netconf:startup</CLICON_FEATURE>
   <CLICON_RESTCONF_DIR>/usr/local/lib/$APPNAME/restconf</CLICON_RESTCONF_DIR>
   <CLICON_BACKEND_PIDFILE>$dir/restconf.pidfile</CLICON_BACKEND_PIDFILE>
   <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
-  <CLICON_NACM_MODE>internal</CLICON_NACM_MODE>
-  <CLICON_NACM_DISABLED_ON_EMPTY>true</CLICON_NACM_DISABLED_ON_EMPTY>
   $RESTCONFIG
 </clixon-config>
 EOF
 
-NACM0="<nacm xmlns=\"urn:ietf:params:xml:ns:yang:ietf-netconf-acm\">
-     <enable-nacm>true</enable-nacm>
-     <read-default>deny</read-default>
-     <write-default>deny</write-default>
-     <exec-default>permit</exec-default>
-   <groups>
-       <group>
-         <name>admin</name>
-         <user-name>andy</user-name>
-       </group>
-       <group>
-         <name>limited</name>
-         <user-name>wilma</user-name>
-       </group>
-   </groups>
-   <rule-list>
-       <name>admin</name>
-       <group>admin</group>
-       <rule>
-         <name>permit-all</name>
-         <module-name>*</module-name>
-         <access-operations>*</access-operations>
-         <action>permit</action>
-         <comment>
-             Allow the 'admin' group complete access to all operations and data.
-         </comment>
-       </rule>
-   </rule-list>
-   <rule-list>
-       <name>limited</name>
-       <group>limited</group>
-       <rule>
-         <name>limit-jukebox</name>
-         <module-name>jukebox-example</module-name>
-         <access-operations>read create delete</access-operations>
-         <action>deny</action>
-       </rule>
-   </rule-list>
- </nacm>
-"
-
-cat<<EOF > $startupdb
-<${DATASTORE_TOP}>
-   $NACM0
-</${DATASTORE_TOP}>
-EOF
-
-# An extra testmodule that includes nacm
-cat <<EOF > $dir/example-system.yang
-   module example-system {
-      namespace "http://example.com/ns/example-system";
-      prefix "ex";
-      import ietf-netconf-acm {
-	prefix nacm;
-      }
-      container system {
-        leaf enable-jukebox-streaming {
-          type boolean;
-        }
-        leaf extraleaf {
-          type string;
-        }
-      }
-   }
-EOF
-
 # Common Jukebox spec (fjukebox must be set)
 . ./jukebox.sh
 
-new "test params: -s startup -f $cfg"
+new "test params: -s init -f $cfg"
 if [ $BE -ne 0 ]; then
     new "kill old backend"
     sudo clixon_backend -zf $cfg
     if [ $? -ne 0 ]; then
 	err
     fi
-    sudo pkill -f clixon_backend # to be sure
-
-    new "start backend -s startup -f $cfg"
-    start_backend -s startup -f $cfg
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
 fi
 
 new "wait backend"
@@ -132,7 +58,12 @@ fi
 new "wait restconf"
 wait_restconf
 
-# RFC 8072 A.1.1 
+ALBUM=$RCPROTO://localhost/restconf/data/example-jukebox:jukebox/library/artist=Foo%20Fighters/album=Wasting%20Light
+
+new "restconf add album"
+expectpart "$(curl $CURLOPTS -X PUT -H 'Content-Type: application/yang-data+json' $ALBUM -d '{"example-jukebox:album":[{"name":"Wasting Light"}]}')" 0 "HTTP/$HVER 201"
+
+# RFC 8072 A.1.1
 REQ='<yang-patch xmlns="urn:ietf:params:xml:ns:yang:ietf-yang-patch">
         <patch-id>add-songs-patch</patch-id>
         <edit>
@@ -161,24 +92,99 @@ REQ='<yang-patch xmlns="urn:ietf:params:xml:ns:yang:ietf-yang-patch">
             </song>
           </value>
         </edit>
+      </yang-patch>'
+
+new "yang patch xml create two songs"
+expectpart "$(curl $CURLOPTS -X PATCH -H 'Content-Type: application/yang-patch+xml' -H 'Accept: application/yang-data+xml' $ALBUM -d "$REQ")" 0 "HTTP/$HVER 200" '<yang-patch-status xmlns="urn:ietf:params:xml:ns:yang:ietf-yang-patch"><patch-id>add-songs-patch</patch-id><ok/></yang-patch-status>'
+
+new "check song created"
+expectpart "$(curl $CURLOPTS -X GET $ALBUM/song=Rope)" 0 "HTTP/$HVER 200" '{"example-jukebox:song":\[{"name":"Rope","location":"/media/rope.mp3","format":"MP3","length":259}\]}'
+
+REQ='<yang-patch xmlns="urn:ietf:params:xml:ns:yang:ietf-yang-patch">
+        <patch-id>add-songs-patch2</patch-id>
         <edit>
-          <edit-id>edit3</edit-id>
+          <edit-id>edit1</edit-id>
           <operation>create</operation>
           <target>/song=Dear%20Rosemary</target>
           <value>
             <song xmlns="http://example.com/ns/example-jukebox">
               <name>Dear Rosemary</name>
               <location>/media/dear_rosemary.mp3</location>
-              <format>MP3</format>
-              <length>269</length>
+            </song>
+          </value>
+        </edit>
+        <edit>
+          <edit-id>edit2</edit-id>
+          <operation>create</operation>
+          <target>/song=Rope</target>
+          <value>
+            <song xmlns="http://example.com/ns/example-jukebox">
+              <name>Rope</name>
+              <location>/media/rope.mp3</location>
             </song>
           </value>
         </edit>
       </yang-patch>'
 
-new "RFC 8072 A.1.1 Add resources: Error."
-expectpart "$(curl -u andy:bar $CURLOPTS -X PATCH -H 'Content-Type: application/yang-patch+xml' -H 'Accept: application/yang-data+xml' $RCPROTO://localhost/restconf/data/example-jukebox:jukebox/library/artist=Foo%20Fighters/album=Wasting%20Light -d "$REQ")" 0 "HTTP/$HVER 409"
+new "yang patch create existing song: error"
+expectpart "$(curl $CURLOPTS -X PATCH -H 'Content-Type: application/yang-patch+xml' -H 'Accept: application/yang-data+xml' $ALBUM -d "$REQ")" 0 "HTTP/$HVER 409" '<yang-patch-status xmlns="urn:ietf:params:xml:ns:yang:ietf-yang-patch"><patch-id>add-songs-patch2</patch-id><errors><error>' '<error-tag>data-exists</error-tag>'
+
+new "check no edit of failed patch applied"
+expectpart "$(curl $CURLOPTS -X GET $ALBUM/song=Dear%20Rosemary)" 0 "HTTP/$HVER 404"
+
+new "yang patch value does not match target: edit error"
+expectpart "$(curl $CURLOPTS -X PATCH -H 'Content-Type: application/yang-patch+json' $ALBUM -d '{"ietf-yang-patch:yang-patch":{"patch-id":"p1","edit":[{"edit-id":"e1","operation":"create","target":"/song=Times%20Like%20These","value":{"example-jukebox:album":[{"name":"x"}]}}]}}')" 0 "HTTP/$HVER 400" '{"ietf-yang-patch:yang-patch-status":{"patch-id":"p1","edit-status":{"edit":\[{"edit-id":"e1","errors":{"error":\[{"error-type":"application","error-tag":"bad-element"'
+
+new "yang patch json merge and delete"
+expectpart "$(curl $CURLOPTS -X PATCH -H 'Content-Type: application/yang-patch+json' $ALBUM -d '{"ietf-yang-patch:yang-patch":{"patch-id":"p2","edit":[{"edit-id":"e1","operation":"merge","target":"/song=Rope","value":{"example-jukebox:song":[{"name":"Rope","length":300}]}},{"edit-id":"e2","operation":"delete","target":"/song=Bridge%20Burning"}]}}')" 0 "HTTP/$HVER 200" '{"ietf-yang-patch:yang-patch-status":{"patch-id":"p2","ok":\[null\]}}'
+
+new "check merge and delete"
+expectpart "$(curl $CURLOPTS -X GET $ALBUM)" 0 "HTTP/$HVER 200" '{"example-jukebox:album":\[{"name":"Wasting Light","song":\[{"name":"Rope","location":"/media/rope.mp3","format":"MP3","length":300}\]}\]}'
+
+new "yang patch delete non-existing: error"
+expectpart "$(curl $CURLOPTS -X PATCH -H 'Content-Type: application/yang-patch+json' $ALBUM -d '{"ietf-yang-patch:yang-patch":{"patch-id":"p3","edit":[{"edit-id":"e1","operation":"delete","target":"/song=Bridge%20Burning"}]}}')" 0 "HTTP/$HVER 409" '"error-tag":"data-missing"'
+
+new "yang patch remove non-existing"
+expectpart "$(curl $CURLOPTS -X PATCH -H 'Content-Type: application/yang-patch+json' $ALBUM -d '{"ietf-yang-patch:yang-patch":{"patch-id":"p4","edit":[{"edit-id":"e1","operation":"remove","target":"/song=Bridge%20Burning"}]}}')" 0 "HTTP/$HVER 200" '"ok":\[null\]'
+
+new "yang patch same target twice: applied in order"
+expectpart "$(curl $CURLOPTS -X PATCH -H 'Content-Type: application/yang-patch+json' $ALBUM -d '{"ietf-yang-patch:yang-patch":{"patch-id":"p5","edit":[{"edit-id":"e1","operation":"merge","target":"/song=Rope","value":{"example-jukebox:song":[{"name":"Rope","length":310}]}},{"edit-id":"e2","operation":"merge","target":"/song=Rope","value":{"example-jukebox:song":[{"name":"Rope","length":320}]}}]}}')" 0 "HTTP/$HVER 200" '"ok":\[null\]'
+
+new "check last edit of same target applied"
+expectpart "$(curl $CURLOPTS -X GET $ALBUM/song=Rope/length)" 0 "HTTP/$HVER 200" '{"example-jukebox:length":320}'
+
+LIBRARY=$RCPROTO://localhost/restconf/data/example-jukebox:jukebox/library
+
+new "yang patch delete entry, then merge child of it"
+expectpart "$(curl $CURLOPTS -X PATCH -H 'Content-Type: application/yang-patch+json' $LIBRARY -d '{"ietf-yang-patch:yang-patch":{"patch-id":"p8","edit":[{"edit-id":"e1","operation":"delete","target":"/artist=Foo%20Fighters"},{"edit-id":"e2","operation":"merge","target":"/artist=Foo%20Fighters/album=Greatest","value":{"example-jukebox:album":[{"name":"Greatest"}]}}]}}')" 0 "HTTP/$HVER 200" '"ok":\[null\]'
+
+new "check entry replaced by merged child"
+expectpart "$(curl $CURLOPTS -X GET $LIBRARY/artist=Foo%20Fighters)" 0 "HTTP/$HVER 200" '{"example-jukebox:artist":\[{"name":"Foo Fighters","album":\[{"name":"Greatest"}\]}\]}'
+
+new "yang patch merge child, then delete ancestor"
+expectpart "$(curl $CURLOPTS -X PATCH -H 'Content-Type: application/yang-patch+json' $LIBRARY -d '{"ietf-yang-patch:yang-patch":{"patch-id":"p9","edit":[{"edit-id":"e1","operation":"merge","target":"/artist=Foo%20Fighters/album=Greatest","value":{"example-jukebox:album":[{"name":"Greatest","year":2009}]}},{"edit-id":"e2","operation":"delete","target":"/artist=Foo%20Fighters"}]}}')" 0 "HTTP/$HVER 200" '"ok":\[null\]'
+
+new "check ancestor deleted"
+expectpart "$(curl $CURLOPTS -X GET $LIBRARY/artist=Foo%20Fighters)" 0 "HTTP/$HVER 404"
+
+new "yang patch overlapping edits with failing edit: edit error"
+expectpart "$(curl $CURLOPTS -X PATCH -H 'Content-Type: application/yang-patch+json' $LIBRARY -d '{"ietf-yang-patch:yang-patch":{"patch-id":"p10","edit":[{"edit-id":"e1","operation":"create","target":"/artist=Nirvana","value":{"example-jukebox:artist":[{"name":"Nirvana"}]}},{"edit-id":"e2","operation":"merge","target":"/artist=Nirvana/album=Nevermind","value":{"example-jukebox:album":[{"name":"Nevermind"}]}},{"edit-id":"e3","operation":"delete","target":"/artist=Nobody"}]}}')" 0 "HTTP/$HVER 409" '"edit-id":"e3"' '"error-tag":"data-missing"'
+
+new "check no overlapping edit of failed patch applied"
+expectpart "$(curl $CURLOPTS -X GET $LIBRARY/artist=Nirvana)" 0 "HTTP/$HVER 404"
+
+# Ordered-by user leaf-list, target resource is the datastore
+new "yang patch create and insert in leaf-list"
+expectpart "$(curl $CURLOPTS -X PATCH -H 'Content-Type: application/yang-patch+json' $RCPROTO://localhost/restconf/data -d '{"ietf-yang-patch:yang-patch":{"patch-id":"p6","edit":[{"edit-id":"e1","operation":"create","target":"/example-jukebox:extra=a","value":{"example-jukebox:extra":["a"]}},{"edit-id":"e2","operation":"create","target":"/example-jukebox:extra=b","value":{"example-jukebox:extra":["b"]}},{"edit-id":"e3","operation":"insert","target":"/example-jukebox:extra=c","where":"before","point":"/example-jukebox:extra=b","value":{"example-jukebox:extra":["c"]}}]}}')" 0 "HTTP/$HVER 200" '"ok":\[null\]'
+
+new "check leaf-list order"
+expectpart "$(curl $CURLOPTS -X GET $RCPROTO://localhost/restconf/data/example-jukebox:extra)" 0 "HTTP/$HVER 200" '{"example-jukebox:extra":\["a","c","b"\]}'
+
+new "yang patch move in leaf-list"
+expectpart "$(curl $CURLOPTS -X PATCH -H 'Content-Type: application/yang-patch+json' $RCPROTO://localhost/restconf/data -d '{"ietf-yang-patch:yang-patch":{"patch-id":"p7","edit":[{"edit-id":"e1","operation":"move","target":"/example-jukebox:extra=a","where":"last"}]}}')" 0 "HTTP/$HVER 200" '"ok":\[null\]'
 
+new "check leaf-list order after move"
+expectpart "$(curl $CURLOPTS -X GET $RCPROTO://localhost/restconf/data/example-jukebox:extra)" 0 "HTTP/$HVER 200" '{"example-jukebox:extra":\["c","b","a"\]}'
 
 if [ $RC -ne 0 ]; then
     new "Kill restconf daemon"
@@ -0,0 +1,156 @@
+#!/usr/bin/env bash
+# Replay store of event streams, RFC5277 startTime/stopTime
+# The example backend sends an EXAMPLE event every 5s. The store keeps two events in a
+# memory-mapped file, so that the oldest is dropped and events survive a restart.
+# A store that is not consistent is discarded.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf.xml
+fyang=$dir/stream.yang
+replayfile=$dir/EXAMPLE.replay
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_DIR>$IETFRFC</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_BACKEND_REGEXP>example_backend.so$</CLICON_BACKEND_REGEXP>
+  <CLICON_BACKEND_PIDFILE>$dir/restconf.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  <CLICON_STREAM_DISCOVERY_RFC5277>true</CLICON_STREAM_DISCOVERY_RFC5277>
+  <CLICON_STREAM_RETENTION>3600</CLICON_STREAM_RETENTION>
+  <CLICON_STREAM_REPLAY_MAX>2</CLICON_STREAM_REPLAY_MAX>
+  <CLICON_STREAM_REPLAY_DIR>$dir</CLICON_STREAM_REPLAY_DIR>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module example {
+   namespace "urn:example:clixon";
+   prefix ex;
+   notification event {
+      leaf event-class {
+         type string;
+      }
+      container reportingEntity {
+         leaf card {
+            type string;
+         }
+      }
+      leaf severity {
+         type string;
+      }
+   }
+}
+EOF
+
+# Replay EXAMPLE events from start to stop and print their eventTimes
+# Live events are not sent since stop has passed
+function replay(){
+    start=$1
+    stop=$2
+    if [ -n "$stop" ]; then
+	stop="<stopTime>$stop</stopTime>"
+    fi
+    (printf "%s" "$DEFAULTHELLO<rpc $DEFAULTNS><create-subscription xmlns=\"urn:ietf:params:xml:ns:netmod:notification\"><stream>EXAMPLE</stream><startTime>$start</startTime>$stop</create-subscription></rpc>]]>]]>"; sleep 1) | $clixon_netconf -qf $cfg | grep -o "<eventTime>[^<]*</eventTime>" | sed 's/<[^>]*>//g'
+}
+
+new "test params: -f $cfg"
+
+rm -f $replayfile
+T0=$(date -u +"%Y-%m-%dT%H:%M:%SZ")
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+	err
+    fi
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+fi
+
+new "waiting"
+wait_backend
+
+new "wait for three events"
+sleep 17
+STOP=$(date -u +"%Y-%m-%dT%H:%M:%SZ")
+
+new "replay keeps the two newest events"
+ret=$(replay $T0 $STOP)
+if [ $(echo "$ret" | grep -c .) -ne 2 ]; then
+    err "2 events" "$ret"
+fi
+E1=$(echo "$ret" | sed -n 1p)
+E2=$(echo "$ret" | sed -n 2p)
+
+new "replay with startTime of newest event"
+ret=$(replay $E2 $STOP)
+if [ "$ret" != "$E2" ]; then
+    err "$E2" "$ret"
+fi
+
+new "replay with stopTime of oldest event"
+ret=$(replay $T0 $E1)
+if [ "$ret" != "$E1" ]; then
+    err "$E1" "$ret"
+fi
+
+if [ $BE -ne 0 ]; then
+    new "restart backend"
+    stop_backend -f $cfg
+    start_backend -s running -f $cfg
+fi
+
+new "waiting"
+wait_backend
+
+new "replay after restart"
+ret=$(replay $T0 $STOP)
+if [ "$ret" != "$E1
+$E2" ]; then
+    err "$E1 $E2" "$ret"
+fi
+
+if [ $BE -ne 0 ]; then
+    stop_backend -f $cfg
+    new "corrupt length of stored events"
+    # Header is 48 bytes, followed by index entries of 32 bytes with length at offset 24
+    for off in 72 104; do
+	printf '\377\377\377\377\377\377\377\377' | dd of=$replayfile bs=1 seek=$off conv=notrunc 2> /dev/null
+    done
+    start_backend -s running -f $cfg
+fi
+
+new "waiting"
+wait_backend
+
+new "replay of corrupt store is empty"
+ret=$(replay $T0 $STOP)
+if [ -n "$ret" ]; then
+    err "" "$ret"
+fi
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+	err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -136,6 +136,40 @@ regex_posix(char *regexp,
     return retval;
 }
 
+/*! Built-in dfa regex implementation
+ * @retval -1   Error
+ * @retval  0   Not match
+ * @retval  1   Match
+ */
+static int
+regex_dfa(char *regexp,
+	  char *content,
+	  int   nr,
+	  int   debug)
+{
+    int   retval = -1;
+    void *re = NULL;
+    int   ret = 0;
+    int   i;
+
+    if ((ret = regex_dfa_compile(&regexp, NULL, 1, &re)) <= 0){
+	retval = ret;
+	goto done;
+    }
+    if (nr==0){
+	retval = 1;
+	goto done;
+    }
+    for (i=0; i<nr; i++)
+	if ((ret = regex_dfa_exec(re, content)) < 0)
+	    break;
+    retval = ret;
+ done:
+    if (re)
+	regex_dfa_free(re);
+    return retval;
+}
+
 static int
 usage(char *argv0)
 {
@@ -145,6 +179,7 @@ usage(char *argv0)
     	    "\t-D <level>\tDebug\n"
 	    "\t-p          \txsd->posix translation regexp (default)\n"
 	    "\t-x          \tlibxml2 regexp (alternative to -p)\n"
+	    "\t-d          \tbuilt-in dfa regexp (alternative to -p)\n"
 	    "\t-n <nr>     \tIterate content match (default: 1, 0: no match only compile)\n"
 	    "\t-r <regexp> \tregexp (mandatory)\n"
 	    "\t-c <string> \tValue content string(mandatory if -n > 0)\n",
@@ -164,12 +199,12 @@ main(int    argc,
     char       *content = NULL;
     int         ret = 0;
     int         nr = 1;
-    int         mode = 0; /* 0 is posix, 1 is libxml */
+    int         mode = 0; /* 0 is posix, 1 is libxml, 2 is dfa */
     int         dbg = 0;
 
     optind = 1;
     opterr = 0;
-    while ((c = getopt(argc, argv, "hD:pxn:r:c:")) != -1)
+    while ((c = getopt(argc, argv, "hD:pxdn:r:c:")) != -1)
 	switch (c) {
 	case 'h':
 	    usage(argv0);
@@ -188,6 +223,9 @@ main(int    argc,
 	case 'x': /* libxml2 */
 	    mode = 1;
 	    break;
+	case 'd': /* built-in dfa */
+	    mode = 2;
+	    break;
 	case 'r': /* regexp */
 	    regexp = optarg;
 	    break;
@@ -209,8 +247,8 @@ main(int    argc,
 	fprintf(stderr, "-c mandatory (if -n > 0)\n");
 	usage(argv0);
     }
-    if (mode != 0 && mode != 1){
-	fprintf(stderr, "Neither posix or libxml2 set\n");
+    if (mode != 0 && mode != 1 && mode != 2){
+	fprintf(stderr, "Neither posix, libxml2 or dfa set\n");
 	usage(argv0);
     }
     clicon_debug(1, "regexp:%s", regexp);
@@ -224,6 +262,10 @@ main(int    argc,
 	if ((ret = regex_libxml2(regexp, content, nr, dbg)) < 0)
 	    goto done;
     }
+    else if (mode == 2){
+	if ((ret = regex_dfa(regexp, content, nr, dbg)) < 0)
+	    goto done;
+    }
     else
 	usage(argv0);
     fprintf(stdout, "%d\n", ret);